@@ -75,6 +75,16 @@ public:
    */
   virtual SysCallSizeResult recv(int socket, void* buffer, size_t length, int flags) PURE;
 
+  /**
+   * @see recvmsg (man 2 recvmsg)
+   */
+  virtual SysCallSizeResult recvmsg(int socket, msghdr* message, int flags) PURE;
+
+  /**
+   * @see sendmsg (man 2 sendmsg)
+   */
+  virtual SysCallSizeResult sendmsg(int socket, const msghdr* message, int flags) PURE;
+
   /**
    * Release all resources allocated for fd.
    * @return zero on success, -1 returned otherwise.
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -17,6 +18,7 @@
 #include "envoy/network/listen_socket.h"
 #include "envoy/network/listener.h"
 #include "envoy/network/transport_socket.h"
+#include "envoy/stats/scope.h"
 #include "envoy/thread/thread.h"
 
 namespace Envoy {
@@ -27,6 +29,20 @@ namespace Event {
  */
 typedef std::function<void()> PostCb;
 
+/**
+ * A callback which ran for longer than the slow callback threshold of its dispatcher.
+ */
+struct SlowCallback {
+  // Kind of event which ran the callback: "file_event", "timer", "signal" or "post".
+  std::string kind_;
+  // Type of the callback, which names the function defining it for a lambda, followed by the file
+  // descriptor for a file event.
+  std::string description_;
+  std::chrono::microseconds duration_;
+  // When the callback returned.
+  SystemTime time_;
+};
+
 /**
  * Abstract event dispatching loop.
  */
@@ -116,6 +132,15 @@ public:
    */
   virtual Event::TimerPtr createTimer(TimerCb cb) PURE;
 
+  /**
+   * Allocate a coarse timer, for timeouts which are re-armed much more often than they fire, such
+   * as idle and request timeouts. A coarse timer is cheaper to arm and disarm than a timer from
+   * createTimer(), but may fire up to a few milliseconds late. @see Timer for docs on how to use
+   * the timer.
+   * @param cb supplies the callback to invoke when the timer fires.
+   */
+  virtual Event::TimerPtr createCoarseTimer(TimerCb cb) PURE;
+
   /**
    * Submit an item for deferred delete. @see DeferredDeletable.
    */
@@ -152,6 +177,24 @@ public:
   enum class RunType { Block, NonBlock };
   virtual void run(RunType type) PURE;
 
+  /**
+   * Start recording statistics of the event loop: for each iteration, the time spent waiting for
+   * events, the time spent running their callbacks, and the number of callbacks run, as well as
+   * the number of posted callbacks run together. Callbacks running for longer than the slow
+   * callback threshold are counted and kept for recentSlowCallbacks(). Must be called before run().
+   * @param scope supplies the scope in which the statistics are created.
+   * @param prefix supplies the prefix of the statistics, e.g. "worker_0.".
+   * @param slow_callback_threshold supplies the duration above which a callback is slow.
+   */
+  virtual void initializeStats(Stats::Scope& scope, const std::string& prefix,
+                               std::chrono::milliseconds slow_callback_threshold) PURE;
+
+  /**
+   * @return std::vector<SlowCallback> the most recent slow callbacks, most recent first. This is
+   *         safe cross thread.
+   */
+  virtual std::vector<SlowCallback> recentSlowCallbacks() const PURE;
+
   /**
    * Returns a factory which connections may use for watermark buffer creation.
    * @return the watermark buffer factory for this dispatcher.
@@ -95,6 +95,14 @@ public:
    */
   virtual void drainConnections() PURE;
 
+  /**
+   * Open the warm connections of the cluster to the host of the pool, see
+   * Upstream::ClusterInfo::warmConnections(), unless the pool already has enough connections. This
+   * is used when the host joins the cluster, so that its first streams do not wait for
+   * connections to be established.
+   */
+  virtual void warmUp() PURE;
+
   /**
    * Create a new stream on the pool.
    * @param response_decoder supplies the decoder events to fire when the response is
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "envoy/common/pure.h"
+#include "envoy/network/listen_socket.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * A connection handler of a listener on one worker, which a connection balancer can pick to own
+ * new connections.
+ */
+class BalancedConnectionHandler {
+public:
+  virtual ~BalancedConnectionHandler() {}
+
+  /**
+   * @return uint64_t the number of connections owned by the handler, including the sockets that
+   *         have been picked for it but not yet received. This may be called from any thread.
+   */
+  virtual uint64_t numConnections() const PURE;
+
+  /**
+   * Account for a socket picked for the handler until it receives it. This may be called from any
+   * thread.
+   */
+  virtual void incNumConnections() PURE;
+
+  /**
+   * Hand an accepted socket to the handler, which creates the connection on its own thread. This is
+   * called by the connection balancer from any thread, while the handler is registered.
+   * @param socket supplies the accepted socket.
+   */
+  virtual void post(ConnectionSocketPtr&& socket) PURE;
+};
+
+/**
+ * Balances the connections accepted by a listener across the handlers of the listener on every
+ * worker. The balancer is shared by all workers, and so must be thread safe.
+ */
+class ConnectionBalancer {
+public:
+  virtual ~ConnectionBalancer() {}
+
+  /**
+   * Register a handler, which may then be picked to own connections.
+   * @param handler supplies the handler to register.
+   */
+  virtual void registerHandler(BalancedConnectionHandler& handler) PURE;
+
+  /**
+   * Unregister a handler, after which it is no longer picked nor posted to, so that it may be
+   * destroyed. Unregistering a handler which is not registered has no effect.
+   * @param handler supplies the handler to unregister.
+   */
+  virtual void unregisterHandler(BalancedConnectionHandler& handler) PURE;
+
+  /**
+   * Pick the handler which should own a connection accepted by a handler, and call
+   * incNumConnections() on it. If another handler is picked, the socket is posted to it before it
+   * can be unregistered, since its worker may destroy it as soon as it is.
+   * @param current_handler supplies the handler which accepted the connection.
+   * @param socket supplies the accepted socket, which is moved if posted to another handler.
+   * @return bool whether the socket was posted to another handler. Otherwise the connection is
+   *         owned by the current handler.
+   */
+  virtual bool balanceConnection(BalancedConnectionHandler& current_handler,
+                                 ConnectionSocketPtr& socket) PURE;
+};
+
+typedef std::unique_ptr<ConnectionBalancer> ConnectionBalancerPtr;
+
+} // namespace Network
+} // namespace Envoy
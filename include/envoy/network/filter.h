@@ -2,11 +2,14 @@
 
 #include <memory>
 
+#include "envoy/api/os_sys_calls.h"
 #include "envoy/buffer/buffer.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/network/transport_socket.h"
 #include "envoy/upstream/host_description.h"
 
+#include "absl/strings/string_view.h"
+
 namespace Envoy {
 
 namespace Event {
@@ -168,6 +171,39 @@ public:
  */
 typedef std::function<void(FilterManager& filter_manager)> FilterFactoryCb;
 
+/**
+ * Bytes received on an accepted socket before its connection is created, shared by the listener
+ * filters of the socket. Each byte is read from the socket once, and the bytes which are not
+ * drained are kept by the socket, see ConnectionSocket::preReadData(), for the filters that come
+ * later and for the transport socket of the connection.
+ */
+class ListenerFilterBuffer {
+public:
+  virtual ~ListenerFilterBuffer() {}
+
+  /**
+   * Read the bytes available on the socket, after the buffered bytes.
+   * @param max_length supplies the maximum number of bytes to buffer.
+   * @return Api::SysCallIntResult the result of the read. On success, rc_ is the number of bytes
+   *         read, which is 0 if max_length bytes are already buffered or if the peer closed the
+   *         socket.
+   */
+  virtual Api::SysCallIntResult readFromSocket(uint64_t max_length) PURE;
+
+  /**
+   * @return absl::string_view the buffered bytes. The view is invalidated by readFromSocket() and
+   *         drain().
+   */
+  virtual absl::string_view data() PURE;
+
+  /**
+   * Remove bytes from the front of the buffer, so that the filters that come later and the
+   * transport socket of the connection do not see them.
+   * @param length supplies the number of bytes to remove, at most the number of buffered bytes.
+   */
+  virtual void drain(uint64_t length) PURE;
+};
+
 /**
  * Callbacks used by individual listener filter instances to communicate with the listener filter
  * manager.
@@ -186,6 +222,12 @@ public:
    */
   virtual Event::Dispatcher& dispatcher() PURE;
 
+  /**
+   * @return ListenerFilterBuffer& the bytes received on the socket, shared with the other
+   *         listener filters of the socket.
+   */
+  virtual ListenerFilterBuffer& buffer() PURE;
+
   /**
    * If a filter stopped filter iteration by returning FilterStatus::StopIteration,
    * the filter should call continueFilterChain(true) when complete to continue the filter chain,
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "envoy/api/v2/core/base.pb.h"
+#include "envoy/buffer/buffer.h"
 #include "envoy/common/exception.h"
 #include "envoy/common/pure.h"
 #include "envoy/network/address.h"
@@ -171,6 +172,13 @@ public:
    * @return requested server name (e.g. SNI in TLS), if any.
    */
   virtual absl::string_view requestedServerName() const PURE;
+
+  /**
+   * @return Buffer::Instance& the bytes read from the socket by the listener filters, before the
+   *         connection of the socket is created. The transport socket of the connection processes
+   *         them before reading from the socket.
+   */
+  virtual Buffer::Instance& preReadData() PURE;
 };
 
 typedef std::unique_ptr<ConnectionSocket> ConnectionSocketPtr;
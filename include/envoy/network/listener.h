@@ -6,6 +6,7 @@
 
 #include "envoy/common/exception.h"
 #include "envoy/network/connection.h"
+#include "envoy/network/connection_balancer.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/stats/scope.h"
 
@@ -87,6 +88,12 @@ public:
   // TODO(qiannawang): this method is deprecated and to be moved soon. See
   // https://github.com/envoyproxy/envoy/pull/4889 for more details.
   virtual bool reverseWriteFilterOrder() const PURE;
+
+  /**
+   * @return ConnectionBalancer& the balancer picking which worker owns each connection accepted
+   *         by the listener.
+   */
+  virtual ConnectionBalancer& connectionBalancer() PURE;
 };
 
 /**
@@ -75,6 +75,13 @@ public:
    * @param event supplies the connection event
    */
   virtual void raiseEvent(ConnectionEvent event) PURE;
+
+  /**
+   * @return Buffer::Instance& the bytes read from the socket before the connection was created, by
+   *         the listener filters of a server connection. The transport socket drains them before
+   *         reading from fd().
+   */
+  virtual Buffer::Instance& preReadData() PURE;
 };
 
 /**
@@ -2,9 +2,11 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/common/pure.h"
 #include "envoy/event/dispatcher.h"
+#include "envoy/ssl/context_config.h"
 #include "envoy/stats/stat_data_allocator.h"
 #include "envoy/thread/thread.h"
 
@@ -27,6 +29,8 @@ public:
 
   struct ShutdownParentAdminInfo {
     time_t original_start_time_;
+    // Shared session ticket keys of the parent, encryption key first.
+    std::vector<Ssl::ServerContextConfig::SessionTicketKey> session_ticket_keys_;
   };
 
   virtual ~HotRestart() {}
@@ -41,9 +45,11 @@ public:
    * Retrieve a listening socket on the specified address from the parent process. The socket will
    * be duplicated across process boundaries.
    * @param address supplies the address of the socket to duplicate, e.g. tcp://127.0.0.1:5000.
+   * @param worker_index supplies the index of the worker the socket is for. This selects among the
+   *        per worker sockets of a listener using SO_REUSEPORT, and is otherwise ignored.
    * @return int the fd or -1 if there is no bound listen port in the parent.
    */
-  virtual int duplicateParentListenSocket(const std::string& address) PURE;
+  virtual int duplicateParentListenSocket(const std::string& address, uint32_t worker_index) PURE;
 
   /**
    * Retrieve stats from our parent process.
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "envoy/api/v2/listener/listener.pb.h"
+#include "envoy/event/dispatcher.h"
 #include "envoy/network/filter.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/network/listener.h"
@@ -46,11 +47,14 @@ public:
    * @param address supplies the socket's address.
    * @param options to be set on the created socket just before calling 'bind()'.
    * @param bind_to_port supplies whether to actually bind the socket.
+   * @param worker_index supplies the index of the worker the socket is for, when a listener using
+   *        SO_REUSEPORT creates one socket per worker. Zero otherwise.
    * @return Network::SocketSharedPtr an initialized and potentially bound socket.
    */
   virtual Network::SocketSharedPtr
   createListenSocket(Network::Address::InstanceConstSharedPtr address,
-                     const Network::Socket::OptionsSharedPtr& options, bool bind_to_port) PURE;
+                     const Network::Socket::OptionsSharedPtr& options, bool bind_to_port,
+                     uint32_t worker_index) PURE;
 
   /**
    * Creates a list of filter factories.
@@ -130,6 +134,24 @@ public:
    */
   virtual uint64_t numConnections() PURE;
 
+  /**
+   * @return std::vector<std::reference_wrapper<Event::Dispatcher>> the dispatchers of the workers,
+   *         in the order in which the workers were created.
+   */
+  virtual std::vector<std::reference_wrapper<Event::Dispatcher>> workerDispatchers() PURE;
+
+  /**
+   * Find the listen socket of an active listener, e.g. to hand it to a new process during a hot
+   * restart.
+   * @param address supplies the local address of the socket.
+   * @param worker_index supplies the index of the worker whose socket is wanted. Listeners which
+   *        share one socket among all workers return it for any index.
+   * @return Network::Socket* the socket, or nullptr if there is no active listener on the address
+   *         or it has no socket for the worker.
+   */
+  virtual Network::Socket* listenSocket(const Network::Address::Instance& address,
+                                        uint32_t worker_index) PURE;
+
   /**
    * Remove a listener by name.
    * @param name supplies the listener name to remove.
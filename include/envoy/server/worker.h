@@ -2,9 +2,12 @@
 
 #include <functional>
 
+#include "envoy/event/dispatcher.h"
 #include "envoy/server/guarddog.h"
 #include "envoy/server/overload_manager.h"
 
+#include "absl/types/optional.h"
+
 namespace Envoy {
 namespace Server {
 
@@ -37,6 +40,17 @@ public:
    */
   virtual uint64_t numConnections() PURE;
 
+  /**
+   * @return Event::Dispatcher& the dispatcher running the worker's event loop.
+   */
+  virtual Event::Dispatcher& dispatcher() PURE;
+
+  /**
+   * @return absl::optional<uint32_t> the CPU to set as SO_INCOMING_CPU of the worker's own
+   *         sockets of listeners using SO_REUSEPORT, if any.
+   */
+  virtual absl::optional<uint32_t> incomingCpu() const PURE;
+
   /**
    * Start the worker thread.
    * @param guard_dog supplies the guard dog to use for thread watching.
@@ -57,6 +57,22 @@ public:
    */
   virtual unsigned maxProtocolVersion() const PURE;
 
+  /**
+   * @return the number of threads performing the private key operations of the handshakes, or 0
+   *         if they are performed on the workers.
+   */
+  virtual uint32_t privateKeySigningThreads() const PURE;
+
+  /**
+   * @return the maximum number of private key operations waiting for a signing thread.
+   */
+  virtual uint32_t maxPendingPrivateKeyOperations() const PURE;
+
+  /**
+   * @return true if the record layer of the connections is offloaded to the kernel when possible.
+   */
+  virtual bool kernelTlsOffload() const PURE;
+
   /**
    * @return true if the ContextConfig is able to provide secrets to create SSL context,
    * and false if dynamic secrets are expected but are not downloaded from SDS server yet.
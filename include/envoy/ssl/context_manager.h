@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 
 #include "envoy/ssl/context.h"
 #include "envoy/ssl/context_config.h"
@@ -38,6 +39,20 @@ public:
    * Iterate through all currently allocated contexts.
    */
   virtual void iterateContexts(std::function<void(const Context&)> callback) PURE;
+
+  /**
+   * @return the session ticket keys shared by the server contexts which do not configure their own
+   *         keys, encryption key first.
+   */
+  virtual std::vector<ServerContextConfig::SessionTicketKey> sessionTicketKeys() PURE;
+
+  /**
+   * Replaces the shared session ticket keys, e.g. with the keys handed over by the parent process
+   * on hot restart.
+   * @param keys supplies the keys, encryption key first.
+   */
+  virtual void
+  setSessionTicketKeys(const std::vector<ServerContextConfig::SessionTicketKey>& keys) PURE;
 };
 
 } // namespace Ssl
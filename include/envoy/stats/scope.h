@@ -51,6 +51,19 @@ public:
    */
   virtual Gauge& gauge(const std::string& name) PURE;
 
+  /**
+   * @return a counter within the scope's namespace which is only allocated the first time it is
+   *         modified. Until then it is reported with a zero value. This is intended for counters
+   *         of which large numbers are declared up front but few are used.
+   */
+  virtual Counter& lazyCounter(const std::string& name) PURE;
+
+  /**
+   * @return a gauge within the scope's namespace which is only allocated the first time it is
+   *         modified. See lazyCounter().
+   */
+  virtual Gauge& lazyGauge(const std::string& name) PURE;
+
   /**
    * @return a histogram within the scope's namespace with a particular value type.
    */
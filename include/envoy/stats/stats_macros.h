@@ -25,6 +25,10 @@ namespace Envoy {
  * Finally, when you want to actually instantiate the above struct using a Stats::Pool, you do:
  *   MyCoolStats stats{
  *     MY_COOL_STATS(POOL_COUNTER(...), POOL_GAUGE(...), POOL_HISTOGRAM(...))};
+ *
+ * Large blocks of stats of which few are used, such as per-cluster and per-host stats, can use
+ * POOL_LAZY_COUNTER(...) and POOL_LAZY_GAUGE(...) instead, so that each stat is only allocated
+ * when it is first modified.
  */
 
 #define GENERATE_COUNTER_STRUCT(NAME) Stats::Counter& NAME##_;
@@ -36,8 +40,12 @@ namespace Envoy {
 #define POOL_COUNTER_PREFIX(POOL, PREFIX) (POOL).counter(PREFIX FINISH_STAT_DECL_
 #define POOL_GAUGE_PREFIX(POOL, PREFIX) (POOL).gauge(PREFIX FINISH_STAT_DECL_
 #define POOL_HISTOGRAM_PREFIX(POOL, PREFIX) (POOL).histogram(PREFIX FINISH_STAT_DECL_
+#define POOL_LAZY_COUNTER_PREFIX(POOL, PREFIX) (POOL).lazyCounter(PREFIX FINISH_STAT_DECL_
+#define POOL_LAZY_GAUGE_PREFIX(POOL, PREFIX) (POOL).lazyGauge(PREFIX FINISH_STAT_DECL_
 
 #define POOL_COUNTER(POOL) POOL_COUNTER_PREFIX(POOL, "")
 #define POOL_GAUGE(POOL) POOL_GAUGE_PREFIX(POOL, "")
 #define POOL_HISTOGRAM(POOL) POOL_HISTOGRAM_PREFIX(POOL, "")
+#define POOL_LAZY_COUNTER(POOL) POOL_LAZY_COUNTER_PREFIX(POOL, "")
+#define POOL_LAZY_GAUGE(POOL) POOL_LAZY_GAUGE_PREFIX(POOL, "")
 } // namespace Envoy
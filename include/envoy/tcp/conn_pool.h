@@ -191,6 +191,14 @@ public:
    */
   virtual void drainConnections() PURE;
 
+  /**
+   * Open the warm connections of the cluster to the host of the pool, see
+   * Upstream::ClusterInfo::warmConnections(), unless the pool already has enough connections. This
+   * is used when the host joins the cluster, so that its first requests do not wait for
+   * connections to be established.
+   */
+  virtual void warmUp() PURE;
+
   /**
    * Create a new connection on the pool.
    * @param cb supplies the callbacks to invoke when the connection is ready or has failed. The
@@ -6,6 +6,7 @@
 
 #include "envoy/common/pure.h"
 #include "envoy/event/dispatcher.h"
+#include "envoy/stats/scope.h"
 
 namespace Envoy {
 namespace ThreadLocal {
@@ -61,6 +62,12 @@ public:
    *                     returns the thread local object which is then stored. The storage is via
    *                     a shared_ptr. Thus, this is a flexible mechanism that can be used to share
    *                     the same data across all threads or to share different data on each thread.
+   *
+   * Updates are coalesced: if set() is called again before a thread has applied a previous call,
+   * the thread skips the previous call and only runs the functor of the most recent one. A call is
+   * never skipped by a thread which has no data in the slot yet, nor if runOnAllThreads() was
+   * called on the slot before the next call, so that the callbacks run by runOnAllThreads() see
+   * the data set before them. Only the most recent call before each runOnAllThreads() is kept.
    */
   typedef std::function<ThreadLocalObjectSharedPtr(Event::Dispatcher& dispatcher)> InitializeCb;
   virtual void set(InitializeCb cb) PURE;
@@ -113,6 +120,13 @@ public:
    * @return Event::Dispatcher& the thread local dispatcher.
    */
   virtual Event::Dispatcher& dispatcher() PURE;
+
+  /**
+   * Start counting the updates skipped by the threads because a newer one was published. Must be
+   * called from the main thread before the worker threads start.
+   * @param scope supplies the scope of the thread local stats.
+   */
+  virtual void initializeStats(Stats::Scope& scope) PURE;
 };
 
 } // namespace ThreadLocal
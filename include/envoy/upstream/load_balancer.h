@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
@@ -93,6 +94,19 @@ public:
    *        is missing and use sensible defaults.
    */
   virtual HostConstSharedPtr chooseHost(LoadBalancerContext* context) PURE;
+
+  /**
+   * Report the response time of a host chosen by this load balancer. This is called on the thread
+   * of the load balancer, once the response is complete or the request failed, for load balancers
+   * which adapt to the latency of the hosts. Other load balancers ignore it.
+   * @param host supplies the host which was sent the request.
+   * @param response_time supplies the time between the start of the request and the end of the
+   *        response, or the failure of the request.
+   * @param complete supplies whether the response is complete. If the request timed out or was
+   *        reset, the response time is only a lower bound of the actual one.
+   */
+  virtual void onHostResponse(const HostDescription& host, std::chrono::microseconds response_time,
+                              bool complete) PURE;
 };
 
 typedef std::unique_ptr<LoadBalancer> LoadBalancerPtr;
@@ -329,6 +329,7 @@ public:
 // clang-format off
 #define ALL_CLUSTER_STATS(COUNTER, GAUGE, HISTOGRAM)                                               \
   COUNTER  (lb_healthy_panic)                                                                      \
+  COUNTER  (lb_hash_host_overloaded)                                                               \
   COUNTER  (lb_local_cluster_not_ok)                                                               \
   COUNTER  (lb_recalculate_zone_structures)                                                        \
   COUNTER  (lb_zone_cluster_too_small)                                                             \
@@ -368,6 +369,7 @@ public:
   COUNTER  (upstream_cx_protocol_error)                                                            \
   COUNTER  (upstream_cx_max_requests)                                                              \
   COUNTER  (upstream_cx_none_healthy)                                                              \
+  COUNTER  (upstream_cx_preconnect)                                                                \
   COUNTER  (upstream_rq_total)                                                                     \
   GAUGE    (upstream_rq_active)                                                                    \
   COUNTER  (upstream_rq_completed)                                                                 \
@@ -543,6 +545,12 @@ public:
   virtual const absl::optional<envoy::api::v2::Cluster::LeastRequestLbConfig>&
   lbLeastRequestConfig() const PURE;
 
+  /**
+   * @return configuration for peak EWMA load balancing, only used if LB type is peak EWMA.
+   */
+  virtual const absl::optional<envoy::api::v2::Cluster::PeakEwmaLbConfig>&
+  lbPeakEwmaConfig() const PURE;
+
   /**
    * @return configuration for ring hash load balancing, only used if type is set to ring_hash_lb.
    */
@@ -572,6 +580,19 @@ public:
    */
   virtual uint64_t maxRequestsPerConnection() const PURE;
 
+  /**
+   * @return float the number of connections a connection pool keeps open to its host, relative to
+   *         the number of requests in progress or pending on it. 1 opens connections only when
+   *         requests need them.
+   */
+  virtual float perUpstreamPreconnectRatio() const PURE;
+
+  /**
+   * @return uint32_t the number of connections each worker opens to a healthy host as soon as it
+   *         joins the cluster. 0 opens connections only when requests need them.
+   */
+  virtual uint32_t warmConnections() const PURE;
+
   /**
    * @return the human readable name of the cluster.
    */
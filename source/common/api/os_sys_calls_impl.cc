@@ -48,6 +48,16 @@ SysCallSizeResult OsSysCallsImpl::recv(int socket, void* buffer, size_t length,
   return {rc, errno};
 }
 
+SysCallSizeResult OsSysCallsImpl::recvmsg(int socket, msghdr* message, int flags) {
+  const ssize_t rc = ::recvmsg(socket, message, flags);
+  return {rc, errno};
+}
+
+SysCallSizeResult OsSysCallsImpl::sendmsg(int socket, const msghdr* message, int flags) {
+  const ssize_t rc = ::sendmsg(socket, message, flags);
+  return {rc, errno};
+}
+
 SysCallIntResult OsSysCallsImpl::shmOpen(const char* name, int oflag, mode_t mode) {
   const int rc = ::shm_open(name, oflag, mode);
   return {rc, errno};
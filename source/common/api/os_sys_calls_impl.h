@@ -17,6 +17,8 @@ public:
   SysCallSizeResult writev(int fd, const iovec* iovec, int num_iovec) override;
   SysCallSizeResult readv(int fd, const iovec* iovec, int num_iovec) override;
   SysCallSizeResult recv(int socket, void* buffer, size_t length, int flags) override;
+  SysCallSizeResult recvmsg(int socket, msghdr* message, int flags) override;
+  SysCallSizeResult sendmsg(int socket, const msghdr* message, int flags) override;
   SysCallIntResult close(int fd) override;
   SysCallIntResult shmOpen(const char* name, int oflag, mode_t mode) override;
   SysCallIntResult shmUnlink(const char* name) override;
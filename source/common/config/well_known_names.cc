@@ -4,21 +4,24 @@ namespace Envoy {
 namespace Config {
 
 TagNameValues::TagNameValues() {
-  // Note: the default regexes are defined below in the order that they will typically be matched
-  // (see the TagExtractor class definition for an explanation of the iterative matching process).
-  // This ordering is roughly from most specific to least specific. Despite the fact that these
-  // regexes are defined with a particular ordering in mind, users can customize the ordering of the
-  // processing of the default tag extraction regexes and include custom tags with regexes via the
-  // bootstrap configuration. Because of this flexibility, these regexes are designed to not
-  // interfere with one another no matter the ordering. They are tested in forward and reverse
+  // Note: the default extractors are defined below in the order that they will typically be
+  // matched (see the TagExtractor class definition for an explanation of the iterative matching
+  // process). This ordering is roughly from most specific to least specific. Despite the fact that
+  // these extractors are defined with a particular ordering in mind, users can customize the
+  // ordering of the processing of the default tag extractors and include custom tags with regexes
+  // via the bootstrap configuration. Because of this flexibility, these extractors are designed to
+  // not interfere with one another no matter the ordering. They are tested in forward and reverse
   // ordering to ensure they will be safe in most ordering configurations.
-
-  // To give a more user-friendly explanation of the intended behavior of each regex, each is
-  // preceded by a comment with a simplified notation to explain what the regex is designed to
-  // match:
-  // - The text that the regex is intended to capture will be enclosed in ().
+  //
+  // Tags whose values are made of whole '.'-separated tokens are described by token patterns
+  // (see Stats::TagTokenMatcher), which are all matched in a single pass over the stat name. The
+  // remaining tags are described by regexes.
+
+  // To give a more user-friendly explanation of the intended behavior of each extractor, each is
+  // preceded by a comment with a simplified notation to explain what it is designed to match:
+  // - The text that the extractor is intended to capture will be enclosed in ().
   // - Other default tags that are expected to exist in the name (and may or may not have been
-  // removed before this regex has been applied) are enclosed in [].
+  // removed before this extractor has been applied) are enclosed in [].
   // - Stand-ins for a variable segment of the name (including inside capture groups) will be
   // enclosed in <>.
   // - Typical * notation will be used to denote an arbitrary set of characters.
@@ -30,82 +33,76 @@ TagNameValues::TagNameValues() {
   addRegex(RESPONSE_CODE_CLASS, "_rq_(\\d)xx$", "_rq_");
 
   // http.[<stat_prefix>.]dynamodb.table.[<table_name>.]capacity.[<operation_name>.](__partition_id=<last_seven_characters_from_partition_id>)
-  addRegex(DYNAMO_PARTITION_ID,
-           "^http(?=\\.).*?\\.dynamodb\\.table(?=\\.).*?\\."
-           "capacity(?=\\.).*?(\\.__partition_id=(\\w{7}))$",
-           ".dynamodb.table.");
+  addTokenized(DYNAMO_PARTITION_ID, "http.**.dynamodb.table.**.capacity.**.__partition_id=$");
 
   // http.[<stat_prefix>.]dynamodb.operation.(<operation_name>.)<base_stat> or
   // http.[<stat_prefix>.]dynamodb.table.[<table_name>.]capacity.(<operation_name>.)[<partition_id>]
-  addRegex(DYNAMO_OPERATION,
-           "^http(?=\\.).*?\\.dynamodb.(?:operation|table(?="
-           "\\.).*?\\.capacity)(\\.(.*?))(?:\\.|$)",
-           ".dynamodb.");
+  addTokenized(DYNAMO_OPERATION, "http.**.dynamodb.operation.$.**");
+  addTokenized(DYNAMO_OPERATION, "http.**.dynamodb.table.**.capacity.$.**");
 
   // mongo.[<stat_prefix>.]collection.[<collection>.]callsite.(<callsite>.)query.<base_stat>
-  addRegex(MONGO_CALLSITE,
-           "^mongo(?=\\.).*?\\.collection(?=\\.).*?\\.callsite\\.((.*?)\\.).*?query.\\w+?$",
-           ".collection.");
+  addTokenized(MONGO_CALLSITE, "mongo.**.collection.**.callsite.$.**.query.*");
 
   // http.[<stat_prefix>.]dynamodb.table.(<table_name>.) or
   // http.[<stat_prefix>.]dynamodb.error.(<table_name>.)*
-  addRegex(DYNAMO_TABLE, "^http(?=\\.).*?\\.dynamodb.(?:table|error)\\.((.*?)\\.)", ".dynamodb.");
+  addTokenized(DYNAMO_TABLE, "http.**.dynamodb.table.$.*.**");
+  addTokenized(DYNAMO_TABLE, "http.**.dynamodb.error.$.*.**");
 
   // mongo.[<stat_prefix>.]collection.(<collection>.)query.<base_stat>
-  addRegex(MONGO_COLLECTION, "^mongo(?=\\.).*?\\.collection\\.((.*?)\\.).*?query.\\w+?$",
-           ".collection.");
+  addTokenized(MONGO_COLLECTION, "mongo.**.collection.$.**.query.*");
 
   // mongo.[<stat_prefix>.]cmd.(<cmd>.)<base_stat>
-  addRegex(MONGO_CMD, "^mongo(?=\\.).*?\\.cmd\\.((.*?)\\.)\\w+?$", ".cmd.");
+  addTokenized(MONGO_CMD, "mongo.**.cmd.$$.*");
 
   // cluster.[<route_target_cluster>.]grpc.[<grpc_service>.](<grpc_method>.)<base_stat>
-  addRegex(GRPC_BRIDGE_METHOD, "^cluster(?=\\.).*?\\.grpc(?=\\.).*\\.((.*?)\\.)\\w+?$", ".grpc.");
+  addTokenized(GRPC_BRIDGE_METHOD, "cluster.**.grpc.**.$.*");
 
   // http.[<stat_prefix>.]user_agent.(<user_agent>.)<base_stat>
-  addRegex(HTTP_USER_AGENT, "^http(?=\\.).*?\\.user_agent\\.((.*?)\\.)\\w+?$", ".user_agent.");
+  addTokenized(HTTP_USER_AGENT, "http.**.user_agent.$$.*");
 
   // vhost.[<virtual host name>.]vcluster.(<virtual_cluster_name>.)<base_stat>
-  addRegex(VIRTUAL_CLUSTER, "^vhost(?=\\.).*?\\.vcluster\\.((.*?)\\.)\\w+?$", ".vcluster.");
+  addTokenized(VIRTUAL_CLUSTER, "vhost.**.vcluster.$$.*");
 
   // http.[<stat_prefix>.]fault.(<downstream_cluster>.)<base_stat>
-  addRegex(FAULT_DOWNSTREAM_CLUSTER, "^http(?=\\.).*?\\.fault\\.((.*?)\\.)\\w+?$", ".fault.");
+  addTokenized(FAULT_DOWNSTREAM_CLUSTER, "http.**.fault.$$.*");
 
   // listener.[<address>.]ssl.cipher.(<cipher>)
-  addRegex(SSL_CIPHER, "^listener(?=\\.).*?\\.ssl\\.cipher(\\.(.*?))$");
+  addTokenized(SSL_CIPHER, "listener.**.ssl.cipher.$$");
 
   // cluster.[<cluster_name>.]ssl.ciphers.(<cipher>)
-  addRegex(SSL_CIPHER_SUITE, "^cluster(?=\\.).*?\\.ssl\\.ciphers(\\.(.*?))$", ".ssl.ciphers.");
+  addTokenized(SSL_CIPHER_SUITE, "cluster.**.ssl.ciphers.$$");
 
   // cluster.[<route_target_cluster>.]grpc.(<grpc_service>.)*
-  addRegex(GRPC_BRIDGE_SERVICE, "^cluster(?=\\.).*?\\.grpc\\.((.*?)\\.)", ".grpc.");
+  addTokenized(GRPC_BRIDGE_SERVICE, "cluster.**.grpc.$.*.**");
 
   // tcp.(<stat_prefix>.)<base_stat>
-  addRegex(TCP_PREFIX, "^tcp\\.((.*?)\\.)\\w+?$");
+  addTokenized(TCP_PREFIX, "tcp.$$.*");
 
   // auth.clientssl.(<stat_prefix>.)<base_stat>
-  addRegex(CLIENTSSL_PREFIX, "^auth\\.clientssl\\.((.*?)\\.)\\w+?$");
+  addTokenized(CLIENTSSL_PREFIX, "auth.clientssl.$$.*");
 
   // ratelimit.(<stat_prefix>.)<base_stat>
-  addRegex(RATELIMIT_PREFIX, "^ratelimit\\.((.*?)\\.)\\w+?$");
+  addTokenized(RATELIMIT_PREFIX, "ratelimit.$$.*");
 
   // cluster.(<cluster_name>.)*
-  addRegex(CLUSTER_NAME, "^cluster\\.((.*?)\\.)");
+  addTokenized(CLUSTER_NAME, "cluster.$.*.**");
 
   // listener.[<address>.]http.(<stat_prefix>.)*
-  addRegex(HTTP_CONN_MANAGER_PREFIX, "^listener(?=\\.).*?\\.http\\.((.*?)\\.)", ".http.");
+  addTokenized(HTTP_CONN_MANAGER_PREFIX, "listener.**.http.$.*.**");
 
   // http.(<stat_prefix>.)*
-  addRegex(HTTP_CONN_MANAGER_PREFIX, "^http\\.((.*?)\\.)");
+  addTokenized(HTTP_CONN_MANAGER_PREFIX, "http.$.*.**");
 
   // listener.(<address>.)*
+  // The address may span several tokens (e.g. an IPv4 address), so this remains a regex.
   addRegex(LISTENER_ADDRESS,
            "^listener\\.(((?:[_.[:digit:]]*|[_\\[\\]aAbBcCdDeEfF[:digit:]]*))\\.)");
 
   // vhost.(<virtual host name>.)*
-  addRegex(VIRTUAL_HOST, "^vhost\\.((.*?)\\.)");
+  addTokenized(VIRTUAL_HOST, "vhost.$.*.**");
 
   // mongo.(<stat_prefix>.)*
-  addRegex(MONGO_PREFIX, "^mongo\\.((.*?)\\.)");
+  addTokenized(MONGO_PREFIX, "mongo.$.*.**");
 }
 
 void TagNameValues::addRegex(const std::string& name, const std::string& regex,
@@ -113,5 +110,9 @@ void TagNameValues::addRegex(const std::string& name, const std::string& regex,
   descriptor_vec_.emplace_back(Descriptor(name, regex, substr));
 }
 
+void TagNameValues::addTokenized(const std::string& name, const std::string& pattern) {
+  tokenized_descriptor_vec_.emplace_back(TokenizedDescriptor(name, pattern));
+}
+
 } // namespace Config
 } // namespace Envoy
@@ -86,10 +86,10 @@ public:
   TagNameValues();
 
   /**
-   * Represents a tag extraction. This structure may be extended to
-   * allow for an faster pattern-matching engine to be used as an
-   * alternative to regexes, on an individual tag basis. Some of the
-   * tags, such as "_rq_(\\d)xx$", will probably stay as regexes.
+   * Represents a regex-based tag extraction. Tags whose values can be found by
+   * matching whole '.'-separated tokens of a stat name are instead described by
+   * a TokenizedDescriptor. Some of the tags, such as "_rq_(\\d)xx$", will stay
+   * as regexes.
    */
   struct Descriptor {
     Descriptor(const std::string& name, const std::string& regex, const std::string& substr = "")
@@ -99,6 +99,17 @@ public:
     const std::string substr_;
   };
 
+  /**
+   * Represents a tag extraction expressed as a token pattern. See
+   * Stats::TagTokenMatcher for the pattern syntax.
+   */
+  struct TokenizedDescriptor {
+    TokenizedDescriptor(const std::string& name, const std::string& pattern)
+        : name_(name), pattern_(pattern) {}
+    const std::string name_;
+    const std::string pattern_;
+  };
+
   // Cluster name tag
   const std::string CLUSTER_NAME = "envoy.cluster_name";
   // Listener port tag
@@ -149,14 +160,23 @@ public:
   // Mapping from the names above to their respective regex strings.
   const std::vector<std::pair<std::string, std::string>> name_regex_pairs_;
 
-  // Returns the list of descriptors.
+  // Returns the list of regex descriptors.
   const std::vector<Descriptor>& descriptorVec() const { return descriptor_vec_; }
 
+  // Returns the list of token pattern descriptors.
+  const std::vector<TokenizedDescriptor>& tokenizedDescriptorVec() const {
+    return tokenized_descriptor_vec_;
+  }
+
 private:
   void addRegex(const std::string& name, const std::string& regex, const std::string& substr = "");
+  void addTokenized(const std::string& name, const std::string& pattern);
 
-  // Collection of tag descriptors.
+  // Collection of regex tag descriptors.
   std::vector<Descriptor> descriptor_vec_;
+
+  // Collection of token pattern tag descriptors.
+  std::vector<TokenizedDescriptor> tokenized_descriptor_vec_;
 };
 
 typedef ConstSingleton<TagNameValues> TagNames;
@@ -1,7 +1,10 @@
 #include "common/event/dispatcher_impl.h"
 
+#include <cxxabi.h>
+
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <string>
 #include <vector>
@@ -10,6 +13,7 @@
 #include "envoy/network/listener.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/fmt.h"
 #include "common/common/lock_guard.h"
 #include "common/common/thread.h"
 #include "common/event/file_event_impl.h"
@@ -24,6 +28,31 @@
 namespace Envoy {
 namespace Event {
 
+namespace {
+// Coarse timers are used for timeouts of a second or more, where firing up to one tick late does
+// not matter.
+const std::chrono::milliseconds CoarseTimerGranularity(10);
+
+uint64_t toMicroseconds(MonotonicTime::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+// Describes a callback by its demangled type, which for a lambda names the function defining it.
+std::string describeCallback(const std::type_info& type, int fd) {
+  int status;
+  char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  std::string description = status == 0 ? demangled : type.name();
+  free(demangled);
+  if (fd >= 0) {
+    description += fmt::format(" (fd {})", fd);
+  }
+  return description;
+}
+
+} // namespace
+
+const size_t DispatcherImpl::MaxRecentSlowCallbacks;
+
 DispatcherImpl::DispatcherImpl(TimeSystem& time_system)
     : DispatcherImpl(time_system, Buffer::WatermarkFactoryPtr{new Buffer::WatermarkBufferFactory}) {
   // The dispatcher won't work as expected if libevent hasn't been configured to use threads.
@@ -33,8 +62,10 @@ DispatcherImpl::DispatcherImpl(TimeSystem& time_system)
 DispatcherImpl::DispatcherImpl(TimeSystem& time_system, Buffer::WatermarkFactoryPtr&& factory)
     : time_system_(time_system), buffer_factory_(std::move(factory)), base_(event_base_new()),
       scheduler_(time_system_.createScheduler(base_)),
+      timer_wheel_(*scheduler_, time_system_, CoarseTimerGranularity),
       deferred_delete_timer_(createTimer([this]() -> void { clearDeferredDeleteList(); })),
-      post_timer_(createTimer([this]() -> void { runPostCallbacks(); })),
+      // Posted callbacks are timed one by one, rather than as the timer running them.
+      post_timer_(scheduler_->createTimer([this]() -> void { runPostCallbacks(); })),
       current_to_delete_(&to_delete_1_) {
   RELEASE_ASSERT(Libevent::Global::initialized(), "");
 }
@@ -100,7 +131,18 @@ Network::DnsResolverSharedPtr DispatcherImpl::createDnsResolver(
 FileEventPtr DispatcherImpl::createFileEvent(int fd, FileReadyCb cb, FileTriggerType trigger,
                                              uint32_t events) {
   ASSERT(isThreadSafe());
-  return FileEventPtr{new FileEventImpl(*this, fd, cb, trigger, events)};
+  return FileEventPtr{new FileEventImpl(
+      *this, fd,
+      [this, fd, cb](uint32_t ready_events) {
+        if (stats_ == nullptr) {
+          cb(ready_events);
+          return;
+        }
+        const MonotonicTime started = callbackStarted();
+        cb(ready_events);
+        callbackFinished(started, "file_event", cb.target_type(), fd);
+      },
+      trigger, events)};
 }
 
 Filesystem::WatcherPtr DispatcherImpl::createFilesystemWatcher() {
@@ -118,7 +160,12 @@ DispatcherImpl::createListener(Network::Socket& socket, Network::ListenerCallbac
 
 TimerPtr DispatcherImpl::createTimer(TimerCb cb) {
   ASSERT(isThreadSafe());
-  return scheduler_->createTimer(cb);
+  return scheduler_->createTimer(instrumentCallback("timer", cb));
+}
+
+TimerPtr DispatcherImpl::createCoarseTimer(TimerCb cb) {
+  ASSERT(isThreadSafe());
+  return timer_wheel_.createTimer(instrumentCallback("timer", cb));
 }
 
 void DispatcherImpl::deferredDelete(DeferredDeletablePtr&& to_delete) {
@@ -132,20 +179,27 @@ void DispatcherImpl::deferredDelete(DeferredDeletablePtr&& to_delete) {
 
 void DispatcherImpl::exit() { event_base_loopexit(base_.get(), nullptr); }
 
+void DispatcherImpl::initializeStats(Stats::Scope& scope, const std::string& prefix,
+                                     std::chrono::milliseconds slow_callback_threshold) {
+  ASSERT(run_tid_ == 0);
+  const std::string final_prefix = prefix + "dispatcher.";
+  stats_ = std::make_unique<DispatcherStats>(DispatcherStats{ALL_DISPATCHER_STATS(
+      POOL_COUNTER_PREFIX(scope, final_prefix), POOL_HISTOGRAM_PREFIX(scope, final_prefix))});
+  slow_callback_threshold_ = slow_callback_threshold;
+}
+
+std::vector<SlowCallback> DispatcherImpl::recentSlowCallbacks() const {
+  Thread::LockGuard lock(slow_callbacks_lock_);
+  return std::vector<SlowCallback>(slow_callbacks_.begin(), slow_callbacks_.end());
+}
+
 SignalEventPtr DispatcherImpl::listenForSignal(int signal_num, SignalCb cb) {
   ASSERT(isThreadSafe());
-  return SignalEventPtr{new SignalEventImpl(*this, signal_num, cb)};
+  return SignalEventPtr{new SignalEventImpl(*this, signal_num, instrumentCallback("signal", cb))};
 }
 
 void DispatcherImpl::post(std::function<void()> callback) {
-  bool do_post;
-  {
-    Thread::LockGuard lock(post_lock_);
-    do_post = post_callbacks_.empty();
-    post_callbacks_.push_back(callback);
-  }
-
-  if (do_post) {
+  if (post_queue_.push(std::move(callback))) {
     post_timer_->enableTimer(std::chrono::milliseconds(0));
   }
 }
@@ -159,27 +213,96 @@ void DispatcherImpl::run(RunType type) {
   // event_base_once() before some other event, the other event might get called first.
   runPostCallbacks();
 
-  event_base_loop(base_.get(), type == RunType::NonBlock ? EVLOOP_NONBLOCK : 0);
+  if (stats_ == nullptr) {
+    event_base_loop(base_.get(), type == RunType::NonBlock ? EVLOOP_NONBLOCK : 0);
+    return;
+  }
+
+  // Run the loop one iteration at a time so that each iteration is recorded. Like a blocking loop,
+  // this returns once no events are left or exit() was called.
+  if (type == RunType::NonBlock) {
+    runIteration(EVLOOP_NONBLOCK);
+    return;
+  }
+  while (runIteration(EVLOOP_ONCE) == 0 && !event_base_got_exit(base_.get()) &&
+         !event_base_got_break(base_.get())) {
+  }
 }
 
 void DispatcherImpl::runPostCallbacks() {
-  while (true) {
-    // It is important that this declaration is inside the body of the loop so that the callback is
-    // destructed while post_lock_ is not held. If callback is declared outside the loop and reused
-    // for each iteration, the previous iteration's callback is destructed when callback is
-    // re-assigned, which happens while holding the lock. This can lead to a deadlock (via
-    // recursive mutex acquisition) if destroying the callback runs a destructor, which through some
-    // callstack calls post() on this dispatcher.
-    std::function<void()> callback;
-    {
-      Thread::LockGuard lock(post_lock_);
-      if (post_callbacks_.empty()) {
-        return;
-      }
-      callback = post_callbacks_.front();
-      post_callbacks_.pop_front();
-    }
+  if (stats_ == nullptr) {
+    post_queue_.runAll();
+    return;
+  }
+
+  const uint64_t depth = post_queue_.runAll([this](const std::function<void()>& callback) {
+    const MonotonicTime started = callbackStarted();
     callback();
+    callbackFinished(started, "post", callback.target_type(), -1);
+  });
+  if (depth > 0) {
+    stats_->post_queue_depth_.recordValue(depth);
+  }
+}
+
+TimerCb DispatcherImpl::instrumentCallback(const char* kind, TimerCb cb) {
+  return [this, kind, cb]() {
+    if (stats_ == nullptr) {
+      cb();
+      return;
+    }
+    const MonotonicTime started = callbackStarted();
+    cb();
+    callbackFinished(started, kind, cb.target_type(), -1);
+  };
+}
+
+int DispatcherImpl::runIteration(int flags) {
+  in_iteration_ = true;
+  polled_ = false;
+  iteration_events_ = 0;
+  const MonotonicTime started = time_system_.monotonicTime();
+  const int rc = event_base_loop(base_.get(), flags);
+  const MonotonicTime finished = time_system_.monotonicTime();
+  in_iteration_ = false;
+
+  // Without any callback, the whole iteration was spent waiting.
+  const MonotonicTime poll_end = polled_ ? poll_end_ : finished;
+  stats_->loop_poll_us_.recordValue(toMicroseconds(poll_end - started));
+  stats_->loop_processing_us_.recordValue(toMicroseconds(finished - poll_end));
+  stats_->loop_events_.recordValue(iteration_events_);
+  return rc;
+}
+
+MonotonicTime DispatcherImpl::callbackStarted() {
+  const MonotonicTime now = time_system_.monotonicTime();
+  if (in_iteration_) {
+    if (!polled_) {
+      polled_ = true;
+      poll_end_ = now;
+    }
+    ++iteration_events_;
+  }
+  return now;
+}
+
+void DispatcherImpl::callbackFinished(MonotonicTime started, const char* kind,
+                                      const std::type_info& type, int fd) {
+  const std::chrono::microseconds duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      time_system_.monotonicTime() - started);
+  if (slow_callback_threshold_.count() == 0 || duration < slow_callback_threshold_) {
+    return;
+  }
+
+  stats_->slow_callbacks_.inc();
+  SlowCallback slow_callback{kind, describeCallback(type, fd), duration,
+                             time_system_.systemTime()};
+  ENVOY_LOG(debug, "slow {} callback ran for {}us: {}", kind, duration.count(),
+            slow_callback.description_);
+  Thread::LockGuard lock(slow_callbacks_lock_);
+  slow_callbacks_.push_front(std::move(slow_callback));
+  if (slow_callbacks_.size() > MaxRecentSlowCallbacks) {
+    slow_callbacks_.pop_back();
   }
 }
 
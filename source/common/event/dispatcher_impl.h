@@ -1,22 +1,46 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <functional>
-#include <list>
+#include <memory>
+#include <string>
+#include <typeinfo>
 #include <vector>
 
 #include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/network/connection_handler.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/common/logger.h"
 #include "common/common/thread.h"
 #include "common/event/libevent.h"
+#include "common/event/post_queue.h"
+#include "common/event/timer_wheel_impl.h"
 
 namespace Envoy {
 namespace Event {
 
+// clang-format off
+#define ALL_DISPATCHER_STATS(COUNTER, HISTOGRAM)                                                   \
+  COUNTER  (slow_callbacks)                                                                        \
+  HISTOGRAM(loop_events)                                                                           \
+  HISTOGRAM(loop_poll_us)                                                                          \
+  HISTOGRAM(loop_processing_us)                                                                    \
+  HISTOGRAM(post_queue_depth)
+// clang-format on
+
+/**
+ * Wrapper struct for dispatcher stats. @see stats_macros.h
+ */
+struct DispatcherStats {
+  ALL_DISPATCHER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
 /**
  * libevent implementation of Event::Dispatcher.
  */
@@ -51,15 +75,26 @@ public:
                                       bool bind_to_port,
                                       bool hand_off_restored_destination_connections) override;
   TimerPtr createTimer(TimerCb cb) override;
+  TimerPtr createCoarseTimer(TimerCb cb) override;
   void deferredDelete(DeferredDeletablePtr&& to_delete) override;
   void exit() override;
+  void initializeStats(Stats::Scope& scope, const std::string& prefix,
+                       std::chrono::milliseconds slow_callback_threshold) override;
+  std::vector<SlowCallback> recentSlowCallbacks() const override;
   SignalEventPtr listenForSignal(int signal_num, SignalCb cb) override;
   void post(std::function<void()> callback) override;
   void run(RunType type) override;
   Buffer::WatermarkFactory& getWatermarkFactory() override { return *buffer_factory_; }
 
+  static const size_t MaxRecentSlowCallbacks = 16;
+
 private:
   void runPostCallbacks();
+  TimerCb instrumentCallback(const char* kind, TimerCb cb);
+  int runIteration(int flags);
+  MonotonicTime callbackStarted();
+  void callbackFinished(MonotonicTime started, const char* kind, const std::type_info& type,
+                        int fd);
 
   // Validate that an operation is thread safe, i.e. it's invoked on the same thread that the
   // dispatcher run loop is executing on. We allow run_tid_ == 0 for tests where we don't invoke
@@ -71,13 +106,25 @@ private:
   Buffer::WatermarkFactoryPtr buffer_factory_;
   Libevent::BasePtr base_;
   SchedulerPtr scheduler_;
+  // Declared before anything which may own coarse timers, such as the deferred delete lists.
+  TimerWheel timer_wheel_;
   TimerPtr deferred_delete_timer_;
   TimerPtr post_timer_;
   std::vector<DeferredDeletablePtr> to_delete_1_;
   std::vector<DeferredDeletablePtr> to_delete_2_;
   std::vector<DeferredDeletablePtr>* current_to_delete_;
-  Thread::MutexBasicLockable post_lock_;
-  std::list<std::function<void()>> post_callbacks_ GUARDED_BY(post_lock_);
+  PostQueue post_queue_;
+  // Set by initializeStats(), after which callbacks are timed.
+  std::unique_ptr<DispatcherStats> stats_;
+  std::chrono::microseconds slow_callback_threshold_{};
+  // State of the loop iteration being recorded, if any. The first callback of an iteration ends
+  // its wait for events.
+  bool in_iteration_{};
+  bool polled_{};
+  MonotonicTime poll_end_;
+  uint64_t iteration_events_{};
+  mutable Thread::MutexBasicLockable slow_callbacks_lock_;
+  std::deque<SlowCallback> slow_callbacks_ GUARDED_BY(slow_callbacks_lock_);
   bool deferred_deleting_{};
 };
 
@@ -0,0 +1,115 @@
+#include "common/event/post_queue.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace Envoy {
+namespace Event {
+
+namespace {
+
+const uint64_t FreeIndexMask = 0xffffffff;
+
+uint64_t makeFreeHead(uint64_t previous_head, uint32_t index) {
+  return (((previous_head >> 32) + 1) << 32) | index;
+}
+
+} // namespace
+
+const uint32_t PostQueue::DefaultPoolSize;
+
+PostQueue::PostQueue(uint32_t pool_size)
+    : pool_size_(pool_size), pool_(new Node[pool_size]), head_(&stub_), tail_(&stub_) {
+  for (uint32_t i = 0; i < pool_size_; ++i) {
+    pool_[i].pooled_ = true;
+    pool_[i].next_free_.store(i + 1 < pool_size_ ? i + 2 : 0, std::memory_order_relaxed);
+  }
+  free_head_.store(pool_size_ > 0 ? 1 : 0, std::memory_order_release);
+}
+
+PostQueue::~PostQueue() {
+  // Callbacks which were never run are destroyed with the queue, as the dispatcher is.
+  while (Node* node = pop()) {
+    release(node);
+  }
+}
+
+bool PostQueue::push(std::function<void()> callback) {
+  Node* node = allocate();
+  node->callback_ = std::move(callback);
+  pushNode(node);
+  // The flag is only set once the node is linked, so that the consumer clearing it either sees the
+  // node or is woken up again.
+  return !wakeup_pending_.exchange(true, std::memory_order_acq_rel);
+}
+
+PostQueue::Node* PostQueue::allocate() {
+  uint64_t head = free_head_.load(std::memory_order_acquire);
+  while ((head & FreeIndexMask) != 0) {
+    Node& node = pool_[(head & FreeIndexMask) - 1];
+    // The node may be concurrently taken and released again by another producer, in which case the
+    // update count of the head changed and the exchange fails.
+    const uint64_t next = makeFreeHead(head, node.next_free_.load(std::memory_order_relaxed));
+    if (free_head_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+      return &node;
+    }
+  }
+  return new Node();
+}
+
+void PostQueue::release(Node* node) {
+  node->callback_ = nullptr;
+  if (!node->pooled_) {
+    delete node;
+    return;
+  }
+
+  const uint32_t index = node - pool_.get() + 1;
+  uint64_t head = free_head_.load(std::memory_order_relaxed);
+  do {
+    node->next_free_.store(head & FreeIndexMask, std::memory_order_relaxed);
+  } while (!free_head_.compare_exchange_weak(head, makeFreeHead(head, index),
+                                             std::memory_order_release, std::memory_order_relaxed));
+}
+
+void PostQueue::pushNode(Node* node) {
+  node->next_.store(nullptr, std::memory_order_relaxed);
+  Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+  previous->next_.store(node, std::memory_order_release);
+}
+
+PostQueue::Node* PostQueue::pop() {
+  Node* tail = tail_;
+  Node* next = tail->next_.load(std::memory_order_acquire);
+  if (tail == &stub_) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    tail_ = next;
+    tail = next;
+    next = next->next_.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+
+  if (tail != head_.load(std::memory_order_acquire)) {
+    // A producer swapped a node in after the tail but did not link it yet. It sets the wakeup flag
+    // once it did, and the consumer runs again.
+    return nullptr;
+  }
+  // The tail is the last node. The stub is pushed back so that the tail can be returned while
+  // producers keep a node to link to.
+  pushNode(&stub_);
+  next = tail->next_.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+} // namespace Event
+} // namespace Envoy
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+namespace Event {
+
+/**
+ * Lock free queue of the callbacks posted to a dispatcher, which any thread may push to but only
+ * the dispatcher's thread runs. Pushing is a single atomic exchange, plus taking a node from a
+ * fixed pool, so that posting from many threads neither contends on a lock nor allocates. Callbacks
+ * are moved into their node and run in the order they were pushed.
+ *
+ * The queue is an intrusive multiple producer, single consumer list around a stub node, in which a
+ * producer links its node after swapping it in as the head. A node whose producer has swapped it
+ * in but not linked it yet hides the nodes after it from the consumer until it is linked.
+ */
+class PostQueue : NonCopyable {
+public:
+  /**
+   * @param pool_size supplies the number of nodes of the pool. Callbacks pushed while the pool is
+   *        exhausted are held by heap allocated nodes.
+   */
+  explicit PostQueue(uint32_t pool_size = DefaultPoolSize);
+  ~PostQueue();
+
+  /**
+   * Push a callback. May be called from any thread.
+   * @param callback supplies the callback to run.
+   * @return bool whether the consumer must be woken up, i.e. whether this is the first callback
+   *         pushed since the consumer last started running callbacks.
+   */
+  bool push(std::function<void()> callback);
+
+  /**
+   * Run the pushed callbacks, including those pushed while running, until the queue is empty. Must
+   * only be called by the consumer thread. A callback whose push is still in progress may not be
+   * run, in which case its producer is told to wake the consumer up again.
+   * @param run supplies the function invoked to run each callback, e.g. to time it.
+   * @return uint64_t the number of callbacks run.
+   */
+  template <class RunCb> uint64_t runAll(RunCb run) {
+    wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+    uint64_t count = 0;
+    while (Node* node = pop()) {
+      run(node->callback_);
+      // Releasing the node destroys the callback, which may post to this queue again.
+      release(node);
+      ++count;
+    }
+    return count;
+  }
+
+  /**
+   * Run the pushed callbacks. @see runAll(RunCb).
+   */
+  uint64_t runAll() {
+    return runAll([](const std::function<void()>& callback) { callback(); });
+  }
+
+  static const uint32_t DefaultPoolSize = 256;
+
+private:
+  struct Node {
+    std::atomic<Node*> next_{};
+    std::function<void()> callback_;
+    // Index plus one of the next node of the pool's free list, or 0 for the end of the list.
+    std::atomic<uint32_t> next_free_{};
+    bool pooled_{};
+  };
+
+  Node* allocate();
+  void release(Node* node);
+  void pushNode(Node* node);
+  Node* pop();
+
+  const uint32_t pool_size_;
+  std::unique_ptr<Node[]> pool_;
+  // Head of the pool's free list, as the index plus one of the first free node in the low 32 bits,
+  // and a count of the updates of the list in the high 32 bits. The count makes a pop fail if the
+  // list changed since the head was read, even if the same node is back at its head.
+  std::atomic<uint64_t> free_head_{};
+  // The most recently pushed node, swapped by producers.
+  std::atomic<Node*> head_;
+  // The oldest node, only accessed by the consumer.
+  Node* tail_;
+  Node stub_;
+  std::atomic<bool> wakeup_pending_{};
+};
+
+} // namespace Event
+} // namespace Envoy
@@ -0,0 +1,251 @@
+#include "common/event/timer_wheel_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Event {
+
+namespace {
+// Level of the timers detached from their slot to be fired.
+const uint32_t ExpiringLevel = TimerWheel::NumLevels;
+const uint64_t SlotMask = TimerWheel::SlotsPerLevel - 1;
+} // namespace
+
+const uint32_t TimerWheel::NumLevels;
+const uint32_t TimerWheel::SlotBits;
+const uint32_t TimerWheel::SlotsPerLevel;
+
+/**
+ * Timer armed in a TimerWheel. It is linked in the slot of its level covering its expiration
+ * while armed.
+ */
+class TimerWheel::WheelTimerImpl : public Timer, public Link {
+public:
+  WheelTimerImpl(TimerWheel& wheel, TimerCb cb) : wheel_(wheel), cb_(cb) { ASSERT(cb_); }
+  ~WheelTimerImpl() { wheel_.disarm(*this); }
+
+  // Timer
+  void disableTimer() override { wheel_.disarm(*this); }
+  void enableTimer(const std::chrono::milliseconds& d) override {
+    wheel_.arm(*this, wheel_.expirationTick(d));
+  }
+
+  TimerWheel& wheel_;
+  const TimerCb cb_;
+  uint64_t expiration_tick_{};
+  uint32_t level_{};
+  uint64_t slot_{};
+  bool armed_{};
+};
+
+TimerWheel::TimerWheel(Scheduler& scheduler, TimeSource& time_source,
+                       std::chrono::milliseconds tick)
+    : time_source_(time_source), tick_(tick), epoch_(time_source.monotonicTime()),
+      driver_(scheduler.createTimer([this]() -> void { onDriverTimer(); })) {
+  ASSERT(tick_.count() > 0);
+}
+
+TimerPtr TimerWheel::createTimer(TimerCb cb) { return std::make_unique<WheelTimerImpl>(*this, cb); }
+
+uint64_t TimerWheel::nowTick() const { return (time_source_.monotonicTime() - epoch_) / tick_; }
+
+uint64_t TimerWheel::expirationTick(const std::chrono::milliseconds& d) const {
+  // Round up, so that timers never fire early.
+  const MonotonicTime::duration expiration = time_source_.monotonicTime() - epoch_ + d;
+  uint64_t tick = expiration / tick_;
+  if (tick * tick_ < expiration) {
+    tick++;
+  }
+  return tick;
+}
+
+bool TimerWheel::slotsEmpty() const {
+  return std::all_of(std::begin(level_sizes_), std::end(level_sizes_),
+                     [](uint64_t size) { return size == 0; });
+}
+
+void TimerWheel::arm(WheelTimerImpl& timer, uint64_t expiration_tick) {
+  if (timer.armed_) {
+    if (timer.level_ != ExpiringLevel && expiration_tick >= timer.expiration_tick_) {
+      // The timer is pushed back, which is the common case for idle timers. It is left in place
+      // and re-placed if its slot is reached before it expires.
+      timer.expiration_tick_ = expiration_tick;
+      return;
+    }
+    disarm(timer);
+  }
+
+  if (!firing_ && slotsEmpty()) {
+    // Nothing is pending, so the ticks elapsed since the wheel was last driven can be skipped.
+    current_tick_ = std::max(current_tick_, nowTick());
+  }
+  timer.expiration_tick_ = std::max(expiration_tick, current_tick_);
+  timer.armed_ = true;
+  place(timer);
+
+  if (!firing_) {
+    // Timers placed in a higher level need the driver when their slot is reached, where they are
+    // moved down.
+    const uint64_t tick = timer.level_ == 0 ? timer.expiration_tick_
+                                            : cascadeTick(timer.level_, timer.slot_);
+    if (!driver_armed_ || tick < driver_tick_) {
+      scheduleDriverAt(tick);
+    }
+  }
+}
+
+void TimerWheel::place(WheelTimerImpl& timer) {
+  ASSERT(timer.expiration_tick_ >= current_tick_);
+  const uint64_t delta = timer.expiration_tick_ - current_tick_;
+  uint32_t level = 0;
+  uint64_t position = timer.expiration_tick_;
+  while (delta >= (uint64_t(1) << (SlotBits * (level + 1)))) {
+    if (level == NumLevels - 1) {
+      // Beyond the wheel: the timer waits at the end of the wheel and is re-placed from there.
+      position = current_tick_ + (uint64_t(1) << (SlotBits * NumLevels)) - 1;
+      break;
+    }
+    level++;
+  }
+  timer.level_ = level;
+  timer.slot_ = (position >> (SlotBits * level)) & SlotMask;
+  level_sizes_[level]++;
+  slots_[level][timer.slot_].pushBack(timer);
+}
+
+void TimerWheel::disarm(WheelTimerImpl& timer) {
+  if (!timer.armed_) {
+    return;
+  }
+  timer.unlink();
+  if (timer.level_ != ExpiringLevel) {
+    ASSERT(level_sizes_[timer.level_] > 0);
+    level_sizes_[timer.level_]--;
+  }
+  timer.armed_ = false;
+  // The driver is left armed, and finds nothing to fire if this was the next timer.
+}
+
+void TimerWheel::cascade(uint32_t level) {
+  Link& slot = slots_[level][(current_tick_ >> (SlotBits * level)) & SlotMask];
+  Link pending;
+  while (slot.linked()) {
+    Link* timer = slot.next_;
+    timer->unlink();
+    pending.pushBack(*timer);
+  }
+  while (pending.linked()) {
+    WheelTimerImpl& timer = *static_cast<WheelTimerImpl*>(pending.next_);
+    timer.unlink();
+    level_sizes_[level]--;
+    place(timer);
+  }
+}
+
+uint64_t TimerWheel::cascadeTick(uint32_t level, uint64_t slot) const {
+  // Slots of the level are reached every SlotsPerLevel^level ticks, in order.
+  const uint32_t shift = SlotBits * level;
+  const uint64_t next = (current_tick_ + (uint64_t(1) << shift) - 1) >> shift;
+  return (next + ((slot - next) & SlotMask)) << shift;
+}
+
+bool TimerWheel::nextTick(uint64_t& tick) const {
+  bool found = false;
+  for (uint32_t level = NumLevels - 1; level > 0; level--) {
+    if (level_sizes_[level] == 0) {
+      continue;
+    }
+    for (uint64_t slot = 0; slot < SlotsPerLevel; slot++) {
+      if (slots_[level][slot].linked()) {
+        const uint64_t candidate = cascadeTick(level, slot);
+        if (!found || candidate < tick) {
+          tick = candidate;
+          found = true;
+        }
+      }
+    }
+  }
+  if (level_sizes_[0] > 0) {
+    for (uint64_t candidate = current_tick_;
+         candidate < current_tick_ + SlotsPerLevel && (!found || candidate < tick); candidate++) {
+      if (slots_[0][candidate & SlotMask].linked()) {
+        tick = candidate;
+        return true;
+      }
+    }
+  }
+  return found;
+}
+
+void TimerWheel::onDriverTimer() {
+  driver_armed_ = false;
+  firing_ = true;
+  const uint64_t now = nowTick();
+  uint64_t tick;
+  while (nextTick(tick) && tick <= now) {
+    current_tick_ = tick;
+    // On a wrap of a level, the slot of the level above covering the next rotation is moved down.
+    for (uint32_t level = 1;
+         level < NumLevels && ((current_tick_ >> (SlotBits * (level - 1))) & SlotMask) == 0;
+         level++) {
+      cascade(level);
+    }
+    current_tick_ = tick + 1;
+
+    Link& slot = slots_[0][tick & SlotMask];
+    while (slot.linked()) {
+      WheelTimerImpl& timer = *static_cast<WheelTimerImpl*>(slot.next_);
+      timer.unlink();
+      level_sizes_[0]--;
+      timer.level_ = ExpiringLevel;
+      expiring_.pushBack(timer);
+    }
+    // Callbacks may disarm, re-arm or destroy any timer, including those left to fire.
+    while (expiring_.linked()) {
+      WheelTimerImpl& timer = *static_cast<WheelTimerImpl*>(expiring_.next_);
+      timer.unlink();
+      if (timer.expiration_tick_ > tick) {
+        place(timer);
+        continue;
+      }
+      timer.armed_ = false;
+      timer.cb_();
+    }
+  }
+  // Nothing is due up to now, so there is nothing to process until the next tick.
+  current_tick_ = std::max(current_tick_, now + 1);
+  firing_ = false;
+  scheduleDriver();
+}
+
+void TimerWheel::scheduleDriver() {
+  uint64_t tick;
+  if (nextTick(tick)) {
+    scheduleDriverAt(tick);
+  } else if (driver_armed_) {
+    driver_->disableTimer();
+    driver_armed_ = false;
+  }
+}
+
+void TimerWheel::scheduleDriverAt(uint64_t tick) {
+  driver_tick_ = tick;
+  driver_armed_ = true;
+  const MonotonicTime deadline = epoch_ + tick * tick_;
+  const MonotonicTime now = time_source_.monotonicTime();
+  std::chrono::milliseconds delay(0);
+  if (deadline > now) {
+    delay = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+    if (delay < deadline - now) {
+      delay++;
+    }
+  }
+  driver_->enableTimer(delay);
+}
+
+} // namespace Event
+} // namespace Envoy
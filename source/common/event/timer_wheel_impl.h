@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "envoy/common/time.h"
+#include "envoy/event/timer.h"
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+namespace Event {
+
+/**
+ * Hierarchical hashed timing wheel for coarse timers, such as idle and request timeouts, which are
+ * re-armed far more often than they fire. All the timers of a wheel share a single Timer from the
+ * underlying scheduler, so arming or disarming a wheel timer is a list operation instead of a
+ * libevent heap operation. Pushing back the timeout of an armed timer, as done by an idle timer on
+ * every read, only records the new expiration, and the timer is moved when its slot is reached.
+ *
+ * Time is divided into ticks of a fixed granularity. The wheel has NumLevels levels of
+ * SlotsPerLevel slots, where a slot of level n covers SlotsPerLevel^n ticks. Timers are placed in
+ * the lowest level covering their expiration, and moved down a level whenever a slot of the level
+ * below wraps around. Timers expiring further than the wheel covers are placed at its end, and
+ * re-placed when reached.
+ *
+ * Timers fire no earlier than requested, and at most one tick later while the dispatcher keeps up.
+ * The wheel is not thread safe; it is owned and used by a single dispatcher.
+ */
+class TimerWheel : NonCopyable {
+public:
+  /**
+   * @param scheduler supplies the scheduler used to create the timer driving the wheel.
+   * @param time_source supplies the time source, which must be that of the scheduler.
+   * @param tick supplies the granularity of the wheel's timers.
+   */
+  TimerWheel(Scheduler& scheduler, TimeSource& time_source, std::chrono::milliseconds tick);
+
+  /**
+   * Create a timer driven by the wheel. The timer must be destroyed before the wheel.
+   * @param cb supplies the callback to invoke when the timer fires.
+   */
+  TimerPtr createTimer(TimerCb cb);
+
+  static const uint32_t NumLevels = 4;
+  static const uint32_t SlotBits = 8;
+  static const uint32_t SlotsPerLevel = 1 << SlotBits;
+
+private:
+  class WheelTimerImpl;
+
+  /**
+   * Intrusive doubly linked list node. Each slot is a circular list around a sentinel node, so
+   * that a timer can unlink itself without knowing its slot.
+   */
+  struct Link {
+    Link() : prev_(this), next_(this) {}
+
+    bool linked() const { return next_ != this; }
+    void unlink() {
+      prev_->next_ = next_;
+      next_->prev_ = prev_;
+      prev_ = next_ = this;
+    }
+    void pushBack(Link& link) {
+      link.prev_ = prev_;
+      link.next_ = this;
+      prev_->next_ = &link;
+      prev_ = &link;
+    }
+
+    Link* prev_;
+    Link* next_;
+  };
+
+  uint64_t nowTick() const;
+  uint64_t expirationTick(const std::chrono::milliseconds& d) const;
+  void arm(WheelTimerImpl& timer, uint64_t expiration_tick);
+  void place(WheelTimerImpl& timer);
+  void disarm(WheelTimerImpl& timer);
+  void cascade(uint32_t level);
+  uint64_t cascadeTick(uint32_t level, uint64_t slot) const;
+  bool nextTick(uint64_t& tick) const;
+  bool slotsEmpty() const;
+  void onDriverTimer();
+  void scheduleDriver();
+  void scheduleDriverAt(uint64_t tick);
+
+  TimeSource& time_source_;
+  const MonotonicTime::duration tick_;
+  const MonotonicTime epoch_;
+  TimerPtr driver_;
+  // The next tick to be processed. Ticks before it have fired.
+  uint64_t current_tick_{};
+  // The tick the driver timer is armed for, if driver_armed_.
+  uint64_t driver_tick_{};
+  bool driver_armed_{};
+  // Set while firing timers, during which the driver is only re-armed once done.
+  bool firing_{};
+  uint64_t level_sizes_[NumLevels]{};
+  Link slots_[NumLevels][SlotsPerLevel];
+  // Timers being fired, detached from their slot so that callbacks may re-arm them.
+  Link expiring_;
+};
+
+} // namespace Event
+} // namespace Envoy
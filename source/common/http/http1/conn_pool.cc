@@ -1,5 +1,6 @@
 #include "common/http/http1/conn_pool.h"
 
+#include <cmath>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -52,6 +53,8 @@ void ConnPoolImpl::drainConnections() {
   }
 }
 
+void ConnPoolImpl::warmUp() { createConnections(host_->cluster().warmConnections()); }
+
 void ConnPoolImpl::addDrainedCallback(DrainedCb cb) {
   drained_callbacks_.push_back(cb);
   checkForDrained();
@@ -82,6 +85,15 @@ void ConnPoolImpl::createNewConnection() {
   client->moveIntoList(std::move(client), busy_clients_);
 }
 
+void ConnPoolImpl::createConnections(uint64_t connections) {
+  // Connections are not opened ahead of demand while the pool drains, nor over the circuit breaker.
+  while (drained_callbacks_.empty() && ready_clients_.size() + busy_clients_.size() < connections &&
+         host_->cluster().resourceManager(priority_).connections().canCreate()) {
+    host_->cluster().stats().upstream_cx_preconnect_.inc();
+    createNewConnection();
+  }
+}
+
 ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_decoder,
                                                      ConnectionPool::Callbacks& callbacks) {
   host_->cluster().stats().upstream_rq_total_.inc();
@@ -90,6 +102,7 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_dec
     ready_clients_.front()->moveBetweenLists(ready_clients_, busy_clients_);
     ENVOY_CONN_LOG(debug, "using existing connection", *busy_clients_.front()->codec_client_);
     attachRequestToClient(*busy_clients_.front(), response_decoder, callbacks);
+    preconnect();
     return nullptr;
   }
 
@@ -105,7 +118,9 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_dec
       createNewConnection();
     }
 
-    return newPendingRequest(response_decoder, callbacks);
+    ConnectionPool::Cancellable* pending_request = newPendingRequest(response_decoder, callbacks);
+    preconnect();
+    return pending_request;
   } else {
     ENVOY_LOG(debug, "max pending requests overflow");
     callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::Overflow, nullptr);
@@ -121,6 +136,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
     ENVOY_CONN_LOG(debug, "client disconnected", *client.codec_client_);
     ActiveClientPtr removed;
     bool check_for_drained = true;
+    bool connect_failure = false;
     if (client.stream_wrapper_) {
       if (!client.stream_wrapper_->decode_complete_) {
         if (event == Network::ConnectionEvent::LocalClose) {
@@ -143,6 +159,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       check_for_drained = false;
     } else {
       // The only time this happens is if we actually saw a connect failure.
+      connect_failure = true;
       host_->cluster().stats().upstream_cx_connect_fail_.inc();
       host_->stats().cx_connect_fail_.inc();
 
@@ -162,6 +179,12 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       createNewConnection();
     }
 
+    // Replace the connection if it was needed ahead of demand. This is not done after connect
+    // failures, so that a failing host is not retried in a loop.
+    if (!connect_failure) {
+      preconnect();
+    }
+
     if (check_for_drained) {
       checkForDrained();
     }
@@ -221,6 +244,13 @@ void ConnPoolImpl::onUpstreamReady() {
   }
 }
 
+void ConnPoolImpl::preconnect() {
+  const float ratio = host_->cluster().perUpstreamPreconnectRatio();
+  if (ratio > 1.0) {
+    createConnections(std::ceil(ratio * (num_active_requests_ + pending_requests_.size())));
+  }
+}
+
 void ConnPoolImpl::processIdleClient(ActiveClient& client, bool delay) {
   client.stream_wrapper_.reset();
   if (pending_requests_.empty() || delay) {
@@ -252,11 +282,13 @@ ConnPoolImpl::StreamWrapper::StreamWrapper(StreamDecoder& response_decoder, Acti
   StreamEncoderWrapper::inner_.getStream().addCallbacks(*this);
   parent_.parent_.host_->cluster().stats().upstream_rq_active_.inc();
   parent_.parent_.host_->stats().rq_active_.inc();
+  parent_.parent_.num_active_requests_++;
 }
 
 ConnPoolImpl::StreamWrapper::~StreamWrapper() {
   parent_.parent_.host_->cluster().stats().upstream_rq_active_.dec();
   parent_.parent_.host_->stats().rq_active_.dec();
+  parent_.parent_.num_active_requests_--;
 }
 
 void ConnPoolImpl::StreamWrapper::onEncodeComplete() { encode_complete_ = true; }
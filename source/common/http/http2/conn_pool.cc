@@ -40,6 +40,14 @@ void ConnPoolImpl::ConnPoolImpl::drainConnections() {
   }
 }
 
+void ConnPoolImpl::warmUp() {
+  // A single connection serves all the streams of the pool, so there is at most one to open.
+  if (host_->cluster().warmConnections() > 0 && !primary_client_ && drained_callbacks_.empty()) {
+    host_->cluster().stats().upstream_cx_preconnect_.inc();
+    primary_client_ = std::make_unique<ActiveClient>(*this);
+  }
+}
+
 void ConnPoolImpl::addDrainedCallback(DrainedCb cb) {
   drained_callbacks_.push_back(cb);
   checkForDrained();
@@ -0,0 +1,47 @@
+#include "common/network/connection_balancer_impl.h"
+
+#include <algorithm>
+
+#include "common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Network {
+
+void ExactConnectionBalancerImpl::registerHandler(BalancedConnectionHandler& handler) {
+  Thread::LockGuard lock(lock_);
+  handlers_.push_back(&handler);
+}
+
+void ExactConnectionBalancerImpl::unregisterHandler(BalancedConnectionHandler& handler) {
+  Thread::LockGuard lock(lock_);
+  handlers_.erase(std::remove(handlers_.begin(), handlers_.end(), &handler), handlers_.end());
+}
+
+bool ExactConnectionBalancerImpl::balanceConnection(BalancedConnectionHandler& current_handler,
+                                                    ConnectionSocketPtr& socket) {
+  Thread::LockGuard lock(lock_);
+  // Ties go to the current handler, which saves a post when the workers are balanced. A current
+  // handler which is no longer registered is only picked if no handler is.
+  BalancedConnectionHandler* min_handler = &current_handler;
+  uint64_t min_connections = UINT64_MAX;
+  for (BalancedConnectionHandler* handler : handlers_) {
+    const uint64_t connections = handler->numConnections();
+    if (connections < min_connections ||
+        (connections == min_connections && handler == &current_handler)) {
+      min_handler = handler;
+      min_connections = connections;
+    }
+  }
+  // The picked handler is accounted for under the lock, so that concurrent picks see it. The socket
+  // is also posted under the lock, which keeps the handler from being unregistered and destroyed
+  // by its worker in the meantime.
+  min_handler->incNumConnections();
+  if (min_handler == &current_handler) {
+    return false;
+  }
+  min_handler->post(std::move(socket));
+  return true;
+}
+
+} // namespace Network
+} // namespace Envoy
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "envoy/network/connection_balancer.h"
+
+#include "common/common/thread.h"
+#include "common/common/thread_annotations.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * Balancer which leaves each connection with the worker which accepted it.
+ */
+class NopConnectionBalancerImpl : public ConnectionBalancer {
+public:
+  // Network::ConnectionBalancer
+  void registerHandler(BalancedConnectionHandler&) override {}
+  void unregisterHandler(BalancedConnectionHandler&) override {}
+  bool balanceConnection(BalancedConnectionHandler& current_handler,
+                         ConnectionSocketPtr&) override {
+    current_handler.incNumConnections();
+    return false;
+  }
+};
+
+/**
+ * Balancer which hands each connection to the worker owning the fewest connections at the time it
+ * is accepted. Every pick takes a lock shared by all the workers of the listener, so this is meant
+ * for listeners with long-lived connections, whose accept rate is low.
+ */
+class ExactConnectionBalancerImpl : public ConnectionBalancer {
+public:
+  // Network::ConnectionBalancer
+  void registerHandler(BalancedConnectionHandler& handler) override;
+  void unregisterHandler(BalancedConnectionHandler& handler) override;
+  bool balanceConnection(BalancedConnectionHandler& current_handler,
+                         ConnectionSocketPtr& socket) override;
+
+private:
+  Thread::MutexBasicLockable lock_;
+  std::vector<BalancedConnectionHandler*> handlers_ GUARDED_BY(lock_);
+};
+
+} // namespace Network
+} // namespace Envoy
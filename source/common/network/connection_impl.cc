@@ -67,6 +67,11 @@ ConnectionImpl::ConnectionImpl(Event::Dispatcher& dispatcher, ConnectionSocketPt
       Event::FileReadyType::Read | Event::FileReadyType::Write);
 
   transport_socket_->setTransportSocketCallbacks(*this);
+
+  // The bytes read by the listener filters are not signaled by the socket again.
+  if (socket_->preReadData().length() > 0) {
+    file_event_->activate(Event::FileReadyType::Read);
+  }
 }
 
 ConnectionImpl::~ConnectionImpl() {
@@ -148,7 +153,8 @@ void ConnectionImpl::close(ConnectionCloseType type) {
     // Create and activate a timer which will immediately close the connection if triggered.
     // A config value of 0 disables the timeout.
     if (delayed_close_timeout_set) {
-      delayed_close_timer_ = dispatcher_.createTimer([this]() -> void { onDelayedCloseTimeout(); });
+      delayed_close_timer_ =
+          dispatcher_.createCoarseTimer([this]() -> void { onDelayedCloseTimeout(); });
       ENVOY_CONN_LOG(debug, "setting delayed close timer with timeout {} ms", *this,
                      delayedCloseTimeout().count());
       delayed_close_timer_->enableTimer(delayedCloseTimeout());
@@ -315,8 +321,8 @@ void ConnectionImpl::readDisable(bool disable) {
     file_event_->setEnabled(Event::FileReadyType::Read | Event::FileReadyType::Write);
     // If the connection has data buffered there's no guarantee there's also data in the kernel
     // which will kick off the filter chain. Instead fake an event to make sure the buffered data
-    // gets processed regardless.
-    if (read_buffer_.length() > 0) {
+    // gets processed regardless. The same goes for the bytes read by the listener filters.
+    if (read_buffer_.length() > 0 || socket_->preReadData().length() > 0) {
       file_event_->activate(Event::FileReadyType::Read);
     }
   }
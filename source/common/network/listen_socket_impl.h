@@ -9,6 +9,7 @@
 #include "envoy/network/connection.h"
 #include "envoy/network/listen_socket.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
 
 namespace Envoy {
@@ -146,12 +147,15 @@ public:
   }
   absl::string_view requestedServerName() const override { return server_name_; }
 
+  Buffer::Instance& preReadData() override { return pre_read_data_; }
+
 protected:
   Address::InstanceConstSharedPtr remote_address_;
   bool local_address_restored_{false};
   std::string transport_protocol_;
   std::vector<std::string> application_protocols_;
   std::string server_name_;
+  Buffer::OwnedImpl pre_read_data_;
 };
 
 // ConnectionSocket used with server connections.
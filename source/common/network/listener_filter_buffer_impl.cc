@@ -0,0 +1,33 @@
+#include "common/network/listener_filter_buffer_impl.h"
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Network {
+
+Api::SysCallIntResult ListenerFilterBufferImpl::readFromSocket(uint64_t max_length) {
+  Buffer::Instance& buffer = socket_.preReadData();
+  if (buffer.length() >= max_length) {
+    return {0, 0};
+  }
+  return buffer.read(socket_.fd(), max_length - buffer.length());
+}
+
+absl::string_view ListenerFilterBufferImpl::data() {
+  Buffer::Instance& buffer = socket_.preReadData();
+  if (buffer.length() == 0) {
+    return {};
+  }
+  // The bytes of a few reads usually fit in the first slice of the buffer, which is then not
+  // copied again.
+  return {static_cast<const char*>(buffer.linearize(buffer.length())), buffer.length()};
+}
+
+void ListenerFilterBufferImpl::drain(uint64_t length) {
+  Buffer::Instance& buffer = socket_.preReadData();
+  ASSERT(length <= buffer.length());
+  buffer.drain(length);
+}
+
+} // namespace Network
+} // namespace Envoy
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "envoy/network/filter.h"
+#include "envoy/network/listen_socket.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * Listener filter buffer of an accepted socket. The bytes are kept by the socket, so that they
+ * follow it when it is handed off to another listener, and then to its connection.
+ */
+class ListenerFilterBufferImpl : public ListenerFilterBuffer {
+public:
+  explicit ListenerFilterBufferImpl(ConnectionSocket& socket) : socket_(socket) {}
+
+  // Network::ListenerFilterBuffer
+  Api::SysCallIntResult readFromSocket(uint64_t max_length) override;
+  absl::string_view data() override;
+  void drain(uint64_t length) override;
+
+private:
+  ConnectionSocket& socket_;
+};
+
+} // namespace Network
+} // namespace Envoy
@@ -15,6 +15,16 @@ IoResult RawBufferSocket::doRead(Buffer::Instance& buffer) {
   PostIoAction action = PostIoAction::KeepOpen;
   uint64_t bytes_read = 0;
   bool end_stream = false;
+  // The bytes read by the listener filters come first.
+  Buffer::Instance& pre_read_data = callbacks_->preReadData();
+  if (pre_read_data.length() > 0) {
+    bytes_read += pre_read_data.length();
+    buffer.move(pre_read_data);
+    if (callbacks_->shouldDrainReadBuffer()) {
+      callbacks_->setReadBufferReady();
+      return {action, bytes_read, end_stream};
+    }
+  }
   do {
     // 16K read is arbitrary. TODO(mattklein123) PERF: Tune the read size.
     Api::SysCallIntResult result = buffer.read(callbacks_->fd(), 16384);
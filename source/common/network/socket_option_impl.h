@@ -83,6 +83,27 @@ typedef absl::optional<std::pair<int, int>> SocketOptionName;
 #define ENVOY_SOCKET_TCP_FASTOPEN Network::SocketOptionName()
 #endif
 
+#ifdef TCP_FASTOPEN_CONNECT
+#define ENVOY_SOCKET_TCP_FASTOPEN_CONNECT                                                          \
+  Network::SocketOptionName(std::make_pair(IPPROTO_TCP, TCP_FASTOPEN_CONNECT))
+#else
+#define ENVOY_SOCKET_TCP_FASTOPEN_CONNECT Network::SocketOptionName()
+#endif
+
+#ifdef SO_REUSEPORT
+#define ENVOY_SOCKET_SO_REUSEPORT                                                                  \
+  Network::SocketOptionName(std::make_pair(SOL_SOCKET, SO_REUSEPORT))
+#else
+#define ENVOY_SOCKET_SO_REUSEPORT Network::SocketOptionName()
+#endif
+
+#ifdef SO_INCOMING_CPU
+#define ENVOY_SOCKET_SO_INCOMING_CPU                                                               \
+  Network::SocketOptionName(std::make_pair(SOL_SOCKET, SO_INCOMING_CPU))
+#else
+#define ENVOY_SOCKET_SO_INCOMING_CPU Network::SocketOptionName()
+#endif
+
 class SocketOptionImpl : public Socket::Option, Logger::Loggable<Logger::Id::connection> {
 public:
   SocketOptionImpl(envoy::api::v2::core::SocketOption::SocketState in_state,
@@ -440,7 +440,7 @@ void Filter::onRequestComplete() {
     maybeDoShadowing();
 
     if (timeout_.global_timeout_.count() > 0) {
-      response_timeout_ = dispatcher.createTimer([this]() -> void { onResponseTimeout(); });
+      response_timeout_ = dispatcher.createCoarseTimer([this]() -> void { onResponseTimeout(); });
       response_timeout_->enableTimer(timeout_.global_timeout_);
     }
   }
@@ -483,6 +483,8 @@ void Filter::onUpstreamReset(UpstreamResetType type,
       upstream_host->outlierDetector().putHttpResponseCode(
           enumToInt(type == UpstreamResetType::Reset ? Http::Code::ServiceUnavailable
                                                      : timeout_response_code_));
+      // A host which hangs or resets its streams must not look faster than it is.
+      reportHostResponseTime(false);
     }
   }
 
@@ -703,6 +705,26 @@ void Filter::onUpstreamTrailers(Http::HeaderMapPtr&& trailers) {
   callbacks_->encodeTrailers(std::move(trailers));
 }
 
+void Filter::reportHostResponseTime(bool complete) {
+  if (cluster_->lbType() != Upstream::LoadBalancerType::PeakEwma ||
+      callbacks_->streamInfo().healthCheck()) {
+    return;
+  }
+
+  // The load balancer of the cluster on this worker adapts to the response times of the hosts. The
+  // time is measured from the start of the attempt, so that the host of a retry is not charged the
+  // time of the previous attempts.
+  Upstream::ThreadLocalCluster* cluster = config_.cm_.get(cluster_->name());
+  if (cluster != nullptr) {
+    cluster->loadBalancer().onHostResponse(
+        *upstream_request_->upstream_host_,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            callbacks_->dispatcher().timeSystem().monotonicTime() -
+            upstream_request_->stream_info_.startTimeMonotonic()),
+        complete);
+  }
+}
+
 void Filter::onUpstreamMetadata(Http::MetadataMapPtr&& metadata_map) {
   callbacks_->encodeMetadata(std::move(metadata_map));
 }
@@ -712,6 +734,8 @@ void Filter::onUpstreamComplete() {
     upstream_request_->resetStream();
   }
 
+  reportHostResponseTime(true);
+
   if (config_.emit_dynamic_stats_ && !callbacks_->streamInfo().healthCheck() &&
       DateUtil::timePointValid(downstream_request_complete_time_)) {
     Event::Dispatcher& dispatcher = callbacks_->dispatcher();
@@ -969,8 +993,8 @@ void Filter::UpstreamRequest::resetStream() {
 void Filter::UpstreamRequest::setupPerTryTimeout() {
   ASSERT(!per_try_timeout_);
   if (parent_.timeout_.per_try_timeout_.count() > 0) {
-    per_try_timeout_ =
-        parent_.callbacks_->dispatcher().createTimer([this]() -> void { onPerTryTimeout(); });
+    per_try_timeout_ = parent_.callbacks_->dispatcher().createCoarseTimer(
+        [this]() -> void { onPerTryTimeout(); });
     per_try_timeout_->enableTimer(parent_.timeout_.per_try_timeout_);
   }
 }
@@ -376,6 +376,9 @@ private:
   void onUpstreamTrailers(Http::HeaderMapPtr&& trailers);
   void onUpstreamMetadata(Http::MetadataMapPtr&& metadata_map);
   void onUpstreamComplete();
+  // Reports the response time of the current attempt to the load balancer of the cluster, if it
+  // adapts to the latency of the hosts.
+  void reportHostResponseTime(bool complete);
   void onUpstreamReset(UpstreamResetType type,
                        const absl::optional<Http::StreamResetReason>& reset_reason);
   void sendNoHealthyUpstreamResponse();
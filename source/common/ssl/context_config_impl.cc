@@ -134,7 +134,14 @@ ContextConfigImpl::ContextConfigImpl(
       min_protocol_version_(
           tlsVersionFromProto(config.tls_params().tls_minimum_protocol_version(), TLS1_VERSION)),
       max_protocol_version_(
-          tlsVersionFromProto(config.tls_params().tls_maximum_protocol_version(), TLS1_2_VERSION)) {
+          tlsVersionFromProto(config.tls_params().tls_maximum_protocol_version(), TLS1_2_VERSION)),
+      private_key_signing_threads_(
+          config.has_private_key_offload()
+              ? PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.private_key_offload(), signing_threads, 1)
+              : 0),
+      max_pending_private_key_operations_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(
+          config.private_key_offload(), max_pending_operations, 1024)),
+      kernel_tls_offload_(config.kernel_tls_offload()) {
   if (default_cvc_ && certficate_validation_context_provider_ != nullptr) {
     // We need to validate combined certificate validation context.
     // The default certificate validation context and dynamic certificate validation
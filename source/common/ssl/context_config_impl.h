@@ -39,6 +39,11 @@ public:
   }
   unsigned minProtocolVersion() const override { return min_protocol_version_; };
   unsigned maxProtocolVersion() const override { return max_protocol_version_; };
+  uint32_t privateKeySigningThreads() const override { return private_key_signing_threads_; }
+  uint32_t maxPendingPrivateKeyOperations() const override {
+    return max_pending_private_key_operations_;
+  }
+  bool kernelTlsOffload() const override { return kernel_tls_offload_; }
 
   bool isReady() const override {
     const bool tls_is_ready =
@@ -87,6 +92,9 @@ private:
   Common::CallbackHandle* cvc_validation_callback_handle_{};
   const unsigned min_protocol_version_;
   const unsigned max_protocol_version_;
+  const uint32_t private_key_signing_threads_;
+  const uint32_t max_pending_private_key_operations_;
+  const bool kernel_tls_offload_;
 };
 
 class ClientContextConfigImpl : public ContextConfigImpl, public ClientContextConfig {
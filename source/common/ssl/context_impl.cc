@@ -44,7 +44,8 @@ bool cbsContainsU16(CBS& cbs, uint16_t n) {
 
 ContextImpl::ContextImpl(Stats::Scope& scope, const ContextConfig& config, TimeSource& time_source)
     : scope_(scope), stats_(generateStats(scope)), time_source_(time_source),
-      tls_max_version_(config.maxProtocolVersion()) {
+      tls_max_version_(config.maxProtocolVersion()),
+      kernel_tls_offload_(config.kernelTlsOffload()) {
   const auto tls_certificates = config.tlsCertificates();
   tls_contexts_.resize(std::max(1UL, tls_certificates.size()));
 
@@ -275,6 +276,16 @@ ContextImpl::ContextImpl(Stats::Scope& scope, const ContextConfig& config, TimeS
     }
   }
 
+  // Offload the private key operations of the handshakes to the signing threads.
+  if (config.privateKeySigningThreads() > 0 && !tls_certificates.empty()) {
+    private_key_signer_ = std::make_shared<PrivateKeySigner>(
+        config.privateKeySigningThreads(), config.maxPendingPrivateKeyOperations(), scope,
+        time_source);
+    for (uint32_t i = 0; i < tls_certificates.size(); ++i) {
+      PrivateKeySigner::setPrivateKeyMethod(tls_contexts_[i].ssl_ctx_.get());
+    }
+  }
+
   // use the server's cipher list preferences
   for (auto& ctx : tls_contexts_) {
     SSL_CTX_set_options(ctx.ssl_ctx_.get(), SSL_OP_CIPHER_SERVER_PREFERENCE);
@@ -644,8 +655,10 @@ int ClientContextImpl::newSessionKey(SSL_SESSION* session) {
 
 ServerContextImpl::ServerContextImpl(Stats::Scope& scope, const ServerContextConfig& config,
                                      const std::vector<std::string>& server_names,
-                                     TimeSource& time_source)
-    : ContextImpl(scope, config, time_source), session_ticket_keys_(config.sessionTicketKeys()) {
+                                     TimeSource& time_source, SessionCache& session_cache,
+                                     SessionTicketKeyRotator& shared_ticket_keys)
+    : ContextImpl(scope, config, time_source), session_ticket_keys_(config.sessionTicketKeys()),
+      session_cache_(session_cache), shared_ticket_keys_(shared_ticket_keys) {
   if (config.tlsCertificates().empty()) {
     throw EnvoyException("Server TlsCertificates must have a certificate specified");
   }
@@ -665,6 +678,8 @@ ServerContextImpl::ServerContextImpl(Stats::Scope& scope, const ServerContextCon
   uint8_t session_context_buf[EVP_MAX_MD_SIZE] = {};
   unsigned session_context_len = 0;
   generateHashForSessionContexId(server_names, session_context_buf, session_context_len);
+  session_context_id_.assign(reinterpret_cast<const char*>(session_context_buf),
+                             session_context_len);
   for (auto& ctx : tls_contexts_) {
     if (config.certificateValidationContext() != nullptr &&
         !config.certificateValidationContext()->caCert().empty()) {
@@ -682,19 +697,35 @@ ServerContextImpl::ServerContextImpl(Stats::Scope& scope, const ServerContextCon
                                  this);
     }
 
-    if (!session_ticket_keys_.empty()) {
-      SSL_CTX_set_tlsext_ticket_key_cb(
-          ctx.ssl_ctx_.get(),
-          [](SSL* ssl, uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx, HMAC_CTX* hmac_ctx,
-             int encrypt) -> int {
-            ContextImpl* context_impl =
-                static_cast<ContextImpl*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
-            ServerContextImpl* server_context_impl = dynamic_cast<ServerContextImpl*>(context_impl);
-            RELEASE_ASSERT(server_context_impl != nullptr, ""); // for Coverity
-            return server_context_impl->sessionTicketProcess(ssl, key_name, iv, ctx, hmac_ctx,
-                                                             encrypt);
-          });
-    }
+    // Without configured keys, the tickets are protected by the keys shared by all the server
+    // contexts rather than by keys internal to the context, so that they survive configuration
+    // updates and hot restarts.
+    SSL_CTX_set_tlsext_ticket_key_cb(
+        ctx.ssl_ctx_.get(),
+        [](SSL* ssl, uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx, HMAC_CTX* hmac_ctx,
+           int encrypt) -> int {
+          return fromSslCtx(SSL_get_SSL_CTX(ssl))
+              ->sessionTicketProcess(ssl, key_name, iv, ctx, hmac_ctx, encrypt);
+        });
+
+    // Sessions resumed by ID are stored in the shared session cache.
+    SSL_CTX_set_session_cache_mode(ctx.ssl_ctx_.get(),
+                                   SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx.ssl_ctx_.get(), [](SSL* ssl, SSL_SESSION* session) -> int {
+      fromSslCtx(SSL_get_SSL_CTX(ssl))->session_cache_.insert(session);
+      return 1; // Tell BoringSSL that we took ownership of the session.
+    });
+    SSL_CTX_sess_set_get_cb(ctx.ssl_ctx_.get(),
+                            [](SSL* ssl, const uint8_t* session_id, int session_id_len,
+                               int* out_copy) -> SSL_SESSION* {
+                              // The session is returned with a reference owned by BoringSSL.
+                              *out_copy = 0;
+                              return fromSslCtx(SSL_get_SSL_CTX(ssl))
+                                  ->lookupSession(session_id, session_id_len);
+                            });
+    SSL_CTX_sess_set_remove_cb(ctx.ssl_ctx_.get(), [](SSL_CTX* ssl_ctx, SSL_SESSION* session) {
+      fromSslCtx(ssl_ctx)->session_cache_.remove(session);
+    });
 
     int rc = SSL_CTX_set_session_id_context(ctx.ssl_ctx_.get(), session_context_buf,
                                             session_context_len);
@@ -794,19 +825,39 @@ void ServerContextImpl::generateHashForSessionContexId(const std::vector<std::st
   RELEASE_ASSERT(rc == 1, "");
 }
 
+ServerContextImpl* ServerContextImpl::fromSslCtx(SSL_CTX* ssl_ctx) {
+  ContextImpl* context_impl = static_cast<ContextImpl*>(SSL_CTX_get_app_data(ssl_ctx));
+  ServerContextImpl* server_context_impl = dynamic_cast<ServerContextImpl*>(context_impl);
+  RELEASE_ASSERT(server_context_impl != nullptr, ""); // for Coverity
+  return server_context_impl;
+}
+
+SSL_SESSION* ServerContextImpl::lookupSession(const uint8_t* session_id, int session_id_len) {
+  SSL_SESSION* session = session_cache_.lookup(session_context_id_, session_id, session_id_len);
+  if (session != nullptr) {
+    stats_.session_cache_hit_.inc();
+  } else {
+    stats_.session_cache_miss_.inc();
+  }
+  return session;
+}
+
 int ServerContextImpl::sessionTicketProcess(SSL*, uint8_t* key_name, uint8_t* iv,
                                             EVP_CIPHER_CTX* ctx, HMAC_CTX* hmac_ctx, int encrypt) {
   const EVP_MD* hmac = EVP_sha256();
   const EVP_CIPHER* cipher = EVP_aes_256_cbc();
 
+  // The snapshot of the shared keys is kept alive while the keys are in use.
+  const SessionTicketKeyRotator::KeysConstSharedPtr shared_keys =
+      session_ticket_keys_.empty() ? shared_ticket_keys_.keys() : nullptr;
+  const std::vector<ServerContextConfig::SessionTicketKey>& keys =
+      shared_keys != nullptr ? *shared_keys : session_ticket_keys_;
+
   if (encrypt == 1) {
     // Encrypt
-    RELEASE_ASSERT(session_ticket_keys_.size() >= 1, "");
-    // TODO(ggreenway): validate in SDS that session_ticket_keys_ cannot be empty,
-    // or if we allow it to be emptied, reconfigure the context so this callback
-    // isn't set.
+    RELEASE_ASSERT(keys.size() >= 1, "");
 
-    const ServerContextConfig::SessionTicketKey& key = session_ticket_keys_.front();
+    const ServerContextConfig::SessionTicketKey& key = keys.front();
 
     static_assert(std::tuple_size<decltype(key.name_)>::value == SSL_TICKET_KEY_NAME_LEN,
                   "Expected key.name length");
@@ -830,7 +881,7 @@ int ServerContextImpl::sessionTicketProcess(SSL*, uint8_t* key_name, uint8_t* iv
   } else {
     // Decrypt
     bool is_enc_key = true; // first element is the encryption key
-    for (const ServerContextConfig::SessionTicketKey& key : session_ticket_keys_) {
+    for (const ServerContextConfig::SessionTicketKey& key : keys) {
       static_assert(std::tuple_size<decltype(key.name_)>::value == SSL_TICKET_KEY_NAME_LEN,
                     "Expected key.name length");
       if (std::equal(key.name_.begin(), key.name_.end(), key_name)) {
@@ -844,12 +895,16 @@ int ServerContextImpl::sessionTicketProcess(SSL*, uint8_t* key_name, uint8_t* iv
         }
 
         // If our current encryption was not the decryption key, renew
+        if (!is_enc_key) {
+          stats_.session_ticket_renewed_.inc();
+        }
         return is_enc_key ? 1  // success; do not renew
                           : 2; // success: renew key
       }
       is_enc_key = false;
     }
 
+    stats_.session_ticket_unknown_key_.inc();
     return 0; // decryption failed
   }
 }
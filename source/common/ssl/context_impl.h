@@ -11,6 +11,8 @@
 #include "envoy/stats/stats_macros.h"
 
 #include "common/ssl/context_manager_impl.h"
+#include "common/ssl/private_key_signer.h"
+#include "common/ssl/session_resumption.h"
 
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
@@ -32,7 +34,17 @@ namespace Ssl {
   COUNTER(fail_verify_no_cert)                                                                     \
   COUNTER(fail_verify_error)                                                                       \
   COUNTER(fail_verify_san)                                                                         \
-  COUNTER(fail_verify_cert_hash)
+  COUNTER(fail_verify_cert_hash)                                                                   \
+  COUNTER(kernel_tls_tx)                                                                           \
+  COUNTER(kernel_tls_rx)                                                                           \
+  COUNTER(kernel_tls_fallback)                                                                     \
+  COUNTER(write_records)                                                                           \
+  COUNTER(write_small_records)                                                                     \
+  COUNTER(write_coalesced_bytes)                                                                   \
+  COUNTER(session_cache_hit)                                                                       \
+  COUNTER(session_cache_miss)                                                                      \
+  COUNTER(session_ticket_renewed)                                                                  \
+  COUNTER(session_ticket_unknown_key)
 // clang-format on
 
 /**
@@ -71,6 +83,17 @@ public:
 
   SslStats& stats() { return stats_; }
 
+  /**
+   * @return the signer performing the private key operations of the handshakes, or nullptr if
+   *         they are performed on the workers.
+   */
+  PrivateKeySigner* privateKeySigner() const { return private_key_signer_.get(); }
+
+  /**
+   * @return true if the record layer of the connections is offloaded to the kernel when possible.
+   */
+  bool kernelTlsOffload() const { return kernel_tls_offload_; }
+
   // Ssl::Context
   size_t daysUntilFirstCertExpires() const override;
   CertificateDetailsPtr getCaCertInformation() const override;
@@ -156,6 +179,8 @@ protected:
   std::string cert_chain_file_path_;
   TimeSource& time_source_;
   const unsigned tls_max_version_;
+  const bool kernel_tls_offload_;
+  PrivateKeySignerSharedPtr private_key_signer_;
 };
 
 typedef std::shared_ptr<ContextImpl> ContextImplSharedPtr;
@@ -180,10 +205,18 @@ private:
 
 class ServerContextImpl : public ContextImpl, public ServerContext {
 public:
+  /**
+   * @param session_cache supplies the session cache shared by the server contexts.
+   * @param shared_ticket_keys supplies the session ticket keys used when the context does not
+   *        configure its own keys.
+   */
   ServerContextImpl(Stats::Scope& scope, const ServerContextConfig& config,
-                    const std::vector<std::string>& server_names, TimeSource& time_source);
+                    const std::vector<std::string>& server_names, TimeSource& time_source,
+                    SessionCache& session_cache, SessionTicketKeyRotator& shared_ticket_keys);
 
 private:
+  static ServerContextImpl* fromSslCtx(SSL_CTX* ssl_ctx);
+  SSL_SESSION* lookupSession(const uint8_t* session_id, int session_id_len);
   int alpnSelectCallback(const unsigned char** out, unsigned char* outlen, const unsigned char* in,
                          unsigned int inlen);
   int sessionTicketProcess(SSL* ssl, uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx,
@@ -196,6 +229,9 @@ private:
                                       uint8_t* session_context_buf, unsigned& session_context_len);
 
   const std::vector<ServerContextConfig::SessionTicketKey> session_ticket_keys_;
+  SessionCache& session_cache_;
+  SessionTicketKeyRotator& shared_ticket_keys_;
+  std::string session_context_id_;
 };
 
 } // namespace Ssl
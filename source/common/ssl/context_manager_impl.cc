@@ -10,6 +10,14 @@
 namespace Envoy {
 namespace Ssl {
 
+constexpr uint64_t ContextManagerImpl::MaxCachedSessions;
+constexpr std::chrono::seconds ContextManagerImpl::TicketKeyRotationInterval;
+constexpr uint32_t ContextManagerImpl::NumTicketKeys;
+
+ContextManagerImpl::ContextManagerImpl(TimeSource& time_source)
+    : time_source_(time_source), session_cache_(MaxCachedSessions),
+      session_ticket_keys_(time_source, TicketKeyRotationInterval, NumTicketKeys) {}
+
 ContextManagerImpl::~ContextManagerImpl() {
   removeEmptyContexts();
   ASSERT(contexts_.empty());
@@ -39,7 +47,8 @@ ContextManagerImpl::createSslServerContext(Stats::Scope& scope, const ServerCont
   }
 
   ServerContextSharedPtr context =
-      std::make_shared<ServerContextImpl>(scope, config, server_names, time_source_);
+      std::make_shared<ServerContextImpl>(scope, config, server_names, time_source_,
+                                          session_cache_, session_ticket_keys_);
   removeEmptyContexts();
   contexts_.emplace_back(context);
   return context;
@@ -56,6 +65,15 @@ size_t ContextManagerImpl::daysUntilFirstCertExpires() const {
   return ret;
 }
 
+std::vector<ServerContextConfig::SessionTicketKey> ContextManagerImpl::sessionTicketKeys() {
+  return *session_ticket_keys_.keys();
+}
+
+void ContextManagerImpl::setSessionTicketKeys(
+    const std::vector<ServerContextConfig::SessionTicketKey>& keys) {
+  session_ticket_keys_.setKeys(keys);
+}
+
 void ContextManagerImpl::iterateContexts(std::function<void(const Context&)> callback) {
   for (const auto& ctx_weak_ptr : contexts_) {
     ContextSharedPtr context = ctx_weak_ptr.lock();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <list>
 
@@ -7,6 +8,8 @@
 #include "envoy/ssl/context_manager.h"
 #include "envoy/stats/scope.h"
 
+#include "common/ssl/session_resumption.h"
+
 namespace Envoy {
 namespace Ssl {
 
@@ -16,10 +19,13 @@ namespace Ssl {
  * thread). They can be released from any thread (and in practice are since cluster information can
  * be released from any thread). Context allocation/free is a very uncommon thing so we just do a
  * global lock to protect it all.
+ *
+ * The manager also owns the session resumption state shared by the server contexts, which outlives
+ * the contexts replaced on configuration updates.
  */
 class ContextManagerImpl final : public ContextManager {
 public:
-  ContextManagerImpl(TimeSource& time_source) : time_source_(time_source) {}
+  ContextManagerImpl(TimeSource& time_source);
   ~ContextManagerImpl();
 
   // Ssl::ContextManager
@@ -30,11 +36,24 @@ public:
                          const std::vector<std::string>& server_names) override;
   size_t daysUntilFirstCertExpires() const override;
   void iterateContexts(std::function<void(const Context&)> callback) override;
+  std::vector<ServerContextConfig::SessionTicketKey> sessionTicketKeys() override;
+  void
+  setSessionTicketKeys(const std::vector<ServerContextConfig::SessionTicketKey>& keys) override;
+
+  // Sessions kept in the shared server session cache. This matches the default size of the
+  // internal cache of a BoringSSL context.
+  static constexpr uint64_t MaxCachedSessions = 20480;
+  // The shared session ticket keys are rotated every hour, and the tickets they issued are accepted
+  // for two more hours, which covers the default lifetime of TLS 1.2 sessions in BoringSSL.
+  static constexpr std::chrono::seconds TicketKeyRotationInterval{3600};
+  static constexpr uint32_t NumTicketKeys = 3;
 
 private:
   void removeEmptyContexts();
   TimeSource& time_source_;
   std::list<std::weak_ptr<Context>> contexts_;
+  SessionCache session_cache_;
+  SessionTicketKeyRotator session_ticket_keys_;
 };
 
 } // namespace Ssl
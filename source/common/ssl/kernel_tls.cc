@@ -0,0 +1,199 @@
+#include "common/ssl/kernel_tls.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <cstring>
+
+#include "common/api/os_sys_calls_impl.h"
+#include "common/common/assert.h"
+
+#ifdef __linux__
+#include <linux/tls.h>
+#endif
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+namespace Envoy {
+namespace Ssl {
+
+#ifdef TLS_RX
+namespace {
+
+// TLS record types and alerts of RFC 5246.
+constexpr uint8_t RecordTypeAlert = 21;
+constexpr uint8_t AlertLevelWarning = 1;
+constexpr uint8_t AlertCloseNotify = 0;
+
+// The kernel knows the salt and the sequence number as 4 and 8 byte arrays for all AES-GCM key
+// sizes.
+constexpr size_t SaltSize = 4;
+
+void sequenceToBytes(uint64_t sequence, unsigned char* bytes) {
+  for (int i = 7; i >= 0; i--) {
+    bytes[i] = sequence & 0xff;
+    sequence >>= 8;
+  }
+}
+
+template <class CryptoInfo>
+bool installKeys(int fd, int direction, uint16_t cipher_type, const uint8_t* key,
+                 const uint8_t* salt, uint64_t sequence) {
+  CryptoInfo info;
+  memset(&info, 0, sizeof(info));
+  info.info.version = TLS_1_2_VERSION;
+  info.info.cipher_type = cipher_type;
+  memcpy(info.key, key, sizeof(info.key));
+  static_assert(sizeof(info.salt) == SaltSize, "unexpected AES-GCM salt size");
+  memcpy(info.salt, salt, sizeof(info.salt));
+  sequenceToBytes(sequence, info.rec_seq);
+  // BoringSSL uses the sequence number of the records as their explicit nonce.
+  sequenceToBytes(sequence, info.iv);
+  const Api::SysCallIntResult result =
+      Api::OsSysCallsSingleton::get().setsockopt(fd, SOL_TLS, direction, &info, sizeof(info));
+  OPENSSL_cleanse(&info, sizeof(info));
+  return result.rc_ == 0;
+}
+
+bool installKeys(int fd, int direction, int cipher_nid, const uint8_t* key, const uint8_t* salt,
+                 uint64_t sequence) {
+  switch (cipher_nid) {
+  case NID_aes_128_gcm:
+    return installKeys<tls12_crypto_info_aes_gcm_128>(fd, direction, TLS_CIPHER_AES_GCM_128, key,
+                                                      salt, sequence);
+#ifdef TLS_CIPHER_AES_GCM_256
+  case NID_aes_256_gcm:
+    return installKeys<tls12_crypto_info_aes_gcm_256>(fd, direction, TLS_CIPHER_AES_GCM_256, key,
+                                                      salt, sequence);
+#endif
+  default:
+    return false;
+  }
+}
+
+size_t keySize(int cipher_nid) {
+  switch (cipher_nid) {
+  case NID_aes_128_gcm:
+    return 16;
+#ifdef TLS_CIPHER_AES_GCM_256
+  case NID_aes_256_gcm:
+    return 32;
+#endif
+  default:
+    return 0;
+  }
+}
+
+} // namespace
+
+KernelTls::Offload KernelTls::enable(SSL* ssl, int fd) {
+  Offload offload;
+  if (SSL_version(ssl) != TLS1_2_VERSION) {
+    return offload;
+  }
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+  const int cipher_nid = cipher != nullptr ? SSL_CIPHER_get_cipher_nid(cipher) : NID_undef;
+  const size_t key_size = keySize(cipher_nid);
+  // The key block of AEAD ciphers is made of the client and server write keys, followed by the
+  // client and server fixed IVs, which are the salts of AES-GCM.
+  if (key_size == 0 || SSL_get_key_block_len(ssl) != 2 * (key_size + SaltSize)) {
+    return offload;
+  }
+
+  Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
+  static const char ulp[] = "tls";
+  if (os_sys_calls.setsockopt(fd, IPPROTO_TCP, TCP_ULP, ulp, sizeof(ulp)).rc_ != 0) {
+    // The tls module is not loaded, or the socket is not TCP.
+    return offload;
+  }
+
+  uint8_t key_block[2 * (32 + SaltSize)];
+  RELEASE_ASSERT(SSL_generate_key_block(ssl, key_block, SSL_get_key_block_len(ssl)) == 1, "");
+  const uint8_t* client_key = key_block;
+  const uint8_t* server_key = key_block + key_size;
+  const uint8_t* client_salt = key_block + 2 * key_size;
+  const uint8_t* server_salt = client_salt + SaltSize;
+  const bool server = SSL_is_server(ssl);
+
+  // BoringSSL has written the whole handshake, so the write sequence is the one of the next record.
+  offload.tx_ = installKeys(fd, TLS_TX, cipher_nid, server ? server_key : client_key,
+                            server ? server_salt : client_salt, SSL_get_write_sequence(ssl));
+  // BoringSSL reads whole records from the socket, without reading ahead. A record it has already
+  // read, or one still held by the read BIO from the listener filters, would be lost to the kernel.
+  if (!SSL_has_pending(ssl) && BIO_pending(SSL_get_rbio(ssl)) == 0) {
+    offload.rx_ = installKeys(fd, TLS_RX, cipher_nid, server ? client_key : server_key,
+                              server ? client_salt : server_salt, SSL_get_read_sequence(ssl));
+  }
+  OPENSSL_cleanse(key_block, sizeof(key_block));
+  return offload;
+}
+
+KernelTls::ControlRecord KernelTls::readControlRecord(int fd) {
+  // Alerts are 2 bytes long. Larger control records, e.g. handshake messages of a renegotiation,
+  // are not supported and close the connection.
+  uint8_t data[2];
+  iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = sizeof(data);
+  char control[CMSG_SPACE(sizeof(uint8_t))];
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  const Api::SysCallSizeResult result =
+      Api::OsSysCallsSingleton::get().recvmsg(fd, &message, 0);
+  if (result.rc_ == -1) {
+    return result.errno_ == EAGAIN ? ControlRecord::Again : ControlRecord::Error;
+  }
+  const cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_TLS || cmsg->cmsg_type != TLS_GET_RECORD_TYPE ||
+      *CMSG_DATA(cmsg) != RecordTypeAlert || result.rc_ != static_cast<ssize_t>(sizeof(data))) {
+    return ControlRecord::Error;
+  }
+  if (data[1] == AlertCloseNotify) {
+    return ControlRecord::CloseNotify;
+  }
+  // Other warning alerts are ignored.
+  return data[0] == AlertLevelWarning ? ControlRecord::Again : ControlRecord::Error;
+}
+
+Api::SysCallSizeResult KernelTls::sendCloseNotify(int fd) {
+  uint8_t data[2] = {AlertLevelWarning, AlertCloseNotify};
+  iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = sizeof(data);
+  char control[CMSG_SPACE(sizeof(uint8_t))];
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_TLS;
+  cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint8_t));
+  *CMSG_DATA(cmsg) = RecordTypeAlert;
+
+  return Api::OsSysCallsSingleton::get().sendmsg(fd, &message, 0);
+}
+#else
+// The kernel headers lack kTLS receive support: all the connections stay on BoringSSL.
+KernelTls::Offload KernelTls::enable(SSL*, int) { return {}; }
+
+KernelTls::ControlRecord KernelTls::readControlRecord(int) { NOT_REACHED_GCOVR_EXCL_LINE; }
+
+Api::SysCallSizeResult KernelTls::sendCloseNotify(int) { NOT_REACHED_GCOVR_EXCL_LINE; }
+#endif
+
+} // namespace Ssl
+} // namespace Envoy
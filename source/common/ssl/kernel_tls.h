@@ -0,0 +1,67 @@
+#pragma once
+
+#include "envoy/api/os_sys_calls.h"
+
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Offload of the TLS record layer to the kernel (kTLS). Once BoringSSL completes the handshake,
+ * the negotiated keys and sequence numbers are installed on the socket, which then reads and writes
+ * plaintext while the kernel decrypts and encrypts the records. This saves the copies through
+ * BoringSSL and allows zero-copy paths such as sendfile on TLS connections.
+ *
+ * Only TLS 1.2 connections using AES-GCM are offloaded: these are the ciphers supported by all the
+ * kernels with kTLS, and TLS 1.2 has no post-handshake key updates. The directions of the other
+ * connections, or for which the kernel lacks kTLS support, stay on BoringSSL.
+ */
+class KernelTls {
+public:
+  /**
+   * Directions of a connection offloaded to the kernel.
+   */
+  struct Offload {
+    bool tx_{};
+    bool rx_{};
+  };
+
+  /**
+   * Result of reading a control record (i.e. a record which is not application data) from an
+   * offloaded socket.
+   */
+  enum class ControlRecord {
+    // No record is available.
+    Again,
+    // The peer closed the TLS session.
+    CloseNotify,
+    // The peer sent a fatal alert or an unexpected record, or the record could not be read.
+    Error
+  };
+
+  /**
+   * Installs the keys of a connection whose handshake is complete in the kernel. This must be done
+   * before any application data is written or read by BoringSSL.
+   * @param ssl supplies the connection.
+   * @param fd supplies the socket of the connection.
+   * @return Offload the directions of the connection which are now processed by the kernel.
+   */
+  static Offload enable(SSL* ssl, int fd);
+
+  /**
+   * Reads a control record from a socket whose RX direction is offloaded. A read of the socket
+   * fails with EIO when the next record is a control record.
+   * @param fd supplies the socket.
+   */
+  static ControlRecord readControlRecord(int fd);
+
+  /**
+   * Sends a close_notify alert on a socket whose TX direction is offloaded.
+   * @param fd supplies the socket.
+   */
+  static Api::SysCallSizeResult sendCloseNotify(int fd);
+};
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,305 @@
+#include "common/ssl/private_key_signer.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "common/common/assert.h"
+#include "common/common/macros.h"
+
+#include "openssl/evp.h"
+#include "openssl/rsa.h"
+
+namespace Envoy {
+namespace Ssl {
+
+namespace {
+
+PrivateKeyStats generateStats(Stats::Scope& store) {
+  std::string prefix("ssl.");
+  return {ALL_PRIVATE_KEY_STATS(POOL_COUNTER_PREFIX(store, prefix),
+                                POOL_GAUGE_PREFIX(store, prefix),
+                                POOL_HISTOGRAM_PREFIX(store, prefix))};
+}
+
+typedef std::shared_ptr<EVP_PKEY> EvpPkeySharedPtr;
+
+// Returns the private key of the certificate selected for the connection, which the operation
+// keeps a reference on.
+EvpPkeySharedPtr privateKey(SSL* ssl) {
+  EVP_PKEY* key = SSL_get_privatekey(ssl);
+  if (key == nullptr) {
+    return nullptr;
+  }
+  EVP_PKEY_up_ref(key);
+  return EvpPkeySharedPtr(key, EVP_PKEY_free);
+}
+
+bool signWithKey(EVP_PKEY* key, uint16_t signature_algorithm, const std::vector<uint8_t>& input,
+                 std::vector<uint8_t>& output) {
+  if (SSL_get_signature_algorithm_key_type(signature_algorithm) != EVP_PKEY_id(key)) {
+    return false;
+  }
+  bssl::ScopedEVP_MD_CTX ctx;
+  EVP_PKEY_CTX* pctx;
+  if (!EVP_DigestSignInit(ctx.get(), &pctx, SSL_get_signature_algorithm_digest(signature_algorithm),
+                          nullptr, key)) {
+    return false;
+  }
+  if (SSL_is_signature_algorithm_rsa_pss(signature_algorithm) &&
+      (!EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) ||
+       !EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, -1 /* salt length is the digest length */))) {
+    return false;
+  }
+  size_t length = EVP_PKEY_size(key);
+  output.resize(length);
+  if (!EVP_DigestSign(ctx.get(), output.data(), &length, input.data(), input.size())) {
+    return false;
+  }
+  output.resize(length);
+  return true;
+}
+
+bool decryptWithKey(EVP_PKEY* key, const std::vector<uint8_t>& input,
+                    std::vector<uint8_t>& output) {
+  RSA* rsa = EVP_PKEY_get0_RSA(key);
+  if (rsa == nullptr) {
+    return false;
+  }
+  // BoringSSL removes the padding itself.
+  size_t length;
+  output.resize(RSA_size(rsa));
+  if (!RSA_decrypt(rsa, &length, output.data(), output.size(), input.data(), input.size(),
+                   RSA_NO_PADDING)) {
+    return false;
+  }
+  output.resize(length);
+  return true;
+}
+
+} // namespace
+
+PrivateKeySigner::PrivateKeySigner(uint32_t threads, uint32_t max_pending, Stats::Scope& scope,
+                                   TimeSource& time_source)
+    : max_pending_(max_pending), stats_(generateStats(scope)), time_source_(time_source) {
+  ASSERT(threads > 0);
+  for (uint32_t i = 0; i < threads; i++) {
+    threads_.push_back(thread_factory_.createThread([this]() -> void { threadRoutine(); }));
+  }
+}
+
+PrivateKeySigner::~PrivateKeySigner() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+  }
+  for (Thread::ThreadPtr& thread : threads_) {
+    thread->join();
+  }
+}
+
+void PrivateKeySigner::setPrivateKeyMethod(SSL_CTX* ctx) {
+  static const SSL_PRIVATE_KEY_METHOD method = {PrivateKeyConnection::sign,
+                                                PrivateKeyConnection::decrypt,
+                                                PrivateKeyConnection::complete};
+  SSL_CTX_set_private_key_method(ctx, &method);
+}
+
+bool PrivateKeySigner::post(std::function<void()> operation) {
+  absl::MutexLock lock(&mutex_);
+  if (queue_.size() >= max_pending_) {
+    return false;
+  }
+  queue_.push_back(std::move(operation));
+  return true;
+}
+
+void PrivateKeySigner::threadRoutine() {
+  while (true) {
+    std::function<void()> operation;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &PrivateKeySigner::hasWork));
+      // The signer is destroyed with its SSL context, once no connection uses the context anymore,
+      // so there is no connection waiting for the operations left in the queue.
+      if (shutdown_) {
+        return;
+      }
+      operation = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    operation();
+  }
+}
+
+PrivateKeyConnection::PrivateKeyConnection(SSL& ssl, PrivateKeySigner& signer,
+                                           Event::Dispatcher& dispatcher,
+                                           std::function<void()> on_complete)
+    : ssl_(ssl), signer_(signer), dispatcher_(dispatcher), on_complete_(on_complete) {
+  SSL_set_ex_data(&ssl_, connectionIndex(), this);
+}
+
+PrivateKeyConnection::~PrivateKeyConnection() {
+  cancel();
+  SSL_set_ex_data(&ssl_, connectionIndex(), nullptr);
+}
+
+int PrivateKeyConnection::connectionIndex() {
+  CONSTRUCT_ON_FIRST_USE(int, []() -> int {
+    int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    RELEASE_ASSERT(index >= 0, "");
+    return index;
+  }());
+}
+
+PrivateKeyConnection* PrivateKeyConnection::fromSsl(SSL* ssl) {
+  return static_cast<PrivateKeyConnection*>(SSL_get_ex_data(ssl, connectionIndex()));
+}
+
+ssl_private_key_result_t PrivateKeyConnection::sign(SSL* ssl, uint8_t* out, size_t* out_len,
+                                                    size_t max_out, uint16_t signature_algorithm,
+                                                    const uint8_t* in, size_t in_len) {
+  PrivateKeyConnection* connection = fromSsl(ssl);
+  EvpPkeySharedPtr key = privateKey(ssl);
+  if (connection == nullptr || key == nullptr) {
+    return ssl_private_key_failure;
+  }
+  const std::vector<uint8_t> input(in, in + in_len);
+  return connection->start(
+      [key, signature_algorithm, input](std::vector<uint8_t>& output) -> bool {
+        return signWithKey(key.get(), signature_algorithm, input, output);
+      },
+      out, out_len, max_out);
+}
+
+ssl_private_key_result_t PrivateKeyConnection::decrypt(SSL* ssl, uint8_t* out, size_t* out_len,
+                                                       size_t max_out, const uint8_t* in,
+                                                       size_t in_len) {
+  PrivateKeyConnection* connection = fromSsl(ssl);
+  EvpPkeySharedPtr key = privateKey(ssl);
+  if (connection == nullptr || key == nullptr) {
+    return ssl_private_key_failure;
+  }
+  const std::vector<uint8_t> input(in, in + in_len);
+  return connection->start(
+      [key, input](std::vector<uint8_t>& output) -> bool {
+        return decryptWithKey(key.get(), input, output);
+      },
+      out, out_len, max_out);
+}
+
+ssl_private_key_result_t PrivateKeyConnection::complete(SSL* ssl, uint8_t* out, size_t* out_len,
+                                                        size_t max_out) {
+  PrivateKeyConnection* connection = fromSsl(ssl);
+  if (connection == nullptr) {
+    return ssl_private_key_failure;
+  }
+  return connection->finish(out, out_len, max_out);
+}
+
+ssl_private_key_result_t
+PrivateKeyConnection::start(std::function<bool(std::vector<uint8_t>&)> operation, uint8_t* out,
+                            size_t* out_len, size_t max_out) {
+  ASSERT(operation_ == nullptr);
+  PrivateKeyStats& stats = signer_.stats();
+  stats.private_key_op_.inc();
+
+  OperationSharedPtr pending = std::make_shared<Operation>(dispatcher_, on_complete_);
+  const bool posted = signer_.post([pending, operation]() -> void {
+    std::vector<uint8_t> output;
+    const bool success = operation(output);
+    pending->complete(std::move(output), success);
+  });
+  if (posted) {
+    operation_ = pending;
+    operation_start_ = signer_.timeSource().monotonicTime();
+    stats.private_key_op_pending_.inc();
+    return ssl_private_key_retry;
+  }
+
+  // All the signing threads are busy and the queue is full. The operation is performed on the
+  // worker rather than failing the handshake.
+  stats.private_key_op_overflow_.inc();
+  std::vector<uint8_t> output;
+  if (!operation(output) || output.size() > max_out) {
+    stats.private_key_op_failed_.inc();
+    return ssl_private_key_failure;
+  }
+  memcpy(out, output.data(), output.size());
+  *out_len = output.size();
+  return ssl_private_key_success;
+}
+
+ssl_private_key_result_t PrivateKeyConnection::finish(uint8_t* out, size_t* out_len,
+                                                      size_t max_out) {
+  if (operation_ == nullptr) {
+    return ssl_private_key_failure;
+  }
+
+  std::vector<uint8_t> output;
+  bool success;
+  {
+    absl::MutexLock lock(&operation_->mutex_);
+    if (!operation_->done_) {
+      return ssl_private_key_retry;
+    }
+    // The result is collected: a completion callback still in flight has nothing to resume.
+    operation_->cancelled_ = true;
+    output = std::move(operation_->output_);
+    success = operation_->success_;
+  }
+  operation_.reset();
+
+  PrivateKeyStats& stats = signer_.stats();
+  stats.private_key_op_pending_.dec();
+  stats.private_key_op_ms_.recordValue(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           signer_.timeSource().monotonicTime() - operation_start_)
+                                           .count());
+  if (!success || output.size() > max_out) {
+    stats.private_key_op_failed_.inc();
+    return ssl_private_key_failure;
+  }
+  memcpy(out, output.data(), output.size());
+  *out_len = output.size();
+  return ssl_private_key_success;
+}
+
+void PrivateKeyConnection::cancel() {
+  if (operation_ == nullptr) {
+    return;
+  }
+  {
+    absl::MutexLock lock(&operation_->mutex_);
+    operation_->cancelled_ = true;
+  }
+  operation_.reset();
+  signer_.stats().private_key_op_pending_.dec();
+}
+
+void PrivateKeyConnection::Operation::complete(std::vector<uint8_t>&& output, bool success) {
+  absl::MutexLock lock(&mutex_);
+  output_ = std::move(output);
+  success_ = success;
+  done_ = true;
+  if (cancelled_) {
+    return;
+  }
+  // The connection cancels the operation before it is destroyed, and it is destroyed before its
+  // dispatcher, so the dispatcher is alive while the operation is not cancelled.
+  std::weak_ptr<Operation> weak_this = shared_from_this();
+  dispatcher_.post([weak_this]() -> void {
+    OperationSharedPtr operation = weak_this.lock();
+    if (operation == nullptr) {
+      return;
+    }
+    {
+      absl::MutexLock lock(&operation->mutex_);
+      if (operation->cancelled_) {
+        return;
+      }
+    }
+    operation->on_complete_();
+  });
+}
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread/thread.h"
+
+#include "common/common/thread.h"
+#include "common/common/thread_annotations.h"
+
+#include "absl/synchronization/mutex.h"
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+// clang-format off
+#define ALL_PRIVATE_KEY_STATS(COUNTER, GAUGE, HISTOGRAM)                                           \
+  COUNTER(private_key_op)                                                                          \
+  COUNTER(private_key_op_failed)                                                                   \
+  COUNTER(private_key_op_overflow)                                                                 \
+  GAUGE(private_key_op_pending)                                                                    \
+  HISTOGRAM(private_key_op_ms)
+// clang-format on
+
+/**
+ * Wrapper struct for private key operation stats. @see stats_macros.h
+ */
+struct PrivateKeyStats {
+  ALL_PRIVATE_KEY_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT, GENERATE_HISTOGRAM_STRUCT)
+};
+
+/**
+ * Pool of threads performing the private key operations of TLS handshakes (signatures, and RSA
+ * decryptions for the RSA key exchange), so that a burst of handshakes does not block the workers
+ * and the established connections they serve. The operations are queued by the BoringSSL private
+ * key method of the SSL contexts set up with setPrivateKeyMethod(), and the handshakes are resumed
+ * on their worker when the operation completes.
+ *
+ * The operations of a connection are tracked by a PrivateKeyConnection.
+ */
+class PrivateKeySigner {
+public:
+  /**
+   * @param threads supplies the number of signing threads.
+   * @param max_pending supplies the maximum number of operations waiting for a signing thread.
+   *        Operations over the limit are performed on the worker.
+   * @param scope supplies the scope of the stats.
+   * @param time_source supplies the time source used to measure the latency of the operations.
+   */
+  PrivateKeySigner(uint32_t threads, uint32_t max_pending, Stats::Scope& scope,
+                   TimeSource& time_source);
+  ~PrivateKeySigner();
+
+  /**
+   * Sets the private key method queueing the operations with the private key of an SSL context.
+   * The private key must have been set on the context.
+   */
+  static void setPrivateKeyMethod(SSL_CTX* ctx);
+
+  PrivateKeyStats& stats() { return stats_; }
+  TimeSource& timeSource() { return time_source_; }
+
+  /**
+   * Queues an operation for the signing threads.
+   * @param operation supplies the operation.
+   * @return false if the queue is full, in which case the operation is not queued.
+   */
+  bool post(std::function<void()> operation);
+
+private:
+  bool hasWork() const EXCLUSIVE_LOCKS_REQUIRED(mutex_) { return shutdown_ || !queue_.empty(); }
+  void threadRoutine();
+
+  const uint32_t max_pending_;
+  PrivateKeyStats stats_;
+  TimeSource& time_source_;
+  Thread::ThreadFactoryImpl thread_factory_;
+  absl::Mutex mutex_;
+  std::deque<std::function<void()>> queue_ GUARDED_BY(mutex_);
+  bool shutdown_ GUARDED_BY(mutex_){};
+  std::vector<Thread::ThreadPtr> threads_;
+};
+
+typedef std::shared_ptr<PrivateKeySigner> PrivateKeySignerSharedPtr;
+
+/**
+ * The private key operations of a TLS connection. The connection is registered on its SSL object,
+ * where the private key method finds it. Only one operation is in flight at a time. Destroying the
+ * connection cancels its operation: the result is dropped when the signing thread completes it.
+ */
+class PrivateKeyConnection {
+public:
+  /**
+   * @param ssl supplies the SSL object of the connection.
+   * @param signer supplies the signer of the SSL context.
+   * @param dispatcher supplies the dispatcher of the connection.
+   * @param on_complete supplies the callback invoked on the dispatcher when an operation
+   *        completes, which resumes the handshake.
+   */
+  PrivateKeyConnection(SSL& ssl, PrivateKeySigner& signer, Event::Dispatcher& dispatcher,
+                       std::function<void()> on_complete);
+  ~PrivateKeyConnection();
+
+private:
+  /**
+   * State of an operation, shared between the connection and the signing thread.
+   */
+  struct Operation : public std::enable_shared_from_this<Operation> {
+    Operation(Event::Dispatcher& dispatcher, std::function<void()> on_complete)
+        : dispatcher_(dispatcher), on_complete_(on_complete) {}
+
+    // Called on the signing thread.
+    void complete(std::vector<uint8_t>&& output, bool success);
+
+    Event::Dispatcher& dispatcher_;
+    const std::function<void()> on_complete_;
+    absl::Mutex mutex_;
+    std::vector<uint8_t> output_ GUARDED_BY(mutex_);
+    bool done_ GUARDED_BY(mutex_){};
+    bool success_ GUARDED_BY(mutex_){};
+    bool cancelled_ GUARDED_BY(mutex_){};
+  };
+
+  typedef std::shared_ptr<Operation> OperationSharedPtr;
+
+  static int connectionIndex();
+  static PrivateKeyConnection* fromSsl(SSL* ssl);
+
+  // SSL_PRIVATE_KEY_METHOD
+  static ssl_private_key_result_t sign(SSL* ssl, uint8_t* out, size_t* out_len, size_t max_out,
+                                       uint16_t signature_algorithm, const uint8_t* in,
+                                       size_t in_len);
+  static ssl_private_key_result_t decrypt(SSL* ssl, uint8_t* out, size_t* out_len, size_t max_out,
+                                          const uint8_t* in, size_t in_len);
+  static ssl_private_key_result_t complete(SSL* ssl, uint8_t* out, size_t* out_len,
+                                           size_t max_out);
+
+  ssl_private_key_result_t start(std::function<bool(std::vector<uint8_t>&)> operation,
+                                 uint8_t* out, size_t* out_len, size_t max_out);
+  ssl_private_key_result_t finish(uint8_t* out, size_t* out_len, size_t max_out);
+  void cancel();
+
+  SSL& ssl_;
+  PrivateKeySigner& signer_;
+  Event::Dispatcher& dispatcher_;
+  const std::function<void()> on_complete_;
+  OperationSharedPtr operation_;
+  MonotonicTime operation_start_;
+
+  friend class PrivateKeySigner;
+};
+
+typedef std::unique_ptr<PrivateKeyConnection> PrivateKeyConnectionPtr;
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,161 @@
+#include "common/ssl/session_resumption.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "common/common/assert.h"
+
+#include "openssl/rand.h"
+
+namespace Envoy {
+namespace Ssl {
+
+SessionCache::SessionCache(uint64_t max_sessions)
+    : max_sessions_per_shard_(std::max<uint64_t>(1, max_sessions / NumShards)) {}
+
+std::string SessionCache::sessionKey(const uint8_t* session_id_context,
+                                     size_t session_id_context_len, const uint8_t* session_id,
+                                     size_t session_id_len) {
+  std::string key;
+  key.reserve(session_id_context_len + session_id_len);
+  key.append(reinterpret_cast<const char*>(session_id_context), session_id_context_len);
+  key.append(reinterpret_cast<const char*>(session_id), session_id_len);
+  return key;
+}
+
+SessionCache::Shard& SessionCache::shard(const std::string& key) {
+  return shards_[std::hash<std::string>()(key) % NumShards];
+}
+
+void SessionCache::insert(SSL_SESSION* session) {
+  bssl::UniquePtr<SSL_SESSION> owned_session(session);
+  unsigned session_id_context_len;
+  const uint8_t* session_id_context =
+      SSL_SESSION_get0_id_context(session, &session_id_context_len);
+  unsigned session_id_len;
+  const uint8_t* session_id = SSL_SESSION_get_id(session, &session_id_len);
+  if (session_id_len == 0) {
+    // The session is resumed with a ticket only.
+    return;
+  }
+  std::string key =
+      sessionKey(session_id_context, session_id_context_len, session_id, session_id_len);
+
+  Shard& cache_shard = shard(key);
+  absl::MutexLock lock(&cache_shard.mutex_);
+  auto existing = cache_shard.index_.find(key);
+  if (existing != cache_shard.index_.end()) {
+    cache_shard.sessions_.erase(existing->second);
+    cache_shard.index_.erase(existing);
+  }
+  while (cache_shard.sessions_.size() >= max_sessions_per_shard_) {
+    cache_shard.index_.erase(cache_shard.sessions_.back().first);
+    cache_shard.sessions_.pop_back();
+  }
+  cache_shard.sessions_.emplace_front(key, std::move(owned_session));
+  cache_shard.index_.emplace(std::move(key), cache_shard.sessions_.begin());
+}
+
+SSL_SESSION* SessionCache::lookup(const std::string& session_id_context,
+                                  const uint8_t* session_id, size_t session_id_len) {
+  const std::string key =
+      sessionKey(reinterpret_cast<const uint8_t*>(session_id_context.data()),
+                 session_id_context.size(), session_id, session_id_len);
+
+  Shard& cache_shard = shard(key);
+  absl::MutexLock lock(&cache_shard.mutex_);
+  auto it = cache_shard.index_.find(key);
+  if (it == cache_shard.index_.end()) {
+    return nullptr;
+  }
+  cache_shard.sessions_.splice(cache_shard.sessions_.begin(), cache_shard.sessions_, it->second);
+  // The reference is taken under the lock: another worker may evict the session as soon as the
+  // lock is released.
+  SSL_SESSION* session = it->second->second.get();
+  SSL_SESSION_up_ref(session);
+  return session;
+}
+
+void SessionCache::remove(SSL_SESSION* session) {
+  unsigned session_id_context_len;
+  const uint8_t* session_id_context =
+      SSL_SESSION_get0_id_context(session, &session_id_context_len);
+  unsigned session_id_len;
+  const uint8_t* session_id = SSL_SESSION_get_id(session, &session_id_len);
+  const std::string key =
+      sessionKey(session_id_context, session_id_context_len, session_id, session_id_len);
+
+  Shard& cache_shard = shard(key);
+  absl::MutexLock lock(&cache_shard.mutex_);
+  auto it = cache_shard.index_.find(key);
+  if (it != cache_shard.index_.end()) {
+    cache_shard.sessions_.erase(it->second);
+    cache_shard.index_.erase(it);
+  }
+}
+
+uint64_t SessionCache::size() {
+  uint64_t size = 0;
+  for (Shard& cache_shard : shards_) {
+    absl::MutexLock lock(&cache_shard.mutex_);
+    size += cache_shard.sessions_.size();
+  }
+  return size;
+}
+
+SessionTicketKeyRotator::SessionTicketKeyRotator(TimeSource& time_source,
+                                                 std::chrono::seconds rotation_interval,
+                                                 uint32_t num_keys)
+    : time_source_(time_source), rotation_interval_(rotation_interval), num_keys_(num_keys) {
+  ASSERT(num_keys_ > 0);
+  absl::MutexLock lock(&mutex_);
+  keys_ = std::make_shared<const Keys>();
+  rotate(time_source_.monotonicTime());
+}
+
+SessionTicketKeyRotator::KeysConstSharedPtr SessionTicketKeyRotator::keys() {
+  const MonotonicTime now = time_source_.monotonicTime();
+  absl::MutexLock lock(&mutex_);
+  if (now - last_rotation_ >= rotation_interval_) {
+    rotate(now);
+  }
+  return keys_;
+}
+
+void SessionTicketKeyRotator::setKeys(const Keys& keys) {
+  if (keys.empty()) {
+    return;
+  }
+  auto new_keys = std::make_shared<Keys>(keys);
+  if (new_keys->size() > num_keys_) {
+    new_keys->resize(num_keys_);
+  }
+  const MonotonicTime now = time_source_.monotonicTime();
+  absl::MutexLock lock(&mutex_);
+  keys_ = std::move(new_keys);
+  last_rotation_ = now;
+}
+
+void SessionTicketKeyRotator::rotate(MonotonicTime now) {
+  ServerContextConfig::SessionTicketKey key;
+  RELEASE_ASSERT(RAND_bytes(key.name_.data(), key.name_.size()) == 1, "");
+  RELEASE_ASSERT(RAND_bytes(key.hmac_key_.data(), key.hmac_key_.size()) == 1, "");
+  RELEASE_ASSERT(RAND_bytes(key.aes_key_.data(), key.aes_key_.size()) == 1, "");
+
+  // The keys are copied on rotation, so that the connections using the previous keys are not
+  // affected.
+  auto new_keys = std::make_shared<Keys>();
+  new_keys->reserve(num_keys_);
+  new_keys->push_back(key);
+  for (const ServerContextConfig::SessionTicketKey& previous_key : *keys_) {
+    if (new_keys->size() == num_keys_) {
+      break;
+    }
+    new_keys->push_back(previous_key);
+  }
+  keys_ = std::move(new_keys);
+  last_rotation_ = now;
+}
+
+} // namespace Ssl
+} // namespace Envoy
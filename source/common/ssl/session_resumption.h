@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/ssl/context_config.h"
+
+#include "common/common/thread_annotations.h"
+
+#include "absl/synchronization/mutex.h"
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Server side TLS session cache shared by all the server contexts of the process, i.e. by all the
+ * workers and listeners, and by the contexts replacing them when their configuration is updated.
+ * Sessions are keyed by their session ID context, which is a hash of the identity of the context
+ * (certificates, validation settings and server names), so that a session is only resumed by a
+ * context with the same identity.
+ *
+ * The cache is sharded by session ID to limit the contention between workers. Each shard evicts
+ * its least recently used sessions when it is full. Expired sessions are left to BoringSSL, which
+ * does not resume them.
+ */
+class SessionCache {
+public:
+  /**
+   * @param max_sessions supplies the maximum number of sessions in the cache.
+   */
+  explicit SessionCache(uint64_t max_sessions);
+
+  /**
+   * Adds a new session. The cache takes ownership of the session. Sessions without ID, which are
+   * resumed with a ticket only, are dropped.
+   */
+  void insert(SSL_SESSION* session);
+
+  /**
+   * @param session_id_context supplies the session ID context of the connection.
+   * @param session_id supplies the session ID sent by the client.
+   * @return the session, with a new reference owned by the caller, or nullptr if it is not cached.
+   */
+  SSL_SESSION* lookup(const std::string& session_id_context, const uint8_t* session_id,
+                      size_t session_id_len);
+
+  /**
+   * Removes a session, e.g. when BoringSSL found it expired.
+   */
+  void remove(SSL_SESSION* session);
+
+  /**
+   * @return the number of sessions in the cache.
+   */
+  uint64_t size();
+
+private:
+  typedef std::list<std::pair<std::string, bssl::UniquePtr<SSL_SESSION>>> SessionList;
+
+  struct Shard {
+    absl::Mutex mutex_;
+    // Most recently used session first.
+    SessionList sessions_ GUARDED_BY(mutex_);
+    std::unordered_map<std::string, SessionList::iterator> index_ GUARDED_BY(mutex_);
+  };
+
+  static constexpr size_t NumShards = 16;
+
+  static std::string sessionKey(const uint8_t* session_id_context, size_t session_id_context_len,
+                                const uint8_t* session_id, size_t session_id_len);
+  Shard& shard(const std::string& key);
+
+  const uint64_t max_sessions_per_shard_;
+  Shard shards_[NumShards];
+};
+
+/**
+ * Session ticket keys shared by all the server contexts of the process which do not configure
+ * their own keys. A new encryption key is generated at every rotation interval, and the previous
+ * keys are kept to decrypt the tickets they issued. The keys are handed over to the new process on
+ * hot restart, so that the tickets issued by the parent are still accepted.
+ */
+class SessionTicketKeyRotator {
+public:
+  typedef std::vector<ServerContextConfig::SessionTicketKey> Keys;
+  typedef std::shared_ptr<const Keys> KeysConstSharedPtr;
+
+  /**
+   * @param time_source supplies the time source of the rotations.
+   * @param rotation_interval supplies the lifetime of an encryption key.
+   * @param num_keys supplies the number of keys kept, including the encryption key.
+   */
+  SessionTicketKeyRotator(TimeSource& time_source, std::chrono::seconds rotation_interval,
+                          uint32_t num_keys);
+
+  /**
+   * @return the current keys, encryption key first. The keys are rotated first if the encryption
+   *         key is older than the rotation interval.
+   */
+  KeysConstSharedPtr keys();
+
+  /**
+   * Replaces the keys, e.g. with the keys of the parent process. The rotation interval starts over.
+   * @param keys supplies the keys, encryption key first. An empty vector is ignored.
+   */
+  void setKeys(const Keys& keys);
+
+private:
+  void rotate(MonotonicTime now) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  TimeSource& time_source_;
+  const std::chrono::seconds rotation_interval_;
+  const uint32_t num_keys_;
+  absl::Mutex mutex_;
+  KeysConstSharedPtr keys_ GUARDED_BY(mutex_);
+  MonotonicTime last_rotation_ GUARDED_BY(mutex_);
+};
+
+} // namespace Ssl
+} // namespace Envoy
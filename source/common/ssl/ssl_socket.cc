@@ -2,6 +2,7 @@
 
 #include "envoy/stats/scope.h"
 
+#include "common/api/os_sys_calls_impl.h"
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/common/hex.h"
@@ -33,6 +34,87 @@ public:
   void onConnected() override {}
   const Ssl::Connection* ssl() const override { return nullptr; }
 };
+
+// TLS records are at most 16K of plaintext, and the peer can't decrypt any byte of a record before
+// receiving all of it. Records small enough to fit in a TCP segment let the peer process the first
+// bytes of a response as soon as they arrive, while the congestion window is small. Bulk transfers
+// use full size records, which have the lowest framing and CPU overhead.
+constexpr uint64_t MaxRecordSize = 16384;
+constexpr uint64_t SmallRecordSize = 1400;
+// Bytes written in small records before switching to full size records, i.e. once the congestion
+// window has grown past a few round trips of slow start.
+constexpr uint64_t SmallRecordBytes = 64 * 1024;
+// After this much idle time, the congestion window may have been reset, and records are small again.
+constexpr std::chrono::milliseconds RecordSizeIdleTimeout(1000);
+// Slices of at least this size are written in place, in a record of their own if they are smaller
+// than the record size. Smaller slices are coalesced into a record.
+constexpr uint64_t MinInPlaceWriteSize = 4096;
+
+// A socket BIO which returns the bytes already read from the socket by the listener filters, e.g.
+// the ClientHello read by the TLS inspector, before reading from the socket.
+struct PreReadBioState {
+  int fd_;
+  Buffer::Instance& pre_read_data_;
+};
+
+int preReadBioRead(BIO* bio, char* out, int length) {
+  auto* state = static_cast<PreReadBioState*>(BIO_get_data(bio));
+  BIO_clear_retry_flags(bio);
+  if (state->pre_read_data_.length() > 0) {
+    const uint64_t copied = std::min<uint64_t>(length, state->pre_read_data_.length());
+    state->pre_read_data_.copyOut(0, copied, out);
+    state->pre_read_data_.drain(copied);
+    return static_cast<int>(copied);
+  }
+  const Api::SysCallSizeResult result =
+      Api::OsSysCallsSingleton::get().recv(state->fd_, out, length, 0);
+  if (result.rc_ == -1 && result.errno_ == EAGAIN) {
+    BIO_set_retry_read(bio);
+  }
+  return static_cast<int>(result.rc_);
+}
+
+long preReadBioCtrl(BIO* bio, int command, long, void* ptr) {
+  auto* state = static_cast<PreReadBioState*>(BIO_get_data(bio));
+  switch (command) {
+  case BIO_CTRL_PENDING:
+    return state->pre_read_data_.length();
+  case BIO_C_GET_FD:
+    if (ptr != nullptr) {
+      *static_cast<int*>(ptr) = state->fd_;
+    }
+    return state->fd_;
+  default:
+    return 0;
+  }
+}
+
+int preReadBioDestroy(BIO* bio) {
+  delete static_cast<PreReadBioState*>(BIO_get_data(bio));
+  BIO_set_data(bio, nullptr);
+  return 1;
+}
+
+const BIO_METHOD PreReadBioMethod = {
+    BIO_TYPE_SOCKET,   // type
+    "pre-read socket", // name
+    nullptr,           // bwrite
+    preReadBioRead,    // bread
+    nullptr,           // bputs
+    nullptr,           // bgets
+    preReadBioCtrl,    // ctrl
+    nullptr,           // create
+    preReadBioDestroy, // destroy
+    nullptr,           // callback_ctrl
+};
+
+BIO* newPreReadBio(int fd, Buffer::Instance& pre_read_data) {
+  BIO* bio = BIO_new(&PreReadBioMethod);
+  RELEASE_ASSERT(bio != nullptr, "");
+  BIO_set_data(bio, new PreReadBioState{fd, pre_read_data});
+  BIO_set_init(bio, 1);
+  return bio;
+}
 } // namespace
 
 SslSocket::SslSocket(ContextSharedPtr ctx, InitialState state,
@@ -54,7 +136,19 @@ void SslSocket::setTransportSocketCallbacks(Network::TransportSocketCallbacks& c
   callbacks_ = &callbacks;
 
   BIO* bio = BIO_new_socket(callbacks_->fd(), 0);
-  SSL_set_bio(ssl_.get(), bio, bio);
+  if (callbacks_->preReadData().length() > 0) {
+    // The handshake starts with the bytes read by the listener filters.
+    SSL_set_bio(ssl_.get(), newPreReadBio(callbacks_->fd(), callbacks_->preReadData()), bio);
+  } else {
+    SSL_set_bio(ssl_.get(), bio, bio);
+  }
+
+  if (ctx_->privateKeySigner() != nullptr) {
+    // The handshake is resumed by a read event when its private key operation completes.
+    private_key_connection_ = std::make_unique<PrivateKeyConnection>(
+        *ssl_, *ctx_->privateKeySigner(), callbacks_->connection().dispatcher(),
+        [this]() -> void { callbacks_->setReadBufferReady(); });
+  }
 }
 
 Network::IoResult SslSocket::doRead(Buffer::Instance& read_buffer) {
@@ -67,6 +161,10 @@ Network::IoResult SslSocket::doRead(Buffer::Instance& read_buffer) {
     }
   }
 
+  if (kernel_tls_.rx_) {
+    return doKernelTlsRead(read_buffer);
+  }
+
   bool keep_reading = true;
   bool end_stream = false;
   PostIoAction action = PostIoAction::KeepOpen;
@@ -124,6 +222,9 @@ PostIoAction SslSocket::doHandshake() {
     ENVOY_CONN_LOG(debug, "handshake complete", callbacks_->connection());
     handshake_complete_ = true;
     ctx_->logHandshake(ssl_.get());
+    if (ctx_->kernelTlsOffload()) {
+      enableKernelTls();
+    }
     callbacks_->raiseEvent(Network::ConnectionEvent::Connected);
 
     // It's possible that we closed during the handshake callback.
@@ -136,6 +237,7 @@ PostIoAction SslSocket::doHandshake() {
     switch (err) {
     case SSL_ERROR_WANT_READ:
     case SSL_ERROR_WANT_WRITE:
+    case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
       return PostIoAction::KeepOpen;
     default:
       drainErrorQueue();
@@ -144,6 +246,126 @@ PostIoAction SslSocket::doHandshake() {
   }
 }
 
+void SslSocket::enableKernelTls() {
+  kernel_tls_ = KernelTls::enable(ssl_.get(), callbacks_->fd());
+  ENVOY_CONN_LOG(debug, "kernel TLS: tx={} rx={}", callbacks_->connection(), kernel_tls_.tx_,
+                 kernel_tls_.rx_);
+  if (kernel_tls_.tx_) {
+    ctx_->stats().kernel_tls_tx_.inc();
+  }
+  if (kernel_tls_.rx_) {
+    ctx_->stats().kernel_tls_rx_.inc();
+  }
+  if (!kernel_tls_.tx_ || !kernel_tls_.rx_) {
+    ctx_->stats().kernel_tls_fallback_.inc();
+  }
+}
+
+Network::IoResult SslSocket::doKernelTlsRead(Buffer::Instance& read_buffer) {
+  PostIoAction action = PostIoAction::KeepOpen;
+  uint64_t bytes_read = 0;
+  bool end_stream = false;
+  while (true) {
+    // 16K read is arbitrary, as in the BoringSSL path.
+    Api::SysCallIntResult result = read_buffer.read(callbacks_->fd(), 16384);
+    ENVOY_CONN_LOG(trace, "kernel TLS read returns: {}", callbacks_->connection(), result.rc_);
+
+    if (result.rc_ > 0) {
+      bytes_read += result.rc_;
+      if (callbacks_->shouldDrainReadBuffer()) {
+        callbacks_->setReadBufferReady();
+        break;
+      }
+      continue;
+    }
+
+    if (result.rc_ == 0) {
+      // The peer closed the connection without close_notify.
+      action = PostIoAction::Close;
+      break;
+    }
+    if (result.errno_ == EAGAIN) {
+      break;
+    }
+    if (result.errno_ == EIO) {
+      // The next record is an alert, or another record which is not application data.
+      const KernelTls::ControlRecord record = KernelTls::readControlRecord(callbacks_->fd());
+      if (record == KernelTls::ControlRecord::CloseNotify) {
+        end_stream = true;
+        break;
+      }
+      if (record == KernelTls::ControlRecord::Again) {
+        continue;
+      }
+    }
+
+    // A record failed to decrypt (EBADMSG), or the peer sent a fatal alert or an unexpected record.
+    ENVOY_CONN_LOG(debug, "kernel TLS read error: {}", callbacks_->connection(), result.errno_);
+    ctx_->stats().connection_error_.inc();
+    action = PostIoAction::Close;
+    break;
+  }
+
+  return {action, bytes_read, end_stream};
+}
+
+Network::IoResult SslSocket::doKernelTlsWrite(Buffer::Instance& write_buffer, bool end_stream) {
+  uint64_t total_bytes_written = 0;
+  while (write_buffer.length() > 0) {
+    Api::SysCallIntResult result = write_buffer.write(callbacks_->fd());
+    ENVOY_CONN_LOG(trace, "kernel TLS write returns: {}", callbacks_->connection(), result.rc_);
+    if (result.rc_ == -1) {
+      return {result.errno_ == EAGAIN ? PostIoAction::KeepOpen : PostIoAction::Close,
+              total_bytes_written, false};
+    }
+    total_bytes_written += result.rc_;
+  }
+
+  if (end_stream) {
+    shutdownSsl();
+  }
+
+  return {PostIoAction::KeepOpen, total_bytes_written, false};
+}
+
+uint64_t SslSocket::nextRecordSize() {
+  const MonotonicTime now = callbacks_->connection().dispatcher().timeSystem().monotonicTime();
+  if (now - last_write_time_ >= RecordSizeIdleTimeout) {
+    small_record_bytes_ = 0;
+  }
+  last_write_time_ = now;
+  return small_record_bytes_ < SmallRecordBytes ? SmallRecordSize : MaxRecordSize;
+}
+
+const void* SslSocket::recordData(Buffer::Instance& write_buffer, uint64_t& size) {
+  // The buffer may start with empty slices, see getRawSlices().
+  Buffer::RawSlice slices[8];
+  const uint64_t num_slices = write_buffer.getRawSlices(slices, 8);
+  for (uint64_t i = 0; i < std::min(num_slices, static_cast<uint64_t>(8)); i++) {
+    if (slices[i].len_ == 0) {
+      continue;
+    }
+    if (slices[i].len_ >= size) {
+      return slices[i].mem_;
+    }
+    // The record spans several slices. A large slice is written in place in a smaller record,
+    // small slices are copied into the record.
+    if (slices[i].len_ >= MinInPlaceWriteSize) {
+      size = slices[i].len_;
+      return slices[i].mem_;
+    }
+    break;
+  }
+
+  ASSERT(size <= MaxRecordSize);
+  if (coalesce_buffer_ == nullptr) {
+    coalesce_buffer_ = std::make_unique<uint8_t[]>(MaxRecordSize);
+  }
+  write_buffer.copyOut(0, size, coalesce_buffer_.get());
+  ctx_->stats().write_coalesced_bytes_.add(size);
+  return coalesce_buffer_.get();
+}
+
 void SslSocket::drainErrorQueue() {
   bool saw_error = false;
   bool saw_counted_error = false;
@@ -176,12 +398,16 @@ Network::IoResult SslSocket::doWrite(Buffer::Instance& write_buffer, bool end_st
     }
   }
 
+  if (kernel_tls_.tx_) {
+    return doKernelTlsWrite(write_buffer, end_stream);
+  }
+
   uint64_t bytes_to_write;
   if (bytes_to_retry_) {
     bytes_to_write = bytes_to_retry_;
     bytes_to_retry_ = 0;
   } else {
-    bytes_to_write = std::min(write_buffer.length(), static_cast<uint64_t>(16384));
+    bytes_to_write = std::min(write_buffer.length(), nextRecordSize());
   }
 
   uint64_t total_bytes_written = 0;
@@ -191,15 +417,22 @@ Network::IoResult SslSocket::doWrite(Buffer::Instance& write_buffer, bool end_st
 
     // SSL_write() requires that if a previous call returns SSL_ERROR_WANT_WRITE, we need to call
     // it again with the same parameters. This is done by tracking last write size, but not write
-    // data, since linearize() will return the same undrained data anyway.
+    // data: the undrained data is the same, either in place in the write buffer or copied again to
+    // the same coalesce buffer, so the retry passes the same address.
     ASSERT(bytes_to_write <= write_buffer.length());
-    int rc = SSL_write(ssl_.get(), write_buffer.linearize(bytes_to_write), bytes_to_write);
+    const void* data = recordData(write_buffer, bytes_to_write);
+    int rc = SSL_write(ssl_.get(), data, bytes_to_write);
     ENVOY_CONN_LOG(trace, "ssl write returns: {}", callbacks_->connection(), rc);
     if (rc > 0) {
       ASSERT(rc == static_cast<int>(bytes_to_write));
+      ctx_->stats().write_records_.inc();
+      if (small_record_bytes_ < SmallRecordBytes) {
+        ctx_->stats().write_small_records_.inc();
+        small_record_bytes_ += rc;
+      }
       total_bytes_written += rc;
       write_buffer.drain(rc);
-      bytes_to_write = std::min(write_buffer.length(), static_cast<uint64_t>(16384));
+      bytes_to_write = std::min(write_buffer.length(), nextRecordSize());
     } else {
       int err = SSL_get_error(ssl_.get(), rc);
       switch (err) {
@@ -229,9 +462,15 @@ void SslSocket::onConnected() { ASSERT(!handshake_complete_); }
 void SslSocket::shutdownSsl() {
   ASSERT(handshake_complete_);
   if (!shutdown_sent_ && callbacks_->connection().state() != Network::Connection::State::Closed) {
-    int rc = SSL_shutdown(ssl_.get());
-    ENVOY_CONN_LOG(debug, "SSL shutdown: rc={}", callbacks_->connection(), rc);
-    drainErrorQueue();
+    if (kernel_tls_.tx_) {
+      // BoringSSL no longer knows the write sequence: the alert is encrypted by the kernel.
+      const Api::SysCallSizeResult result = KernelTls::sendCloseNotify(callbacks_->fd());
+      ENVOY_CONN_LOG(debug, "kernel TLS shutdown: rc={}", callbacks_->connection(), result.rc_);
+    } else {
+      int rc = SSL_shutdown(ssl_.get());
+      ENVOY_CONN_LOG(debug, "SSL shutdown: rc={}", callbacks_->connection(), rc);
+      drainErrorQueue();
+    }
     shutdown_sent_ = true;
   }
 }
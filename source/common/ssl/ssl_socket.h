@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
 
+#include "envoy/common/time.h"
 #include "envoy/network/connection.h"
 #include "envoy/network/transport_socket.h"
 #include "envoy/secret/secret_callbacks.h"
@@ -11,6 +14,8 @@
 
 #include "common/common/logger.h"
 #include "common/ssl/context_impl.h"
+#include "common/ssl/kernel_tls.h"
+#include "common/ssl/private_key_signer.h"
 #include "common/ssl/utility.h"
 
 #include "absl/synchronization/mutex.h"
@@ -65,18 +70,37 @@ public:
   const Ssl::Connection* ssl() const override { return this; }
 
   SSL* rawSslForTest() const { return ssl_.get(); }
+  // Completes the handshake, with the given directions of the connection processed by the kernel.
+  void enableKernelTlsForTest(KernelTls::Offload offload) {
+    handshake_complete_ = true;
+    kernel_tls_ = offload;
+  }
 
 private:
   Network::PostIoAction doHandshake();
+  void enableKernelTls();
+  Network::IoResult doKernelTlsRead(Buffer::Instance& read_buffer);
+  Network::IoResult doKernelTlsWrite(Buffer::Instance& write_buffer, bool end_stream);
+  uint64_t nextRecordSize();
+  const void* recordData(Buffer::Instance& write_buffer, uint64_t& size);
   void drainErrorQueue();
   void shutdownSsl();
 
   Network::TransportSocketCallbacks* callbacks_{};
   ContextImplSharedPtr ctx_;
   bssl::UniquePtr<SSL> ssl_;
+  PrivateKeyConnectionPtr private_key_connection_;
   bool handshake_complete_{};
+  // Directions of the connection whose records are processed by the kernel.
+  KernelTls::Offload kernel_tls_;
   bool shutdown_sent_{};
   uint64_t bytes_to_retry_{};
+  // Records made of several small slices are copied here. SSL_write() must be retried with the
+  // same buffer after SSL_ERROR_WANT_WRITE, so this is kept until the connection is closed.
+  std::unique_ptr<uint8_t[]> coalesce_buffer_;
+  // Bytes written in small records since the connection started or was last idle.
+  uint64_t small_record_bytes_{};
+  MonotonicTime last_write_time_;
   mutable std::string cached_sha_256_peer_certificate_digest_;
   mutable std::string cached_url_encoded_pem_encoded_peer_certificate_;
 };
@@ -25,8 +25,49 @@ IsolatedStoreImpl::IsolatedStoreImpl()
       }),
       histograms_([this](const std::string& name) -> HistogramSharedPtr {
         return std::make_shared<HistogramImpl>(name, *this, std::string(name), std::vector<Tag>());
+      }),
+      lazy_counters_([this](const std::string& name) -> LazyCounterImplSharedPtr {
+        return std::make_shared<LazyCounterImpl>(alloc_, LazyStatName(name, nullptr, nullptr));
+      }),
+      lazy_gauges_([this](const std::string& name) -> LazyGaugeImplSharedPtr {
+        return std::make_shared<LazyGaugeImpl>(alloc_, LazyStatName(name, nullptr, nullptr));
       }) {}
 
+Counter& IsolatedStoreImpl::lazyCounter(const std::string& name) {
+  if (counters_.contains(name)) {
+    return counters_.get(name);
+  }
+  return lazy_counters_.get(name);
+}
+
+Gauge& IsolatedStoreImpl::lazyGauge(const std::string& name) {
+  if (gauges_.contains(name)) {
+    return gauges_.get(name);
+  }
+  return lazy_gauges_.get(name);
+}
+
+std::vector<CounterSharedPtr> IsolatedStoreImpl::counters() const {
+  std::vector<CounterSharedPtr> counters = counters_.toVector();
+  // A lazy counter shares its data with any counter of the same name, which is listed instead.
+  for (const LazyCounterImplSharedPtr& counter : lazy_counters_.toVector()) {
+    if (!counters_.contains(counter->name())) {
+      counters.push_back(counter);
+    }
+  }
+  return counters;
+}
+
+std::vector<GaugeSharedPtr> IsolatedStoreImpl::gauges() const {
+  std::vector<GaugeSharedPtr> gauges = gauges_.toVector();
+  for (const LazyGaugeImplSharedPtr& gauge : lazy_gauges_.toVector()) {
+    if (!gauges_.contains(gauge->name())) {
+      gauges.push_back(gauge);
+    }
+  }
+  return gauges;
+}
+
 struct IsolatedScopeImpl : public Scope {
   IsolatedScopeImpl(IsolatedStoreImpl& parent, const std::string& prefix)
       : parent_(parent), prefix_(Utility::sanitizeStatsName(prefix)) {}
@@ -38,6 +79,10 @@ struct IsolatedScopeImpl : public Scope {
   void deliverHistogramToSinks(const Histogram&, uint64_t) override {}
   Counter& counter(const std::string& name) override { return parent_.counter(prefix_ + name); }
   Gauge& gauge(const std::string& name) override { return parent_.gauge(prefix_ + name); }
+  Counter& lazyCounter(const std::string& name) override {
+    return parent_.lazyCounter(prefix_ + name);
+  }
+  Gauge& lazyGauge(const std::string& name) override { return parent_.lazyGauge(prefix_ + name); }
   Histogram& histogram(const std::string& name) override {
     return parent_.histogram(prefix_ + name);
   }
@@ -9,8 +9,10 @@
 #include "envoy/stats/stats_options.h"
 #include "envoy/stats/store.h"
 
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/stats/heap_stat_data.h"
+#include "common/stats/lazy_stat_impl.h"
 #include "common/stats/stats_options_impl.h"
 #include "common/stats/utility.h"
 
@@ -18,7 +20,8 @@ namespace Envoy {
 namespace Stats {
 
 /**
- * A stats cache template that is used by the isolated store.
+ * A stats cache template that is used by the isolated store. Stats are keyed by their own name, so
+ * that the cache does not store another copy of it.
  */
 template <class Base> class IsolatedStatsCache {
 public:
@@ -27,16 +30,20 @@ public:
   IsolatedStatsCache(Allocator alloc) : alloc_(alloc) {}
 
   Base& get(const std::string& name) {
-    auto stat = stats_.find(name);
+    auto stat = stats_.find(name.c_str());
     if (stat != stats_.end()) {
       return *stat->second;
     }
 
     std::shared_ptr<Base> new_stat = alloc_(name);
-    stats_.emplace(name, new_stat);
+    stats_.emplace(new_stat->nameCStr(), new_stat);
     return *new_stat;
   }
 
+  bool contains(const std::string& name) const {
+    return stats_.find(name.c_str()) != stats_.end();
+  }
+
   std::vector<std::shared_ptr<Base>> toVector() const {
     std::vector<std::shared_ptr<Base>> vec;
     vec.reserve(stats_.size());
@@ -48,7 +55,7 @@ public:
   }
 
 private:
-  std::unordered_map<std::string, std::shared_ptr<Base>> stats_;
+  CharStarHashMap<std::shared_ptr<Base>> stats_;
   Allocator alloc_;
 };
 
@@ -61,6 +68,8 @@ public:
   ScopePtr createScope(const std::string& name) override;
   void deliverHistogramToSinks(const Histogram&, uint64_t) override {}
   Gauge& gauge(const std::string& name) override { return gauges_.get(name); }
+  Counter& lazyCounter(const std::string& name) override;
+  Gauge& lazyGauge(const std::string& name) override;
   Histogram& histogram(const std::string& name) override {
     Histogram& histogram = histograms_.get(name);
     return histogram;
@@ -68,8 +77,8 @@ public:
   const Stats::StatsOptions& statsOptions() const override { return stats_options_; }
 
   // Stats::Store
-  std::vector<CounterSharedPtr> counters() const override { return counters_.toVector(); }
-  std::vector<GaugeSharedPtr> gauges() const override { return gauges_.toVector(); }
+  std::vector<CounterSharedPtr> counters() const override;
+  std::vector<GaugeSharedPtr> gauges() const override;
   std::vector<ParentHistogramSharedPtr> histograms() const override {
     return std::vector<ParentHistogramSharedPtr>{};
   }
@@ -79,6 +88,8 @@ private:
   IsolatedStatsCache<Counter> counters_;
   IsolatedStatsCache<Gauge> gauges_;
   IsolatedStatsCache<Histogram> histograms_;
+  IsolatedStatsCache<LazyCounterImpl> lazy_counters_;
+  IsolatedStatsCache<LazyGaugeImpl> lazy_gauges_;
   const StatsOptionsImpl stats_options_;
 };
 
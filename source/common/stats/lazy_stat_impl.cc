@@ -0,0 +1,94 @@
+#include "common/stats/lazy_stat_impl.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/macros.h"
+
+namespace Envoy {
+namespace Stats {
+
+const std::vector<Tag>& LazyStatName::tags() const {
+  if (tags_ != nullptr) {
+    return *tags_;
+  }
+  CONSTRUCT_ON_FIRST_USE(std::vector<Tag>);
+}
+
+std::shared_ptr<const std::string>
+LazyStatTagTable::tagExtractedName(const std::string& name, std::string&& tag_extracted_name) {
+  if (tag_extracted_name == name) {
+    return nullptr;
+  }
+  std::string key = tag_extracted_name;
+  return intern(tag_extracted_names_, std::move(key), std::move(tag_extracted_name));
+}
+
+std::shared_ptr<const std::vector<Tag>> LazyStatTagTable::tags(std::vector<Tag>&& tags) {
+  if (tags.empty()) {
+    return nullptr;
+  }
+  std::string key;
+  for (const Tag& tag : tags) {
+    key.append(tag.name_);
+    key.push_back('\0');
+    key.append(tag.value_);
+    key.push_back('\0');
+  }
+  return intern(tags_, std::move(key), std::move(tags));
+}
+
+template <class Value>
+std::shared_ptr<const Value> LazyStatTagTable::intern(Table<Value>& table, std::string&& key,
+                                                      Value&& value) {
+  std::weak_ptr<const Value>& entry = table.entries_[std::move(key)];
+  std::shared_ptr<const Value> shared = entry.lock();
+  if (shared != nullptr) {
+    return shared;
+  }
+  shared = std::make_shared<const Value>(std::move(value));
+  entry = shared;
+
+  if (table.entries_.size() >= table.prune_size_) {
+    for (auto it = table.entries_.begin(); it != table.entries_.end();) {
+      if (it->second.expired()) {
+        it = table.entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    table.prune_size_ = std::max(table.prune_size_, 2 * table.entries_.size());
+  }
+  return shared;
+}
+
+LazyCounterImpl::LazyCounterImpl(StatDataAllocator& alloc, LazyStatName&& name)
+    : alloc_(alloc), name_(std::move(name)), placeholder_(*this), counter_(&placeholder_) {}
+
+Counter& LazyCounterImpl::materialize() {
+  // Modifications racing on several threads all wait for the counter to be allocated once, and
+  // then apply to it.
+  std::call_once(materialize_once_, [this] {
+    materialized_ = alloc_.makeCounter(name_.name(), std::string(), std::vector<Tag>());
+    ASSERT(materialized_ != nullptr);
+    counter_.store(materialized_.get(), std::memory_order_release);
+  });
+  return counter();
+}
+
+LazyGaugeImpl::LazyGaugeImpl(StatDataAllocator& alloc, LazyStatName&& name)
+    : alloc_(alloc), name_(std::move(name)), placeholder_(*this), gauge_(&placeholder_) {}
+
+Gauge& LazyGaugeImpl::materialize() {
+  std::call_once(materialize_once_, [this] {
+    materialized_ = alloc_.makeGauge(name_.name(), std::string(), std::vector<Tag>());
+    ASSERT(materialized_ != nullptr);
+    gauge_.store(materialized_.get(), std::memory_order_release);
+  });
+  return gauge();
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/stats/stat_data_allocator.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/tag.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Name, tag extracted name and tags of a lazy stat. Only the name is owned by the stat: the tag
+ * extracted name and tags are shared with the other lazy stats having the same ones (see
+ * LazyStatTagTable), and are null when they are the name and no tags respectively.
+ */
+class LazyStatName {
+public:
+  LazyStatName(const std::string& name, std::shared_ptr<const std::string> tag_extracted_name,
+               std::shared_ptr<const std::vector<Tag>> tags)
+      : name_(name), tag_extracted_name_(std::move(tag_extracted_name)), tags_(std::move(tags)) {}
+
+  const std::string& name() const { return name_; }
+  const std::string& tagExtractedName() const {
+    return tag_extracted_name_ != nullptr ? *tag_extracted_name_ : name_;
+  }
+  const std::vector<Tag>& tags() const;
+
+private:
+  std::string name_;
+  std::shared_ptr<const std::string> tag_extracted_name_;
+  std::shared_ptr<const std::vector<Tag>> tags_;
+};
+
+/**
+ * Shares the tag extracted names and tags of lazy stats between them: all the stats of a cluster
+ * have the same tags, and a stat has the same tag extracted name in every cluster. Entries are
+ * dropped once no stat references them. This class is not thread safe.
+ */
+class LazyStatTagTable {
+public:
+  /**
+   * @param name supplies the name of the stat.
+   * @param tag_extracted_name supplies the tag extracted name of the stat.
+   * @return the shared tag extracted name, or nullptr if it is the name of the stat.
+   */
+  std::shared_ptr<const std::string> tagExtractedName(const std::string& name,
+                                                      std::string&& tag_extracted_name);
+
+  /**
+   * @param tags supplies the tags of the stat.
+   * @return the shared tags, or nullptr if there are none.
+   */
+  std::shared_ptr<const std::vector<Tag>> tags(std::vector<Tag>&& tags);
+
+  size_t numTagsForTest() const { return tags_.entries_.size(); }
+
+private:
+  template <class Value> struct Table {
+    std::unordered_map<std::string, std::weak_ptr<const Value>> entries_;
+    // Expired entries are erased whenever the table has doubled since they last were.
+    size_t prune_size_{64};
+  };
+
+  template <class Value>
+  static std::shared_ptr<const Value> intern(Table<Value>& table, std::string&& key,
+                                             Value&& value);
+
+  Table<std::string> tag_extracted_names_;
+  Table<std::vector<Tag>> tags_;
+};
+
+/**
+ * Counter handle which only allocates the counter the first time it is modified, so that counters
+ * which are never used take no stat memory. Until then the handle reports a zero value under the
+ * counter's name. Stores list the handle in place of the counter, and it may be materialized by
+ * any thread.
+ *
+ * Every call is forwarded through a pointer which initially references a placeholder, and which
+ * is switched to the created counter by the first modification. Once materialized, the handle
+ * costs an extra indirection but no branch. The created counter has no tags of its own: it is
+ * only reached through the handle, which keeps reporting the tags it was declared with.
+ */
+class LazyCounterImpl : public Counter {
+public:
+  /**
+   * @param alloc supplies the allocator used when the counter is first modified, from any thread.
+   * @param name supplies the name, tag extracted name and tags of the counter.
+   */
+  LazyCounterImpl(StatDataAllocator& alloc, LazyStatName&& name);
+
+  /**
+   * @return bool whether the counter has been allocated.
+   */
+  bool materialized() const { return &counter() != &placeholder_; }
+
+  // Stats::Metric
+  std::string name() const override { return name_.name(); }
+  const char* nameCStr() const override { return name_.name().c_str(); }
+  const std::vector<Tag>& tags() const override { return name_.tags(); }
+  const std::string& tagExtractedName() const override { return name_.tagExtractedName(); }
+  bool used() const override { return counter().used(); }
+
+  // Stats::Counter
+  void add(uint64_t amount) override { counter().add(amount); }
+  void inc() override { counter().inc(); }
+  uint64_t latch() override { return counter().latch(); }
+  void reset() override { counter().reset(); }
+  uint64_t value() const override { return counter().value(); }
+
+private:
+  /**
+   * Stands for the counter until it is allocated: reads report zero and modifications materialize
+   * the counter before being applied to it.
+   */
+  class Placeholder : public Counter {
+  public:
+    Placeholder(LazyCounterImpl& parent) : parent_(parent) {}
+
+    // Stats::Metric
+    std::string name() const override { return parent_.name(); }
+    const char* nameCStr() const override { return parent_.nameCStr(); }
+    const std::vector<Tag>& tags() const override { return parent_.tags(); }
+    const std::string& tagExtractedName() const override { return parent_.tagExtractedName(); }
+    bool used() const override { return false; }
+
+    // Stats::Counter
+    void add(uint64_t amount) override { parent_.materialize().add(amount); }
+    void inc() override { parent_.materialize().inc(); }
+    uint64_t latch() override { return 0; }
+    void reset() override {}
+    uint64_t value() const override { return 0; }
+
+  private:
+    LazyCounterImpl& parent_;
+  };
+
+  Counter& counter() const { return *counter_.load(std::memory_order_acquire); }
+  Counter& materialize();
+
+  StatDataAllocator& alloc_;
+  const LazyStatName name_;
+  Placeholder placeholder_;
+  CounterSharedPtr materialized_;
+  std::atomic<Counter*> counter_;
+  std::once_flag materialize_once_;
+};
+
+typedef std::shared_ptr<LazyCounterImpl> LazyCounterImplSharedPtr;
+
+/**
+ * Gauge handle which only allocates the gauge the first time it is modified. See LazyCounterImpl.
+ */
+class LazyGaugeImpl : public Gauge {
+public:
+  /**
+   * @param alloc supplies the allocator used when the gauge is first modified, from any thread.
+   * @param name supplies the name, tag extracted name and tags of the gauge.
+   */
+  LazyGaugeImpl(StatDataAllocator& alloc, LazyStatName&& name);
+
+  /**
+   * @return bool whether the gauge has been allocated.
+   */
+  bool materialized() const { return &gauge() != &placeholder_; }
+
+  // Stats::Metric
+  std::string name() const override { return name_.name(); }
+  const char* nameCStr() const override { return name_.name().c_str(); }
+  const std::vector<Tag>& tags() const override { return name_.tags(); }
+  const std::string& tagExtractedName() const override { return name_.tagExtractedName(); }
+  bool used() const override { return gauge().used(); }
+
+  // Stats::Gauge
+  void add(uint64_t amount) override { gauge().add(amount); }
+  void dec() override { gauge().dec(); }
+  void inc() override { gauge().inc(); }
+  void set(uint64_t value) override { gauge().set(value); }
+  void sub(uint64_t amount) override { gauge().sub(amount); }
+  uint64_t value() const override { return gauge().value(); }
+
+private:
+  class Placeholder : public Gauge {
+  public:
+    Placeholder(LazyGaugeImpl& parent) : parent_(parent) {}
+
+    // Stats::Metric
+    std::string name() const override { return parent_.name(); }
+    const char* nameCStr() const override { return parent_.nameCStr(); }
+    const std::vector<Tag>& tags() const override { return parent_.tags(); }
+    const std::string& tagExtractedName() const override { return parent_.tagExtractedName(); }
+    bool used() const override { return false; }
+
+    // Stats::Gauge
+    void add(uint64_t amount) override { parent_.materialize().add(amount); }
+    void dec() override { parent_.materialize().dec(); }
+    void inc() override { parent_.materialize().inc(); }
+    void set(uint64_t value) override { parent_.materialize().set(value); }
+    void sub(uint64_t amount) override { parent_.materialize().sub(amount); }
+    uint64_t value() const override { return 0; }
+
+  private:
+    LazyGaugeImpl& parent_;
+  };
+
+  Gauge& gauge() const { return *gauge_.load(std::memory_order_acquire); }
+  Gauge& materialize();
+
+  StatDataAllocator& alloc_;
+  const LazyStatName name_;
+  Placeholder placeholder_;
+  GaugeSharedPtr materialized_;
+  std::atomic<Gauge*> gauge_;
+  std::once_flag materialize_once_;
+};
+
+typedef std::shared_ptr<LazyGaugeImpl> LazyGaugeImplSharedPtr;
+
+} // namespace Stats
+} // namespace Envoy
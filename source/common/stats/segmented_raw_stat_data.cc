@@ -0,0 +1,290 @@
+#include "common/stats/segmented_raw_stat_data.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/assert.h"
+#include "common/common/fmt.h"
+#include "common/common/hash.h"
+#include "common/common/lock_guard.h"
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Stats {
+
+namespace {
+
+// Segments double in size from InitialSegmentSize up to MaxSegmentSize, so that a small
+// configuration only maps a few pages while a large one does not need many segments.
+const uint64_t InitialSegmentSize = 64 * 1024;
+const uint64_t MaxSegmentSize = 16 * 1024 * 1024;
+
+// Block sizes are rounded up to a multiple of this, which is also the width of a size class.
+const uint64_t SizeClassGranularity = 16;
+
+// Terminates the free lists.
+const uint64_t NoBlock = UINT64_MAX;
+
+// Locations of blocks are encoded as the segment index and the offset within that segment, so
+// that they are meaningful in every process.
+uint64_t makeLocation(uint64_t segment, uint64_t offset) { return (segment << 32) | offset; }
+uint64_t locationSegment(uint64_t location) { return location >> 32; }
+uint64_t locationOffset(uint64_t location) { return location & 0xffffffff; }
+
+} // namespace
+
+const uint32_t SegmentedRawStatDataControl::MaxSegments;
+const uint32_t SegmentedRawStatDataControl::NumSizeClasses;
+
+SegmentedRawStatDataAllocator::SegmentedRawStatDataAllocator(Thread::BasicLockable& mutex,
+                                                             SegmentedRawStatDataControl& control,
+                                                             RawStatDataSegmentMapper& mapper,
+                                                             bool init, uint64_t max_stats,
+                                                             const StatsOptions& options)
+    : mutex_(mutex), control_(control), mapper_(mapper), max_stats_(max_stats), options_(options) {
+  Thread::LockGuard lock(mutex_);
+  if (init) {
+    memset(&control_, 0, sizeof(control_));
+    control_.signature_ = signature();
+    std::fill(std::begin(control_.free_lists_), std::end(control_.free_lists_), NoBlock);
+  } else if (control_.signature_ != signature()) {
+    throw EnvoyException("SegmentedRawStatDataAllocator: incompatible memory block");
+  }
+  syncIndex();
+}
+
+std::string SegmentedRawStatDataAllocator::version() {
+  return fmt::format("block_header={} stat_data={} segments={}x{}-{} size_classes={}x{}",
+                     sizeof(BlockHeader), sizeof(RawStatData),
+                     SegmentedRawStatDataControl::MaxSegments, InitialSegmentSize, MaxSegmentSize,
+                     SegmentedRawStatDataControl::NumSizeClasses, SizeClassGranularity);
+}
+
+uint64_t SegmentedRawStatDataAllocator::signature() { return HashUtil::xxHash64(version()); }
+
+uint64_t SegmentedRawStatDataAllocator::numStats() const {
+  Thread::LockGuard lock(mutex_);
+  return control_.num_stats_;
+}
+
+uint64_t SegmentedRawStatDataAllocator::numSegments() const {
+  Thread::LockGuard lock(mutex_);
+  return control_.num_segments_;
+}
+
+uint64_t SegmentedRawStatDataAllocator::blockSize(uint64_t name_size) {
+  const uint64_t size = sizeof(BlockHeader) + RawStatData::structSize(name_size);
+  return (size + SizeClassGranularity - 1) / SizeClassGranularity * SizeClassGranularity;
+}
+
+SegmentedRawStatDataAllocator::BlockHeader&
+SegmentedRawStatDataAllocator::header(uint64_t location) {
+  ASSERT(locationSegment(location) < segments_.size());
+  return *reinterpret_cast<BlockHeader*>(segments_[locationSegment(location)] +
+                                         locationOffset(location));
+}
+
+RawStatData& SegmentedRawStatDataAllocator::data(uint64_t location) {
+  return *reinterpret_cast<RawStatData*>(reinterpret_cast<uint8_t*>(&header(location)) +
+                                         sizeof(BlockHeader));
+}
+
+uint64_t SegmentedRawStatDataAllocator::locationOf(const RawStatData& stat) const {
+  const uint8_t* block = reinterpret_cast<const uint8_t*>(&stat) - sizeof(BlockHeader);
+  for (uint64_t segment = 0; segment < segments_.size(); ++segment) {
+    if (block >= segments_[segment] &&
+        block < segments_[segment] + control_.segment_sizes_[segment]) {
+      return makeLocation(segment, block - segments_[segment]);
+    }
+  }
+  NOT_REACHED_GCOVR_EXCL_LINE;
+}
+
+void SegmentedRawStatDataAllocator::mapSegments() {
+  while (segments_.size() < control_.num_segments_) {
+    const uint32_t index = segments_.size();
+    uint8_t* memory = mapper_.mapSegment(index, control_.segment_sizes_[index], false);
+    RELEASE_ASSERT(memory != nullptr, fmt::format("unable to map stats segment {}", index));
+    segments_.push_back(memory);
+  }
+}
+
+void SegmentedRawStatDataAllocator::syncIndex() {
+  if (index_generation_ != control_.generation_) {
+    // Another process reused a freed block for a different name, so the names referenced by the
+    // index may have changed under it. This only happens while processes overlap during a hot
+    // restart.
+    index_.clear();
+    index_generation_ = control_.generation_;
+    index_segment_ = 0;
+    index_offset_ = 0;
+  }
+
+  mapSegments();
+  while (index_segment_ < control_.num_segments_) {
+    const bool last = index_segment_ + 1 == control_.num_segments_;
+    const uint64_t end = last ? control_.tail_offset_ : control_.segment_sizes_[index_segment_];
+    while (index_offset_ < end) {
+      const uint64_t location = makeLocation(index_segment_, index_offset_);
+      const uint64_t size = header(location).size_;
+      if (size == 0) {
+        // The rest of the segment was left unused when the next segment was mapped.
+        break;
+      }
+      index_.emplace(data(location).key(), location);
+      index_offset_ += size;
+    }
+    if (last) {
+      break;
+    }
+    ++index_segment_;
+    index_offset_ = 0;
+  }
+}
+
+uint64_t SegmentedRawStatDataAllocator::appendBlock(uint64_t size) {
+  ASSERT(segments_.size() == control_.num_segments_);
+  if (control_.num_segments_ == 0 ||
+      control_.tail_offset_ + size > control_.segment_sizes_[control_.num_segments_ - 1]) {
+    const uint64_t index = control_.num_segments_;
+    if (index == SegmentedRawStatDataControl::MaxSegments) {
+      return NoBlock;
+    }
+    const uint64_t segment_size =
+        std::max(std::min(InitialSegmentSize << std::min<uint64_t>(index, 32), MaxSegmentSize),
+                 size);
+    uint8_t* memory = mapper_.mapSegment(index, segment_size, true);
+    if (memory == nullptr) {
+      return NoBlock;
+    }
+    segments_.push_back(memory);
+    control_.segment_sizes_[index] = segment_size;
+    control_.num_segments_ = index + 1;
+    control_.tail_offset_ = 0;
+  }
+
+  const uint64_t location = makeLocation(control_.num_segments_ - 1, control_.tail_offset_);
+  control_.tail_offset_ += size;
+  header(location).size_ = size;
+  return location;
+}
+
+void SegmentedRawStatDataAllocator::pushFree(uint64_t location) {
+  BlockHeader& block = header(location);
+  const uint64_t size_class = block.size_ / SizeClassGranularity;
+  if (size_class >= SegmentedRawStatDataControl::NumSizeClasses) {
+    // Blocks for very long names are only reused when the same name is allocated again.
+    return;
+  }
+  uint64_t& head = control_.free_lists_[size_class];
+  block.prev_free_ = NoBlock;
+  block.next_free_ = head;
+  if (head != NoBlock) {
+    header(head).prev_free_ = location;
+  }
+  head = location;
+}
+
+void SegmentedRawStatDataAllocator::unlinkFree(uint64_t location) {
+  BlockHeader& block = header(location);
+  const uint64_t size_class = block.size_ / SizeClassGranularity;
+  if (size_class >= SegmentedRawStatDataControl::NumSizeClasses) {
+    return;
+  }
+  if (block.prev_free_ == NoBlock) {
+    control_.free_lists_[size_class] = block.next_free_;
+  } else {
+    header(block.prev_free_).next_free_ = block.next_free_;
+  }
+  if (block.next_free_ != NoBlock) {
+    header(block.next_free_).prev_free_ = block.prev_free_;
+  }
+}
+
+bool SegmentedRawStatDataAllocator::full() const {
+  return max_stats_ != 0 && control_.num_stats_ >= max_stats_;
+}
+
+RawStatData* SegmentedRawStatDataAllocator::alloc(absl::string_view name) {
+  Thread::LockGuard lock(mutex_);
+  if (name.length() > options_.maxNameLength()) {
+    ENVOY_LOG_MISC(
+        warn,
+        "Statistic '{}' is too long with {} characters, it will be truncated to {} characters",
+        name, name.size(), options_.maxNameLength());
+    name = name.substr(0, options_.maxNameLength());
+  }
+  syncIndex();
+
+  const auto iter = index_.find(name);
+  if (iter != index_.end()) {
+    RawStatData& existing = data(iter->second);
+    if (existing.ref_count_ > 0) {
+      ++existing.ref_count_;
+      return &existing;
+    }
+    // The stat was freed, but its block still holds the name.
+    if (full()) {
+      return nullptr;
+    }
+    unlinkFree(iter->second);
+    existing.ref_count_ = 1;
+    ++control_.num_stats_;
+    return &existing;
+  }
+
+  if (full()) {
+    return nullptr;
+  }
+  const uint64_t size = blockSize(name.size());
+  const uint64_t size_class = size / SizeClassGranularity;
+  uint64_t location = size_class < SegmentedRawStatDataControl::NumSizeClasses
+                          ? control_.free_lists_[size_class]
+                          : NoBlock;
+  if (location != NoBlock) {
+    // Reuse a freed block of the same size. The indexes of the other processes still reference
+    // its previous name, so they are invalidated.
+    unlinkFree(location);
+    RawStatData& reused = data(location);
+    index_.erase(reused.key());
+    reused.name_[0] = '\0';
+    index_generation_ = ++control_.generation_;
+  } else {
+    location = appendBlock(size);
+    if (location == NoBlock) {
+      return nullptr;
+    }
+  }
+
+  RawStatData& created = data(location);
+  created.initialize(name, options_);
+  index_.emplace(created.key(), location);
+  ++control_.num_stats_;
+  return &created;
+}
+
+void SegmentedRawStatDataAllocator::free(RawStatData& stat) {
+  // We must hold the lock since the reference decrement can race with an alloc above.
+  Thread::LockGuard lock(mutex_);
+  ASSERT(stat.ref_count_ > 0);
+  if (--stat.ref_count_ > 0) {
+    return;
+  }
+  // The name is kept so that the block is found again if any process re-allocates the stat, but the
+  // values are reset as for a new stat.
+  stat.value_ = 0;
+  stat.pending_increment_ = 0;
+  stat.flags_ = 0;
+  stat.unused_ = 0;
+  mapSegments();
+  pushFree(locationOf(stat));
+  --control_.num_stats_;
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/stats/stats_options.h"
+
+#include "common/common/thread.h"
+#include "common/common/thread_annotations.h"
+#include "common/stats/raw_stat_data.h"
+#include "common/stats/stat_data_allocator_impl.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Maps the memory segments backing a SegmentedRawStatDataAllocator. A segment is identified by its
+ * index, and must map to the same memory in every process sharing the allocator.
+ */
+class RawStatDataSegmentMapper {
+public:
+  virtual ~RawStatDataSegmentMapper() {}
+
+  /**
+   * @param index supplies the index of the segment.
+   * @param size supplies the size of the segment in bytes.
+   * @param create true if the segment is being created, in which case its memory must be zeroed;
+   *        false if it was created by another process sharing the allocator.
+   * @return uint8_t* the segment memory, aligned for RawStatData, or nullptr if the segment could
+   *         not be mapped.
+   */
+  virtual uint8_t* mapSegment(uint32_t index, uint64_t size, bool create) PURE;
+};
+
+/**
+ * Control block of a SegmentedRawStatDataAllocator. It is free of pointers so that it can be laid
+ * directly into shared memory, and describes where every segment and free block is so that a
+ * process attaching to it can find the stats allocated by the others.
+ */
+struct SegmentedRawStatDataControl {
+  static const uint32_t MaxSegments = 64;
+  static const uint32_t NumSizeClasses = 64;
+
+  uint64_t signature_;
+  // Number of values currently allocated, used to enforce the configured maximum if any.
+  uint64_t num_stats_;
+  // Incremented whenever a block is reused for a different name, which invalidates the name
+  // indexes held by each process.
+  uint64_t generation_;
+  uint64_t num_segments_;
+  // Number of bytes used in the last segment.
+  uint64_t tail_offset_;
+  uint64_t segment_sizes_[MaxSegments];
+  // Heads of the lists of freed blocks, by block size class.
+  uint64_t free_lists_[NumSizeClasses];
+};
+
+/**
+ * Implementation of StatDataAllocator which carves variable-length RawStatData blocks out of a set
+ * of memory segments. Segments are only mapped as stats are allocated, so memory use follows the
+ * number and length of the stat names rather than being reserved up front for the maximum.
+ *
+ * Blocks are appended to the last segment, and a new, larger segment is mapped when it is full.
+ * Freed blocks keep their name, so that they can be found again by any process when the same stat
+ * is re-allocated, and are kept in a list by size class so that they can be reused for other names
+ * of similar length.
+ *
+ * Each process keeps a heap index from names to blocks. It is brought up to date under the lock by
+ * scanning the blocks appended since the last lookup, and rebuilt when another process has reused a
+ * freed block for a different name.
+ */
+class SegmentedRawStatDataAllocator : public StatDataAllocatorImpl<RawStatData> {
+public:
+  /**
+   * @param mutex supplies the lock serializing access to the control block, shared by every
+   *        process sharing the allocator.
+   * @param control supplies the control block.
+   * @param mapper supplies the mapper used to map segments.
+   * @param init true if the control block should be initialized, false to attach to the segments
+   *        allocated by another process.
+   * @param max_stats supplies the maximum number of values allocated at any time, or 0 for no
+   *        maximum, in which case allocations only fail once every segment is full.
+   * @param options supplies the stats options, which bound the stat name length.
+   * @throw EnvoyException if attaching to a control block with a different layout.
+   */
+  SegmentedRawStatDataAllocator(Thread::BasicLockable& mutex, SegmentedRawStatDataControl& control,
+                                RawStatDataSegmentMapper& mapper, bool init, uint64_t max_stats,
+                                const StatsOptions& options);
+
+  /**
+   * @return std::string a signature of the memory layout, which must match for processes to share
+   *         the allocator.
+   */
+  static std::string version();
+
+  /**
+   * @return uint64_t the number of values currently allocated.
+   */
+  uint64_t numStats() const;
+
+  /**
+   * @return uint64_t the number of segments mapped.
+   */
+  uint64_t numSegments() const;
+
+  // StatDataAllocator
+  bool requiresBoundedStatNameSize() const override { return true; }
+  RawStatData* alloc(absl::string_view name) override;
+  void free(RawStatData& stat) override;
+
+private:
+  /**
+   * Header preceding each RawStatData in a segment.
+   */
+  struct BlockHeader {
+    // Size of the block including this header. Zero past the last block of a segment.
+    uint64_t size_;
+    // Links in the free list of the block's size class, valid while the block is freed.
+    uint64_t prev_free_;
+    uint64_t next_free_;
+  };
+
+  static uint64_t blockSize(uint64_t name_size);
+  static uint64_t signature();
+
+  bool full() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  BlockHeader& header(uint64_t location) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  RawStatData& data(uint64_t location) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  uint64_t locationOf(const RawStatData& stat) const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void syncIndex() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void mapSegments() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  uint64_t appendBlock(uint64_t size) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void pushFree(uint64_t location) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void unlinkFree(uint64_t location) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  Thread::BasicLockable& mutex_;
+  SegmentedRawStatDataControl& control_ GUARDED_BY(mutex_);
+  RawStatDataSegmentMapper& mapper_;
+  const uint64_t max_stats_;
+  const StatsOptions& options_;
+  std::vector<uint8_t*> segments_ GUARDED_BY(mutex_);
+  // Names of the blocks found so far, referencing the names in the segments.
+  absl::flat_hash_map<absl::string_view, uint64_t> index_ GUARDED_BY(mutex_);
+  uint64_t index_generation_ GUARDED_BY(mutex_){};
+  // Location of the next block to add to index_.
+  uint64_t index_segment_ GUARDED_BY(mutex_){};
+  uint64_t index_offset_ GUARDED_BY(mutex_){};
+};
+
+} // namespace Stats
+} // namespace Envoy
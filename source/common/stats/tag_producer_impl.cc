@@ -50,6 +50,12 @@ int TagProducerImpl::addExtractorsMatching(absl::string_view name) {
       ++num_found;
     }
   }
+  for (const auto& desc : Config::TagNames::get().tokenizedDescriptorVec()) {
+    if (desc.name_ == name) {
+      tag_token_matcher_.addPattern(desc.name_, desc.pattern_);
+      ++num_found;
+    }
+  }
   return num_found;
 }
 
@@ -84,6 +90,7 @@ std::string TagProducerImpl::produceTags(const std::string& metric_name,
                                          std::vector<Tag>& tags) const {
   tags.insert(tags.end(), default_tags_.begin(), default_tags_.end());
   IntervalSetImpl<size_t> remove_characters;
+  tag_token_matcher_.extractTags(metric_name, tags, remove_characters);
   forEachExtractorMatching(
       metric_name, [&remove_characters, &tags, &metric_name](const TagExtractorPtr& tag_extractor) {
         tag_extractor->extractTag(metric_name, tags, remove_characters);
@@ -104,6 +111,10 @@ TagProducerImpl::addDefaultExtractors(const envoy::config::metrics::v2::StatsCon
       addExtractor(
           Stats::TagExtractorImpl::createTagExtractor(desc.name_, desc.regex_, desc.substr_));
     }
+    for (const auto& desc : Config::TagNames::get().tokenizedDescriptorVec()) {
+      names.emplace(desc.name_);
+      tag_token_matcher_.addPattern(desc.name_, desc.pattern_);
+    }
   }
   return names;
 }
@@ -16,6 +16,7 @@
 #include "common/common/utility.h"
 #include "common/config/well_known_names.h"
 #include "common/protobuf/protobuf.h"
+#include "common/stats/tag_token_matcher.h"
 
 #include "absl/strings/string_view.h"
 
@@ -24,7 +25,8 @@ namespace Stats {
 
 /**
  * Organizes a collection of TagExtractors so that stat-names can be processed without
- * iterating through all extractors.
+ * iterating through all extractors. Default tags described by token patterns are compiled into
+ * a single TagTokenMatcher, so that they are all extracted in one pass over the stat-name.
  */
 class TagProducerImpl : public TagProducer {
 public:
@@ -51,8 +53,8 @@ private:
 
   /**
    * Adds all default extractors matching the specified tag name. In this model,
-   * more than one TagExtractor can be used to generate a given tag. The default
-   * extractors are specified in common/config/well_known_names.cc.
+   * more than one TagExtractor or token pattern can be used to generate a given tag.
+   * The default extractors are specified in common/config/well_known_names.cc.
    * @param name absl::string_view the extractor to add.
    * @return int the number of matching extractors.
    */
@@ -76,7 +78,7 @@ private:
   addDefaultExtractors(const envoy::config::metrics::v2::StatsConfig& config);
 
   /**
-   * Iterates over every tag extractor that might possibly match stat_name, calling
+   * Iterates over every regex tag extractor that might possibly match stat_name, calling
    * callback f for each one. This is broken out this way to reduce code redundancy
    * during testing, where we want to verify that extraction is order-independent.
    * The possibly-matching-extractors list is computed by:
@@ -92,6 +94,9 @@ private:
   void forEachExtractorMatching(const std::string& stat_name,
                                 std::function<void(const TagExtractorPtr&)> f) const;
 
+  // Default tags which can be described by token patterns.
+  TagTokenMatcher tag_token_matcher_;
+
   std::vector<TagExtractorPtr> tag_extractors_without_prefix_;
 
   // Maps a prefix word extracted out of a regex to a vector of TagExtractors. Note that
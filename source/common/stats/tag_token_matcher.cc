@@ -0,0 +1,157 @@
+#include "common/stats/tag_token_matcher.h"
+
+#include <algorithm>
+#include <string>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/assert.h"
+#include "common/common/fmt.h"
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_split.h"
+
+namespace Envoy {
+namespace Stats {
+
+void TagTokenMatcher::addPattern(const std::string& name, const std::string& pattern) {
+  if (name.empty()) {
+    throw EnvoyException("tag_name cannot be empty");
+  }
+
+  Node* node = &root_;
+  std::vector<Element> elements;
+  uint32_t num_captures = 0;
+  for (absl::string_view token : absl::StrSplit(pattern, '.')) {
+    if (token.empty()) {
+      throw EnvoyException(fmt::format("Empty token in tag pattern '{}'", pattern));
+    }
+    Element element;
+    if (token == "*") {
+      element.type_ = ElementType::AnyToken;
+    } else if (token == "**") {
+      element.type_ = ElementType::AnyTokens;
+    } else if (token == "$$") {
+      element.type_ = ElementType::CaptureTokens;
+      ++num_captures;
+    } else if (absl::EndsWith(token, "$")) {
+      element.type_ = ElementType::Capture;
+      element.literal_ = std::string(token.substr(0, token.size() - 1));
+      if (element.literal_.find_first_of("$*") != std::string::npos) {
+        throw EnvoyException(fmt::format("Invalid token '{}' in tag pattern '{}'", token, pattern));
+      }
+      ++num_captures;
+    } else if (token.find_first_of("$*") != absl::string_view::npos) {
+      throw EnvoyException(fmt::format("Invalid token '{}' in tag pattern '{}'", token, pattern));
+    } else {
+      element.type_ = ElementType::Literal;
+      element.literal_ = std::string(token);
+    }
+
+    // Leading literals are encoded in the trie, so that patterns are only considered for names
+    // sharing those tokens.
+    if (elements.empty() && element.type_ == ElementType::Literal) {
+      auto iter = node->children_.find(token);
+      if (iter == node->children_.end()) {
+        NodePtr child = std::make_unique<Node>();
+        child->token_ = element.literal_;
+        const absl::string_view key = child->token_;
+        iter = node->children_.emplace(key, std::move(child)).first;
+      }
+      node = iter->second.get();
+      continue;
+    }
+    elements.emplace_back(std::move(element));
+  }
+
+  if (node == &root_) {
+    throw EnvoyException(fmt::format("Tag pattern '{}' must start with a literal token", pattern));
+  }
+  if (num_captures != 1) {
+    throw EnvoyException(
+        fmt::format("Tag pattern '{}' must contain exactly one capture token", pattern));
+  }
+  node->patterns_.emplace_back(Pattern{name, num_patterns_++, std::move(elements)});
+}
+
+bool TagTokenMatcher::matchElements(const std::vector<Element>& elements, size_t element,
+                                    const std::vector<absl::string_view>& tokens, size_t token,
+                                    Capture& capture) {
+  if (element == elements.size()) {
+    return token == tokens.size();
+  }
+
+  const Element& e = elements[element];
+  switch (e.type_) {
+  case ElementType::Literal:
+    return token < tokens.size() && tokens[token] == e.literal_ &&
+           matchElements(elements, element + 1, tokens, token + 1, capture);
+  case ElementType::AnyToken:
+    return token < tokens.size() &&
+           matchElements(elements, element + 1, tokens, token + 1, capture);
+  case ElementType::AnyTokens:
+    for (size_t next = token; next <= tokens.size(); ++next) {
+      if (matchElements(elements, element + 1, tokens, next, capture)) {
+        return true;
+      }
+    }
+    return false;
+  case ElementType::Capture:
+    if (token < tokens.size() && absl::StartsWith(tokens[token], e.literal_) &&
+        matchElements(elements, element + 1, tokens, token + 1, capture)) {
+      capture = {token, token, e.literal_.size()};
+      return true;
+    }
+    return false;
+  case ElementType::CaptureTokens:
+    for (size_t next = token + 1; next <= tokens.size(); ++next) {
+      if (matchElements(elements, element + 1, tokens, next, capture)) {
+        capture = {token, next - 1, 0};
+        return true;
+      }
+    }
+    return false;
+  }
+  NOT_REACHED_GCOVR_EXCL_LINE;
+}
+
+void TagTokenMatcher::extractTags(absl::string_view stat_name, std::vector<Tag>& tags,
+                                  IntervalSet<size_t>& remove_characters) const {
+  const std::vector<absl::string_view> tokens = absl::StrSplit(stat_name, '.');
+  std::vector<Match> matches;
+
+  const Node* node = &root_;
+  for (size_t token = 0; token < tokens.size(); ++token) {
+    const auto iter = node->children_.find(tokens[token]);
+    if (iter == node->children_.end()) {
+      break;
+    }
+    node = iter->second.get();
+    for (const Pattern& pattern : node->patterns_) {
+      Capture capture;
+      if (matchElements(pattern.elements_, 0, tokens, token + 1, capture)) {
+        const absl::string_view first = tokens[capture.first_token_];
+        const absl::string_view last = tokens[capture.last_token_];
+        const size_t value_start = first.data() - stat_name.data();
+        const size_t value_end = last.data() + last.size() - stat_name.data();
+        // The capture is never the first token, so there is always a preceding '.' to elide.
+        matches.emplace_back(Match{
+            &pattern,
+            std::string(stat_name.substr(value_start + capture.prefix_size_,
+                                         value_end - value_start - capture.prefix_size_)),
+            value_start - 1, value_end});
+      }
+    }
+  }
+
+  std::sort(matches.begin(), matches.end(), [](const Match& lhs, const Match& rhs) {
+    return lhs.pattern_->index_ < rhs.pattern_->index_;
+  });
+  for (Match& match : matches) {
+    tags.emplace_back(Tag{match.pattern_->name_, std::move(match.value_)});
+    remove_characters.insert(match.start_, match.end_);
+  }
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/interval_set.h"
+#include "envoy/stats/tag.h"
+
+#include "common/common/utility.h"
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Extracts tags from stat names using patterns expressed in terms of the '.'-separated tokens of
+ * a name rather than as regexes. All patterns are compiled into a single trie keyed on their
+ * leading literal tokens, so that a stat name is tokenized once and only the patterns sharing its
+ * leading tokens are considered, without running a regex per tag.
+ *
+ * A pattern is a '.'-separated list of elements:
+ *   literal   matches a token equal to the literal.
+ *   *         matches exactly one token.
+ *   **        matches zero or more tokens. Alternatives are tried shortest first.
+ *   $         captures exactly one token as the tag value.
+ *   $$        captures one or more tokens as the tag value. Alternatives are tried shortest first.
+ *   prefix$   captures a token starting with "prefix"; the tag value excludes the prefix.
+ *
+ * A pattern must start with a literal, contain exactly one capture, and match the entire stat
+ * name. The captured tokens are removed from the tag-extracted name together with the '.'
+ * preceding them. For example, "cluster.$.*.**" extracts "foo" from "cluster.foo.upstream_rq",
+ * leaving "cluster.upstream_rq".
+ */
+class TagTokenMatcher {
+public:
+  /**
+   * Compiles a pattern into the matcher.
+   * @param name the name of the tag extracted by the pattern.
+   * @param pattern the token pattern, as described above.
+   * @throw EnvoyException if the pattern is malformed.
+   */
+  void addPattern(const std::string& name, const std::string& pattern);
+
+  /**
+   * Finds tags for every pattern matching stat_name and adds them to tags, in the order in which
+   * the patterns were added. The characters to elide from stat_name are added to
+   * remove_characters. See TagExtractor::extractTag for details on the contract.
+   * @param stat_name the stat name.
+   * @param tags list of tags updated with the tags found in the name.
+   * @param remove_characters set of intervals of character-indices to be removed from name.
+   */
+  void extractTags(absl::string_view stat_name, std::vector<Tag>& tags,
+                   IntervalSet<size_t>& remove_characters) const;
+
+  /**
+   * @return bool whether no patterns have been added.
+   */
+  bool empty() const { return num_patterns_ == 0; }
+
+private:
+  enum class ElementType { Literal, AnyToken, AnyTokens, Capture, CaptureTokens };
+
+  struct Element {
+    ElementType type_;
+    // The token to match for Literal, or the required token prefix for Capture.
+    std::string literal_;
+  };
+
+  struct Pattern {
+    std::string name_;
+    // Order in which the pattern was added, used to report tags in a stable order.
+    uint32_t index_;
+    // Elements following the leading literals which are encoded in the trie.
+    std::vector<Element> elements_;
+  };
+
+  struct Node;
+  typedef std::unique_ptr<Node> NodePtr;
+
+  struct Node {
+    // Keys reference the token_ owned by each child.
+    std::unordered_map<absl::string_view, NodePtr, StringViewHash> children_;
+    std::string token_;
+    std::vector<Pattern> patterns_;
+  };
+
+  // Location of the captured value within the tokenized stat name.
+  struct Capture {
+    size_t first_token_;
+    size_t last_token_;
+    size_t prefix_size_;
+  };
+
+  struct Match {
+    const Pattern* pattern_;
+    std::string value_;
+    size_t start_;
+    size_t end_;
+  };
+
+  static bool matchElements(const std::vector<Element>& elements, size_t element,
+                            const std::vector<absl::string_view>& tokens, size_t token,
+                            Capture& capture);
+
+  Node root_;
+  uint32_t num_patterns_{};
+};
+
+} // namespace Stats
+} // namespace Envoy
@@ -26,7 +26,8 @@ ThreadLocalStoreImpl::ThreadLocalStoreImpl(const StatsOptions& stats_options,
     : stats_options_(stats_options), alloc_(alloc), default_scope_(createScope("")),
       tag_producer_(std::make_unique<TagProducerImpl>()),
       stats_matcher_(std::make_unique<StatsMatcherImpl>()),
-      num_last_resort_stats_(default_scope_->counter("stats.overflow")), source_(*this) {}
+      num_last_resort_stats_(default_scope_->counter("stats.overflow")), lazy_allocator_(*this),
+      source_(*this) {}
 
 ThreadLocalStoreImpl::~ThreadLocalStoreImpl() {
   ASSERT(shutting_down_);
@@ -46,6 +47,8 @@ void ThreadLocalStoreImpl::setStatsMatcher(StatsMatcherPtr&& stats_matcher) {
     removeRejectedStats(scope->central_cache_.counters_, deleted_counters_);
     removeRejectedStats(scope->central_cache_.gauges_, deleted_gauges_);
     removeRejectedStats(scope->central_cache_.histograms_, deleted_histograms_);
+    removeRejectedStats(scope->central_cache_.lazy_counters_, deleted_counters_);
+    removeRejectedStats(scope->central_cache_.lazy_gauges_, deleted_gauges_);
   }
 }
 
@@ -84,6 +87,14 @@ std::vector<CounterSharedPtr> ThreadLocalStoreImpl::counters() const {
       }
     }
   }
+  // A lazy counter shares its data with any counter of the same name, which is listed instead.
+  for (ScopeImpl* scope : scopes_) {
+    for (auto& counter : scope->central_cache_.lazy_counters_) {
+      if (names.insert(counter.first).second) {
+        ret.push_back(counter.second);
+      }
+    }
+  }
 
   return ret;
 }
@@ -107,6 +118,13 @@ std::vector<GaugeSharedPtr> ThreadLocalStoreImpl::gauges() const {
       }
     }
   }
+  for (ScopeImpl* scope : scopes_) {
+    for (auto& gauge : scope->central_cache_.lazy_gauges_) {
+      if (names.insert(gauge.first).second) {
+        ret.push_back(gauge.second);
+      }
+    }
+  }
 
   return ret;
 }
@@ -147,16 +165,9 @@ void ThreadLocalStoreImpl::mergeHistograms(PostMergeCb merge_complete_cb) {
   if (!shutting_down_) {
     ASSERT(!merge_in_progress_);
     merge_in_progress_ = true;
-    tls_->runOnAllThreads(
-        [this]() -> void {
-          for (const auto& scope : tls_->getTyped<TlsCache>().scope_cache_) {
-            const TlsCacheEntry& tls_cache_entry = scope.second;
-            for (const auto& name_histogram_pair : tls_cache_entry.histograms_) {
-              const TlsHistogramSharedPtr& tls_hist = name_histogram_pair.second;
-              tls_hist->beginMerge();
-            }
-          }
-        },
+    // TLS histograms are harvested from the main thread without involving the workers, so the
+    // merge only has to be deferred to honor the contract that the callback runs after return.
+    main_thread_dispatcher_->post(
         [this, merge_complete_cb]() -> void { mergeInternal(merge_complete_cb); });
   } else {
     // If server is shutting down, just call the callback to allow flush to continue.
@@ -213,6 +224,35 @@ absl::string_view ThreadLocalStoreImpl::truncateStatNameIfNeeded(absl::string_vi
   return name;
 }
 
+CounterSharedPtr ThreadLocalStoreImpl::LazyStatDataAllocator::makeCounter(
+    absl::string_view name, std::string&& tag_extracted_name, std::vector<Tag>&& tags) {
+  CounterSharedPtr counter =
+      parent_.alloc_.makeCounter(name, std::move(tag_extracted_name), std::move(tags));
+  if (counter == nullptr) {
+    // See the comment in safeMakeStat() about the use-after-move.
+    parent_.num_last_resort_stats_.inc();
+    counter = parent_.heap_allocator_.makeCounter(
+        name,
+        std::move(tag_extracted_name), // NOLINT(bugprone-use-after-move)
+        std::move(tags));              // NOLINT(bugprone-use-after-move)
+  }
+  return counter;
+}
+
+GaugeSharedPtr ThreadLocalStoreImpl::LazyStatDataAllocator::makeGauge(
+    absl::string_view name, std::string&& tag_extracted_name, std::vector<Tag>&& tags) {
+  GaugeSharedPtr gauge =
+      parent_.alloc_.makeGauge(name, std::move(tag_extracted_name), std::move(tags));
+  if (gauge == nullptr) {
+    parent_.num_last_resort_stats_.inc();
+    gauge = parent_.heap_allocator_.makeGauge(
+        name,
+        std::move(tag_extracted_name), // NOLINT(bugprone-use-after-move)
+        std::move(tags));              // NOLINT(bugprone-use-after-move)
+  }
+  return gauge;
+}
+
 std::atomic<uint64_t> ThreadLocalStoreImpl::ScopeImpl::next_scope_id_;
 
 ThreadLocalStoreImpl::ScopeImpl::~ScopeImpl() { parent_.releaseScopeCrossThread(this); }
@@ -315,6 +355,52 @@ Counter& ThreadLocalStoreImpl::ScopeImpl::counter(const std::string& name) {
       tls_cache);
 }
 
+template <class StatType, class LazyStatType>
+StatType& ThreadLocalStoreImpl::ScopeImpl::safeMakeLazyStat(
+    const std::string& name, StatMap<std::shared_ptr<StatType>>& central_cache_map,
+    StatMap<std::shared_ptr<LazyStatType>>& lazy_cache_map) {
+  const std::string stat_name(parent_.truncateStatNameIfNeeded(name));
+
+  Thread::LockGuard lock(parent_.lock_);
+  auto stat = central_cache_map.find(stat_name.c_str());
+  if (stat != central_cache_map.end()) {
+    return *stat->second;
+  }
+  auto lazy_stat = lazy_cache_map.find(stat_name.c_str());
+  if (lazy_stat != lazy_cache_map.end()) {
+    return *lazy_stat->second;
+  }
+
+  // Tags are extracted when the stat is declared so that it is reported with them before it is
+  // materialized.
+  std::vector<Tag> tags;
+  std::string tag_extracted_name = parent_.getTagsForName(name, tags);
+  std::shared_ptr<LazyStatType> new_stat = std::make_shared<LazyStatType>(
+      parent_.lazy_allocator_,
+      LazyStatName(stat_name,
+                   parent_.lazy_tags_.tagExtractedName(stat_name, std::move(tag_extracted_name)),
+                   parent_.lazy_tags_.tags(std::move(tags))));
+  lazy_cache_map[new_stat->nameCStr()] = new_stat;
+  return *new_stat;
+}
+
+Counter& ThreadLocalStoreImpl::ScopeImpl::lazyCounter(const std::string& name) {
+  std::string final_name = prefix_ + name;
+  if (parent_.rejects(final_name)) {
+    return null_counter_;
+  }
+  return safeMakeLazyStat<Counter>(final_name, central_cache_.counters_,
+                                   central_cache_.lazy_counters_);
+}
+
+Gauge& ThreadLocalStoreImpl::ScopeImpl::lazyGauge(const std::string& name) {
+  std::string final_name = prefix_ + name;
+  if (parent_.rejects(final_name)) {
+    return null_gauge_;
+  }
+  return safeMakeLazyStat<Gauge>(final_name, central_cache_.gauges_, central_cache_.lazy_gauges_);
+}
+
 void ThreadLocalStoreImpl::ScopeImpl::deliverHistogramToSinks(const Histogram& histogram,
                                                               uint64_t value) {
   // Thread local deliveries must be blocked outright for histograms and timers during shutdown.
@@ -436,8 +522,9 @@ Histogram& ThreadLocalStoreImpl::ScopeImpl::tlsHistogram(const std::string& name
 ThreadLocalHistogramImpl::ThreadLocalHistogramImpl(const std::string& name,
                                                    std::string&& tag_extracted_name,
                                                    std::vector<Tag>&& tags)
-    : MetricImpl(std::move(tag_extracted_name), std::move(tags)), current_active_(0), flags_(0),
-      created_thread_id_(std::this_thread::get_id()), name_(name) {
+    : MetricImpl(std::move(tag_extracted_name), std::move(tags)), current_active_(0),
+      recording_{{false}, {false}}, flags_(0), created_thread_id_(std::this_thread::get_id()),
+      name_(name) {
   histograms_[0] = hist_alloc();
   histograms_[1] = hist_alloc();
 }
@@ -449,14 +536,44 @@ ThreadLocalHistogramImpl::~ThreadLocalHistogramImpl() {
 
 void ThreadLocalHistogramImpl::recordValue(uint64_t value) {
   ASSERT(std::this_thread::get_id() == created_thread_id_);
-  hist_insert_intscale(histograms_[current_active_], value, 0, 1);
+  // Announce the histogram being written before re-checking that it is still active. Together
+  // with the sequentially consistent operations in merge(), either the merging thread observes the
+  // write in progress and waits for it, or this thread observes the swap and retries.
+  uint32_t index = current_active_.load();
+  recording_[index].store(true);
+  while (current_active_.load() != index) {
+    recording_[index].store(false);
+    index = current_active_.load();
+    recording_[index].store(true);
+  }
+  hist_insert_intscale(histograms_[index], value, 0, 1);
+  recording_[index].store(false);
   flags_ |= Flags::Used;
 }
 
-void ThreadLocalHistogramImpl::merge(histogram_t* target) {
-  histogram_t** other_histogram = &histograms_[otherHistogramIndex()];
-  hist_accumulate(target, other_histogram, 1);
-  hist_clear(*other_histogram);
+uint64_t ThreadLocalHistogramImpl::merge(histogram_t* target) {
+  const uint32_t index = current_active_.load();
+  current_active_.store(1 - index);
+  // Any recordValue() starting from here writes to the other histogram, so this waits for at most
+  // a single in-flight insertion.
+  while (recording_[index].load()) {
+    std::this_thread::yield();
+  }
+
+  histogram_t* harvested = histograms_[index];
+  uint64_t samples = 0;
+  const int bucket_count = hist_bucket_count(harvested);
+  for (int i = 0; i < bucket_count; ++i) {
+    hist_bucket_t bucket;
+    uint64_t count;
+    if (hist_bucket_idx_bucket(harvested, i, &bucket, &count) && count > 0) {
+      hist_insert_raw(target, bucket, count);
+      samples += count;
+    }
+  }
+  // Clearing keeps the allocated bins, so that recording does not allocate in steady state.
+  hist_clear(harvested);
+  return samples;
 }
 
 ParentHistogramImpl::ParentHistogramImpl(const std::string& name, Store& parent,
@@ -486,19 +603,29 @@ bool ParentHistogramImpl::used() const {
 void ParentHistogramImpl::merge() {
   Thread::ReleasableLockGuard lock(merge_lock_);
   if (merged_ || usedLockHeld()) {
-    hist_clear(interval_histogram_);
+    // The interval histogram is rebuilt from scratch rather than cleared, so that bins which were
+    // only used in past intervals are not carried along and merged into the cumulative histogram.
+    hist_free(interval_histogram_);
+    interval_histogram_ = hist_alloc();
+    uint64_t interval_samples = 0;
     // Here we could copy all the pointers to TLS histograms in the tls_histogram_ list,
     // then release the lock before we do the actual merge. However it is not a big deal
     // because the tls_histogram merge is not that expensive as it is a single histogram
     // merge and adding TLS histograms is rare.
     for (const TlsHistogramSharedPtr& tls_histogram : tls_histograms_) {
-      tls_histogram->merge(interval_histogram_);
+      interval_samples += tls_histogram->merge(interval_histogram_);
     }
     // Since TLS merge is done, we can release the lock here.
     lock.release();
-    hist_accumulate(cumulative_histogram_, &interval_histogram_, 1);
-    cumulative_statistics_.refresh(cumulative_histogram_);
-    interval_statistics_.refresh(interval_histogram_);
+    if (interval_samples > 0) {
+      hist_accumulate(cumulative_histogram_, &interval_histogram_, 1);
+      cumulative_statistics_.refresh(cumulative_histogram_);
+    }
+    // The quantiles of an empty interval only need to be computed once.
+    if (interval_samples > 0 || last_interval_samples_ > 0) {
+      interval_statistics_.refresh(interval_histogram_);
+    }
+    last_interval_samples_ = interval_samples;
     merged_ = true;
   }
 }
@@ -5,12 +5,14 @@
 #include <cstdint>
 #include <list>
 #include <string>
+#include <thread>
 
 #include "envoy/thread_local/thread_local.h"
 
 #include "common/common/hash.h"
 #include "common/stats/heap_stat_data.h"
 #include "common/stats/histogram_impl.h"
+#include "common/stats/lazy_stat_impl.h"
 #include "common/stats/source_impl.h"
 #include "common/stats/utility.h"
 
@@ -23,8 +25,10 @@ namespace Stats {
 
 /**
  * A histogram that is stored in TLS and used to record values per thread. This holds two
- * histograms, one to collect the values and other as backup that is used for merge process. The
- * swap happens during the merge process.
+ * histograms, one to collect the values and other that is harvested by the merge process. The
+ * swap is performed by the merging thread without a cross-thread barrier: the recording thread
+ * announces which histogram it is writing to, and the merging thread only waits if a single
+ * value is being recorded into the histogram it is about to harvest.
  */
 class ThreadLocalHistogramImpl : public Histogram, public MetricImpl {
 public:
@@ -32,17 +36,14 @@ public:
                            std::vector<Tag>&& tags);
   ~ThreadLocalHistogramImpl();
 
-  void merge(histogram_t* target);
-
   /**
-   * Called in the beginning of merge process. Swaps the histogram used for collection so that we do
-   * not have to lock the histogram in high throughput TLS writes.
+   * Called by the merging thread to swap the histogram used for collection and move the values
+   * recorded since the previous merge into target. Only the non-empty bins are copied, so target
+   * does not accumulate empty bins. Calls must be serialized by the caller.
+   * @param target histogram to add the harvested values to.
+   * @return uint64_t the number of values harvested.
    */
-  void beginMerge() {
-    // This switches the current_active_ between 1 and 0.
-    ASSERT(std::this_thread::get_id() == created_thread_id_);
-    current_active_ = otherHistogramIndex();
-  }
+  uint64_t merge(histogram_t* target);
 
   // Stats::Histogram
   void recordValue(uint64_t value) override;
@@ -53,8 +54,10 @@ public:
   const char* nameCStr() const override { return name_.c_str(); }
 
 private:
-  uint64_t otherHistogramIndex() const { return 1 - current_active_; }
-  uint64_t current_active_;
+  // Index of the histogram used for collection. Only written by the merging thread.
+  std::atomic<uint32_t> current_active_;
+  // Set by the recording thread while it writes to the corresponding histogram.
+  std::atomic<bool> recording_[2];
   histogram_t* histograms_[2];
   std::atomic<uint16_t> flags_;
   std::thread::id created_thread_id_;
@@ -82,7 +85,8 @@ public:
    * This method is called during the main stats flush process for each of the histograms. It
    * iterates through the TLS histograms and collects the histogram data of all of them
    * in to "interval_histogram". Then the collected "interval_histogram" is merged to a
-   * "cumulative_histogram".
+   * "cumulative_histogram". Quantiles are only recomputed when they may have changed, i.e. when
+   * values were recorded in this or the previous interval.
    */
   void merge() override;
 
@@ -108,6 +112,7 @@ private:
   mutable Thread::MutexBasicLockable merge_lock_;
   std::list<TlsHistogramSharedPtr> tls_histograms_ GUARDED_BY(merge_lock_);
   bool merged_;
+  uint64_t last_interval_samples_{};
   const std::string name_;
 };
 
@@ -144,6 +149,10 @@ public:
     return default_scope_->deliverHistogramToSinks(histogram, value);
   }
   Gauge& gauge(const std::string& name) override { return default_scope_->gauge(name); }
+  Counter& lazyCounter(const std::string& name) override {
+    return default_scope_->lazyCounter(name);
+  }
+  Gauge& lazyGauge(const std::string& name) override { return default_scope_->lazyGauge(name); }
   Histogram& histogram(const std::string& name) override {
     return default_scope_->histogram(name);
   };
@@ -183,6 +192,30 @@ private:
     StatMap<CounterSharedPtr> counters_;
     StatMap<GaugeSharedPtr> gauges_;
     StatMap<ParentHistogramImplSharedPtr> histograms_;
+    // Lazy stats are only looked up when they are declared, so they are not cached in TLS.
+    StatMap<LazyCounterImplSharedPtr> lazy_counters_;
+    StatMap<LazyGaugeImplSharedPtr> lazy_gauges_;
+  };
+
+  /**
+   * Allocator used by lazy stats when they are materialized, which falls back to the heap
+   * allocator if the main allocator is full, as for the other stats.
+   */
+  class LazyStatDataAllocator : public StatDataAllocator {
+  public:
+    LazyStatDataAllocator(ThreadLocalStoreImpl& parent) : parent_(parent) {}
+
+    // Stats::StatDataAllocator
+    CounterSharedPtr makeCounter(absl::string_view name, std::string&& tag_extracted_name,
+                                 std::vector<Tag>&& tags) override;
+    GaugeSharedPtr makeGauge(absl::string_view name, std::string&& tag_extracted_name,
+                             std::vector<Tag>&& tags) override;
+    bool requiresBoundedStatNameSize() const override {
+      return parent_.alloc_.requiresBoundedStatNameSize();
+    }
+
+  private:
+    ThreadLocalStoreImpl& parent_;
   };
 
   struct ScopeImpl : public TlsScope {
@@ -198,6 +231,8 @@ private:
     }
     void deliverHistogramToSinks(const Histogram& histogram, uint64_t value) override;
     Gauge& gauge(const std::string& name) override;
+    Counter& lazyCounter(const std::string& name) override;
+    Gauge& lazyGauge(const std::string& name) override;
     Histogram& histogram(const std::string& name) override;
     Histogram& tlsHistogram(const std::string& name, ParentHistogramImpl& parent) override;
     const Stats::StatsOptions& statsOptions() const override { return parent_.statsOptions(); }
@@ -224,6 +259,18 @@ private:
     safeMakeStat(const std::string& name, StatMap<std::shared_ptr<StatType>>& central_cache_map,
                  MakeStatFn<StatType> make_stat, StatMap<std::shared_ptr<StatType>>* tls_cache);
 
+    /**
+     * Makes a lazy stat, unless the stat itself is already in the central cache.
+     *
+     * @param name the full name of the stat (not tag extracted).
+     * @param central_cache_map a map from name to the stat in the central cache.
+     * @param lazy_cache_map a map from name to the lazy stat in the central cache.
+     */
+    template <class StatType, class LazyStatType>
+    StatType& safeMakeLazyStat(const std::string& name,
+                               StatMap<std::shared_ptr<StatType>>& central_cache_map,
+                               StatMap<std::shared_ptr<LazyStatType>>& lazy_cache_map);
+
     static std::atomic<uint64_t> next_scope_id_;
 
     const uint64_t scope_id_;
@@ -270,6 +317,8 @@ private:
   std::atomic<bool> merge_in_progress_{};
   Counter& num_last_resort_stats_;
   HeapStatDataAllocator heap_allocator_;
+  LazyStatDataAllocator lazy_allocator_;
+  LazyStatTagTable lazy_tags_ GUARDED_BY(lock_);
   SourceImpl source_;
 
   // Retain storage for deleted stats; these are no longer in maps because the
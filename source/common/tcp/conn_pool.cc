@@ -1,5 +1,6 @@
 #include "common/tcp/conn_pool.h"
 
+#include <cmath>
 #include <memory>
 
 #include "envoy/event/dispatcher.h"
@@ -50,6 +51,8 @@ void ConnPoolImpl::drainConnections() {
   }
 }
 
+void ConnPoolImpl::warmUp() { createConnections(host_->cluster().warmConnections()); }
+
 void ConnPoolImpl::addDrainedCallback(DrainedCb cb) {
   drained_callbacks_.push_back(cb);
   checkForDrained();
@@ -82,11 +85,22 @@ void ConnPoolImpl::createNewConnection() {
   conn->moveIntoList(std::move(conn), pending_conns_);
 }
 
+void ConnPoolImpl::createConnections(uint64_t connections) {
+  // Connections are not opened ahead of demand while the pool drains, nor over the circuit breaker.
+  while (drained_callbacks_.empty() &&
+         ready_conns_.size() + busy_conns_.size() + pending_conns_.size() < connections &&
+         host_->cluster().resourceManager(priority_).connections().canCreate()) {
+    host_->cluster().stats().upstream_cx_preconnect_.inc();
+    createNewConnection();
+  }
+}
+
 ConnectionPool::Cancellable* ConnPoolImpl::newConnection(ConnectionPool::Callbacks& callbacks) {
   if (!ready_conns_.empty()) {
     ready_conns_.front()->moveBetweenLists(ready_conns_, busy_conns_);
     ENVOY_CONN_LOG(debug, "using existing connection", *busy_conns_.front()->conn_);
     assignConnection(*busy_conns_.front(), callbacks);
+    preconnect();
     return nullptr;
   }
 
@@ -106,7 +120,9 @@ ConnectionPool::Cancellable* ConnPoolImpl::newConnection(ConnectionPool::Callbac
     ENVOY_LOG(debug, "queueing request due to no available connections");
     PendingRequestPtr pending_request(new PendingRequest(*this, callbacks));
     pending_request->moveIntoList(std::move(pending_request), pending_requests_);
-    return pending_requests_.front().get();
+    ConnectionPool::Cancellable* cancellable = pending_requests_.front().get();
+    preconnect();
+    return cancellable;
   } else {
     ENVOY_LOG(debug, "max pending requests overflow");
     callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::Overflow, nullptr);
@@ -130,6 +146,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveConn& conn, Network::ConnectionEvent
 
     ActiveConnPtr removed;
     bool check_for_drained = true;
+    bool connect_failure = false;
     if (conn.wrapper_ != nullptr) {
       if (!conn.wrapper_->released_) {
         if (event == Network::ConnectionEvent::LocalClose) {
@@ -151,6 +168,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveConn& conn, Network::ConnectionEvent
       check_for_drained = false;
     } else {
       // The only time this happens is if we actually saw a connect failure.
+      connect_failure = true;
       host_->cluster().stats().upstream_cx_connect_fail_.inc();
       host_->stats().cx_connect_fail_.inc();
       removed = conn.removeFromList(pending_conns_);
@@ -187,6 +205,12 @@ void ConnPoolImpl::onConnectionEvent(ActiveConn& conn, Network::ConnectionEvent
       createNewConnection();
     }
 
+    // Replace the connection if it was needed ahead of demand. This is not done after connect
+    // failures, so that a failing host is not retried in a loop.
+    if (!connect_failure) {
+      preconnect();
+    }
+
     if (check_for_drained) {
       checkForDrained();
     }
@@ -258,6 +282,13 @@ void ConnPoolImpl::onUpstreamReady() {
   }
 }
 
+void ConnPoolImpl::preconnect() {
+  const float ratio = host_->cluster().perUpstreamPreconnectRatio();
+  if (ratio > 1.0) {
+    createConnections(std::ceil(ratio * (busy_conns_.size() + pending_requests_.size())));
+  }
+}
+
 void ConnPoolImpl::processIdleConnection(ActiveConn& conn, bool new_connection, bool delay) {
   if (conn.wrapper_) {
     conn.wrapper_->invalidate();
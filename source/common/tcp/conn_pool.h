@@ -30,6 +30,7 @@ public:
   // ConnectionPool::Instance
   void addDrainedCallback(DrainedCb cb) override;
   void drainConnections() override;
+  void warmUp() override;
   ConnectionPool::Cancellable* newConnection(ConnectionPool::Callbacks& callbacks) override;
 
 protected:
@@ -137,11 +138,16 @@ protected:
 
   void assignConnection(ActiveConn& conn, ConnectionPool::Callbacks& callbacks);
   void createNewConnection();
+  // Opens connections until the pool has the given number of connections, within the connection
+  // circuit breaker.
+  void createConnections(uint64_t connections);
   void onConnectionEvent(ActiveConn& conn, Network::ConnectionEvent event);
   void onPendingRequestCancel(PendingRequest& request, ConnectionPool::CancelPolicy cancel_policy);
   virtual void onConnReleased(ActiveConn& conn);
   virtual void onConnDestroyed(ActiveConn& conn);
   void onUpstreamReady();
+  // Opens connections ahead of the requests, as configured by the preconnect ratio of the cluster.
+  void preconnect();
   void processIdleConnection(ActiveConn& conn, bool new_connection, bool delay);
   void checkForDrained();
 
@@ -114,15 +114,42 @@ void InstanceImpl::SlotImpl::set(InitializeCb cb) {
   ASSERT(std::this_thread::get_id() == parent_.main_thread_id_);
   ASSERT(!parent_.shutdown_);
 
+  // The version is published after the barrier of the previous version was set, so that a thread
+  // which sees the new version also sees that barrier.
+  version_ = std::make_shared<SlotVersion>(latest_, *latest_ + 1);
+  ++*latest_;
   for (Event::Dispatcher& dispatcher : parent_.registered_threads_) {
     const uint32_t index = index_;
-    dispatcher.post([index, cb, &dispatcher]() -> void { setThreadLocal(index, cb(dispatcher)); });
+    InstanceImpl& parent = parent_;
+    SlotVersionSharedPtr version = version_;
+    dispatcher.post([index, cb, &dispatcher, &parent, version]() -> void {
+      // Updates are posted in order, so the update superseding this one is already queued behind
+      // it and this one can be skipped.
+      if (supersededOnThread(index, *version)) {
+        if (parent.stats_ != nullptr) {
+          parent.stats_->collapsed_updates_.inc();
+        }
+        return;
+      }
+      setThreadLocal(index, cb(dispatcher));
+    });
   }
 
   // Handle main thread.
   setThreadLocal(index_, cb(*parent_.main_thread_dispatcher_));
 }
 
+bool InstanceImpl::supersededOnThread(uint32_t index, const SlotVersion& version) {
+  // The barrier of a version is only set by runOnAllThreads() before the next set() publishes a
+  // newer version. Once a newer version is seen, the barrier of this one is final and visible, as
+  // it is read after the latest version.
+  if (*version.latest_ == version.version_ || version.barrier_) {
+    return false;
+  }
+  // Code running on the thread relies on the slot having data once it was set.
+  return index < thread_local_data_.data_.size() && thread_local_data_.data_[index] != nullptr;
+}
+
 void InstanceImpl::setThreadLocal(uint32_t index, ThreadLocalObjectSharedPtr object) {
   if (thread_local_data_.data_.size() <= index) {
     thread_local_data_.data_.resize(index + 1);
@@ -169,6 +196,12 @@ void InstanceImpl::shutdownThread() {
   thread_local_data_.data_.clear();
 }
 
+void InstanceImpl::initializeStats(Stats::Scope& scope) {
+  ASSERT(std::this_thread::get_id() == main_thread_id_);
+  stats_ = std::make_unique<ThreadLocalStats>(
+      ThreadLocalStats{ALL_THREAD_LOCAL_STATS(POOL_COUNTER_PREFIX(scope, "thread_local."))});
+}
+
 Event::Dispatcher& InstanceImpl::dispatcher() {
   ASSERT(thread_local_data_.dispatcher_ != nullptr);
   return *thread_local_data_.dispatcher_;
@@ -3,8 +3,11 @@
 #include <atomic>
 #include <cstdint>
 #include <list>
+#include <memory>
 #include <vector>
 
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/thread_local/thread_local.h"
 
 #include "common/common/logger.h"
@@ -12,6 +15,21 @@
 namespace Envoy {
 namespace ThreadLocal {
 
+/**
+ * All thread local stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_THREAD_LOCAL_STATS(COUNTER)                                                            \
+  COUNTER(collapsed_updates)
+// clang-format on
+
+/**
+ * Struct definition for all thread local stats. @see stats_macros.h
+ */
+struct ThreadLocalStats {
+  ALL_THREAD_LOCAL_STATS(GENERATE_COUNTER_STRUCT)
+};
+
 /**
  * Implementation of ThreadLocal that relies on static thread_local objects.
  */
@@ -26,22 +44,55 @@ public:
   void shutdownGlobalThreading() override;
   void shutdownThread() override;
   Event::Dispatcher& dispatcher() override;
+  void initializeStats(Stats::Scope& scope) override;
 
 private:
+  /**
+   * Version of the data set in a slot, shared with the updates posted to the threads so that they
+   * can tell whether they have been superseded, even once the slot is gone.
+   */
+  struct SlotVersion {
+    SlotVersion(std::shared_ptr<std::atomic<uint64_t>> latest, uint64_t version)
+        : latest_(latest), version_(version) {}
+
+    // Version of the most recent set() of the slot.
+    const std::shared_ptr<std::atomic<uint64_t>> latest_;
+    const uint64_t version_;
+    // Whether runOnAllThreads() was called on the slot while this version was the most recent.
+    // The callbacks may read the data, so this version can't be skipped.
+    std::atomic<bool> barrier_{};
+  };
+
+  typedef std::shared_ptr<SlotVersion> SlotVersionSharedPtr;
+
   struct SlotImpl : public Slot {
-    SlotImpl(InstanceImpl& parent, uint64_t index) : parent_(parent), index_(index) {}
+    SlotImpl(InstanceImpl& parent, uint64_t index)
+        : parent_(parent), index_(index), latest_(std::make_shared<std::atomic<uint64_t>>()) {}
     ~SlotImpl() { parent_.removeSlot(*this); }
 
     // ThreadLocal::Slot
     ThreadLocalObjectSharedPtr get() override;
-    void runOnAllThreads(Event::PostCb cb) override { parent_.runOnAllThreads(cb); }
+    void runOnAllThreads(Event::PostCb cb) override {
+      setBarrier();
+      parent_.runOnAllThreads(cb);
+    }
     void runOnAllThreads(Event::PostCb cb, Event::PostCb main_callback) override {
+      setBarrier();
       parent_.runOnAllThreads(cb, main_callback);
     }
     void set(InitializeCb cb) override;
 
+    void setBarrier() {
+      if (version_ != nullptr) {
+        version_->barrier_ = true;
+      }
+    }
+
     InstanceImpl& parent_;
     const uint64_t index_;
+    const std::shared_ptr<std::atomic<uint64_t>> latest_;
+    // Version of the most recent set(), if any.
+    SlotVersionSharedPtr version_;
   };
 
   struct ThreadLocalData {
@@ -53,6 +104,7 @@ private:
   void runOnAllThreads(Event::PostCb cb);
   void runOnAllThreads(Event::PostCb cb, Event::PostCb main_callback);
   static void setThreadLocal(uint32_t index, ThreadLocalObjectSharedPtr object);
+  static bool supersededOnThread(uint32_t index, const SlotVersion& version);
 
   static thread_local ThreadLocalData thread_local_data_;
   std::vector<SlotImpl*> slots_;
@@ -60,6 +112,7 @@ private:
   std::thread::id main_thread_id_;
   Event::Dispatcher* main_thread_dispatcher_{};
   std::atomic<bool> shutdown_{};
+  std::unique_ptr<ThreadLocalStats> stats_;
 };
 
 } // namespace ThreadLocal
@@ -181,7 +181,7 @@ ClusterManagerImpl::ClusterManagerImpl(
       config_tracker_entry_(
           admin.getConfigTracker().add("clusters", [this] { return dumpClusterConfigs(); })),
       time_source_(main_thread_dispatcher.timeSystem()), dispatcher_(main_thread_dispatcher),
-      http_context_(http_context) {
+      http_context_(http_context), api_(api) {
   async_client_manager_ =
       std::make_unique<Grpc::AsyncClientManagerImpl>(*this, tls, time_source_, api);
   const auto& cm_config = bootstrap.cluster_manager();
@@ -624,7 +624,7 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster,
   if (cluster_reference.info()->lbType() == LoadBalancerType::RingHash) {
     cluster_entry_it->second->thread_aware_lb_ = std::make_unique<RingHashLoadBalancer>(
         cluster_reference.prioritySet(), cluster_reference.info()->stats(), runtime_, random_,
-        cluster_reference.info()->lbRingHashConfig(), cluster_reference.info()->lbConfig());
+        cluster_reference.info()->lbRingHashConfig(), cluster_reference.info()->lbConfig(), api_);
   } else if (cluster_reference.info()->lbType() == LoadBalancerType::Maglev) {
     cluster_entry_it->second->thread_aware_lb_ = std::make_unique<MaglevLoadBalancer>(
         cluster_reference.prioritySet(), cluster_reference.info()->stats(), runtime_, random_,
@@ -1031,14 +1031,16 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
     lb_ = std::make_unique<SubsetLoadBalancer>(
         cluster->lbType(), priority_set_, parent_.local_priority_set_, cluster->stats(),
         parent.parent_.runtime_, parent.parent_.random_, cluster->lbSubsetInfo(),
-        cluster->lbRingHashConfig(), cluster->lbLeastRequestConfig(), cluster->lbConfig());
+        cluster->lbRingHashConfig(), cluster->lbLeastRequestConfig(), cluster->lbConfig(),
+        parent.thread_local_dispatcher_.timeSystem(), parent.parent_.api_);
   } else {
     switch (cluster->lbType()) {
     case LoadBalancerType::LeastRequest: {
       ASSERT(lb_factory_ == nullptr);
       lb_ = std::make_unique<LeastRequestLoadBalancer>(
           priority_set_, parent_.local_priority_set_, cluster->stats(), parent.parent_.runtime_,
-          parent.parent_.random_, cluster->lbConfig(), cluster->lbLeastRequestConfig());
+          parent.parent_.random_, cluster->lbConfig(), cluster->lbLeastRequestConfig(),
+          parent.thread_local_dispatcher_.timeSystem());
       break;
     }
     case LoadBalancerType::Random: {
@@ -1050,9 +1052,17 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
     }
     case LoadBalancerType::RoundRobin: {
       ASSERT(lb_factory_ == nullptr);
-      lb_ = std::make_unique<RoundRobinLoadBalancer>(priority_set_, parent_.local_priority_set_,
-                                                     cluster->stats(), parent.parent_.runtime_,
-                                                     parent.parent_.random_, cluster->lbConfig());
+      lb_ = std::make_unique<RoundRobinLoadBalancer>(
+          priority_set_, parent_.local_priority_set_, cluster->stats(), parent.parent_.runtime_,
+          parent.parent_.random_, cluster->lbConfig(), parent.thread_local_dispatcher_.timeSystem());
+      break;
+    }
+    case LoadBalancerType::PeakEwma: {
+      ASSERT(lb_factory_ == nullptr);
+      lb_ = std::make_unique<PeakEwmaLoadBalancer>(
+          priority_set_, parent_.local_priority_set_, cluster->stats(), parent.parent_.runtime_,
+          parent.parent_.random_, cluster->lbConfig(), cluster->lbPeakEwmaConfig(),
+          parent.thread_local_dispatcher_.timeSystem());
       break;
     }
     case LoadBalancerType::RingHash:
@@ -1072,14 +1082,65 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
   }
 
   priority_set_.addMemberUpdateCb(
-      [this](uint32_t, const HostVector&, const HostVector& hosts_removed) -> void {
+      [this](uint32_t priority, const HostVector&, const HostVector& hosts_removed) -> void {
         // We need to go through and purge any connection pools for hosts that got deleted.
         // Even if two hosts actually point to the same address this will be safe, since if a
         // host is readded it will be a different physical HostSharedPtr.
         parent_.drainConnPools(hosts_removed);
+        warmUpHosts(priority);
       });
 }
 
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::warmUpHosts(
+    uint32_t priority) {
+  if (cluster_info_->warmConnections() == 0) {
+    return;
+  }
+
+  // The hosts which became healthy are warmed up, whether they joined the cluster healthy or passed
+  // their health checks since the last update. The health changes are not reported as hosts added,
+  // so the healthy hosts are compared with the ones of the last update. Hosts waiting for their
+  // first health check are not warmed up, the load balancer would not pick them.
+  if (healthy_hosts_.size() <= priority) {
+    healthy_hosts_.resize(priority + 1);
+  }
+  const HostVector& hosts = priority_set_.hostSetsPerPriority()[priority]->healthyHosts();
+  std::unordered_set<HostSharedPtr> healthy_hosts;
+  healthy_hosts.reserve(hosts.size());
+  for (const HostSharedPtr& host : hosts) {
+    if (healthy_hosts_[priority].count(host) == 0) {
+      warmUpHost(host);
+    }
+    healthy_hosts.insert(host);
+  }
+  healthy_hosts_[priority] = std::move(healthy_hosts);
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::warmUpHost(
+    const HostSharedPtr& host) {
+  for (const auto& kind : warm_http_pools_) {
+    const std::vector<uint8_t> hash_key = {uint8_t(kind.second), uint8_t(kind.first)};
+    Http::ConnectionPool::InstancePtr& pool =
+        parent_.host_http_conn_pool_map_[host].pools_[hash_key];
+    if (!pool) {
+      pool = parent_.parent_.factory_.allocateConnPool(parent_.thread_local_dispatcher_, host,
+                                                       kind.first, kind.second, nullptr);
+    }
+    pool->warmUp();
+  }
+
+  for (const ResourcePriority priority : warm_tcp_pools_) {
+    const std::vector<uint8_t> hash_key = {uint8_t(priority)};
+    Tcp::ConnectionPool::InstancePtr& pool =
+        parent_.host_tcp_conn_pool_map_[host].pools_[hash_key];
+    if (!pool) {
+      pool = parent_.parent_.factory_.allocateTcpConnPool(parent_.thread_local_dispatcher_, host,
+                                                          priority, nullptr, nullptr);
+    }
+    pool->warmUp();
+  }
+}
+
 ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::~ClusterEntry() {
   // We need to drain all connection pools for the cluster being removed. Then we can remove the
   // cluster.
@@ -1120,6 +1181,10 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
     }
   }
 
+  if (!have_options && cluster_info_->warmConnections() > 0) {
+    warm_http_pools_.emplace(priority, protocol);
+  }
+
   ConnPoolsContainer& container = parent_.host_http_conn_pool_map_[host];
   if (!container.pools_[hash_key]) {
     container.pools_[hash_key] = parent_.parent_.factory_.allocateConnPool(
@@ -1163,6 +1228,11 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::tcpConnPool(
     transport_socket_options->hashKey(hash_key);
   }
 
+  if (!have_options && transport_socket_options == nullptr &&
+      cluster_info_->warmConnections() > 0) {
+    warm_tcp_pools_.insert(priority);
+  }
+
   TcpConnPoolsContainer& container = parent_.host_tcp_conn_pool_map_[host];
   if (!container.pools_[hash_key]) {
     container.pools_[hash_key] = parent_.parent_.factory_.allocateTcpConnPool(
@@ -6,7 +6,10 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "envoy/api/api.h"
@@ -287,6 +290,11 @@ private:
       tcpConnPool(ResourcePriority priority, LoadBalancerContext* context,
                   Network::TransportSocketOptionsSharedPtr transport_socket_options);
 
+      // Opens the warm connections of the cluster to the hosts of a priority which became healthy,
+      // in the kinds of connection pools used so far.
+      void warmUpHosts(uint32_t priority);
+      void warmUpHost(const HostSharedPtr& host);
+
       // Upstream::ThreadLocalCluster
       const PrioritySet& prioritySet() override { return priority_set_; }
       ClusterInfoConstSharedPtr info() override { return cluster_info_; }
@@ -302,6 +310,14 @@ private:
       LoadBalancerPtr lb_;
       ClusterInfoConstSharedPtr cluster_info_;
       Http::AsyncClientImpl http_async_client_;
+      // Kinds of connection pools without downstream socket options or transport socket options
+      // used so far, which are warmed up on the hosts joining the cluster. Only tracked if the
+      // cluster has warm connections.
+      std::set<std::pair<ResourcePriority, Http::Protocol>> warm_http_pools_;
+      std::set<ResourcePriority> warm_tcp_pools_;
+      // Healthy hosts of each priority at the last update. Only tracked if the cluster has warm
+      // connections.
+      std::vector<std::unordered_set<HostSharedPtr>> healthy_hosts_;
     };
 
     typedef std::unique_ptr<ClusterEntry> ClusterEntryPtr;
@@ -450,6 +466,7 @@ private:
   ClusterUpdatesMap updates_map_;
   Event::Dispatcher& dispatcher_;
   Http::Context& http_context_;
+  Api::Api& api_;
 };
 
 } // namespace Upstream
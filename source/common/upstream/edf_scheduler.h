@@ -73,6 +73,13 @@ public:
    */
   bool empty() const { return queue_.empty(); }
 
+  /**
+   * Implements size() on the internal queue. Expired elements are counted until they are
+   * discarded by pick().
+   * @return size_t the number of elements in the internal queue.
+   */
+  size_t size() const { return queue_.size(); }
+
 private:
   struct EdfEntry {
     double deadline_;
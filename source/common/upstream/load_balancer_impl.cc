@@ -1,5 +1,7 @@
 #include "common/upstream/load_balancer_impl.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -499,68 +501,188 @@ const HostVector& ZoneAwareLoadBalancerBase::hostSourceToHosts(HostsSource hosts
 EdfLoadBalancerBase::EdfLoadBalancerBase(
     const PrioritySet& priority_set, const PrioritySet* local_priority_set, ClusterStats& stats,
     Runtime::Loader& runtime, Runtime::RandomGenerator& random,
-    const envoy::api::v2::Cluster::CommonLbConfig& common_config)
+    const envoy::api::v2::Cluster::CommonLbConfig& common_config, TimeSource& time_source)
     : ZoneAwareLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random,
                                 common_config),
-      seed_(random_.random()) {
-  // We fully recompute the schedulers for a given host set here on membership change, which is
-  // consistent with what other LB implementations do (e.g. thread aware).
-  // The downside of a full recompute is that time complexity is O(n * log n),
-  // so we will need to do better at delta tracking to scale (see
-  // https://github.com/envoyproxy/envoy/issues/2874).
-  priority_set.addMemberUpdateCb(
-      [this](uint32_t priority, const HostVector&, const HostVector&) { refresh(priority); });
+      seed_(random_.random()), time_source_(time_source),
+      slow_start_window_(PROTOBUF_GET_MS_OR_DEFAULT(common_config.slow_start_config(),
+                                                    slow_start_window, 0)),
+      slow_start_aggression_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(common_config.slow_start_config(),
+                                                             aggression, 1.0)),
+      // The weight must stay positive in the EDF schedule.
+      slow_start_min_weight_(std::max(
+          common_config.slow_start_config().has_min_weight_percent()
+              ? common_config.slow_start_config().min_weight_percent().value() / 100.0
+              : 0.1,
+          0.001)) {
+  // The schedulers are updated incrementally on membership change: only the hosts added to or
+  // removed from a source are added to or removed from its schedule, the other hosts keep their
+  // place. This keeps the cost of an update proportional to the change for the hosts of the
+  // priority, and to a hash lookup per host for the healthy hosts, whose changes are not reported
+  // (e.g. a single host failing its health checks).
+  priority_set.addMemberUpdateCb([this](uint32_t priority, const HostVector& hosts_added,
+                                        const HostVector& hosts_removed) {
+    refresh(priority, hosts_added, hosts_removed);
+  });
 }
 
 void EdfLoadBalancerBase::initialize() {
+  initializing_ = true;
   for (uint32_t priority = 0; priority < priority_set_.hostSetsPerPriority().size(); ++priority) {
-    refresh(priority);
+    refresh(priority, {}, {});
+  }
+  initializing_ = false;
+}
+
+void EdfLoadBalancerBase::refresh(uint32_t priority, const HostVector& hosts_added,
+                                  const HostVector& hosts_removed) {
+  // Update EdfSchedulers for each valid HostsSource value for the host set at this priority.
+  const auto& host_set = priority_set_.hostSetsPerPriority()[priority];
+  updateHostsSource(HostsSource(priority, HostsSource::SourceType::AllHosts), host_set->hosts(),
+                    &hosts_added, &hosts_removed);
+  updateHostsSource(HostsSource(priority, HostsSource::SourceType::HealthyHosts),
+                    host_set->healthyHosts(), nullptr, nullptr);
+  const uint32_t num_localities = host_set->healthyHostsPerLocality().get().size();
+  for (uint32_t locality_index = 0; locality_index < num_localities; ++locality_index) {
+    updateHostsSource(
+        HostsSource(priority, HostsSource::SourceType::LocalityHealthyHosts, locality_index),
+        host_set->healthyHostsPerLocality().get()[locality_index], nullptr, nullptr);
+  }
+  // Drop the schedulers of the localities which are gone.
+  for (uint32_t locality_index = num_localities;
+       scheduler_.erase(HostsSource(priority, HostsSource::SourceType::LocalityHealthyHosts,
+                                    locality_index)) > 0;
+       ++locality_index) {
   }
 }
 
-void EdfLoadBalancerBase::refresh(uint32_t priority) {
-  const auto add_hosts_source = [this](HostsSource source, const HostVector& hosts) {
-    // Nuke existing scheduler if it exists.
-    auto& scheduler = scheduler_[source] = Scheduler{};
-    refreshHostSource(source);
+void EdfLoadBalancerBase::updateHostsSource(const HostsSource& source, const HostVector& hosts,
+                                            const HostVector* hosts_added,
+                                            const HostVector* hosts_removed) {
+  refreshHostSource(source);
+  Scheduler& scheduler = scheduler_[source];
 
-    // Populate scheduler with host list.
+  if (scheduler.entries_.empty()) {
+    // Populate the scheduler from scratch, dropping the entries left by the removed hosts.
+    scheduler.edf_ = EdfScheduler<const Scheduler::ScheduledHost>{};
     // TODO(mattklein123): We must build the EDF schedule even if all of the hosts are currently
     // weighted 1. This is because currently we don't refresh host sets if only weights change.
     // We should probably change this to refresh at all times. See the comment in
     // BaseDynamicClusterImpl::updateDynamicHostList about this.
     for (const auto& host : hosts) {
-      // We use a fixed weight here. While the weight may change without
-      // notification, this will only be stale until this host is next picked,
-      // at which point it is reinserted into the EdfScheduler with its new
-      // weight in chooseHost().
-      scheduler.edf_.add(hostWeight(*host), host);
+      addHost(scheduler, host);
     }
 
     // Cycle through hosts to achieve the intended offset behavior.
     // TODO(htuch): Consider how we can avoid biasing towards earlier hosts in the schedule across
     // refreshes for the weighted case.
     if (!hosts.empty()) {
+      const MonotonicTime now =
+          slow_start_window_.count() > 0 ? time_source_.monotonicTime() : MonotonicTime();
       for (uint32_t i = 0; i < seed_ % hosts.size(); ++i) {
-        auto host = scheduler.edf_.pick();
-        scheduler.edf_.add(hostWeight(*host), host);
+        auto entry = scheduler.edf_.pick();
+        scheduler.edf_.add(scheduledHostWeight(*entry, now), entry);
       }
     }
-  };
+    return;
+  }
 
-  // Populate EdfSchedulers for each valid HostsSource value for the host set at this priority.
-  const auto& host_set = priority_set_.hostSetsPerPriority()[priority];
-  add_hosts_source(HostsSource(priority, HostsSource::SourceType::AllHosts), host_set->hosts());
-  add_hosts_source(HostsSource(priority, HostsSource::SourceType::HealthyHosts),
-                   host_set->healthyHosts());
-  for (uint32_t locality_index = 0;
-       locality_index < host_set->healthyHostsPerLocality().get().size(); ++locality_index) {
-    add_hosts_source(
-        HostsSource(priority, HostsSource::SourceType::LocalityHealthyHosts, locality_index),
-        host_set->healthyHostsPerLocality().get()[locality_index]);
+  bool updated = false;
+  if (hosts_added != nullptr) {
+    // The membership of the source changes by the hosts added and removed.
+    for (const auto& host : *hosts_added) {
+      if (scheduler.entries_.find(host.get()) == scheduler.entries_.end()) {
+        addHost(scheduler, host);
+      }
+    }
+    for (const auto& host : *hosts_removed) {
+      scheduler.entries_.erase(host.get());
+    }
+    // If the change was not fully reported, fall back to comparing the memberships.
+    updated = scheduler.entries_.size() == hosts.size();
+  }
+
+  if (!updated) {
+    // Mark the hosts still in the source, adding the new ones, and sweep the others.
+    const uint64_t generation = ++scheduler.generation_;
+    for (const auto& host : hosts) {
+      auto it = scheduler.entries_.find(host.get());
+      if (it == scheduler.entries_.end()) {
+        addHost(scheduler, host);
+      } else {
+        it->second.generation_ = generation;
+      }
+    }
+    if (scheduler.entries_.size() != hosts.size()) {
+      for (auto it = scheduler.entries_.begin(); it != scheduler.entries_.end();) {
+        if (it->second.generation_ != generation) {
+          scheduler.entries_.erase(it++);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  compactScheduler(scheduler);
+}
+
+void EdfLoadBalancerBase::compactScheduler(Scheduler& scheduler) {
+  // The hosts which left the source leave their expired entries in the queue until they are
+  // picked, and a host which joins the source again gets a new entry. The queue is not picked at
+  // all in unweighted mode, or for a source which is not used, so it is rebuilt from the entries
+  // once the expired ones make up most of it. This keeps the queue bounded under host churn and
+  // health flapping, for an amortized constant cost per update.
+  if (scheduler.edf_.size() <= 2 * scheduler.entries_.size()) {
+    return;
+  }
+  const MonotonicTime now =
+      slow_start_window_.count() > 0 ? time_source_.monotonicTime() : MonotonicTime();
+  scheduler.edf_ = EdfScheduler<const Scheduler::ScheduledHost>{};
+  for (const auto& entry : scheduler.entries_) {
+    scheduler.edf_.add(scheduledHostWeight(*entry.second.host_, now), entry.second.host_);
   }
 }
 
+void EdfLoadBalancerBase::addHost(Scheduler& scheduler, const HostSharedPtr& host) {
+  MonotonicTime now;
+  MonotonicTime added;
+  if (slow_start_window_.count() > 0) {
+    now = time_source_.monotonicTime();
+    if (initializing_) {
+      // The host was there before the load balancer: its slow start is over.
+      added = now - slow_start_window_;
+    } else {
+      added = now;
+      slow_start_end_ = std::max(slow_start_end_, now + slow_start_window_);
+    }
+  }
+  auto entry =
+      std::make_shared<const Scheduler::ScheduledHost>(Scheduler::ScheduledHost{host, added});
+  // We use a fixed weight here. While the weight may change without notification, this will only
+  // be stale until this host is next picked, at which point it is reinserted into the
+  // EdfScheduler with its new weight in chooseHost().
+  scheduler.edf_.add(scheduledHostWeight(*entry, now), entry);
+  scheduler.entries_[host.get()] = {std::move(entry), scheduler.generation_};
+}
+
+double EdfLoadBalancerBase::scheduledHostWeight(const Scheduler::ScheduledHost& scheduled_host,
+                                                MonotonicTime now) {
+  const double weight = hostWeight(*scheduled_host.host_);
+  if (slow_start_window_.count() == 0) {
+    return weight;
+  }
+  const auto elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(now - scheduled_host.added_);
+  if (elapsed >= slow_start_window_) {
+    return weight;
+  }
+  const double progress =
+      std::max<double>(elapsed.count(), 0) / static_cast<double>(slow_start_window_.count());
+  return weight *
+         std::max(slow_start_min_weight_, std::pow(progress, 1.0 / slow_start_aggression_));
+}
+
 HostConstSharedPtr EdfLoadBalancerBase::chooseHostOnce(LoadBalancerContext* context) {
   const HostsSource hosts_source = hostSourceToUse(context);
   auto scheduler_it = scheduler_.find(hosts_source);
@@ -576,11 +698,15 @@ HostConstSharedPtr EdfLoadBalancerBase::chooseHostOnce(LoadBalancerContext* cont
   // host set if any weights change. Additionally, it has the property that if all weights are
   // the same but not 1 (like 42), we will use the EDF schedule not the unweighted pick. This is
   // not optimal. If this is fixed, remove the note in the arch overview docs for the LR LB.
-  if (stats_.max_host_weight_.value() != 1) {
-    auto host = scheduler.edf_.pick();
-    if (host != nullptr) {
-      scheduler.edf_.add(hostWeight(*host), host);
+  const MonotonicTime now =
+      slow_start_window_.count() > 0 ? time_source_.monotonicTime() : MonotonicTime();
+  if (stats_.max_host_weight_.value() != 1 || now < slow_start_end_) {
+    auto entry = scheduler.edf_.pick();
+    if (entry == nullptr) {
+      return nullptr;
     }
+    HostConstSharedPtr host = entry->host_;
+    scheduler.edf_.add(scheduledHostWeight(*entry, now), entry);
     return host;
   } else {
     const HostVector& hosts_to_use = hostSourceToHosts(hosts_source);
@@ -614,6 +740,91 @@ HostConstSharedPtr LeastRequestLoadBalancer::unweightedHostPick(const HostVector
   return candidate_host;
 }
 
+PeakEwmaLoadBalancer::PeakEwmaLoadBalancer(
+    const PrioritySet& priority_set, const PrioritySet* local_priority_set, ClusterStats& stats,
+    Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+    const envoy::api::v2::Cluster::CommonLbConfig& common_config,
+    const absl::optional<envoy::api::v2::Cluster::PeakEwmaLbConfig>& peak_ewma_config,
+    TimeSource& time_source)
+    : ZoneAwareLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random,
+                                common_config),
+      choice_count_(peak_ewma_config.has_value() ? PROTOBUF_GET_WRAPPED_OR_DEFAULT(
+                                                       peak_ewma_config.value(), choice_count, 2)
+                                                 : 2),
+      decay_time_(1000.0 * (peak_ewma_config.has_value()
+                                ? PROTOBUF_GET_MS_OR_DEFAULT(peak_ewma_config.value(),
+                                                             decay_time, 10000)
+                                : 10000)),
+      time_source_(time_source) {
+  priority_set.addMemberUpdateCb(
+      [this](uint32_t, const HostVector&, const HostVector& hosts_removed) -> void {
+        for (const HostSharedPtr& host : hosts_removed) {
+          latencies_.erase(host.get());
+        }
+      });
+}
+
+double PeakEwmaLoadBalancer::decay(MonotonicTime from, MonotonicTime to) const {
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+  return std::exp(-std::max<double>(elapsed.count(), 0) / decay_time_);
+}
+
+double PeakEwmaLoadBalancer::cost(const Host& host, MonotonicTime now) {
+  const HostLatency& latency = latencies_[&host];
+  const uint64_t active_rq = host.stats().rq_active_.value();
+  if (!latency.responded_) {
+    // Probe the host with a single request until its latency is known.
+    return active_rq == 0 ? 0 : UnknownLatencyCost + active_rq;
+  }
+  return latency.ewma_ * decay(latency.last_update_, now) * (active_rq + 1) / host.weight();
+}
+
+void PeakEwmaLoadBalancer::onHostResponse(const HostDescription& host,
+                                          std::chrono::microseconds response_time, bool complete) {
+  auto it = latencies_.find(&host);
+  if (it == latencies_.end()) {
+    return;
+  }
+  HostLatency& latency = it->second;
+  const MonotonicTime now = time_source_.monotonicTime();
+  const double sample = response_time.count();
+  const double weight = decay(latency.last_update_, now);
+  if (!latency.responded_ || sample > latency.ewma_) {
+    // Peak sensitivity: a slower response is taken as is.
+    latency.ewma_ = sample;
+    latency.responded_ = true;
+  } else if (complete) {
+    latency.ewma_ = latency.ewma_ * weight + sample * (1 - weight);
+  } else {
+    // The time of a timed out or reset request is only a lower bound of the response time of the
+    // host. It raises the average, as decayed while the host did not respond, but does not lower
+    // it, which would make a host which hangs cheaper.
+    latency.ewma_ = std::max(latency.ewma_ * weight, sample);
+  }
+  latency.last_update_ = now;
+}
+
+HostConstSharedPtr PeakEwmaLoadBalancer::chooseHostOnce(LoadBalancerContext* context) {
+  const HostVector& hosts_to_use = hostSourceToHosts(hostSourceToUse(context));
+  if (hosts_to_use.empty()) {
+    return nullptr;
+  }
+
+  const MonotonicTime now = time_source_.monotonicTime();
+  HostSharedPtr candidate_host = nullptr;
+  double candidate_cost = 0;
+  for (uint32_t choice_idx = 0; choice_idx < choice_count_; ++choice_idx) {
+    const HostSharedPtr& sampled_host = hosts_to_use[random_.random() % hosts_to_use.size()];
+    const double sampled_cost = cost(*sampled_host, now);
+    if (candidate_host == nullptr || sampled_cost < candidate_cost) {
+      candidate_host = sampled_host;
+      candidate_cost = sampled_cost;
+    }
+  }
+
+  return candidate_host;
+}
+
 HostConstSharedPtr RandomLoadBalancer::chooseHostOnce(LoadBalancerContext* context) {
   const HostVector& hosts_to_use = hostSourceToHosts(hostSourceToUse(context));
   if (hosts_to_use.empty()) {
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <queue>
 #include <set>
 #include <vector>
 
 #include "envoy/api/v2/cds.pb.h"
+#include "envoy/common/time.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/load_balancer.h"
 #include "envoy/upstream/upstream.h"
@@ -13,6 +15,8 @@
 #include "common/protobuf/utility.h"
 #include "common/upstream/edf_scheduler.h"
 
+#include "absl/container/flat_hash_map.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -31,6 +35,7 @@ public:
   static uint32_t choosePriority(uint64_t hash, const std::vector<uint32_t>& per_priority_load);
 
   HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+  void onHostResponse(const HostDescription&, std::chrono::microseconds, bool) override {}
 
 protected:
   /**
@@ -273,21 +278,46 @@ private:
  *
  * This base class also supports unweighted selection which derived classes can use to customize
  * behavior. Derived classes can also override how host weight is determined when in weighted mode.
+ *
+ * When slow start is configured, the weight of a host which enters a host source, i.e. which is
+ * added or becomes healthy again, ramps up over the slow start window. The ramp is applied each time
+ * the host is (re)inserted in the EDF schedule, and the schedule is used while any host is in slow
+ * start.
  */
+class EdfLoadBalancerBasePeer;
+
 class EdfLoadBalancerBase : public ZoneAwareLoadBalancerBase {
 public:
   EdfLoadBalancerBase(const PrioritySet& priority_set, const PrioritySet* local_priority_set,
                       ClusterStats& stats, Runtime::Loader& runtime,
                       Runtime::RandomGenerator& random,
-                      const envoy::api::v2::Cluster::CommonLbConfig& common_config);
+                      const envoy::api::v2::Cluster::CommonLbConfig& common_config,
+                      TimeSource& time_source);
 
   // Upstream::LoadBalancerBase
   HostConstSharedPtr chooseHostOnce(LoadBalancerContext* context) override;
 
 protected:
   struct Scheduler {
+    struct ScheduledHost {
+      HostConstSharedPtr host_;
+      // When the host entered the source, which starts its slow start.
+      MonotonicTime added_;
+    };
+
+    struct Entry {
+      // The EdfScheduler only holds a weak reference on the entry: dropping the entry removes the
+      // host from the schedule, and the queue entry is lazily unloaded.
+      std::shared_ptr<const ScheduledHost> host_;
+      // Last membership update in which the host belonged to the source.
+      uint64_t generation_;
+    };
+
     // EdfScheduler for weighted LB.
-    EdfScheduler<const Host> edf_;
+    EdfScheduler<const ScheduledHost> edf_;
+    // Entries of the hosts in the schedule.
+    absl::flat_hash_map<const Host*, Entry> entries_;
+    uint64_t generation_{};
   };
 
   void initialize();
@@ -300,7 +330,13 @@ protected:
   const uint64_t seed_;
 
 private:
-  void refresh(uint32_t priority);
+  void refresh(uint32_t priority, const HostVector& hosts_added, const HostVector& hosts_removed);
+  void updateHostsSource(const HostsSource& source, const HostVector& hosts,
+                         const HostVector* hosts_added, const HostVector* hosts_removed);
+  void addHost(Scheduler& scheduler, const HostSharedPtr& host);
+  void compactScheduler(Scheduler& scheduler);
+  // Returns the weight of the host in the schedule, which ramps up during its slow start.
+  double scheduledHostWeight(const Scheduler::ScheduledHost& scheduled_host, MonotonicTime now);
   virtual void refreshHostSource(const HostsSource& source) PURE;
   virtual double hostWeight(const Host& host) PURE;
   virtual HostConstSharedPtr unweightedHostPick(const HostVector& hosts_to_use,
@@ -308,6 +344,20 @@ private:
 
   // Scheduler for each valid HostsSource.
   std::unordered_map<HostsSource, Scheduler, HostsSourceHash> scheduler_;
+
+  friend class EdfLoadBalancerBasePeer;
+
+  TimeSource& time_source_;
+  // Slow start window, 0 if slow start is disabled.
+  const std::chrono::milliseconds slow_start_window_;
+  const double slow_start_aggression_;
+  // Minimum fraction of its weight a host in slow start gets.
+  const double slow_start_min_weight_;
+  // The hosts added during initialize() get their full weight at once.
+  bool initializing_{};
+  // End of the slow start of the last host added. While a host is in slow start, the EDF schedule
+  // is used even if all the weights are 1, so that its weight ramps up.
+  MonotonicTime slow_start_end_;
 };
 
 /**
@@ -319,9 +369,10 @@ public:
   RoundRobinLoadBalancer(const PrioritySet& priority_set, const PrioritySet* local_priority_set,
                          ClusterStats& stats, Runtime::Loader& runtime,
                          Runtime::RandomGenerator& random,
-                         const envoy::api::v2::Cluster::CommonLbConfig& common_config)
+                         const envoy::api::v2::Cluster::CommonLbConfig& common_config,
+                         TimeSource& time_source)
       : EdfLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random,
-                            common_config) {
+                            common_config, time_source) {
     initialize();
   }
 
@@ -368,9 +419,10 @@ public:
       const PrioritySet& priority_set, const PrioritySet* local_priority_set, ClusterStats& stats,
       Runtime::Loader& runtime, Runtime::RandomGenerator& random,
       const envoy::api::v2::Cluster::CommonLbConfig& common_config,
-      const absl::optional<envoy::api::v2::Cluster::LeastRequestLbConfig> least_request_config)
+      const absl::optional<envoy::api::v2::Cluster::LeastRequestLbConfig> least_request_config,
+      TimeSource& time_source)
       : EdfLoadBalancerBase(priority_set, local_priority_set, stats, runtime, random,
-                            common_config),
+                            common_config, time_source),
         choice_count_(
             least_request_config.has_value()
                 ? PROTOBUF_GET_WRAPPED_OR_DEFAULT(least_request_config.value(), choice_count, 2)
@@ -398,6 +450,60 @@ private:
   const uint32_t choice_count_;
 };
 
+/**
+ * Peak EWMA load balancer, based on the load balancer of the same name of Finagle.
+ *
+ * It keeps a peak sensitive exponentially weighted moving average of the response time of each
+ * host, and picks the host with the lowest cost out of N random healthy hosts (P2C), the cost being
+ * the average response time times the number of active requests plus one, divided by the weight
+ * of the host. A response slower than the average replaces it, so that a host which gets slow is
+ * avoided at once, while faster responses lower it progressively. The average of a host decays
+ * while it does not respond, so that idle hosts, e.g. hosts avoided after a slow period, are tried
+ * again. Hosts which have not responded yet get one request at a time.
+ *
+ * The averages are kept by each load balancer, i.e. by each worker, from the responses to its own
+ * requests, so that no locking is needed.
+ */
+class PeakEwmaLoadBalancer : public ZoneAwareLoadBalancerBase {
+public:
+  PeakEwmaLoadBalancer(
+      const PrioritySet& priority_set, const PrioritySet* local_priority_set, ClusterStats& stats,
+      Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+      const envoy::api::v2::Cluster::CommonLbConfig& common_config,
+      const absl::optional<envoy::api::v2::Cluster::PeakEwmaLbConfig>& peak_ewma_config,
+      TimeSource& time_source);
+
+  // Upstream::LoadBalancer
+  void onHostResponse(const HostDescription& host, std::chrono::microseconds response_time,
+                      bool complete) override;
+
+  // Upstream::LoadBalancerBase
+  HostConstSharedPtr chooseHostOnce(LoadBalancerContext* context) override;
+
+private:
+  struct HostLatency {
+    // Average response time in microseconds as of last_update_.
+    double ewma_{};
+    MonotonicTime last_update_;
+    bool responded_{};
+  };
+
+  double cost(const Host& host, MonotonicTime now);
+  double decay(MonotonicTime from, MonotonicTime to) const;
+
+  // Cost of the hosts with active requests which have not responded yet, higher than the cost of
+  // any host which has responded.
+  static constexpr double UnknownLatencyCost = 1e12;
+
+  const uint32_t choice_count_;
+  // Decay time in microseconds.
+  const double decay_time_;
+  TimeSource& time_source_;
+  // The entries are created when a host is first sampled, while it is in the priority set, and
+  // erased when it is removed. Responses of the hosts without an entry are ignored.
+  absl::flat_hash_map<const HostDescription*, HostLatency> latencies_;
+};
+
 /**
  * Random load balancer that picks a random host out of all hosts.
  */
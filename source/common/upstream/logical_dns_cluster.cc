@@ -128,9 +128,10 @@ void LogicalDnsCluster::startResolve() {
             logical_host_->setHealthCheckAddress(new_address);
 
             // Capture URL to avoid a race with another update.
-            tls_->runOnAllThreads([this, new_address]() -> void {
-              PerThreadCurrentHostData& data = tls_->getTyped<PerThreadCurrentHostData>();
-              data.current_resolved_address_ = new_address;
+            tls_->set([new_address](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+              auto data = std::make_shared<PerThreadCurrentHostData>();
+              data->current_resolved_address_ = new_address;
+              return data;
             });
           }
         }
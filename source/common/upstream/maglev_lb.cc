@@ -91,12 +91,15 @@ MaglevTable::MaglevTable(const HostsPerLocality& hosts_per_locality,
   }
 }
 
-HostConstSharedPtr MaglevTable::chooseHost(uint64_t hash) const {
+HostConstSharedPtr MaglevTable::chooseHost(uint64_t hash, uint32_t attempt) const {
   if (table_.empty()) {
     return nullptr;
   }
 
-  return table_[hash % table_size_];
+  // The following attempts walk the table from the entry of the hash. The entries are filled in
+  // the order of the permutations of the hosts, so that neighbouring entries are spread over the
+  // hosts.
+  return table_[(hash % table_size_ + attempt) % table_size_];
 }
 
 uint64_t MaglevTable::permutation(const TableBuildEntry& entry) {
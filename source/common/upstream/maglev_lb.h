@@ -20,7 +20,7 @@ public:
               uint64_t table_size = DefaultTableSize);
 
   // ThreadAwareLoadBalancerBase::HashingLoadBalancer
-  HostConstSharedPtr chooseHost(uint64_t hash) const override;
+  HostConstSharedPtr chooseHost(uint64_t hash, uint32_t attempt) const override;
 
   // Recommended table size in section 5.3 of the paper.
   static const uint64_t DefaultTableSize = 65537;
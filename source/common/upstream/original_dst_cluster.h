@@ -50,6 +50,7 @@ public:
 
     // Upstream::LoadBalancer
     HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+    void onHostResponse(const HostDescription&, std::chrono::microseconds, bool) override {}
 
   private:
     /**
@@ -1,8 +1,11 @@
 #include "common/upstream/ring_hash_lb.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "common/common/assert.h"
@@ -13,54 +16,89 @@
 namespace Envoy {
 namespace Upstream {
 
+namespace {
+
+// Rings are sorted by a thread per chunk of at least this many entries.
+constexpr size_t MinSortChunkSize = 1 << 16;
+constexpr uint32_t MaxSortThreads = 8;
+
+// Runs task(0) to task(num_tasks - 1), on the calling thread and num_tasks - 1 other threads.
+void runInParallel(Api::Api& api, uint32_t num_tasks, const std::function<void(uint32_t)>& task) {
+  std::vector<Thread::ThreadPtr> threads;
+  for (uint32_t i = 1; i < num_tasks; i++) {
+    threads.push_back(api.createThread([&task, i]() -> void { task(i); }));
+  }
+  task(0);
+  for (Thread::ThreadPtr& thread : threads) {
+    thread->join();
+  }
+}
+
+} // namespace
+
+void RingHashLoadBalancer::sortRing(Api::Api& api, std::vector<RingEntry>& ring,
+                                    uint32_t max_threads) {
+  const auto compare = [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
+    return lhs.hash_ < rhs.hash_ || (lhs.hash_ == rhs.hash_ && lhs.host_index_ < rhs.host_index_);
+  };
+  const uint32_t num_chunks =
+      static_cast<uint32_t>(std::min<size_t>(max_threads, ring.size() / MinSortChunkSize));
+  if (num_chunks < 2) {
+    std::sort(ring.begin(), ring.end(), compare);
+    return;
+  }
+
+  std::vector<std::vector<RingEntry>::iterator> bounds;
+  for (uint32_t i = 0; i <= num_chunks; i++) {
+    bounds.push_back(ring.begin() + ring.size() * i / num_chunks);
+  }
+  runInParallel(api, num_chunks, [&bounds, &compare](uint32_t chunk) -> void {
+    std::sort(bounds[chunk], bounds[chunk + 1], compare);
+  });
+  for (uint32_t width = 1; width < num_chunks; width *= 2) {
+    const uint32_t num_merges = (num_chunks + 2 * width - 1) / (2 * width);
+    runInParallel(api, num_merges, [&bounds, &compare, width, num_chunks](uint32_t merge) -> void {
+      const uint32_t first = 2 * width * merge;
+      const uint32_t middle = std::min(first + width, num_chunks);
+      const uint32_t last = std::min(first + 2 * width, num_chunks);
+      std::inplace_merge(bounds[first], bounds[middle], bounds[last], compare);
+    });
+  }
+}
+
 RingHashLoadBalancer::RingHashLoadBalancer(
     PrioritySet& priority_set, ClusterStats& stats, Runtime::Loader& runtime,
     Runtime::RandomGenerator& random,
     const absl::optional<envoy::api::v2::Cluster::RingHashLbConfig>& config,
-    const envoy::api::v2::Cluster::CommonLbConfig& common_config)
+    const envoy::api::v2::Cluster::CommonLbConfig& common_config, Api::Api& api)
     : ThreadAwareLoadBalancerBase(priority_set, stats, runtime, random, common_config),
-      config_(config) {}
+      config_(config), api_(api) {}
 
-HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(uint64_t h) const {
-  if (ring_.empty()) {
+HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(uint64_t h, uint32_t attempt) const {
+  if (hashes_.empty()) {
     return nullptr;
   }
 
-  // Ported from https://github.com/RJ/ketama/blob/master/libketama/ketama.c (ketama_get_server)
-  // I've generally kept the variable names to make the code easier to compare.
-  // NOTE: The algorithm depends on using signed integers for lowp, midp, and highp. Do not
-  //       change them!
-  int64_t lowp = 0;
-  int64_t highp = ring_.size();
-  while (true) {
-    int64_t midp = (lowp + highp) / 2;
-
-    if (midp == static_cast<int64_t>(ring_.size())) {
-      return ring_[0].host_;
-    }
-
-    uint64_t midval = ring_[midp].hash_;
-    uint64_t midval1 = midp == 0 ? 0 : ring_[midp - 1].hash_;
-
-    if (h <= midval && h > midval1) {
-      return ring_[midp].host_;
-    }
-
-    if (midval < h) {
-      lowp = midp + 1;
-    } else {
-      highp = midp - 1;
-    }
-
-    if (lowp > highp) {
-      return ring_[0].host_;
-    }
+  // Find the first entry whose hash is not less than h, wrapping around to the first entry, as
+  // ketama does. The binary search is branch free: each step selects the upper half of the range
+  // with a conditional move instead of a jump, which is mispredicted half of the time on random
+  // hashes.
+  const uint64_t* base = hashes_.data();
+  size_t size = hashes_.size();
+  while (size > 1) {
+    const size_t half = size / 2;
+    base = base[half] < h ? base + half : base;
+    size -= half;
   }
+  // The following attempts walk the ring clockwise from the entry of the hash.
+  const size_t index = (base - hashes_.data()) + (*base < h) + attempt;
+  return hosts_[host_indexes_[index % hashes_.size()]];
 }
 
 RingHashLoadBalancer::Ring::Ring(
     const absl::optional<envoy::api::v2::Cluster::RingHashLbConfig>& config,
-    const HostVector& hosts) {
+    const HostVector& hosts, Api::Api& api)
+    : hosts_(hosts) {
   ENVOY_LOG(trace, "ring hash: building ring");
   if (hosts.empty()) {
     return;
@@ -86,15 +124,16 @@ RingHashLoadBalancer::Ring::Ring(
   }
 
   ENVOY_LOG(info, "ring hash: min_ring_size={} hashes_per_host={}", min_ring_size, hashes_per_host);
-  ring_.reserve(hosts.size() * hashes_per_host);
+  std::vector<RingEntry> ring;
+  ring.reserve(hosts.size() * hashes_per_host);
 
   const bool use_std_hash =
       config ? PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.value().deprecated_v1(), use_std_hash, false)
              : false;
 
   char hash_key_buffer[196];
-  for (const auto& host : hosts) {
-    const std::string& address_string = host->address()->asString();
+  for (uint32_t host_index = 0; host_index < hosts.size(); host_index++) {
+    const std::string& address_string = hosts[host_index]->address()->asString();
     uint64_t offset_start = address_string.size();
 
     // Currently, we support both IP and UDS addresses. The UDS max path length is ~108 on all Unix
@@ -119,17 +158,22 @@ RingHashLoadBalancer::Ring::Ring(
       const uint64_t hash = use_std_hash ? std::hash<std::string>()(std::string(hash_key))
                                          : HashUtil::xxHash64(hash_key);
       ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key.data(), hash);
-      ring_.push_back({hash, host});
+      ring.push_back({hash, host_index});
     }
   }
 
-  std::sort(ring_.begin(), ring_.end(), [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
-    return lhs.hash_ < rhs.hash_;
-  });
+  sortRing(api, ring,
+           std::min(MaxSortThreads, std::max(1U, std::thread::hardware_concurrency())));
+  hashes_.reserve(ring.size());
+  host_indexes_.reserve(ring.size());
+  for (const RingEntry& entry : ring) {
+    hashes_.push_back(entry.hash_);
+    host_indexes_.push_back(entry.host_index_);
+  }
   if (ENVOY_LOG_CHECK_LEVEL(trace)) {
-    for (const auto& entry : ring_) {
-      ENVOY_LOG(trace, "ring hash: host={} hash={}", entry.host_->address()->asString(),
-                entry.hash_);
+    for (size_t i = 0; i < hashes_.size(); i++) {
+      ENVOY_LOG(trace, "ring hash: host={} hash={}",
+                hosts_[host_indexes_[i]]->address()->asString(), hashes_[i]);
     }
   }
 }
@@ -1,7 +1,7 @@
 #include "common/upstream/subset_lb.h"
 
+#include <algorithm>
 #include <memory>
-#include <unordered_set>
 
 #include "envoy/api/v2/cds.pb.h"
 #include "envoy/runtime/runtime.h"
@@ -23,10 +23,12 @@ SubsetLoadBalancer::SubsetLoadBalancer(
     const LoadBalancerSubsetInfo& subsets,
     const absl::optional<envoy::api::v2::Cluster::RingHashLbConfig>& lb_ring_hash_config,
     const absl::optional<envoy::api::v2::Cluster::LeastRequestLbConfig>& least_request_config,
-    const envoy::api::v2::Cluster::CommonLbConfig& common_config)
+    const envoy::api::v2::Cluster::CommonLbConfig& common_config, TimeSource& time_source,
+    Api::Api& api)
     : lb_type_(lb_type), lb_ring_hash_config_(lb_ring_hash_config),
       least_request_config_(least_request_config), common_config_(common_config), stats_(stats),
-      runtime_(runtime), random_(random), fallback_policy_(subsets.fallbackPolicy()),
+      runtime_(runtime), random_(random), time_source_(time_source), api_(api),
+      fallback_policy_(subsets.fallbackPolicy()),
       default_subset_metadata_(subsets.defaultSubset().fields().begin(),
                                subsets.defaultSubset().fields().end()),
       subset_keys_(subsets.subsetKeys()), original_priority_set_(priority_set),
@@ -35,26 +37,24 @@ SubsetLoadBalancer::SubsetLoadBalancer(
       scale_locality_weight_(subsets.scaleLocalityWeight()) {
   ASSERT(subsets.isEnabled());
 
+  for (const auto& keys : subset_keys_) {
+    indexed_keys_.insert(keys.begin(), keys.end());
+  }
+  if (fallback_policy_ == envoy::api::v2::Cluster::LbSubsetConfig::DEFAULT_SUBSET) {
+    for (const auto& kv : default_subset_metadata_) {
+      indexed_keys_.insert(kv.first);
+    }
+  }
+
   // Create filtered default subset (if necessary) and other subsets based on current hosts.
   refreshSubsets();
 
-  // Configure future updates.
+  // Configure future updates. The metadata of the hosts may change without hosts being added or
+  // removed: the host index finds the hosts whose metadata changed, and regroups them into the
+  // right subsets.
   original_priority_set_callback_handle_ = priority_set.addMemberUpdateCb(
       [this](uint32_t priority, const HostVector& hosts_added, const HostVector& hosts_removed) {
-        if (!hosts_added.size() && !hosts_removed.size()) {
-          // It's possible that metadata changed, without hosts being added nor removed.
-          // If so we need to add any new subsets, remove unused ones, and regroup hosts into
-          // the right subsets.
-          //
-          // Note, note, note: if metadata for existing endpoints changed _and_ hosts were also
-          // added or removed, we don't need to hit this path. That's fine, given that
-          // findOrCreateSubset() will be called from processSubsets because it'll be triggered by
-          // either hosts_added or hosts_removed. That's where the new subsets will be created.
-          refreshSubsets(priority);
-        } else {
-          // This is a regular update with deltas.
-          update(priority, hosts_added, hosts_removed);
-        }
+        update(priority, hosts_added, hosts_removed);
       });
 }
 
@@ -76,12 +76,6 @@ void SubsetLoadBalancer::refreshSubsets() {
   }
 }
 
-void SubsetLoadBalancer::refreshSubsets(uint32_t priority) {
-  const auto& host_sets = original_priority_set_.hostSetsPerPriority();
-  ASSERT(priority < host_sets.size());
-  update(priority, host_sets[priority]->hosts(), {});
-}
-
 HostConstSharedPtr SubsetLoadBalancer::chooseHost(LoadBalancerContext* context) {
   if (context) {
     bool host_chosen;
@@ -163,153 +157,323 @@ SubsetLoadBalancer::LbSubsetEntryPtr SubsetLoadBalancer::findSubset(
   return nullptr;
 }
 
-void SubsetLoadBalancer::updateFallbackSubset(uint32_t priority, const HostVector& hosts_added,
-                                              const HostVector& hosts_removed) {
-  if (fallback_policy_ == envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK) {
-    ENVOY_LOG(debug, "subset lb: fallback load balancer disabled");
-    return;
+// Given the addition and/or removal of hosts, update the host index of this priority level, then
+// the subsets whose hosts changed, creating new subsets as necessary.
+void SubsetLoadBalancer::update(uint32_t priority, const HostVector&,
+                                const HostVector& hosts_removed) {
+  const auto& host_sets = original_priority_set_.hostSetsPerPriority();
+  ASSERT(priority < host_sets.size());
+  if (host_indexes_.size() < host_sets.size()) {
+    host_indexes_.resize(host_sets.size());
+  }
+  HostIndex& index = host_indexes_[priority];
+  const HostSet& host_set = *host_sets[priority];
+
+  // The hosts added are found by walking the hosts of the priority, along with the hosts whose
+  // metadata, health or weight changed.
+  HostVector hosts_indexed;
+  HostBitmap hosts_changed;
+  updateHostIndex(index, host_set, hosts_removed, hosts_indexed, hosts_changed);
+
+  // The subsets keep the locality layout they were last updated with: all the subsets are updated
+  // when it changes.
+  bool localities_changed = false;
+  const uint32_t num_localities = host_set.hostsPerLocality().get().size();
+  const LocalityWeights locality_weights =
+      host_set.localityWeights() != nullptr ? *host_set.localityWeights() : LocalityWeights();
+  if (num_localities != index.num_localities_ || locality_weights != index.locality_weights_) {
+    index.num_localities_ = num_localities;
+    index.locality_weights_ = locality_weights;
+    localities_changed = true;
   }
 
-  if (fallback_subset_ == nullptr) {
-    // First update: create the default host subset.
-    HostPredicate predicate;
-    if (fallback_policy_ == envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT) {
-      predicate = [](const Host&) -> bool { return true; };
+  // Update the existing subsets. A subset is only updated if its hosts changed.
+  if (fallback_subset_ != nullptr) {
+    updateSubset(*fallback_subset_, priority, hosts_changed, localities_changed);
+  }
+  forEachSubset(subsets_, [&](LbSubsetEntryPtr entry) {
+    if (!entry->initialized()) {
+      return;
+    }
 
+    const bool active_before = entry->active();
+    if (!updateSubset(*entry, priority, hosts_changed, localities_changed)) {
+      return;
+    }
+
+    if (active_before && !entry->active()) {
+      stats_.lb_subsets_active_.dec();
+      stats_.lb_subsets_removed_.inc();
+    } else if (!active_before && entry->active()) {
+      stats_.lb_subsets_active_.inc();
+      stats_.lb_subsets_created_.inc();
+    }
+  });
+
+  // Create the new subsets. Only the hosts added, or whose metadata changed, can belong to a
+  // subset which does not exist yet.
+  if (fallback_policy_ == envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK) {
+    ENVOY_LOG(debug, "subset lb: fallback load balancer disabled");
+  } else if (fallback_subset_ == nullptr) {
+    fallback_subset_.reset(new LbSubsetEntry());
+    if (fallback_policy_ == envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT) {
       ENVOY_LOG(debug, "subset lb: creating any-endpoint fallback load balancer");
+      initializeSubset(*fallback_subset_, {});
     } else {
-      predicate = std::bind(&SubsetLoadBalancer::hostMatches, this, default_subset_metadata_,
-                            std::placeholders::_1);
-
       ENVOY_LOG(debug, "subset lb: creating fallback load balancer for {}",
                 describeMetadata(default_subset_metadata_));
+      initializeSubset(*fallback_subset_, default_subset_metadata_);
     }
+  }
 
-    fallback_subset_.reset(new LbSubsetEntry());
-    fallback_subset_->priority_subset_.reset(
-        new PrioritySubsetImpl(*this, predicate, locality_weight_aware_, scale_locality_weight_));
-    return;
+  for (const auto& host : hosts_indexed) {
+    for (const auto& keys : subset_keys_) {
+      // For each host, for each subset key, attempt to extract the metadata corresponding to the
+      // key from the host.
+      SubsetMetadata kvs = extractSubsetMetadata(keys, *host);
+      if (kvs.empty()) {
+        continue;
+      }
+
+      // The host has metadata for each key, find or create its subset.
+      LbSubsetEntryPtr entry = findOrCreateSubset(subsets_, kvs, 0);
+      if (entry->initialized()) {
+        continue;
+      }
+
+      ENVOY_LOG(debug, "subset lb: creating load balancer for {}", describeMetadata(kvs));
+      initializeSubset(*entry, kvs);
+      stats_.lb_subsets_active_.inc();
+      stats_.lb_subsets_created_.inc();
+    }
   }
 
-  // Subsequent updates: add/remove hosts.
-  fallback_subset_->priority_subset_->update(priority, hosts_added, hosts_removed);
+  releaseIndexedHosts(index);
 }
 
-// Iterates over the added and removed hosts, looking up an LbSubsetEntryPtr for each. For every
-// unique LbSubsetEntryPtr found, it either invokes new_cb or update_cb depending on whether the
-// LbSubsetEntryPtr is already initialized (update_cb) or not (new_cb). In addition, update_cb is
-// invoked for any otherwise unmodified but active and initialized LbSubsetEntryPtr to allow host
-// health to be updated.
-void SubsetLoadBalancer::processSubsets(
-    const HostVector& hosts_added, const HostVector& hosts_removed,
-    std::function<void(LbSubsetEntryPtr)> update_cb,
-    std::function<void(LbSubsetEntryPtr, HostPredicate, const SubsetMetadata&, bool)> new_cb) {
-  std::unordered_set<LbSubsetEntryPtr> subsets_modified;
-
-  std::pair<const HostVector&, bool> steps[] = {{hosts_added, true}, {hosts_removed, false}};
-  for (const auto& step : steps) {
-    const auto& hosts = step.first;
-    const bool adding_hosts = step.second;
-
-    for (const auto& host : hosts) {
-      for (const auto& keys : subset_keys_) {
-        // For each host, for each subset key, attempt to extract the metadata corresponding to the
-        // key from the host.
-        SubsetMetadata kvs = extractSubsetMetadata(keys, *host);
-        if (!kvs.empty()) {
-          // The host has metadata for each key, find or create its subset.
-          LbSubsetEntryPtr entry = findOrCreateSubset(subsets_, kvs, 0);
-          if (subsets_modified.find(entry) != subsets_modified.end()) {
-            // We've already invoked the callback for this entry.
-            continue;
-          }
-          subsets_modified.emplace(entry);
-
-          if (entry->initialized()) {
-            update_cb(entry);
-          } else {
-            HostPredicate predicate =
-                std::bind(&SubsetLoadBalancer::hostMatches, this, kvs, std::placeholders::_1);
-
-            new_cb(entry, predicate, kvs, adding_hosts);
-          }
-        }
-      }
+// Updates the host index of a priority from its current hosts. The hosts added or whose metadata
+// changed are appended to hosts_indexed, and the slots of the hosts whose health or weight changed
+// are set in hosts_changed.
+void SubsetLoadBalancer::updateHostIndex(HostIndex& index, const HostSet& host_set,
+                                         const HostVector& hosts_removed,
+                                         HostVector& hosts_indexed, HostBitmap& hosts_changed) {
+  const uint64_t generation = ++index.generation_;
+
+  // Hosts removed which are not in the index are ignored.
+  for (const auto& host : hosts_removed) {
+    const auto it = index.host_slots_.find(host.get());
+    if (it != index.host_slots_.end()) {
+      removeIndexedHost(index, it->second);
     }
   }
 
-  forEachSubset(subsets_, [&](LbSubsetEntryPtr entry) {
-    if (subsets_modified.find(entry) != subsets_modified.end()) {
-      // Already handled due to hosts being added or removed.
-      return;
+  for (const auto& host : host_set.hosts()) {
+    const auto it = index.host_slots_.find(host.get());
+    if (it == index.host_slots_.end()) {
+      addIndexedHost(index, host);
+      hosts_indexed.push_back(host);
+      continue;
     }
 
-    if (entry->initialized() && entry->active()) {
-      update_cb(entry);
+    const uint32_t slot = it->second;
+    HostIndex::Slot& indexed_host = index.slots_[slot];
+    indexed_host.generation_ = generation;
+    std::shared_ptr<envoy::api::v2::core::Metadata> metadata = host->metadata();
+    if (indexed_host.metadata_ != metadata) {
+      updateIndexedValues(index, slot, false);
+      indexed_host.metadata_ = std::move(metadata);
+      updateIndexedValues(index, slot, true);
+      hosts_indexed.push_back(host);
     }
-  });
+    if (indexed_host.healthy_ != host->healthy() || indexed_host.weight_ != host->weight()) {
+      indexed_host.healthy_ = host->healthy();
+      indexed_host.weight_ = host->weight();
+      hosts_changed.set(slot);
+    }
+  }
+
+  if (index.host_slots_.size() != host_set.hosts().size()) {
+    // Some hosts left the priority without being reported as removed.
+    for (uint32_t slot = 0; slot < index.slots_.size(); ++slot) {
+      if (index.slots_[slot].host_ != nullptr && index.slots_[slot].generation_ != generation) {
+        removeIndexedHost(index, slot);
+      }
+    }
+  }
 }
 
-// Given the addition and/or removal of hosts, update all subsets for this priority level, creating
-// new subsets as necessary.
-void SubsetLoadBalancer::update(uint32_t priority, const HostVector& hosts_added,
-                                const HostVector& hosts_removed) {
-  updateFallbackSubset(priority, hosts_added, hosts_removed);
-
-  processSubsets(hosts_added, hosts_removed,
-                 [&](LbSubsetEntryPtr entry) {
-                   const bool active_before = entry->active();
-                   entry->priority_subset_->update(priority, hosts_added, hosts_removed);
-
-                   if (active_before && !entry->active()) {
-                     stats_.lb_subsets_active_.dec();
-                     stats_.lb_subsets_removed_.inc();
-                   } else if (!active_before && entry->active()) {
-                     stats_.lb_subsets_active_.inc();
-                     stats_.lb_subsets_created_.inc();
-                   }
-                 },
-                 [&](LbSubsetEntryPtr entry, HostPredicate predicate, const SubsetMetadata& kvs,
-                     bool adding_host) {
-                   UNREFERENCED_PARAMETER(kvs);
-                   if (adding_host) {
-                     ENVOY_LOG(debug, "subset lb: creating load balancer for {}",
-                               describeMetadata(kvs));
-
-                     // Initialize new entry with hosts and update stats. (An uninitialized entry
-                     // with only removed hosts is a degenerate case and we leave the entry
-                     // uninitialized.)
-                     entry->priority_subset_.reset(new PrioritySubsetImpl(
-                         *this, predicate, locality_weight_aware_, scale_locality_weight_));
-                     stats_.lb_subsets_active_.inc();
-                     stats_.lb_subsets_created_.inc();
-                   }
-                 });
+void SubsetLoadBalancer::addIndexedHost(HostIndex& index, const HostSharedPtr& host) {
+  uint32_t slot;
+  if (!index.free_slots_.empty()) {
+    slot = index.free_slots_.back();
+    index.free_slots_.pop_back();
+  } else {
+    slot = index.slots_.size();
+    index.slots_.emplace_back();
+  }
+
+  HostIndex::Slot& indexed_host = index.slots_[slot];
+  indexed_host.host_ = host;
+  indexed_host.metadata_ = host->metadata();
+  indexed_host.healthy_ = host->healthy();
+  indexed_host.weight_ = host->weight();
+  indexed_host.generation_ = index.generation_;
+  index.host_slots_[host.get()] = slot;
+  index.hosts_.set(slot);
+  index.hosts_generation_ = index.generation_;
+  updateIndexedValues(index, slot, true);
+}
+
+// Removes a host from the index. Its slot is released at the end of the update, so that the
+// subsets it leaves still find it.
+void SubsetLoadBalancer::removeIndexedHost(HostIndex& index, uint32_t slot) {
+  HostIndex::Slot& indexed_host = index.slots_[slot];
+  updateIndexedValues(index, slot, false);
+  index.hosts_.clear(slot);
+  index.hosts_generation_ = index.generation_;
+  index.host_slots_.erase(indexed_host.host_.get());
+  indexed_host.generation_ = index.generation_;
+  index.released_slots_.push_back(slot);
 }
 
-bool SubsetLoadBalancer::hostMatches(const SubsetMetadata& kvs, const Host& host) {
-  const envoy::api::v2::core::Metadata& host_metadata = *host.metadata();
-  const auto filter_it =
-      host_metadata.filter_metadata().find(Config::MetadataFilters::get().ENVOY_LB);
+// Adds the slot of a host to, or removes it from, the hosts of the values of its metadata for the
+// indexed keys.
+void SubsetLoadBalancer::updateIndexedValues(HostIndex& index, uint32_t slot, bool add) {
+  const envoy::api::v2::core::Metadata& metadata = *index.slots_[slot].metadata_;
+  const auto filter_it = metadata.filter_metadata().find(Config::MetadataFilters::get().ENVOY_LB);
+  if (filter_it == metadata.filter_metadata().end()) {
+    return;
+  }
+
+  const auto& fields = filter_it->second.fields();
+  for (const auto& key : indexed_keys_) {
+    const auto field_it = fields.find(key);
+    if (field_it == fields.end()) {
+      continue;
+    }
+
+    const HashedValue value(field_it->second);
+    auto& values = index.values_[key];
+    if (add) {
+      HostIndex::ValueHosts& value_hosts = values[value];
+      value_hosts.hosts_.set(slot);
+      value_hosts.generation_ = index.generation_;
+      continue;
+    }
 
-  if (filter_it == host_metadata.filter_metadata().end()) {
-    return kvs.size() == 0;
+    const auto value_it = values.find(value);
+    ASSERT(value_it != values.end());
+    value_it->second.hosts_.clear(slot);
+    value_it->second.generation_ = index.generation_;
+    if (value_it->second.hosts_.empty()) {
+      index.emptied_values_.emplace_back(key, value);
+    }
+  }
+}
+
+// Releases the slots of the hosts removed, and drops the values left without hosts, once the
+// subsets are updated.
+void SubsetLoadBalancer::releaseIndexedHosts(HostIndex& index) {
+  for (const uint32_t slot : index.released_slots_) {
+    index.slots_[slot] = HostIndex::Slot();
+    index.free_slots_.push_back(slot);
   }
+  index.released_slots_.clear();
 
-  const ProtobufWkt::Struct& data_struct = filter_it->second;
-  const auto& fields = data_struct.fields();
+  for (const auto& emptied_value : index.emptied_values_) {
+    auto& values = index.values_[emptied_value.first];
+    const auto value_it = values.find(emptied_value.second);
+    if (value_it != values.end() && value_it->second.hosts_.empty()) {
+      values.erase(value_it);
+    }
+    if (values.empty()) {
+      index.values_.erase(emptied_value.first);
+    }
+  }
+  index.emptied_values_.clear();
+}
+
+// Returns true if the hosts with the given key-values may have changed in the current update of
+// the index.
+bool SubsetLoadBalancer::subsetHostsChanged(const HostIndex& index,
+                                            const HashedSubsetMetadata& kvs) const {
+  if (kvs.empty()) {
+    return index.hosts_generation_ == index.generation_;
+  }
 
   for (const auto& kv : kvs) {
-    const auto entry_it = fields.find(kv.first);
-    if (entry_it == fields.end()) {
-      return false;
+    const auto key_it = index.values_.find(kv.first);
+    if (key_it == index.values_.end()) {
+      continue;
+    }
+    const auto value_it = key_it->second.find(kv.second);
+    if (value_it != key_it->second.end() && value_it->second.generation_ == index.generation_) {
+      return true;
     }
+  }
+  return false;
+}
 
-    if (!ValueUtil::equal(entry_it->second, kv.second)) {
-      return false;
+// Returns the hosts with the given key-values, i.e. the intersection of the hosts of each
+// key-value. Without key-values, all the hosts match.
+SubsetLoadBalancer::HostBitmap
+SubsetLoadBalancer::subsetHosts(const HostIndex& index, const HashedSubsetMetadata& kvs) const {
+  HostBitmap hosts = index.hosts_;
+  for (const auto& kv : kvs) {
+    const auto key_it = index.values_.find(kv.first);
+    if (key_it == index.values_.end()) {
+      return {};
+    }
+    const auto value_it = key_it->second.find(kv.second);
+    if (value_it == key_it->second.end()) {
+      return {};
     }
+    hosts.intersect(value_it->second.hosts_);
   }
+  return hosts;
+}
+
+// Initializes a new subset with its hosts in each priority, and creates its load balancer.
+void SubsetLoadBalancer::initializeSubset(LbSubsetEntry& entry, const SubsetMetadata& kvs) {
+  for (const auto& kv : kvs) {
+    entry.kvs_.emplace_back(kv.first, HashedValue(kv.second));
+  }
+  for (const auto& index : host_indexes_) {
+    entry.hosts_.push_back(subsetHosts(index, entry.kvs_));
+  }
+
+  entry.priority_subset_.reset(
+      new PrioritySubsetImpl(*this, entry, locality_weight_aware_, scale_locality_weight_));
+}
 
+// Updates the hosts of a subset at the given priority from the index. The subset, and its load
+// balancer, are left untouched if no host entered or left the subset and none of its hosts
+// changed. Returns true if the subset was updated.
+bool SubsetLoadBalancer::updateSubset(LbSubsetEntry& entry, uint32_t priority,
+                                      const HostBitmap& hosts_changed, bool localities_changed) {
+  if (entry.hosts_.size() <= priority) {
+    entry.hosts_.resize(priority + 1);
+  }
+  const HostIndex& index = host_indexes_[priority];
+  HostBitmap& hosts = entry.hosts_[priority];
+
+  HostVector hosts_added;
+  HostVector hosts_removed;
+  if (subsetHostsChanged(index, entry.kvs_)) {
+    HostBitmap new_hosts = subsetHosts(index, entry.kvs_);
+    new_hosts.forEachDifference(
+        hosts, [&](uint32_t slot) { hosts_added.push_back(index.slots_[slot].host_); });
+    hosts.forEachDifference(
+        new_hosts, [&](uint32_t slot) { hosts_removed.push_back(index.slots_[slot].host_); });
+    hosts = std::move(new_hosts);
+  }
+
+  if (hosts_added.empty() && hosts_removed.empty() && !localities_changed &&
+      !hosts.intersects(hosts_changed)) {
+    return false;
+  }
+
+  entry.priority_subset_->update(priority, hosts_added, hosts_removed);
   return true;
 }
 
@@ -416,29 +580,32 @@ void SubsetLoadBalancer::forEachSubset(LbSubsetMap& subsets,
   }
 }
 
-// Initialize a new HostSubsetImpl and LoadBalancer from the SubsetLoadBalancer, filtering hosts
-// with the given predicate.
+// Initialize a new HostSubsetImpl and LoadBalancer from the SubsetLoadBalancer, with the hosts of
+// the given subset entry.
 SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalancer& subset_lb,
-                                                           HostPredicate predicate,
+                                                           const LbSubsetEntry& entry,
                                                            bool locality_weight_aware,
                                                            bool scale_locality_weight)
-    : PrioritySetImpl(), original_priority_set_(subset_lb.original_priority_set_),
-      predicate_(predicate), locality_weight_aware_(locality_weight_aware),
-      scale_locality_weight_(scale_locality_weight) {
+    : PrioritySetImpl(), subset_lb_(subset_lb), entry_(entry),
+      original_priority_set_(subset_lb.original_priority_set_),
+      locality_weight_aware_(locality_weight_aware), scale_locality_weight_(scale_locality_weight) {
 
   for (size_t i = 0; i < original_priority_set_.hostSetsPerPriority().size(); ++i) {
     empty_ &= getOrCreateHostSet(i).hosts().empty();
   }
 
+  // The load balancer is created below, with the hosts of the subset: there is no need to report
+  // them as added.
   for (size_t i = 0; i < subset_lb.original_priority_set_.hostSetsPerPriority().size(); ++i) {
-    update(i, subset_lb.original_priority_set_.hostSetsPerPriority()[i]->hosts(), {});
+    update(i, {}, {});
   }
 
   switch (subset_lb.lb_type_) {
   case LoadBalancerType::LeastRequest:
     lb_ = std::make_unique<LeastRequestLoadBalancer>(
         *this, subset_lb.original_local_priority_set_, subset_lb.stats_, subset_lb.runtime_,
-        subset_lb.random_, subset_lb.common_config_, subset_lb.least_request_config_);
+        subset_lb.random_, subset_lb.common_config_, subset_lb.least_request_config_,
+        subset_lb.time_source_);
     break;
 
   case LoadBalancerType::Random:
@@ -448,9 +615,9 @@ SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalan
     break;
 
   case LoadBalancerType::RoundRobin:
-    lb_ = std::make_unique<RoundRobinLoadBalancer>(*this, subset_lb.original_local_priority_set_,
-                                                   subset_lb.stats_, subset_lb.runtime_,
-                                                   subset_lb.random_, subset_lb.common_config_);
+    lb_ = std::make_unique<RoundRobinLoadBalancer>(
+        *this, subset_lb.original_local_priority_set_, subset_lb.stats_, subset_lb.runtime_,
+        subset_lb.random_, subset_lb.common_config_, subset_lb.time_source_);
     break;
 
   case LoadBalancerType::RingHash:
@@ -459,7 +626,7 @@ SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalan
     // can also use a thread aware sub-LB properly. The following works fine but is not optimal.
     thread_aware_lb_ = std::make_unique<RingHashLoadBalancer>(
         *this, subset_lb.stats_, subset_lb.runtime_, subset_lb.random_,
-        subset_lb.lb_ring_hash_config_, subset_lb.common_config_);
+        subset_lb.lb_ring_hash_config_, subset_lb.common_config_, subset_lb.api_);
     thread_aware_lb_->initialize();
     lb_ = thread_aware_lb_->factory()->create();
     break;
@@ -475,44 +642,24 @@ SubsetLoadBalancer::PrioritySubsetImpl::PrioritySubsetImpl(const SubsetLoadBalan
     break;
 
   case LoadBalancerType::OriginalDst:
+  case LoadBalancerType::PeakEwma:
     NOT_REACHED_GCOVR_EXCL_LINE;
   }
 
   triggerCallbacks();
 }
 
-// Given hosts_added and hosts_removed, update the underlying HostSet. The hosts_added Hosts must
-// be filtered to match hosts that belong in this subset. The hosts_removed Hosts are ignored if
-// they are not currently a member of this subset.
+// Given hosts_added and hosts_removed, the hosts which entered and left this subset, update the
+// underlying HostSet. The predicate, which tells whether a host belongs to the subset, is a lookup
+// in the host index.
 void SubsetLoadBalancer::HostSubsetImpl::update(const HostVector& hosts_added,
                                                 const HostVector& hosts_removed,
                                                 std::function<bool(const Host&)> predicate) {
-  std::unordered_set<HostSharedPtr> predicate_added;
-
-  HostVector filtered_added;
-  for (const auto host : hosts_added) {
-    if (predicate(*host)) {
-      predicate_added.insert(host);
-      filtered_added.emplace_back(host);
-    }
-  }
-
-  HostVector filtered_removed;
-  for (const auto host : hosts_removed) {
-    if (predicate(*host)) {
-      filtered_removed.emplace_back(host);
-    }
-  }
-
   HostVectorSharedPtr hosts(new HostVector());
   HostVectorSharedPtr healthy_hosts(new HostVector());
 
-  // It's possible that hosts_added == original_host_set_.hosts(), e.g.: when
-  // calling refreshSubsets() if only metadata change. If so, we can avoid the
-  // predicate() call.
-  for (const auto host : original_host_set_.hosts()) {
-    bool host_seen = predicate_added.count(host) == 1;
-    if (host_seen || predicate(*host)) {
+  for (const auto& host : original_host_set_.hosts()) {
+    if (predicate(*host)) {
       hosts->emplace_back(host);
       if (host->healthy()) {
         healthy_hosts->emplace_back(host);
@@ -520,9 +667,8 @@ void SubsetLoadBalancer::HostSubsetImpl::update(const HostVector& hosts_added,
     }
   }
 
-  // Calling predicate() is expensive since it involves metadata lookups; so we
-  // avoid it in the 2nd call to filter() by using the result from the first call
-  // to filter() as the starting point.
+  // We avoid calling the predicate in the 2nd call to filter() by using the result from the first
+  // call to filter() as the starting point.
   //
   // Also, if we only have one locality we can avoid the first call to filter() by
   // just creating a new HostsPerLocality from the list of all hosts.
@@ -541,8 +687,8 @@ void SubsetLoadBalancer::HostSubsetImpl::update(const HostVector& hosts_added,
       hosts_per_locality->filter([](const Host& host) { return host.healthy(); });
 
   HostSetImpl::updateHosts(hosts, healthy_hosts, hosts_per_locality, healthy_hosts_per_locality,
-                           determineLocalityWeights(*hosts_per_locality), filtered_added,
-                           filtered_removed);
+                           determineLocalityWeights(*hosts_per_locality), hosts_added,
+                           hosts_removed);
 }
 
 LocalityWeightsConstSharedPtr SubsetLoadBalancer::HostSubsetImpl::determineLocalityWeights(
@@ -591,7 +737,11 @@ void SubsetLoadBalancer::PrioritySubsetImpl::update(uint32_t priority,
                                                     const HostVector& hosts_added,
                                                     const HostVector& hosts_removed) {
   HostSubsetImpl* host_subset = getOrCreateHostSubset(priority);
-  host_subset->update(hosts_added, hosts_removed, predicate_);
+  const HostIndex& index = subset_lb_.host_indexes_[priority];
+  const HostBitmap& hosts = entry_.hosts_[priority];
+  host_subset->update(hosts_added, hosts_removed, [&index, &hosts](const Host& host) -> bool {
+    return index.contains(hosts, host);
+  });
 
   if (host_subset->hosts().empty() != empty_) {
     empty_ = true;
@@ -608,5 +758,38 @@ void SubsetLoadBalancer::PrioritySubsetImpl::update(uint32_t priority,
   }
 }
 
+bool SubsetLoadBalancer::HostBitmap::empty() const {
+  return std::all_of(words_.begin(), words_.end(), [](uint64_t word) { return word == 0; });
+}
+
+bool SubsetLoadBalancer::HostBitmap::intersects(const HostBitmap& other) const {
+  const size_t size = std::min(words_.size(), other.words_.size());
+  for (size_t i = 0; i < size; ++i) {
+    if ((words_[i] & other.words_[i]) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SubsetLoadBalancer::HostBitmap::intersect(const HostBitmap& other) {
+  words_.resize(std::min(words_.size(), other.words_.size()));
+  for (size_t i = 0; i < words_.size(); ++i) {
+    words_[i] &= other.words_[i];
+  }
+}
+
+void SubsetLoadBalancer::HostBitmap::forEachDifference(const HostBitmap& other,
+                                                       std::function<void(uint32_t)> cb) const {
+  for (size_t i = 0; i < words_.size(); ++i) {
+    uint64_t word = words_[i] & ~(i < other.words_.size() ? other.words_[i] : 0);
+    while (word != 0) {
+      cb(i * 64 + __builtin_ctzll(word));
+      // Clear the lowest bit set.
+      word &= word - 1;
+    }
+  }
+}
+
 } // namespace Upstream
 } // namespace Envoy
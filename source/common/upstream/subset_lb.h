@@ -1,11 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "envoy/api/api.h"
+#include "envoy/common/time.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/load_balancer.h"
 
@@ -14,6 +19,7 @@
 #include "common/protobuf/utility.h"
 #include "common/upstream/upstream_impl.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/types/optional.h"
 
 namespace Envoy {
@@ -27,11 +33,13 @@ public:
       const LoadBalancerSubsetInfo& subsets,
       const absl::optional<envoy::api::v2::Cluster::RingHashLbConfig>& lb_ring_hash_config,
       const absl::optional<envoy::api::v2::Cluster::LeastRequestLbConfig>& least_request_config,
-      const envoy::api::v2::Cluster::CommonLbConfig& common_config);
+      const envoy::api::v2::Cluster::CommonLbConfig& common_config, TimeSource& time_source,
+      Api::Api& api);
   ~SubsetLoadBalancer();
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+  void onHostResponse(const HostDescription&, std::chrono::microseconds, bool) override {}
 
 private:
   typedef std::function<bool(const Host&)> HostPredicate;
@@ -45,6 +53,9 @@ private:
           original_host_set_(original_host_set), locality_weight_aware_(locality_weight_aware),
           scale_locality_weight_(scale_locality_weight) {}
 
+    // Updates the hosts of the subset: hosts_added and hosts_removed are the hosts which entered
+    // and left the subset, and the predicate tells whether a host of the original host set belongs
+    // to the subset.
     void update(const HostVector& hosts_added, const HostVector& hosts_removed,
                 HostPredicate predicate);
     LocalityWeightsConstSharedPtr
@@ -59,10 +70,12 @@ private:
     const bool scale_locality_weight_;
   };
 
+  class LbSubsetEntry;
+
   // Represents a subset of an original PrioritySet.
   class PrioritySubsetImpl : public PrioritySetImpl {
   public:
-    PrioritySubsetImpl(const SubsetLoadBalancer& subset_lb, HostPredicate predicate,
+    PrioritySubsetImpl(const SubsetLoadBalancer& subset_lb, const LbSubsetEntry& entry,
                        bool locality_weight_aware, bool scale_locality_weight);
 
     void update(uint32_t priority, const HostVector& hosts_added, const HostVector& hosts_removed);
@@ -89,8 +102,9 @@ private:
                                  absl::optional<uint32_t> overprovisioning_factor) override;
 
   private:
+    const SubsetLoadBalancer& subset_lb_;
+    const LbSubsetEntry& entry_;
     const PrioritySet& original_priority_set_;
-    const HostPredicate predicate_;
     const bool locality_weight_aware_;
     const bool scale_locality_weight_;
     bool empty_ = true;
@@ -100,8 +114,80 @@ private:
   typedef std::shared_ptr<PrioritySubsetImpl> PrioritySubsetImplPtr;
 
   typedef std::vector<std::pair<std::string, ProtobufWkt::Value>> SubsetMetadata;
+  typedef std::vector<std::pair<std::string, HashedValue>> HashedSubsetMetadata;
+
+  // Set of hosts of a priority, as a bitmap of their slots in the HostIndex.
+  class HostBitmap {
+  public:
+    void set(uint32_t slot) {
+      if (slot / 64 >= words_.size()) {
+        words_.resize(slot / 64 + 1);
+      }
+      words_[slot / 64] |= 1ULL << (slot % 64);
+    }
+    void clear(uint32_t slot) {
+      if (slot / 64 < words_.size()) {
+        words_[slot / 64] &= ~(1ULL << (slot % 64));
+      }
+    }
+    bool test(uint32_t slot) const {
+      return slot / 64 < words_.size() && (words_[slot / 64] >> (slot % 64)) & 1;
+    }
+    bool empty() const;
+    bool intersects(const HostBitmap& other) const;
+    void intersect(const HostBitmap& other);
+    // Invokes cb with each slot in this bitmap which is not in other.
+    void forEachDifference(const HostBitmap& other, std::function<void(uint32_t)> cb) const;
+
+  private:
+    std::vector<uint64_t> words_;
+  };
+
+  // Index of the hosts of a priority by the values of their metadata for the subset keys. Each
+  // host gets a slot, which it keeps while it belongs to the priority, so that the hosts of a
+  // subset are the intersection of the bitmaps of its key-values. The index is updated with the
+  // hosts added, removed, or whose metadata changed.
+  struct HostIndex {
+    struct Slot {
+      HostSharedPtr host_;
+      // Metadata the host is indexed with. Updating the metadata of a host replaces it.
+      std::shared_ptr<envoy::api::v2::core::Metadata> metadata_;
+      bool healthy_{};
+      uint32_t weight_{};
+      // Last update which found the host in the priority.
+      uint64_t generation_{};
+    };
+
+    struct ValueHosts {
+      HostBitmap hosts_;
+      // Last update which changed the hosts.
+      uint64_t generation_{};
+    };
+
+    // Returns true if the host is in the given set.
+    bool contains(const HostBitmap& hosts, const Host& host) const {
+      const auto it = host_slots_.find(&host);
+      return it != host_slots_.end() && hosts.test(it->second);
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    // Slots of the hosts removed in the current update, released at its end.
+    std::vector<uint32_t> released_slots_;
+    absl::flat_hash_map<const Host*, uint32_t> host_slots_;
+    // All the hosts of the priority.
+    HostBitmap hosts_;
+    uint64_t hosts_generation_{};
+    // Hosts by key and value.
+    std::unordered_map<std::string, std::unordered_map<HashedValue, ValueHosts>> values_;
+    // Values which lost their last host in the current update, dropped at its end.
+    std::vector<std::pair<std::string, HashedValue>> emptied_values_;
+    uint64_t generation_{};
+    // Locality layout of the priority at the last update.
+    uint32_t num_localities_{};
+    LocalityWeights locality_weights_;
+  };
 
-  class LbSubsetEntry;
   typedef std::shared_ptr<LbSubsetEntry> LbSubsetEntryPtr;
   typedef std::unordered_map<HashedValue, LbSubsetEntryPtr> ValueSubsetMap;
   typedef std::unordered_map<std::string, ValueSubsetMap> LbSubsetMap;
@@ -118,25 +204,33 @@ private:
 
     // Only initialized if a match exists at this level.
     PrioritySubsetImplPtr priority_subset_;
+
+    // Key-values of the subset, and its hosts in the index of each priority. Only set once the
+    // subset is initialized.
+    HashedSubsetMetadata kvs_;
+    std::vector<HostBitmap> hosts_;
   };
 
   // Create filtered default subset (if necessary) and other subsets based on current hosts.
   void refreshSubsets();
-  void refreshSubsets(uint32_t priority);
 
   // Called by HostSet::MemberUpdateCb
   void update(uint32_t priority, const HostVector& hosts_added, const HostVector& hosts_removed);
 
-  void updateFallbackSubset(uint32_t priority, const HostVector& hosts_added,
-                            const HostVector& hosts_removed);
-  void processSubsets(
-      const HostVector& hosts_added, const HostVector& hosts_removed,
-      std::function<void(LbSubsetEntryPtr)> update_cb,
-      std::function<void(LbSubsetEntryPtr, HostPredicate, const SubsetMetadata&, bool)> cb);
+  void updateHostIndex(HostIndex& index, const HostSet& host_set, const HostVector& hosts_removed,
+                       HostVector& hosts_indexed, HostBitmap& hosts_changed);
+  void addIndexedHost(HostIndex& index, const HostSharedPtr& host);
+  void removeIndexedHost(HostIndex& index, uint32_t slot);
+  void updateIndexedValues(HostIndex& index, uint32_t slot, bool add);
+  void releaseIndexedHosts(HostIndex& index);
+  bool subsetHostsChanged(const HostIndex& index, const HashedSubsetMetadata& kvs) const;
+  HostBitmap subsetHosts(const HostIndex& index, const HashedSubsetMetadata& kvs) const;
 
-  HostConstSharedPtr tryChooseHostFromContext(LoadBalancerContext* context, bool& host_chosen);
+  void initializeSubset(LbSubsetEntry& entry, const SubsetMetadata& kvs);
+  bool updateSubset(LbSubsetEntry& entry, uint32_t priority, const HostBitmap& hosts_changed,
+                    bool localities_changed);
 
-  bool hostMatches(const SubsetMetadata& kvs, const Host& host);
+  HostConstSharedPtr tryChooseHostFromContext(LoadBalancerContext* context, bool& host_chosen);
 
   LbSubsetEntryPtr
   findSubset(const std::vector<Router::MetadataMatchCriterionConstSharedPtr>& matches);
@@ -155,10 +249,15 @@ private:
   ClusterStats& stats_;
   Runtime::Loader& runtime_;
   Runtime::RandomGenerator& random_;
+  TimeSource& time_source_;
+  Api::Api& api_;
 
   const envoy::api::v2::Cluster::LbSubsetConfig::LbSubsetFallbackPolicy fallback_policy_;
   const SubsetMetadata default_subset_metadata_;
   const std::vector<std::set<std::string>> subset_keys_;
+  // Keys of the host metadata in the host indexes: the subset keys and the keys of the default
+  // subset.
+  std::set<std::string> indexed_keys_;
 
   const PrioritySet& original_priority_set_;
   const PrioritySet* original_local_priority_set_;
@@ -166,6 +265,9 @@ private:
 
   LbSubsetEntryPtr fallback_subset_;
 
+  // Host index of each priority.
+  std::vector<HostIndex> host_indexes_;
+
   // Forms a trie-like structure. Requires lexically sorted Host and Route metadata.
   LbSubsetMap subsets_;
 
@@ -173,6 +275,7 @@ private:
   const bool scale_locality_weight_;
 
   friend class SubsetLoadBalancerDescribeMetadataTester;
+  friend class SubsetLoadBalancerSubsetTester;
 };
 
 } // namespace Upstream
@@ -2,6 +2,8 @@
 
 #include <memory>
 
+#include "absl/container/flat_hash_set.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -32,6 +34,9 @@ void ThreadAwareLoadBalancerBase::refresh() {
     per_priority_state->global_panic_ = per_priority_panic_[priority];
     per_priority_state->current_lb_ =
         createLoadBalancer(*host_set, per_priority_state->global_panic_);
+    per_priority_state->num_hosts_ = per_priority_state->global_panic_
+                                         ? host_set->hosts().size()
+                                         : host_set->healthyHosts().size();
   }
 
   {
@@ -62,11 +67,48 @@ ThreadAwareLoadBalancerBase::LoadBalancerImpl::chooseHost(LoadBalancerContext* c
   if (per_priority_state->global_panic_) {
     stats_.lb_healthy_panic_.inc();
   }
-  return per_priority_state->current_lb_->chooseHost(h);
+  if (hash_balance_factor_ == 0) {
+    return per_priority_state->current_lb_->chooseHost(h, 0);
+  }
+  return chooseHostWithBoundedLoad(*per_priority_state, h);
+}
+
+HostConstSharedPtr ThreadAwareLoadBalancerBase::LoadBalancerImpl::chooseHostWithBoundedLoad(
+    const PerPriorityState& per_priority_state, uint64_t hash) {
+  const HostConstSharedPtr first = per_priority_state.current_lb_->chooseHost(hash, 0);
+  const uint64_t num_hosts = per_priority_state.num_hosts_;
+  if (first == nullptr || num_hosts <= 1) {
+    return first;
+  }
+
+  // The capacity of a host is the balance factor times the average number of active requests of
+  // the hosts, including this request, rounded up. At least one host is under capacity, provided
+  // that the cluster active requests are spread over these hosts only, which is not the case e.g.
+  // during a failover: the walk is bounded, and ends on the host of the hash.
+  const uint64_t capacity =
+      (hash_balance_factor_ * (stats_.upstream_rq_active_.value() + 1) + 100 * num_hosts - 1) /
+      (100 * num_hosts);
+  // A host has many entries in a ring or table, and is only checked and counted as overloaded
+  // once per request. The set only allocates once a host is overloaded.
+  const uint64_t max_attempts = num_hosts * MaxAttemptsPerHost;
+  absl::flat_hash_set<const Host*> overloaded;
+  for (uint64_t attempt = 0; attempt < max_attempts && overloaded.size() < num_hosts; attempt++) {
+    const HostConstSharedPtr host =
+        attempt == 0 ? first : per_priority_state.current_lb_->chooseHost(hash, attempt);
+    if (overloaded.count(host.get()) != 0) {
+      continue;
+    }
+    if (host->stats().rq_active_.value() < capacity) {
+      return host;
+    }
+    stats_.lb_hash_host_overloaded_.inc();
+    overloaded.insert(host.get());
+  }
+  return first;
 }
 
 LoadBalancerPtr ThreadAwareLoadBalancerBase::LoadBalancerFactoryImpl::create() {
-  auto lb = std::make_unique<LoadBalancerImpl>(stats_, random_);
+  auto lb = std::make_unique<LoadBalancerImpl>(stats_, random_, hash_balance_factor_);
 
   // We must protect current_lb_ via a RW lock since it is accessed and written to by multiple
   // threads. All complex processing has already been precalculated however.
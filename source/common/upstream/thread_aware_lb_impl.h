@@ -20,7 +20,15 @@ public:
   class HashingLoadBalancer {
   public:
     virtual ~HashingLoadBalancer() {}
-    virtual HostConstSharedPtr chooseHost(uint64_t hash) const PURE;
+
+    /**
+     * @param hash supplies the hash of the request.
+     * @param attempt supplies the number of entries already tried for the hash, when its host is
+     *        overloaded. Attempt N returns the host of the Nth entry following the entry of the
+     *        hash on the ring or in the table, so that the hosts tried for a hash are stable.
+     * @return the host of the attempt, or nullptr if there is no host.
+     */
+    virtual HostConstSharedPtr chooseHost(uint64_t hash, uint32_t attempt) const PURE;
   };
   typedef std::shared_ptr<HashingLoadBalancer> HashingLoadBalancerSharedPtr;
 
@@ -38,37 +46,54 @@ protected:
                               Runtime::Loader& runtime, Runtime::RandomGenerator& random,
                               const envoy::api::v2::Cluster::CommonLbConfig& common_config)
       : LoadBalancerBase(priority_set, stats, runtime, random, common_config),
-        factory_(new LoadBalancerFactoryImpl(stats, random)) {}
+        factory_(new LoadBalancerFactoryImpl(
+            stats, random,
+            PROTOBUF_GET_WRAPPED_OR_DEFAULT(common_config.consistent_hashing_lb_config(),
+                                            hash_balance_factor, 0))) {}
 
 private:
   struct PerPriorityState {
     std::shared_ptr<HashingLoadBalancer> current_lb_;
     bool global_panic_{};
+    // Number of hosts current_lb_ chooses from, over which the load is bounded.
+    uint32_t num_hosts_{};
   };
   typedef std::unique_ptr<PerPriorityState> PerPriorityStatePtr;
 
   struct LoadBalancerImpl : public LoadBalancer {
-    LoadBalancerImpl(ClusterStats& stats, Runtime::RandomGenerator& random)
-        : stats_(stats), random_(random) {}
+    LoadBalancerImpl(ClusterStats& stats, Runtime::RandomGenerator& random,
+                     uint32_t hash_balance_factor)
+        : stats_(stats), random_(random), hash_balance_factor_(hash_balance_factor) {}
 
     // Upstream::LoadBalancer
     HostConstSharedPtr chooseHost(LoadBalancerContext* context) override;
+    void onHostResponse(const HostDescription&, std::chrono::microseconds, bool) override {}
+
+    HostConstSharedPtr chooseHostWithBoundedLoad(const PerPriorityState& per_priority_state,
+                                                 uint64_t hash);
+
+    // Bound of the number of ring or table entries walked for a request with bounded load.
+    static const uint64_t MaxAttemptsPerHost = 4;
 
     ClusterStats& stats_;
     Runtime::RandomGenerator& random_;
+    // Percent of the average load over which a host is skipped, or 0 if the load is not bounded.
+    const uint32_t hash_balance_factor_;
     std::shared_ptr<std::vector<PerPriorityStatePtr>> per_priority_state_;
     std::shared_ptr<std::vector<uint32_t>> per_priority_load_;
   };
 
   struct LoadBalancerFactoryImpl : public LoadBalancerFactory {
-    LoadBalancerFactoryImpl(ClusterStats& stats, Runtime::RandomGenerator& random)
-        : stats_(stats), random_(random) {}
+    LoadBalancerFactoryImpl(ClusterStats& stats, Runtime::RandomGenerator& random,
+                            uint32_t hash_balance_factor)
+        : stats_(stats), random_(random), hash_balance_factor_(hash_balance_factor) {}
 
     // Upstream::LoadBalancerFactory
     LoadBalancerPtr create() override;
 
     ClusterStats& stats_;
     Runtime::RandomGenerator& random_;
+    const uint32_t hash_balance_factor_;
     absl::Mutex mutex_;
     std::shared_ptr<std::vector<PerPriorityStatePtr>> per_priority_state_ GUARDED_BY(mutex_);
     // This is split out of PerPriorityState so LoadBalancerBase::ChoosePriorirty can be reused.
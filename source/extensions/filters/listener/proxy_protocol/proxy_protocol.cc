@@ -1,8 +1,6 @@
 #include "extensions/filters/listener/proxy_protocol/proxy_protocol.h"
 
 #include <string.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
 
 #include <algorithm>
 #include <cstdint>
@@ -15,7 +13,6 @@
 #include "envoy/network/listen_socket.h"
 #include "envoy/stats/scope.h"
 
-#include "common/api/os_sys_calls_impl.h"
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/common/utility.h"
@@ -41,6 +38,10 @@ Network::FilterStatus Filter::onAccept(Network::ListenerFilterCallbacks& cb) {
                                       },
                                       Event::FileTriggerType::Edge, Event::FileReadyType::Read);
   cb_ = &cb;
+  // The bytes read by the filters that came before are not signaled by the socket again.
+  if (!cb.buffer().data().empty()) {
+    file_event_->activate(Event::FileReadyType::Read);
+  }
   return Network::FilterStatus::StopIteration;
 }
 
@@ -56,8 +57,8 @@ void Filter::onRead() {
 void Filter::onReadWorker() {
   Network::ConnectionSocket& socket = cb_->socket();
 
-  if ((!proxy_protocol_header_.has_value() && !readProxyHeader(socket.fd())) ||
-      (proxy_protocol_header_.has_value() && !parseExtensions(socket.fd()))) {
+  if ((!proxy_protocol_header_.has_value() && !readProxyHeader()) ||
+      (proxy_protocol_header_.has_value() && !parseExtensions())) {
     // We return if a) we do not yet have the header, or b) we have the header but not yet all
     // the extension data. In both cases we'll be called again when the socket is ready to read
     // and pick up where we left off.
@@ -94,7 +95,7 @@ void Filter::onReadWorker() {
   cb_->continueFilterChain(true);
 }
 
-size_t Filter::lenV2Address(char* buf) {
+size_t Filter::lenV2Address(const char* buf) {
   const uint8_t proto_family = buf[PROXY_PROTO_V2_SIGNATURE_LEN + 1];
   const int ver_cmd = buf[PROXY_PROTO_V2_SIGNATURE_LEN];
   size_t len;
@@ -117,7 +118,7 @@ size_t Filter::lenV2Address(char* buf) {
   return len;
 }
 
-void Filter::parseV2Header(char* buf) {
+void Filter::parseV2Header(const char* buf) {
   const int ver_cmd = buf[PROXY_PROTO_V2_SIGNATURE_LEN];
   uint8_t upper_byte = buf[PROXY_PROTO_V2_HEADER_LEN - 2];
   uint8_t lower_byte = buf[PROXY_PROTO_V2_HEADER_LEN - 1];
@@ -143,8 +144,8 @@ void Filter::parseV2Header(char* buf) {
           uint16_t src_port;
           uint16_t dst_port;
         });
-        pp_ipv4_addr* v4;
-        v4 = reinterpret_cast<pp_ipv4_addr*>(&buf[PROXY_PROTO_V2_HEADER_LEN]);
+        const pp_ipv4_addr* v4;
+        v4 = reinterpret_cast<const pp_ipv4_addr*>(&buf[PROXY_PROTO_V2_HEADER_LEN]);
         sockaddr_in ra4, la4;
         memset(&ra4, 0, sizeof(ra4));
         memset(&la4, 0, sizeof(la4));
@@ -167,8 +168,8 @@ void Filter::parseV2Header(char* buf) {
           uint16_t src_port;
           uint16_t dst_port;
         });
-        pp_ipv6_addr* v6;
-        v6 = reinterpret_cast<pp_ipv6_addr*>(&buf[PROXY_PROTO_V2_HEADER_LEN]);
+        const pp_ipv6_addr* v6;
+        v6 = reinterpret_cast<const pp_ipv6_addr*>(&buf[PROXY_PROTO_V2_HEADER_LEN]);
         sockaddr_in6 ra6, la6;
         memset(&ra6, 0, sizeof(ra6));
         memset(&la6, 0, sizeof(la6));
@@ -191,7 +192,7 @@ void Filter::parseV2Header(char* buf) {
   throw EnvoyException("Unsupported command or address family or transport");
 }
 
-void Filter::parseV1Header(char* buf, size_t len) {
+void Filter::parseV1Header(const char* buf, size_t len) {
   std::string proxy_line;
   proxy_line.assign(buf, len);
   const auto trimmed_proxy_line = StringUtil::rtrim(proxy_line);
@@ -234,144 +235,96 @@ void Filter::parseV1Header(char* buf, size_t len) {
   }
 }
 
-bool Filter::parseExtensions(int fd) {
+bool Filter::parseExtensions() {
   // If we ever implement extensions elsewhere, be sure to
   // continue to skip and ignore those for LOCAL.
-  while (proxy_protocol_header_.value().extensions_length_) {
-    // buf_ is no longer in use so we re-use it to read/discard
-    int bytes_avail;
-    auto& os_syscalls = Api::OsSysCallsSingleton::get();
-    if (os_syscalls.ioctl(fd, FIONREAD, &bytes_avail).rc_ < 0) {
-      throw EnvoyException("failed to read proxy protocol (no bytes avail)");
+  // The extensions are drained from the listener filter buffer, so that the filters coming later
+  // do not see them.
+  Network::ListenerFilterBuffer& buffer = cb_->buffer();
+  size_t& extensions_length = proxy_protocol_header_.value().extensions_length_;
+  while (true) {
+    const size_t buffered = std::min(buffer.data().size(), extensions_length);
+    buffer.drain(buffered);
+    extensions_length -= buffered;
+    if (extensions_length == 0) {
+      return true;
     }
-    if (bytes_avail == 0) {
+
+    const Api::SysCallIntResult result =
+        buffer.readFromSocket(std::min(extensions_length, size_t(MAX_PROXY_PROTO_LEN_V2)));
+    if (result.rc_ == -1 && result.errno_ == EAGAIN) {
       return false;
     }
-    bytes_avail = std::min(size_t(bytes_avail), sizeof(buf_));
-    bytes_avail = std::min(size_t(bytes_avail), proxy_protocol_header_.value().extensions_length_);
-    const Api::SysCallSizeResult recv_result = os_syscalls.recv(fd, buf_, bytes_avail, 0);
-    if (recv_result.rc_ != bytes_avail) {
+    if (result.rc_ <= 0) {
       throw EnvoyException("failed to read proxy protocol extension");
     }
-    proxy_protocol_header_.value().extensions_length_ -= recv_result.rc_;
   }
-  return true;
 }
 
-bool Filter::readProxyHeader(int fd) {
-  while (buf_off_ < MAX_PROXY_PROTO_LEN_V2) {
-    int bytes_avail;
-    auto& os_syscalls = Api::OsSysCallsSingleton::get();
+bool Filter::readProxyHeader() {
+  // The header is read into the listener filter buffer, and drained from it once parsed, so that
+  // the filters coming later do not see it. The bytes following the header stay in the buffer.
+  Network::ListenerFilterBuffer& buffer = cb_->buffer();
+  const Api::SysCallIntResult result = buffer.readFromSocket(MAX_PROXY_PROTO_LEN_V2);
+  if (result.rc_ < 0 && result.errno_ != EAGAIN) {
+    throw EnvoyException("failed to read proxy protocol (no bytes read)");
+  }
 
-    if (os_syscalls.ioctl(fd, FIONREAD, &bytes_avail).rc_ < 0) {
-      throw EnvoyException("failed to read proxy protocol (no bytes avail)");
+  const absl::string_view data = buffer.data();
+  const char* buf = data.data();
+  if (header_version_ != V2 && data.size() >= PROXY_PROTO_V2_HEADER_LEN) {
+    const char* sig = PROXY_PROTO_V2_SIGNATURE;
+    if (!memcmp(buf, sig, PROXY_PROTO_V2_SIGNATURE_LEN)) {
+      header_version_ = V2;
+    } else if (memcmp(buf, PROXY_PROTO_V1_SIGNATURE, PROXY_PROTO_V1_SIGNATURE_LEN)) {
+      // It is not v2, and can't be v1, so no sense hanging around: it is invalid
+      throw EnvoyException("failed to read proxy protocol (exceed max v1 header len)");
     }
+  }
 
-    if (bytes_avail == 0) {
-      return false;
+  if (header_version_ == V2) {
+    const int ver_cmd = buf[PROXY_PROTO_V2_SIGNATURE_LEN];
+    if (((ver_cmd & 0xf0) >> 4) != PROXY_PROTO_V2_VERSION) {
+      throw EnvoyException("Unsupported V2 proxy protocol version");
     }
-
-    bytes_avail = std::min(size_t(bytes_avail), MAX_PROXY_PROTO_LEN_V2 - buf_off_);
-
-    const Api::SysCallSizeResult result =
-        os_syscalls.recv(fd, buf_ + buf_off_, bytes_avail, MSG_PEEK);
-    ssize_t nread = result.rc_;
-
-    if (nread < 1) {
-      throw EnvoyException("failed to read proxy protocol (no bytes read)");
+    const size_t addr_len = lenV2Address(buf);
+    uint8_t upper_byte = buf[PROXY_PROTO_V2_HEADER_LEN - 2];
+    uint8_t lower_byte = buf[PROXY_PROTO_V2_HEADER_LEN - 1];
+    const size_t hdr_addr_len = (upper_byte << 8) + lower_byte;
+    if (hdr_addr_len < addr_len) {
+      throw EnvoyException("failed to read proxy protocol (insufficient data)");
     }
-
-    if (buf_off_ + nread >= PROXY_PROTO_V2_HEADER_LEN) {
-      const char* sig = PROXY_PROTO_V2_SIGNATURE;
-      if (!memcmp(buf_, sig, PROXY_PROTO_V2_SIGNATURE_LEN)) {
-        header_version_ = V2;
-      } else if (memcmp(buf_, PROXY_PROTO_V1_SIGNATURE, PROXY_PROTO_V1_SIGNATURE_LEN)) {
-        // It is not v2, and can't be v1, so no sense hanging around: it is invalid
-        throw EnvoyException("failed to read proxy protocol (exceed max v1 header len)");
-      }
+    if (data.size() >= PROXY_PROTO_V2_HEADER_LEN + addr_len) {
+      parseV2Header(buf);
+      // The TLV remain, they are read/discard in parseExtensions() which is called from the
+      // parent (if needed).
+      buffer.drain(PROXY_PROTO_V2_HEADER_LEN + addr_len);
+      return true;
     }
-
-    if (header_version_ == V2) {
-      const int ver_cmd = buf_[PROXY_PROTO_V2_SIGNATURE_LEN];
-      if (((ver_cmd & 0xf0) >> 4) != PROXY_PROTO_V2_VERSION) {
-        throw EnvoyException("Unsupported V2 proxy protocol version");
-      }
-      if (buf_off_ < PROXY_PROTO_V2_HEADER_LEN) {
-        ssize_t exp = PROXY_PROTO_V2_HEADER_LEN - buf_off_;
-        const Api::SysCallSizeResult read_result = os_syscalls.recv(fd, buf_ + buf_off_, exp, 0);
-        if (read_result.rc_ != exp) {
-          throw EnvoyException("failed to read proxy protocol (remote closed)");
-        }
-        buf_off_ += read_result.rc_;
-        nread -= read_result.rc_;
-      }
-      ssize_t addr_len = lenV2Address(buf_);
-      uint8_t upper_byte = buf_[PROXY_PROTO_V2_HEADER_LEN - 2];
-      uint8_t lower_byte = buf_[PROXY_PROTO_V2_HEADER_LEN - 1];
-      ssize_t hdr_addr_len = (upper_byte << 8) + lower_byte;
-      if (hdr_addr_len < addr_len) {
-        throw EnvoyException("failed to read proxy protocol (insufficient data)");
-      }
-      if (ssize_t(buf_off_) + nread >= PROXY_PROTO_V2_HEADER_LEN + addr_len) {
-        ssize_t missing = (PROXY_PROTO_V2_HEADER_LEN + addr_len) - buf_off_;
-        const Api::SysCallSizeResult read_result =
-            os_syscalls.recv(fd, buf_ + buf_off_, missing, 0);
-        if (read_result.rc_ != missing) {
-          throw EnvoyException("failed to read proxy protocol (remote closed)");
-        }
-        buf_off_ += read_result.rc_;
-        parseV2Header(buf_);
-        // The TLV remain, they are read/discard in parseExtensions() which is called from the
-        // parent (if needed).
-        return true;
-      } else {
-        const Api::SysCallSizeResult result = os_syscalls.recv(fd, buf_ + buf_off_, nread, 0);
-        nread = result.rc_;
-        if (nread < 0) {
-          throw EnvoyException("failed to read proxy protocol (remote closed)");
-        }
-        buf_off_ += nread;
-      }
-    } else {
-      // continue searching buf_ from where we left off
-      for (; search_index_ < buf_off_ + nread; search_index_++) {
-        if (buf_[search_index_] == '\n' && buf_[search_index_ - 1] == '\r') {
-          if (search_index_ == 1) {
-            // This could be the binary protocol. It cannot be the ascii protocol
-            header_version_ = InProgress;
-          } else {
-            header_version_ = V1;
-            search_index_++;
-          }
+  } else {
+    // continue searching the buffer from where we left off
+    for (; search_index_ < data.size(); search_index_++) {
+      if (buf[search_index_] == '\n' && buf[search_index_ - 1] == '\r') {
+        if (search_index_ == 1) {
+          // This could be the binary protocol. It cannot be the ascii protocol
+          header_version_ = InProgress;
           break;
         }
-      }
-
-      // If we bailed on the first char, we might be v2, but are for sure not v1. Thus we
-      // can read up to min(PROXY_PROTO_V2_HEADER_LEN, bytes_avail). If we bailed after first
-      // char, but before we hit \r\n, read up to search_index_. We're asking only for
-      // bytes we've already seen so there should be no block or fail
-      size_t ntoread;
-      if (header_version_ == InProgress) {
-        ntoread = bytes_avail;
-      } else {
-        ntoread = search_index_ - buf_off_;
-      }
-
-      const Api::SysCallSizeResult result = os_syscalls.recv(fd, buf_ + buf_off_, ntoread, 0);
-      nread = result.rc_;
-      ASSERT(size_t(nread) == ntoread);
-
-      buf_off_ += nread;
-
-      if (header_version_ == V1) {
-        parseV1Header(buf_, buf_off_);
+        header_version_ = V1;
+        parseV1Header(buf, search_index_ + 1);
+        buffer.drain(search_index_ + 1);
         return true;
       }
     }
   }
 
-  throw EnvoyException("failed to read proxy protocol (exceed max v2 header len)");
+  if (data.size() >= MAX_PROXY_PROTO_LEN_V2) {
+    throw EnvoyException("failed to read proxy protocol (exceed max v2 header len)");
+  }
+  if (result.rc_ == 0) {
+    throw EnvoyException("failed to read proxy protocol (remote closed)");
+  }
+  return false;
 }
 
 } // namespace ProxyProtocol
@@ -74,34 +74,28 @@ private:
    * throws EnvoyException on any socket errors.
    * @return bool true valid header, false if more data is needed.
    */
-  bool readProxyHeader(int fd);
+  bool readProxyHeader();
 
   /**
    * Parse (and discard unknown) header extensions (until hdr.extensions_length == 0)
    */
-  bool parseExtensions(int fd);
+  bool parseExtensions();
 
   /**
    * Given a char * & len, parse the header as per spec
    */
-  void parseV1Header(char* buf, size_t len);
-  void parseV2Header(char* buf);
-  size_t lenV2Address(char* buf);
+  void parseV1Header(const char* buf, size_t len);
+  void parseV2Header(const char* buf);
+  size_t lenV2Address(const char* buf);
 
   Network::ListenerFilterCallbacks* cb_{};
   Event::FileEventPtr file_event_;
 
-  // The offset in buf_ that has been fully read
-  size_t buf_off_{};
-
-  // The index in buf_ where the search for '\r\n' should continue from
+  // The index in the listener filter buffer where the search for '\r\n' should continue from
   size_t search_index_{1};
 
   ProxyProtocolVersion header_version_{Unknown};
 
-  // Stores the portion of the first line that has been read so far.
-  char buf_[MAX_PROXY_PROTO_LEN_V2];
-
   ConfigSharedPtr config_;
 
   absl::optional<WireHeader> proxy_protocol_header_;
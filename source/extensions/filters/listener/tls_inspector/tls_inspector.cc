@@ -11,7 +11,6 @@
 #include "envoy/network/listen_socket.h"
 #include "envoy/stats/scope.h"
 
-#include "common/api/os_sys_calls_impl.h"
 #include "common/common/assert.h"
 
 #include "extensions/transport_sockets/well_known_names.h"
@@ -60,11 +59,7 @@ Config::Config(Stats::Scope& scope, uint32_t max_client_hello_size)
 
 bssl::UniquePtr<SSL> Config::newSsl() { return bssl::UniquePtr<SSL>{SSL_new(ssl_ctx_.get())}; }
 
-thread_local uint8_t Filter::buf_[Config::TLS_MAX_CLIENT_HELLO];
-
 Filter::Filter(const ConfigSharedPtr config) : config_(config), ssl_(config_->newSsl()) {
-  RELEASE_ASSERT(sizeof(buf_) >= config_->maxClientHelloSize(), "");
-
   SSL_set_app_data(ssl_.get(), this);
   SSL_set_accept_state(ssl_.get());
 }
@@ -89,6 +84,10 @@ Network::FilterStatus Filter::onAccept(Network::ListenerFilterCallbacks& cb) {
       Event::FileTriggerType::Edge, Event::FileReadyType::Read | Event::FileReadyType::Closed);
 
   cb_ = &cb;
+  // The bytes read by the filters that came before are not signaled by the socket again.
+  if (!cb.buffer().data().empty()) {
+    file_event_->activate(Event::FileReadyType::Read);
+  }
   return Network::FilterStatus::StopIteration;
 }
 
@@ -124,38 +123,31 @@ void Filter::onServername(absl::string_view name) {
 }
 
 void Filter::onRead() {
-  // This receive code is somewhat complicated, because it must be done as a MSG_PEEK because
-  // there is no way for a listener-filter to pass payload data to the ConnectionImpl and filters
-  // that get created later.
-  //
-  // The file_event_ in this class gets events everytime new data is available on the socket,
-  // even if previous data has not been read, which is always the case due to MSG_PEEK. When
-  // the TlsInspector completes and passes the socket along, a new FileEvent is created for the
-  // socket, so that new event is immediately signalled as readable because it is new and the socket
-  // is readable, even though no new events have occurred.
+  // The ClientHello is read into the listener filter buffer of the socket, which keeps the bytes
+  // for the filters that come later and for the transport socket of the connection. The read
+  // bytes are not signaled again by the socket, so the connection reads them from the buffer first.
   //
   // TODO(ggreenway): write an integration test to ensure the events work as expected on all
   // platforms.
-  auto& os_syscalls = Api::OsSysCallsSingleton::get();
-  const Api::SysCallSizeResult result =
-      os_syscalls.recv(cb_->socket().fd(), buf_, config_->maxClientHelloSize(), MSG_PEEK);
+  Network::ListenerFilterBuffer& buffer = cb_->buffer();
+  const Api::SysCallIntResult result = buffer.readFromSocket(config_->maxClientHelloSize());
   ENVOY_LOG(trace, "tls inspector: recv: {}", result.rc_);
 
-  if (result.rc_ == -1 && result.errno_ == EAGAIN) {
-    return;
-  } else if (result.rc_ < 0) {
+  // Nothing may be left to read when the bytes left by the filters that came before are processed.
+  if (result.rc_ < 0 && result.errno_ != EAGAIN) {
     config_->stats().read_error_.inc();
     done(false);
     return;
   }
 
-  // Because we're doing a MSG_PEEK, data we've seen before gets returned every time, so
-  // skip over what we've already processed.
-  if (static_cast<uint64_t>(result.rc_) > read_) {
-    const uint8_t* data = buf_ + read_;
-    const size_t len = result.rc_ - read_;
-    read_ = result.rc_;
-    parseClientHello(data, len);
+  // The buffer also holds the bytes processed by the previous reads, so skip over what we've
+  // already processed.
+  const absl::string_view data = buffer.data();
+  if (data.size() > read_) {
+    const char* new_data = data.data() + read_;
+    const size_t len = data.size() - read_;
+    read_ = data.size();
+    parseClientHello(new_data, len);
   }
 }
 
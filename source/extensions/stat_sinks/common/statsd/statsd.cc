@@ -1,8 +1,12 @@
 #include "extensions/stat_sinks/common/statsd/statsd.h"
 
+#include <sys/socket.h>
+
 #include <chrono>
 #include <cstdint>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #include "envoy/common/exception.h"
 #include "envoy/event/dispatcher.h"
@@ -38,32 +42,102 @@ void Writer::write(const std::string& message) {
   ::send(fd_, message.c_str(), message.size(), MSG_DONTWAIT);
 }
 
+void Writer::writeBatch(const std::vector<absl::string_view>& datagrams) {
+#if defined(__linux__)
+  std::vector<struct iovec> iovecs(datagrams.size());
+  // Value initialization zeroes the message headers.
+  std::vector<struct mmsghdr> messages(datagrams.size());
+  for (size_t i = 0; i < datagrams.size(); ++i) {
+    iovecs[i].iov_base = const_cast<char*>(datagrams[i].data());
+    iovecs[i].iov_len = datagrams[i].size();
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  size_t sent = 0;
+  while (sent < messages.size()) {
+    // The kernel sends at most UIO_MAXIOV messages per call, and stops at the first failing one.
+    const int rc = ::sendmmsg(fd_, &messages[sent], messages.size() - sent, MSG_DONTWAIT);
+    if (rc > 0) {
+      sent += rc;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else {
+      // Skip a datagram which cannot be sent, e.g. because it is larger than the socket allows.
+      ++sent;
+    }
+  }
+#else
+  for (const absl::string_view datagram : datagrams) {
+    ::send(fd_, datagram.data(), datagram.size(), MSG_DONTWAIT);
+  }
+#endif
+}
+
+constexpr uint64_t UdpStatsdSink::DEFAULT_MAX_BYTES_PER_DATAGRAM;
+
 UdpStatsdSink::UdpStatsdSink(ThreadLocal::SlotAllocator& tls,
                              Network::Address::InstanceConstSharedPtr address, const bool use_tag,
-                             const std::string& prefix)
+                             const std::string& prefix, uint64_t max_bytes_per_datagram)
     : tls_(tls.allocateSlot()), server_address_(std::move(address)), use_tag_(use_tag),
-      prefix_(prefix.empty() ? Statsd::getDefaultPrefix() : prefix) {
+      prefix_(prefix.empty() ? Statsd::getDefaultPrefix() : prefix),
+      max_bytes_per_datagram_(max_bytes_per_datagram) {
   tls_->set([this](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     return std::make_shared<Writer>(this->server_address_);
   });
 }
 
 void UdpStatsdSink::flush(Stats::Source& source) {
-  Writer& writer = tls_->getTyped<Writer>();
+  buffer_.clear();
+  datagram_ends_.clear();
   for (const Stats::CounterSharedPtr& counter : source.cachedCounters()) {
     if (counter->used()) {
-      uint64_t delta = counter->latch();
-      writer.write(fmt::format("{}.{}:{}|c{}", prefix_, getName(*counter), delta,
-                               buildTagStr(counter->tags())));
+      appendLine(*counter, counter->latch(), "c");
     }
   }
 
   for (const Stats::GaugeSharedPtr& gauge : source.cachedGauges()) {
     if (gauge->used()) {
-      writer.write(fmt::format("{}.{}:{}|g{}", prefix_, getName(*gauge), gauge->value(),
-                               buildTagStr(gauge->tags())));
+      appendLine(*gauge, gauge->value(), "g");
     }
   }
+
+  if (buffer_.size() > (datagram_ends_.empty() ? 0 : datagram_ends_.back())) {
+    datagram_ends_.push_back(buffer_.size());
+  }
+  if (datagram_ends_.empty()) {
+    return;
+  }
+
+  // The datagrams are only referenced once the buffer is complete, since appending to it may move
+  // its contents.
+  datagrams_.clear();
+  size_t begin = 0;
+  for (const size_t end : datagram_ends_) {
+    datagrams_.emplace_back(buffer_.data() + begin, end - begin);
+    begin = end;
+  }
+  tls_->getTyped<Writer>().writeBatch(datagrams_);
+}
+
+void UdpStatsdSink::appendLine(const Stats::Metric& metric, uint64_t value,
+                               absl::string_view type) {
+  const size_t datagram_begin = datagram_ends_.empty() ? 0 : datagram_ends_.back();
+  const size_t line_begin = buffer_.size();
+  const bool first_line = line_begin == datagram_begin;
+  if (!first_line) {
+    buffer_.push_back('\n');
+  }
+  fmt::format_to(std::back_inserter(buffer_), "{}.{}:{}|{}", prefix_, getName(metric), value,
+                 type);
+  appendTags(buffer_, metric.tags());
+
+  // A line which does not fit in the current datagram starts the next one instead. A single line
+  // larger than the limit is still sent, alone in its datagram.
+  if (!first_line && buffer_.size() - datagram_begin > max_bytes_per_datagram_) {
+    buffer_.erase(line_begin, 1);
+    datagram_ends_.push_back(line_begin);
+  }
 }
 
 void UdpStatsdSink::onHistogramComplete(const Stats::Histogram& histogram, uint64_t value) {
@@ -83,16 +157,25 @@ const std::string UdpStatsdSink::getName(const Stats::Metric& metric) {
 }
 
 const std::string UdpStatsdSink::buildTagStr(const std::vector<Stats::Tag>& tags) {
+  std::string tag_str;
+  appendTags(tag_str, tags);
+  return tag_str;
+}
+
+void UdpStatsdSink::appendTags(std::string& buffer, const std::vector<Stats::Tag>& tags) {
   if (!use_tag_ || tags.empty()) {
-    return "";
+    return;
   }
 
-  std::vector<std::string> tag_strings;
-  tag_strings.reserve(tags.size());
+  buffer.append("|#");
   for (const Stats::Tag& tag : tags) {
-    tag_strings.emplace_back(tag.name_ + ":" + tag.value_);
+    if (&tag != &tags.front()) {
+      buffer.push_back(',');
+    }
+    buffer.append(tag.name_);
+    buffer.push_back(':');
+    buffer.append(tag.value_);
   }
-  return "|#" + StringUtil::join(tag_strings, ",");
 }
 
 TcpStatsdSink::TcpStatsdSink(const LocalInfo::LocalInfo& local_info,
@@ -14,6 +14,8 @@
 #include "common/buffer/buffer_impl.h"
 #include "common/common/macros.h"
 
+#include "absl/strings/string_view.h"
+
 namespace Envoy {
 namespace Extensions {
 namespace StatSinks {
@@ -33,6 +35,14 @@ public:
   virtual ~Writer();
 
   virtual void write(const std::string& message);
+
+  /**
+   * Sends several datagrams, with as few system calls as the platform allows. As for write(),
+   * datagrams which cannot be sent without blocking are dropped.
+   * @param datagrams supplies the payloads of the datagrams.
+   */
+  virtual void writeBatch(const std::vector<absl::string_view>& datagrams);
+
   // Called in unit test to validate address.
   int getFdForTests() const { return fd_; };
 
@@ -45,13 +55,20 @@ private:
  */
 class UdpStatsdSink : public Stats::Sink {
 public:
+  // Default payload size of the datagrams sent on flush, which keeps them within an Ethernet MTU
+  // once IP and UDP headers are added, with some headroom for IPv6 or tunnel headers.
+  static constexpr uint64_t DEFAULT_MAX_BYTES_PER_DATAGRAM = 1432;
+
   UdpStatsdSink(ThreadLocal::SlotAllocator& tls, Network::Address::InstanceConstSharedPtr address,
-                const bool use_tag, const std::string& prefix = getDefaultPrefix());
+                const bool use_tag, const std::string& prefix = getDefaultPrefix(),
+                uint64_t max_bytes_per_datagram = DEFAULT_MAX_BYTES_PER_DATAGRAM);
   // For testing.
   UdpStatsdSink(ThreadLocal::SlotAllocator& tls, const std::shared_ptr<Writer>& writer,
-                const bool use_tag, const std::string& prefix = getDefaultPrefix())
+                const bool use_tag, const std::string& prefix = getDefaultPrefix(),
+                uint64_t max_bytes_per_datagram = DEFAULT_MAX_BYTES_PER_DATAGRAM)
       : tls_(tls.allocateSlot()), use_tag_(use_tag),
-        prefix_(prefix.empty() ? getDefaultPrefix() : prefix) {
+        prefix_(prefix.empty() ? getDefaultPrefix() : prefix),
+        max_bytes_per_datagram_(max_bytes_per_datagram) {
     tls_->set(
         [writer](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr { return writer; });
   }
@@ -64,16 +81,25 @@ public:
   int getFdForTests() { return tls_->getTyped<Writer>().getFdForTests(); }
   bool getUseTagForTest() { return use_tag_; }
   const std::string& getPrefix() { return prefix_; }
+  uint64_t getMaxBytesPerDatagramForTest() { return max_bytes_per_datagram_; }
 
 private:
   const std::string getName(const Stats::Metric& metric);
   const std::string buildTagStr(const std::vector<Stats::Tag>& tags);
+  void appendTags(std::string& buffer, const std::vector<Stats::Tag>& tags);
+  void appendLine(const Stats::Metric& metric, uint64_t value, absl::string_view type);
 
   ThreadLocal::SlotPtr tls_;
   Network::Address::InstanceConstSharedPtr server_address_;
   const bool use_tag_;
   // Prefix for all flushed stats.
   const std::string prefix_;
+  const uint64_t max_bytes_per_datagram_;
+  // Newline separated lines of the datagrams sent by flush(), and the offset at which each datagram
+  // ends. They are only used on the main thread, and kept across flushes to reuse their memory.
+  std::string buffer_;
+  std::vector<size_t> datagram_ends_;
+  std::vector<absl::string_view> datagrams_;
 };
 
 /**
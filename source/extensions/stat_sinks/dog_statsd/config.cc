@@ -7,6 +7,7 @@
 #include "envoy/registry/registry.h"
 
 #include "common/network/resolver_impl.h"
+#include "common/protobuf/utility.h"
 
 #include "extensions/stat_sinks/common/statsd/statsd.h"
 #include "extensions/stat_sinks/well_known_names.h"
@@ -23,8 +24,12 @@ Stats::SinkPtr DogStatsdSinkFactory::createStatsSink(const Protobuf::Message& co
   Network::Address::InstanceConstSharedPtr address =
       Network::Address::resolveProtoAddress(sink_config.address());
   ENVOY_LOG(debug, "dog_statsd UDP ip address: {}", address->asString());
+  const uint64_t max_bytes_per_datagram = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
+      sink_config, max_bytes_per_datagram,
+      Common::Statsd::UdpStatsdSink::DEFAULT_MAX_BYTES_PER_DATAGRAM);
   return std::make_unique<Common::Statsd::UdpStatsdSink>(server.threadLocal(), std::move(address),
-                                                         true, sink_config.prefix());
+                                                         true, sink_config.prefix(),
+                                                         max_bytes_per_datagram);
 }
 
 ProtobufTypes::MessagePtr DogStatsdSinkFactory::createEmptyConfigProto() {
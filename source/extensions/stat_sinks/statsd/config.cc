@@ -7,6 +7,7 @@
 #include "envoy/registry/registry.h"
 
 #include "common/network/resolver_impl.h"
+#include "common/protobuf/utility.h"
 
 #include "extensions/stat_sinks/common/statsd/statsd.h"
 #include "extensions/stat_sinks/well_known_names.h"
@@ -26,8 +27,12 @@ Stats::SinkPtr StatsdSinkFactory::createStatsSink(const Protobuf::Message& confi
     Network::Address::InstanceConstSharedPtr address =
         Network::Address::resolveProtoAddress(statsd_sink.address());
     ENVOY_LOG(debug, "statsd UDP ip address: {}", address->asString());
+    const uint64_t max_bytes_per_datagram = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
+        statsd_sink, max_bytes_per_datagram,
+        Common::Statsd::UdpStatsdSink::DEFAULT_MAX_BYTES_PER_DATAGRAM);
     return std::make_unique<Common::Statsd::UdpStatsdSink>(server.threadLocal(), std::move(address),
-                                                           false, statsd_sink.prefix());
+                                                           false, statsd_sink.prefix(),
+                                                           max_bytes_per_datagram);
   }
   case envoy::config::metrics::v2::StatsdSink::kTcpClusterName:
     ENVOY_LOG(debug, "statsd TCP cluster: {}", statsd_sink.tcp_cluster_name());
@@ -20,6 +20,7 @@ public:
   int fd() const override { return parent_.fd(); }
   Network::Connection& connection() override { return parent_.connection(); }
   bool shouldDrainReadBuffer() override { return false; }
+  Buffer::Instance& preReadData() override { return parent_.preReadData(); }
   /*
    * No-op for these two methods to hold back the callbacks.
    */
@@ -6,6 +6,7 @@
 #include "envoy/stats/scope.h"
 #include "envoy/stats/timespan.h"
 
+#include "common/common/fmt.h"
 #include "common/network/connection_impl.h"
 #include "common/network/utility.h"
 
@@ -14,8 +15,13 @@
 namespace Envoy {
 namespace Server {
 
-ConnectionHandlerImpl::ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher)
-    : logger_(logger), dispatcher_(dispatcher), disable_listeners_(false) {}
+ConnectionHandlerImpl::ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher,
+                                             absl::optional<uint32_t> worker_index)
+    : logger_(logger), dispatcher_(dispatcher),
+      per_handler_stat_prefix_(worker_index.has_value()
+                                   ? fmt::format("worker_{}.", worker_index.value())
+                                   : "main_thread."),
+      disable_listeners_(false) {}
 
 void ConnectionHandlerImpl::addListener(Network::ListenerConfig& config) {
   ActiveListenerPtr l(new ActiveListener(*this, config));
@@ -38,14 +44,14 @@ void ConnectionHandlerImpl::removeListeners(uint64_t listener_tag) {
 void ConnectionHandlerImpl::stopListeners(uint64_t listener_tag) {
   for (auto& listener : listeners_) {
     if (listener.second->listener_tag_ == listener_tag) {
-      listener.second->listener_.reset();
+      listener.second->stop();
     }
   }
 }
 
 void ConnectionHandlerImpl::stopListeners() {
   for (auto& listener : listeners_) {
-    listener.second->listener_.reset();
+    listener.second->stop();
   }
 }
 
@@ -70,6 +76,8 @@ void ConnectionHandlerImpl::ActiveListener::removeConnection(ActiveConnection& c
   parent_.dispatcher_.deferredDelete(std::move(removed));
   ASSERT(parent_.num_connections_ > 0);
   parent_.num_connections_--;
+  ASSERT(num_listener_connections_ > 0);
+  num_listener_connections_--;
 }
 
 ConnectionHandlerImpl::ActiveListener::ActiveListener(ConnectionHandlerImpl& parent,
@@ -85,10 +93,21 @@ ConnectionHandlerImpl::ActiveListener::ActiveListener(ConnectionHandlerImpl& par
                                                       Network::ListenerConfig& config)
     : parent_(parent), listener_(std::move(listener)),
       stats_(generateStats(config.listenerScope())),
+      per_handler_stats_(
+          generatePerHandlerStats(config.listenerScope(), parent.per_handler_stat_prefix_)),
       listener_filters_timeout_(config.listenerFiltersTimeout()),
-      listener_tag_(config.listenerTag()), config_(config) {}
+      listener_tag_(config.listenerTag()), config_(config) {
+  config_.connectionBalancer().registerHandler(*this);
+}
+
+void ConnectionHandlerImpl::ActiveListener::stop() {
+  config_.connectionBalancer().unregisterHandler(*this);
+  listener_.reset();
+}
 
 ConnectionHandlerImpl::ActiveListener::~ActiveListener() {
+  config_.connectionBalancer().unregisterHandler(*this);
+
   // Purge sockets that have not progressed to connections. This should only happen when
   // a listener filter stops iteration and never resumes.
   while (!sockets_.empty()) {
@@ -109,6 +128,16 @@ ConnectionHandlerImpl::findListenerByAddress(const Network::Address::Instance& a
   return listener ? listener->listener_.get() : nullptr;
 }
 
+ConnectionHandlerImpl::ActiveListener*
+ConnectionHandlerImpl::findActiveListenerByTag(uint64_t listener_tag) {
+  for (auto& listener : listeners_) {
+    if (listener.second->listener_tag_ == listener_tag) {
+      return listener.second.get();
+    }
+  }
+  return nullptr;
+}
+
 ConnectionHandlerImpl::ActiveListener*
 ConnectionHandlerImpl::findActiveListenerByAddress(const Network::Address::Instance& address) {
   // This is a linear operation, may need to add a map<address, listener> to improve performance.
@@ -187,8 +216,8 @@ void ConnectionHandlerImpl::ActiveSocket::continueFilterChain(bool success) {
     if (new_listener != nullptr) {
       // Hands off connections redirected by iptables to the listener associated with the
       // original destination address. Pass 'hand_off_restored_destionations' as false to
-      // prevent further redirection.
-      new_listener->onAccept(std::move(socket_), false);
+      // prevent further redirection. The socket stays on this worker, so it is not balanced again.
+      new_listener->onAcceptWorker(std::move(socket_), false, false);
     } else {
       // Set default transport protocol if none of the listener filters did it.
       if (socket_->detectedTransportProtocol().empty()) {
@@ -208,7 +237,42 @@ void ConnectionHandlerImpl::ActiveSocket::continueFilterChain(bool success) {
 
 void ConnectionHandlerImpl::ActiveListener::onAccept(
     Network::ConnectionSocketPtr&& socket, bool hand_off_restored_destination_connections) {
-  Network::Address::InstanceConstSharedPtr local_address = socket->localAddress();
+  if (config_.connectionBalancer().balanceConnection(*this, socket)) {
+    stats_.downstream_cx_rebalanced_.inc();
+    return;
+  }
+
+  onAcceptWorker(std::move(socket), hand_off_restored_destination_connections, true);
+}
+
+void ConnectionHandlerImpl::ActiveListener::post(Network::ConnectionSocketPtr&& socket) {
+  // This runs on the accepting worker, under the balancer's lock which keeps this listener from
+  // being destroyed, so the callback only captures what it needs to find the listener again on its
+  // own worker. The posted callback must be copyable, so the socket is carried by a shared
+  // pointer. If the listener has been removed from the worker by the time the callback runs, the
+  // socket is closed when the callback is destroyed.
+  auto socket_to_rebalance = std::make_shared<Network::ConnectionSocketPtr>(std::move(socket));
+  ConnectionHandlerImpl& parent = parent_;
+  const uint64_t listener_tag = listener_tag_;
+  parent.dispatcher_.post([socket_to_rebalance, listener_tag, &parent]() -> void {
+    ActiveListener* listener = parent.findActiveListenerByTag(listener_tag);
+    if (listener != nullptr) {
+      listener->onAcceptWorker(std::move(*socket_to_rebalance),
+                               listener->config_.handOffRestoredDestinationConnections(), true);
+    }
+  });
+}
+
+void ConnectionHandlerImpl::ActiveListener::onAcceptWorker(
+    Network::ConnectionSocketPtr&& socket, bool hand_off_restored_destination_connections,
+    bool picked_by_balancer) {
+  if (picked_by_balancer) {
+    // The socket has been received, so the balancer no longer needs to account for it. The
+    // connection is accounted for once created.
+    ASSERT(num_listener_connections_ > 0);
+    num_listener_connections_--;
+  }
+
   auto active_socket = std::make_unique<ActiveSocket>(*this, std::move(socket),
                                                       hand_off_restored_destination_connections);
 
@@ -263,6 +327,7 @@ void ConnectionHandlerImpl::ActiveListener::onNewConnection(
         new ActiveConnection(*this, std::move(new_connection), parent_.dispatcher_.timeSystem()));
     active_connection->moveIntoList(std::move(active_connection), connections_);
     parent_.num_connections_++;
+    num_listener_connections_++;
   }
 }
 
@@ -277,10 +342,13 @@ ConnectionHandlerImpl::ActiveConnection::ActiveConnection(ActiveListener& listen
   connection_->addConnectionCallbacks(*this);
   listener_.stats_.downstream_cx_total_.inc();
   listener_.stats_.downstream_cx_active_.inc();
+  listener_.per_handler_stats_.downstream_cx_total_.inc();
+  listener_.per_handler_stats_.downstream_cx_active_.inc();
 }
 
 ConnectionHandlerImpl::ActiveConnection::~ActiveConnection() {
   listener_.stats_.downstream_cx_active_.dec();
+  listener_.per_handler_stats_.downstream_cx_active_.dec();
   listener_.stats_.downstream_cx_destroy_.inc();
   conn_length_->complete();
 }
@@ -289,5 +357,11 @@ ListenerStats ConnectionHandlerImpl::generateStats(Stats::Scope& scope) {
   return {ALL_LISTENER_STATS(POOL_COUNTER(scope), POOL_GAUGE(scope), POOL_HISTOGRAM(scope))};
 }
 
+PerHandlerListenerStats ConnectionHandlerImpl::generatePerHandlerStats(Stats::Scope& scope,
+                                                                       const std::string& prefix) {
+  return {ALL_PER_HANDLER_LISTENER_STATS(POOL_COUNTER_PREFIX(scope, prefix),
+                                         POOL_GAUGE_PREFIX(scope, prefix))};
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -4,10 +4,12 @@
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <string>
 
 #include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/network/connection.h"
+#include "envoy/network/connection_balancer.h"
 #include "envoy/network/connection_handler.h"
 #include "envoy/network/filter.h"
 #include "envoy/network/listen_socket.h"
@@ -18,7 +20,9 @@
 
 #include "common/common/linked_object.h"
 #include "common/common/non_copyable.h"
+#include "common/network/listener_filter_buffer_impl.h"
 
+#include "absl/types/optional.h"
 #include "spdlog/spdlog.h"
 
 namespace Envoy {
@@ -32,6 +36,7 @@ namespace Server {
   HISTOGRAM(downstream_cx_length_ms)                                                               \
   COUNTER  (downstream_pre_cx_timeout)                                                             \
   GAUGE    (downstream_pre_cx_active)                                                              \
+  COUNTER  (downstream_cx_rebalanced)                                                              \
   COUNTER  (no_filter_chain_match)
 // clang-format on
 
@@ -42,13 +47,37 @@ struct ListenerStats {
   ALL_LISTENER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT, GENERATE_HISTOGRAM_STRUCT)
 };
 
+/**
+ * Listener stats kept by each worker, or by the main thread, under *worker_<index>.* or
+ * *main_thread.* in the listener scope. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_PER_HANDLER_LISTENER_STATS(COUNTER, GAUGE)                                             \
+  COUNTER(downstream_cx_total)                                                                     \
+  GAUGE  (downstream_cx_active)
+// clang-format on
+
+/**
+ * Wrapper struct for per handler listener stats. @see stats_macros.h
+ */
+struct PerHandlerListenerStats {
+  ALL_PER_HANDLER_LISTENER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
 /**
  * Server side connection handler. This is used both by workers as well as the
  * main thread for non-threaded listeners.
  */
 class ConnectionHandlerImpl : public Network::ConnectionHandler, NonCopyable {
 public:
-  ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher);
+  /**
+   * @param logger supplies the logger.
+   * @param dispatcher supplies the dispatcher of the thread running the handler.
+   * @param worker_index supplies the index of the worker running the handler, or nullopt for the
+   *        main thread. It names the per handler listener stats.
+   */
+  ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher,
+                        absl::optional<uint32_t> worker_index = absl::nullopt);
 
   // Network::ConnectionHandler
   uint64_t numConnections() override { return num_connections_; }
@@ -64,6 +93,7 @@ public:
 private:
   struct ActiveListener;
   ActiveListener* findActiveListenerByAddress(const Network::Address::Instance& address);
+  ActiveListener* findActiveListenerByTag(uint64_t listener_tag);
 
   struct ActiveConnection;
   typedef std::unique_ptr<ActiveConnection> ActiveConnectionPtr;
@@ -71,9 +101,11 @@ private:
   typedef std::unique_ptr<ActiveSocket> ActiveSocketPtr;
 
   /**
-   * Wrapper for an active listener owned by this handler.
+   * Wrapper for an active listener owned by this handler. It is registered with the listener's
+   * connection balancer while it is listening.
    */
-  struct ActiveListener : public Network::ListenerCallbacks {
+  struct ActiveListener : public Network::ListenerCallbacks,
+                          public Network::BalancedConnectionHandler {
     ActiveListener(ConnectionHandlerImpl& parent, Network::ListenerConfig& config);
 
     ActiveListener(ConnectionHandlerImpl& parent, Network::ListenerPtr&& listener,
@@ -86,6 +118,27 @@ private:
                   bool hand_off_restored_destination_connections) override;
     void onNewConnection(Network::ConnectionPtr&& new_connection) override;
 
+    // Network::BalancedConnectionHandler
+    uint64_t numConnections() const override { return num_listener_connections_; }
+    void incNumConnections() override { ++num_listener_connections_; }
+    void post(Network::ConnectionSocketPtr&& socket) override;
+
+    /**
+     * Run the listener filters on a socket owned by this worker.
+     * @param socket supplies the accepted socket.
+     * @param hand_off_restored_destination_connections supplies whether the socket may be handed
+     *        off to the listener of its restored destination address.
+     * @param picked_by_balancer supplies whether the socket was picked for this listener by the
+     *        connection balancer, which accounted for it in numConnections().
+     */
+    void onAcceptWorker(Network::ConnectionSocketPtr&& socket,
+                        bool hand_off_restored_destination_connections, bool picked_by_balancer);
+
+    /**
+     * Stop accepting connections, and stop being picked by the connection balancer.
+     */
+    void stop();
+
     /**
      * Remove and destroy an active connection.
      * @param connection supplies the connection to remove.
@@ -100,6 +153,10 @@ private:
     ConnectionHandlerImpl& parent_;
     Network::ListenerPtr listener_;
     ListenerStats stats_;
+    PerHandlerListenerStats per_handler_stats_;
+    // Connections owned by this listener, plus the sockets picked for it by the connection
+    // balancer which have not been received yet. Read by the balancer on other workers.
+    std::atomic<uint64_t> num_listener_connections_{};
     std::list<ActiveSocketPtr> sockets_;
     std::list<ActiveConnectionPtr> connections_;
     const std::chrono::milliseconds listener_filters_timeout_;
@@ -144,7 +201,7 @@ private:
                         public Event::DeferredDeletable {
     ActiveSocket(ActiveListener& listener, Network::ConnectionSocketPtr&& socket,
                  bool hand_off_restored_destination_connections)
-        : listener_(listener), socket_(std::move(socket)),
+        : listener_(listener), socket_(std::move(socket)), buffer_(*socket_),
           hand_off_restored_destination_connections_(hand_off_restored_destination_connections),
           iter_(accept_filters_.end()) {
       listener_.stats_.downstream_pre_cx_active_.inc();
@@ -166,10 +223,12 @@ private:
     // Network::ListenerFilterCallbacks
     Network::ConnectionSocket& socket() override { return *socket_.get(); }
     Event::Dispatcher& dispatcher() override { return listener_.parent_.dispatcher_; }
+    Network::ListenerFilterBuffer& buffer() override { return buffer_; }
     void continueFilterChain(bool success) override;
 
     ActiveListener& listener_;
     Network::ConnectionSocketPtr socket_;
+    Network::ListenerFilterBufferImpl buffer_;
     const bool hand_off_restored_destination_connections_;
     std::list<Network::ListenerFilterPtr> accept_filters_;
     std::list<Network::ListenerFilterPtr>::iterator iter_;
@@ -177,9 +236,12 @@ private:
   };
 
   static ListenerStats generateStats(Stats::Scope& scope);
+  static PerHandlerListenerStats generatePerHandlerStats(Stats::Scope& scope,
+                                                         const std::string& prefix);
 
   spdlog::logger& logger_;
   Event::Dispatcher& dispatcher_;
+  const std::string per_handler_stat_prefix_;
   std::list<std::pair<Network::Address::InstanceConstSharedPtr, ActiveListenerPtr>> listeners_;
   std::atomic<uint64_t> num_connections_{};
   bool disable_listeners_;
@@ -0,0 +1,323 @@
+#include "server/filter_chain_index.h"
+
+#include <algorithm>
+#include <map>
+
+#include "common/common/assert.h"
+#include "common/common/empty_string.h"
+#include "common/network/address_impl.h"
+#include "common/network/cidr_range.h"
+#include "common/network/utility.h"
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+
+namespace Envoy {
+namespace Server {
+
+namespace {
+
+// Find the match of an interned protocol in a list sorted by protocol.
+template <class T>
+const T* findProtocol(const std::vector<std::pair<uint32_t, T>>& protocols, uint32_t protocol) {
+  const auto it = std::lower_bound(
+      protocols.begin(), protocols.end(), protocol,
+      [](const std::pair<uint32_t, T>& entry, uint32_t value) { return entry.first < value; });
+  if (it == protocols.end() || it->first != protocol) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+} // namespace
+
+FilterChainIndex::FilterChainIndex(const std::vector<FilterChainMatchRules>& rules) {
+  // The rules are first grouped by match step in ordered maps, which are then compiled into the
+  // flat structures used for matching.
+  typedef std::map<uint32_t, SourceTypesArray> ApplicationProtocolsMap;
+  typedef std::map<uint32_t, ApplicationProtocolsMap> TransportProtocolsMap;
+  typedef std::map<std::string, TransportProtocolsMap> ServerNamesMap;
+  typedef std::map<std::string, ServerNamesMap> DestinationIPsMap;
+  std::map<uint16_t, DestinationIPsMap> destination_ports_map;
+
+  const std::vector<std::string> any{EMPTY_STRING};
+  for (const FilterChainMatchRules& rule : rules) {
+    const uint32_t transport_protocol =
+        internProtocol(transport_protocol_ids_, rule.transport_protocol_);
+    std::vector<uint32_t> application_protocols;
+    for (const std::string& application_protocol : rule.application_protocols_) {
+      application_protocols.push_back(
+          internProtocol(application_protocol_ids_, application_protocol));
+    }
+    if (application_protocols.empty()) {
+      application_protocols.push_back(0);
+    }
+
+    DestinationIPsMap& destination_ips_map = destination_ports_map[rule.destination_port_];
+    for (const std::string& destination_ip :
+         rule.destination_ips_.empty() ? any : rule.destination_ips_) {
+      ServerNamesMap& server_names_map = destination_ips_map[destination_ip];
+      for (const std::string& server_name :
+           rule.server_names_.empty() ? any : rule.server_names_) {
+        ApplicationProtocolsMap& application_protocols_map =
+            server_names_map[server_name][transport_protocol];
+        for (uint32_t application_protocol : application_protocols) {
+          application_protocols_map[application_protocol][rule.source_type_] = rule.filter_chain_;
+        }
+      }
+    }
+  }
+
+  for (const auto& port : destination_ports_map) {
+    std::vector<std::pair<uint32_t, std::vector<Network::Address::CidrRange>>> list;
+    for (const auto& destination_ip : port.second) {
+      std::vector<Network::Address::CidrRange> subnets;
+      if (destination_ip.first == EMPTY_STRING) {
+        if (Network::Address::ipFamilySupported(AF_INET)) {
+          subnets.push_back(Network::Address::CidrRange::create("0.0.0.0/0"));
+        }
+        if (Network::Address::ipFamilySupported(AF_INET6)) {
+          subnets.push_back(Network::Address::CidrRange::create("::/0"));
+        }
+      } else {
+        subnets.push_back(Network::Address::CidrRange::create(destination_ip.first));
+      }
+      list.emplace_back(server_names_matches_.size(), std::move(subnets));
+
+      ServerNamesMatch match;
+      for (const auto& server_name : destination_ip.second) {
+        TransportProtocolsMatch transport_protocols;
+        for (const auto& transport_protocol : server_name.second) {
+          transport_protocols.emplace_back(
+              transport_protocol.first,
+              ApplicationProtocolsMatch(transport_protocol.second.begin(),
+                                        transport_protocol.second.end()));
+        }
+        const int32_t target = match.transport_protocols_.size();
+        match.transport_protocols_.push_back(std::move(transport_protocols));
+
+        if (server_name.first.empty()) {
+          match.catch_all_ = target;
+          continue;
+        }
+        // Wildcard domains, i.e. "*.example.com", are kept on the node of "example.com". Fully
+        // qualified names, i.e. "example.com.", are kept on the node of "example.com".
+        const bool wildcard = absl::StartsWith(server_name.first, "*.");
+        const std::vector<absl::string_view> labels = absl::StrSplit(
+            absl::StripSuffix(absl::string_view(server_name.first).substr(wildcard ? 2 : 0), "."),
+            '.');
+        uint32_t node = 0;
+        for (auto label = labels.rbegin(); label != labels.rend(); ++label) {
+          node = findOrAddChild(match, node, *label);
+        }
+        if (wildcard) {
+          match.nodes_[node].wildcard_ = target;
+        } else {
+          match.nodes_[node].exact_ = target;
+        }
+      }
+      server_names_matches_.push_back(std::move(match));
+    }
+    destination_ports_.emplace_back(port.first, std::make_unique<DestinationIPsTrie>(list, true));
+  }
+}
+
+uint32_t FilterChainIndex::internProtocol(absl::flat_hash_map<std::string, uint32_t>& ids,
+                                          const std::string& protocol) {
+  if (protocol.empty()) {
+    return 0;
+  }
+  return ids.emplace(protocol, ids.size() + 1).first->second;
+}
+
+uint32_t FilterChainIndex::findOrAddChild(ServerNamesMatch& match, uint32_t node,
+                                          absl::string_view label) {
+  auto& children = match.nodes_[node].children_;
+  const auto it = std::lower_bound(children.begin(), children.end(), label,
+                                   [](const std::pair<std::string, uint32_t>& child,
+                                      absl::string_view value) { return child.first < value; });
+  if (it != children.end() && it->first == label) {
+    return it->second;
+  }
+  const uint32_t child = match.nodes_.size();
+  children.emplace(it, std::string(label), child);
+  // This invalidates children, which is no longer used.
+  match.nodes_.emplace_back();
+  return child;
+}
+
+const FilterChainIndex::ServerNamesMatch::Node*
+FilterChainIndex::findChild(const ServerNamesMatch& match, const ServerNamesMatch::Node& node,
+                            absl::string_view label) {
+  const auto it = std::lower_bound(node.children_.begin(), node.children_.end(), label,
+                                   [](const std::pair<std::string, uint32_t>& child,
+                                      absl::string_view value) { return child.first < value; });
+  if (it == node.children_.end() || it->first != label) {
+    return nullptr;
+  }
+  return &match.nodes_[it->second];
+}
+
+const Network::FilterChain*
+FilterChainIndex::findFilterChain(const Network::ConnectionSocket& socket) const {
+  const auto find_port = [this](uint16_t port) -> const DestinationIPsTrie* {
+    const auto it = std::lower_bound(
+        destination_ports_.begin(), destination_ports_.end(), port,
+        [](const std::pair<uint16_t, DestinationIPsTriePtr>& entry, uint16_t value) {
+          return entry.first < value;
+        });
+    return it != destination_ports_.end() && it->first == port ? it->second.get() : nullptr;
+  };
+
+  // Match on destination port (only for IP addresses), then on catch-all port 0.
+  auto address = socket.localAddress();
+  const DestinationIPsTrie* destination_ips_trie = nullptr;
+  if (address->type() == Network::Address::Type::Ip) {
+    destination_ips_trie = find_port(address->ip()->port());
+  }
+  if (destination_ips_trie == nullptr) {
+    destination_ips_trie = find_port(0);
+  }
+  if (destination_ips_trie == nullptr) {
+    return nullptr;
+  }
+
+  // Use invalid IP address (matching only filter chains without IP requirements) for UDS.
+  static const auto& fake_address = Network::Utility::parseInternetAddress("255.255.255.255");
+  if (address->type() != Network::Address::Type::Ip) {
+    address = fake_address;
+  }
+
+  // Match on both: exact IP and wider CIDR ranges using LcTrie.
+  const std::vector<uint32_t> data = destination_ips_trie->getData(address);
+  if (data.empty()) {
+    return nullptr;
+  }
+  ASSERT(data.size() == 1);
+  return findFilterChainForServerName(server_names_matches_[data.back()], socket);
+}
+
+const Network::FilterChain*
+FilterChainIndex::findFilterChainForServerName(const ServerNamesMatch& match,
+                                               const Network::ConnectionSocket& socket) const {
+  // A fully qualified server name, i.e. "www.example.com.", matches as "www.example.com".
+  const absl::string_view server_name = absl::StripSuffix(socket.requestedServerName(), ".");
+
+  // Walk the labels of the server name from the last one. The exact server name wins over the
+  // wildcard domains, i.e. "www.example.com" over "*.example.com" for "www.example.com", and the
+  // longest wildcard domain wins over the others, i.e. "*.example.com" over "*.com".
+  int32_t target = -1;
+  if (!server_name.empty()) {
+    int32_t wildcard = -1;
+    const ServerNamesMatch::Node* node = &match.nodes_[0];
+    absl::string_view remaining = server_name;
+    while (true) {
+      const size_t pos = remaining.rfind('.');
+      node = findChild(match, *node,
+                       pos == absl::string_view::npos ? remaining : remaining.substr(pos + 1));
+      if (node == nullptr) {
+        break;
+      }
+      if (pos == absl::string_view::npos) {
+        target = node->exact_;
+        break;
+      }
+      if (node->wildcard_ != -1) {
+        wildcard = node->wildcard_;
+      }
+      remaining = remaining.substr(0, pos);
+    }
+    if (target == -1) {
+      target = wildcard;
+    }
+  }
+
+  // Match on a filter chain without server name requirements.
+  if (target == -1) {
+    target = match.catch_all_;
+  }
+  if (target == -1) {
+    return nullptr;
+  }
+  return findFilterChainForTransportProtocol(match.transport_protocols_[target], socket);
+}
+
+const Network::FilterChain*
+FilterChainIndex::findFilterChainForTransportProtocol(const TransportProtocolsMatch& match,
+                                                      const Network::ConnectionSocket& socket) const {
+  // Match on exact transport protocol, e.g. "tls".
+  const auto transport_protocol = transport_protocol_ids_.find(socket.detectedTransportProtocol());
+  if (transport_protocol != transport_protocol_ids_.end()) {
+    const ApplicationProtocolsMatch* transport_protocol_match =
+        findProtocol(match, transport_protocol->second);
+    if (transport_protocol_match != nullptr) {
+      return findFilterChainForApplicationProtocols(*transport_protocol_match, socket);
+    }
+  }
+
+  // Match on a filter chain without transport protocol requirements.
+  const ApplicationProtocolsMatch* any_protocol_match = findProtocol(match, 0);
+  if (any_protocol_match != nullptr) {
+    return findFilterChainForApplicationProtocols(*any_protocol_match, socket);
+  }
+
+  return nullptr;
+}
+
+const Network::FilterChain*
+FilterChainIndex::findFilterChainForApplicationProtocols(
+    const ApplicationProtocolsMatch& match, const Network::ConnectionSocket& socket) const {
+  // Match on exact application protocol, e.g. "h2" or "http/1.1".
+  for (const auto& application_protocol : socket.requestedApplicationProtocols()) {
+    const auto id = application_protocol_ids_.find(application_protocol);
+    if (id != application_protocol_ids_.end()) {
+      const SourceTypesArray* application_protocol_match = findProtocol(match, id->second);
+      if (application_protocol_match != nullptr) {
+        return findFilterChainForSourceTypes(*application_protocol_match, socket);
+      }
+    }
+  }
+
+  // Match on a filter chain without application protocol requirements.
+  const SourceTypesArray* any_protocol_match = findProtocol(match, 0);
+  if (any_protocol_match != nullptr) {
+    return findFilterChainForSourceTypes(*any_protocol_match, socket);
+  }
+
+  return nullptr;
+}
+
+const Network::FilterChain*
+FilterChainIndex::findFilterChainForSourceTypes(const SourceTypesArray& source_types,
+                                                const Network::ConnectionSocket& socket) {
+  const auto& filter_chain_local =
+      source_types[envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
+                       FilterChainMatch_ConnectionSourceType_LOCAL];
+
+  const auto& filter_chain_external =
+      source_types[envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
+                       FilterChainMatch_ConnectionSourceType_EXTERNAL];
+
+  // isLocalConnection can be expensive. Call it only if LOCAL or EXTERNAL are defined.
+  const bool is_local_connection = (filter_chain_local || filter_chain_external)
+                                       ? Network::Utility::isLocalConnection(socket)
+                                       : false;
+
+  if (is_local_connection) {
+    if (filter_chain_local) {
+      return filter_chain_local.get();
+    }
+  } else {
+    if (filter_chain_external) {
+      return filter_chain_external.get();
+    }
+  }
+
+  return source_types[envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
+                          FilterChainMatch_ConnectionSourceType_ANY]
+      .get();
+}
+
+} // namespace Server
+} // namespace Envoy
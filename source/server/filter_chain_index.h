@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envoy/api/v2/listener/listener.pb.h"
+#include "envoy/network/filter.h"
+#include "envoy/network/listen_socket.h"
+
+#include "common/network/lc_trie.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Server {
+
+/**
+ * Match rules of a filter chain, as configured by its FilterChainMatch.
+ */
+struct FilterChainMatchRules {
+  uint16_t destination_port_{};
+  // CIDR ranges, in the canonical form of Network::Address::CidrRange::asString().
+  std::vector<std::string> destination_ips_;
+  // Exact server names, and wildcard domains such as "*.example.com". A trailing dot, as in the
+  // fully qualified "example.com.", is ignored.
+  std::vector<std::string> server_names_;
+  std::string transport_protocol_;
+  std::vector<std::string> application_protocols_;
+  envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type_{};
+  Network::FilterChainSharedPtr filter_chain_;
+};
+
+/**
+ * Immutable index of the filter chains of a listener, compiled once per listener update. A socket
+ * is matched in turn on its destination port, destination IP, server name, transport protocol,
+ * application protocols and source type, the most specific rule winning at each step:
+ * - destination ports are kept in a sorted flat array,
+ * - destination IPs in a level compressed trie per port,
+ * - server names in a trie of their labels, from the top level domain down, which matches the
+ *   exact name and the most specific wildcard domain in a single walk,
+ * - transport and application protocols are interned to small integers, so that matching on them
+ *   compares integers rather than strings.
+ */
+class FilterChainIndex {
+public:
+  /**
+   * @param rules supplies the match rules of the filter chains. The rules of two filter chains
+   *              must differ.
+   */
+  explicit FilterChainIndex(const std::vector<FilterChainMatchRules>& rules);
+
+  /**
+   * @param socket supplies the socket to match.
+   * @return const Network::FilterChain* the filter chain matching the socket, or nullptr.
+   */
+  const Network::FilterChain* findFilterChain(const Network::ConnectionSocket& socket) const;
+
+private:
+  typedef std::array<Network::FilterChainSharedPtr, 3> SourceTypesArray;
+  // Interned protocol and the match on the next step, sorted by protocol. Protocol 0 stands for
+  // the rules without protocol requirements.
+  typedef std::vector<std::pair<uint32_t, SourceTypesArray>> ApplicationProtocolsMatch;
+  typedef std::vector<std::pair<uint32_t, ApplicationProtocolsMatch>> TransportProtocolsMatch;
+
+  /**
+   * Trie of the server names of a destination IP match. Node 0 is the root, each node of depth N
+   * stands for the last N labels of a server name.
+   */
+  struct ServerNamesMatch {
+    struct Node {
+      // Child nodes by label, sorted by label.
+      std::vector<std::pair<std::string, uint32_t>> children_;
+      // Transport protocols matches of the exact server name of the node, and of the wildcard
+      // domain of the node, or -1.
+      int32_t exact_{-1};
+      int32_t wildcard_{-1};
+    };
+
+    std::vector<Node> nodes_{1};
+    std::vector<TransportProtocolsMatch> transport_protocols_;
+    // Transport protocols match of the rules without server name requirements, or -1.
+    int32_t catch_all_{-1};
+  };
+
+  typedef Network::LcTrie::LcTrie<uint32_t> DestinationIPsTrie;
+  typedef std::unique_ptr<DestinationIPsTrie> DestinationIPsTriePtr;
+
+  static uint32_t internProtocol(absl::flat_hash_map<std::string, uint32_t>& ids,
+                                 const std::string& protocol);
+  static uint32_t findOrAddChild(ServerNamesMatch& match, uint32_t node, absl::string_view label);
+  static const ServerNamesMatch::Node* findChild(const ServerNamesMatch& match,
+                                                 const ServerNamesMatch::Node& node,
+                                                 absl::string_view label);
+
+  const Network::FilterChain* findFilterChainForServerName(const ServerNamesMatch& match,
+                                                           const Network::ConnectionSocket& socket)
+      const;
+  const Network::FilterChain*
+  findFilterChainForTransportProtocol(const TransportProtocolsMatch& match,
+                                      const Network::ConnectionSocket& socket) const;
+  const Network::FilterChain*
+  findFilterChainForApplicationProtocols(const ApplicationProtocolsMatch& match,
+                                         const Network::ConnectionSocket& socket) const;
+  static const Network::FilterChain*
+  findFilterChainForSourceTypes(const SourceTypesArray& source_types,
+                                const Network::ConnectionSocket& socket);
+
+  // Destination ports and their destination IPs trie, sorted by port.
+  std::vector<std::pair<uint16_t, DestinationIPsTriePtr>> destination_ports_;
+  // Server names matches, indexed by the data of the destination IPs tries.
+  std::vector<ServerNamesMatch> server_names_matches_;
+  // Interned transport and application protocols. Protocols start at 1.
+  absl::flat_hash_map<std::string, uint32_t> transport_protocol_ids_;
+  absl::flat_hash_map<std::string, uint32_t> application_protocol_ids_;
+};
+
+typedef std::unique_ptr<const FilterChainIndex> FilterChainIndexConstPtr;
+
+} // namespace Server
+} // namespace Envoy
@@ -5,6 +5,7 @@
 #include <sys/types.h>
 #include <sys/un.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -19,32 +20,30 @@
 #include "common/common/lock_guard.h"
 #include "common/common/utility.h"
 #include "common/network/utility.h"
-#include "common/stats/raw_stat_data.h"
+#include "common/stats/segmented_raw_stat_data.h"
 #include "common/stats/stats_options_impl.h"
 
 #include "absl/strings/string_view.h"
+#include "openssl/mem.h"
 
 namespace Envoy {
 namespace Server {
 
 // Increment this whenever there is a shared memory / RPC change that will prevent a hot restart
 // from working. Operations code can then cope with this and do a full restart.
-const uint64_t SharedMemory::VERSION = 10;
+const uint64_t SharedMemory::VERSION = 13;
 
-static BlockMemoryHashSetOptions blockMemHashOptions(uint64_t max_stats) {
-  BlockMemoryHashSetOptions hash_set_options;
-  hash_set_options.capacity = max_stats;
+constexpr uint32_t HotRestartImpl::MaxSessionTicketKeys;
 
-  // https://stackoverflow.com/questions/3980117/hash-table-why-size-should-be-prime
-  hash_set_options.num_slots = Primes::findPrimeLargerThan(hash_set_options.capacity / 2);
-  return hash_set_options;
+std::string SharedMemory::statsSegmentName(uint64_t base_id, uint32_t index) {
+  return fmt::format("/envoy_shared_memory_{}_stats_{}", base_id, index);
 }
 
-SharedMemory& SharedMemory::initialize(uint64_t stats_set_size, Options& options) {
+SharedMemory& SharedMemory::initialize(Options& options) {
   Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
 
-  const uint64_t entry_size = Stats::RawStatData::structSizeWithOptions(options.statsOptions());
-  const uint64_t total_size = sizeof(SharedMemory) + stats_set_size;
+  const uint64_t max_name_length = options.statsOptions().maxNameLength();
+  const uint64_t total_size = sizeof(SharedMemory);
 
   int flags = O_RDWR;
   const std::string shmem_name = fmt::format("/envoy_shared_memory_{}", options.baseId());
@@ -52,8 +51,15 @@ SharedMemory& SharedMemory::initialize(uint64_t stats_set_size, Options& options
     flags |= O_CREAT | O_EXCL;
 
     // If we are meant to be first, attempt to unlink a previous shared memory instance. If this
-    // is a clean restart this should then allow the shm_open() call below to succeed.
+    // is a clean restart this should then allow the shm_open() call below to succeed. Stats
+    // segments are created in order, so the previous instance's segments end at the first one
+    // that does not exist.
     os_sys_calls.shmUnlink(shmem_name.c_str());
+    for (uint32_t i = 0; i < Stats::SegmentedRawStatDataControl::MaxSegments; ++i) {
+      if (os_sys_calls.shmUnlink(statsSegmentName(options.baseId(), i).c_str()).rc_ == -1) {
+        break;
+      }
+    }
   }
 
   const Api::SysCallIntResult result =
@@ -77,8 +83,7 @@ SharedMemory& SharedMemory::initialize(uint64_t stats_set_size, Options& options
   if (options.restartEpoch() == 0) {
     shmem->size_ = total_size;
     shmem->version_ = VERSION;
-    shmem->max_stats_ = options.maxStats();
-    shmem->entry_size_ = entry_size;
+    shmem->max_name_length_ = max_name_length;
     shmem->initializeMutex(shmem->log_lock_);
     shmem->initializeMutex(shmem->access_log_lock_);
     shmem->initializeMutex(shmem->stat_lock_);
@@ -86,15 +91,9 @@ SharedMemory& SharedMemory::initialize(uint64_t stats_set_size, Options& options
   } else {
     RELEASE_ASSERT(shmem->size_ == total_size, "");
     RELEASE_ASSERT(shmem->version_ == VERSION, "");
-    RELEASE_ASSERT(shmem->max_stats_ == options.maxStats(), "");
-    RELEASE_ASSERT(shmem->entry_size_ == entry_size, "");
+    RELEASE_ASSERT(shmem->max_name_length_ == max_name_length, "");
   }
 
-  // Stats::RawStatData must be naturally aligned for atomics to work properly.
-  RELEASE_ASSERT(
-      (reinterpret_cast<uintptr_t>(shmem->stats_set_data_) % alignof(Stats::RawStatDataSet)) == 0,
-      "");
-
   // Here we catch the case where a new Envoy starts up when the current Envoy has not yet fully
   // initialized. The startup logic is quite complicated, and it's not worth trying to handle this
   // in a finer way. This will cause the startup to fail with an error code early, without
@@ -116,28 +115,19 @@ void SharedMemory::initializeMutex(pthread_mutex_t& mutex) {
   pthread_mutex_init(&mutex, &attribute);
 }
 
-std::string SharedMemory::version(uint64_t max_num_stats,
-                                  const Stats::StatsOptions& stats_options) {
-  return fmt::format("{}.{}.{}.{}", VERSION, sizeof(SharedMemory), max_num_stats,
-                     stats_options.maxNameLength());
+std::string SharedMemory::version(const Stats::StatsOptions& stats_options) {
+  return fmt::format("{}.{}.{}", VERSION, sizeof(SharedMemory), stats_options.maxNameLength());
 }
 
 HotRestartImpl::HotRestartImpl(Options& options)
-    : options_(options), stats_set_options_(blockMemHashOptions(options.maxStats())),
-      shmem_(SharedMemory::initialize(
-          Stats::RawStatDataSet::numBytes(stats_set_options_, options_.statsOptions()), options_)),
+    : options_(options), shmem_(SharedMemory::initialize(options_)),
       log_lock_(shmem_.log_lock_), access_log_lock_(shmem_.access_log_lock_),
       stat_lock_(shmem_.stat_lock_), init_lock_(shmem_.init_lock_) {
-  {
-    // We must hold the stat lock when attaching to an existing memory segment
-    // because it might be actively written to while we sanityCheck it.
-    Thread::LockGuard lock(stat_lock_);
-    stats_set_ =
-        std::make_unique<Stats::RawStatDataSet>(stats_set_options_, options.restartEpoch() == 0,
-                                                shmem_.stats_set_data_, options_.statsOptions());
-  }
-  stats_allocator_ = std::make_unique<Stats::RawStatDataAllocator>(stat_lock_, *stats_set_,
-                                                                   options_.statsOptions());
+  // The allocator takes the stat lock when attaching to the existing stats segments, because they
+  // might be actively written to while it indexes them.
+  stats_allocator_ = std::make_unique<Stats::SegmentedRawStatDataAllocator>(
+      stat_lock_, shmem_.stats_control_, *this, options.restartEpoch() == 0, options.maxStats(),
+      options_.statsOptions());
   my_domain_socket_ = bindDomainSocket(options.restartEpoch());
   child_address_ = createDomainSocketAddress((options.restartEpoch() + 1));
   initDomainSocketAddress(&parent_address_);
@@ -151,6 +141,39 @@ HotRestartImpl::HotRestartImpl(Options& options)
   RELEASE_ASSERT(rc != -1, "");
 }
 
+uint8_t* HotRestartImpl::mapSegment(uint32_t index, uint64_t size, bool create) {
+  Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
+  const std::string name = SharedMemory::statsSegmentName(options_.baseId(), index);
+  const int flags = create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR;
+  const Api::SysCallIntResult result = os_sys_calls.shmOpen(name.c_str(), flags, S_IRUSR | S_IWUSR);
+  if (result.rc_ == -1) {
+    ENVOY_LOG(warn, "cannot open stats shared memory segment {}: {}", name,
+              strerror(result.errno_));
+    return nullptr;
+  }
+
+  // ftruncate() zero-fills the new segment.
+  if (create) {
+    const Api::SysCallIntResult truncate_result = os_sys_calls.ftruncate(result.rc_, size);
+    if (truncate_result.rc_ == -1) {
+      ENVOY_LOG(warn, "cannot size stats shared memory segment {}: {}", name,
+                strerror(truncate_result.errno_));
+      os_sys_calls.close(result.rc_);
+      return nullptr;
+    }
+  }
+
+  const Api::SysCallPtrResult mmap_result =
+      os_sys_calls.mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, result.rc_, 0);
+  os_sys_calls.close(result.rc_);
+  if (mmap_result.rc_ == MAP_FAILED) {
+    ENVOY_LOG(warn, "cannot map stats shared memory segment {}: {}", name,
+              strerror(mmap_result.errno_));
+    return nullptr;
+  }
+  return reinterpret_cast<uint8_t*>(mmap_result.rc_);
+}
+
 int HotRestartImpl::bindDomainSocket(uint64_t id) {
   Api::OsSysCalls& os_sys_calls = Api::OsSysCallsSingleton::get();
   // This actually creates the socket and binds it. We use the socket in datagram mode so we can
@@ -199,7 +222,8 @@ void HotRestartImpl::drainParentListeners() {
   shmem_.flags_ &= ~SharedMemory::Flags::INITIALIZING;
 }
 
-int HotRestartImpl::duplicateParentListenSocket(const std::string& address) {
+int HotRestartImpl::duplicateParentListenSocket(const std::string& address,
+                                                uint32_t worker_index) {
   if (options_.restartEpoch() == 0 || parent_terminated_) {
     return -1;
   }
@@ -207,6 +231,7 @@ int HotRestartImpl::duplicateParentListenSocket(const std::string& address) {
   RpcGetListenSocketRequest rpc;
   ASSERT(address.length() < sizeof(rpc.address_));
   StringUtil::strlcpy(rpc.address_, address.c_str(), sizeof(rpc.address_));
+  rpc.worker_index_ = worker_index;
   sendMessage(parent_address_, rpc);
   RpcGetListenSocketReply* reply =
       receiveTypedRpc<RpcGetListenSocketReply, RpcMessageType::GetListenSocketReply>();
@@ -335,11 +360,9 @@ void HotRestartImpl::onGetListenSocket(RpcGetListenSocketRequest& rpc) {
 
   Network::Address::InstanceConstSharedPtr addr =
       Network::Utility::resolveUrl(std::string(rpc.address_));
-  for (const auto& listener : server_->listenerManager().listeners()) {
-    if (*listener.get().socket().localAddress() == *addr) {
-      reply.fd_ = listener.get().socket().fd();
-      break;
-    }
+  Network::Socket* socket = server_->listenerManager().listenSocket(*addr, rpc.worker_index_);
+  if (socket != nullptr) {
+    reply.fd_ = socket->fd();
   }
 
   if (reply.fd_ == -1) {
@@ -385,7 +408,16 @@ void HotRestartImpl::onSocketEvent() {
       server_->shutdownAdmin();
       RpcShutdownAdminReply rpc;
       rpc.original_start_time_ = server_->startTimeFirstEpoch();
+      // Hand the session ticket keys over, so that the child accepts the tickets issued by this
+      // process.
+      const std::vector<Ssl::ServerContextConfig::SessionTicketKey> keys =
+          server_->sslContextManager().sessionTicketKeys();
+      const uint32_t num_keys = std::min<size_t>(keys.size(), MaxSessionTicketKeys);
+      std::copy_n(keys.begin(), num_keys, rpc.session_ticket_keys_);
+      rpc.num_session_ticket_keys_ = num_keys;
       sendMessage(child_address_, rpc);
+      // The keys are not needed on the stack anymore.
+      OPENSSL_cleanse(rpc.session_ticket_keys_, sizeof(rpc.session_ticket_keys_));
       break;
     }
 
@@ -438,6 +470,11 @@ void HotRestartImpl::shutdownParentAdmin(ShutdownParentAdminInfo& info) {
   RpcShutdownAdminReply* reply =
       receiveTypedRpc<RpcShutdownAdminReply, RpcMessageType::ShutdownAdminReply>();
   info.original_start_time_ = reply->original_start_time_;
+  const uint32_t num_keys = std::min<uint32_t>(
+      static_cast<uint32_t>(reply->num_session_ticket_keys_), MaxSessionTicketKeys);
+  info.session_ticket_keys_.assign(reply->session_ticket_keys_,
+                                   reply->session_ticket_keys_ + num_keys);
+  OPENSSL_cleanse(reply->session_ticket_keys_, sizeof(reply->session_ticket_keys_));
 }
 
 void HotRestartImpl::terminateParent() {
@@ -452,32 +489,18 @@ void HotRestartImpl::terminateParent() {
 
 void HotRestartImpl::shutdown() { socket_event_.reset(); }
 
-std::string HotRestartImpl::version() {
-  Thread::LockGuard lock(stat_lock_);
-  return versionHelper(shmem_.maxStats(), options_.statsOptions(), *stats_set_);
-}
+std::string HotRestartImpl::version() { return versionHelper(options_.statsOptions()); }
 
-// Called from envoy --hot-restart-version -- needs to instantiate a RawStatDataSet so it
-// can generate the version string.
-std::string HotRestartImpl::hotRestartVersion(uint64_t max_num_stats, uint64_t max_stat_name_len) {
+// Called from envoy --hot-restart-version.
+std::string HotRestartImpl::hotRestartVersion(uint64_t, uint64_t max_stat_name_len) {
   Stats::StatsOptionsImpl stats_options;
   stats_options.max_obj_name_length_ = max_stat_name_len - stats_options.maxStatSuffixLength();
-
-  const BlockMemoryHashSetOptions hash_set_options = blockMemHashOptions(max_num_stats);
-  const uint64_t bytes = Stats::RawStatDataSet::numBytes(hash_set_options, stats_options);
-  std::unique_ptr<uint8_t[]> mem_buffer_for_dry_run_(new uint8_t[bytes]);
-
-  Stats::RawStatDataSet stats_set(hash_set_options, true /* init */, mem_buffer_for_dry_run_.get(),
-                                  stats_options);
-
-  return versionHelper(max_num_stats, stats_options, stats_set);
+  return versionHelper(stats_options);
 }
 
-std::string HotRestartImpl::versionHelper(uint64_t max_num_stats,
-                                          const Stats::StatsOptions& stats_options,
-                                          Stats::RawStatDataSet& stats_set) {
-  return SharedMemory::version(max_num_stats, stats_options) + "." +
-         stats_set.version(stats_options);
+std::string HotRestartImpl::versionHelper(const Stats::StatsOptions& stats_options) {
+  return SharedMemory::version(stats_options) + "." +
+         Stats::SegmentedRawStatDataAllocator::version();
 }
 
 } // namespace Server
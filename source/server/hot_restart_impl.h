@@ -14,32 +14,36 @@
 #include "envoy/stats/stats_options.h"
 
 #include "common/common/assert.h"
-#include "common/stats/raw_stat_data.h"
+#include "common/stats/segmented_raw_stat_data.h"
 
 namespace Envoy {
 namespace Server {
 
 /**
  * Shared memory segment. This structure is laid directly into shared memory and is used amongst
- * all running envoy processes.
+ * all running envoy processes. The stats themselves are kept in additional segments which are
+ * mapped as needed, see Stats::SegmentedRawStatDataAllocator.
  */
 class SharedMemory {
 public:
-  static void configure(uint64_t max_num_stats, uint64_t max_stat_name_len);
-  static std::string version(uint64_t max_num_stats, const Stats::StatsOptions& stats_options);
+  static std::string version(const Stats::StatsOptions& stats_options);
+
+  /**
+   * @return std::string the name of a segment holding stats.
+   * @param base_id supplies the base ID of the envoy processes sharing the segment.
+   * @param index supplies the index of the segment.
+   */
+  static std::string statsSegmentName(uint64_t base_id, uint32_t index);
 
   // Made public for testing.
   static const uint64_t VERSION;
 
-  int64_t maxStats() const { return max_stats_; }
-
 private:
   struct Flags {
     static const uint64_t INITIALIZING = 0x1;
   };
 
-  // Due to the flexible-array-length of stats_set_data_, c-style allocation
-  // and initialization are necessary.
+  // The structure is only ever mapped from shared memory.
   SharedMemory() = delete;
   ~SharedMemory() = delete;
 
@@ -47,7 +51,7 @@ private:
    * Initialize the shared memory segment, depending on whether we should be the first running
    * envoy, or a host restarted envoy process.
    */
-  static SharedMemory& initialize(uint64_t stats_set_size, Options& options);
+  static SharedMemory& initialize(Options& options);
 
   /**
    * Initialize a pthread mutex for process shared locking.
@@ -56,14 +60,13 @@ private:
 
   uint64_t size_;
   uint64_t version_;
-  uint64_t max_stats_;
-  uint64_t entry_size_;
+  uint64_t max_name_length_;
   std::atomic<uint64_t> flags_;
   pthread_mutex_t log_lock_;
   pthread_mutex_t access_log_lock_;
   pthread_mutex_t stat_lock_;
   pthread_mutex_t init_lock_;
-  alignas(BlockMemoryHashSet<Stats::RawStatData>) uint8_t stats_set_data_[];
+  Stats::SegmentedRawStatDataControl stats_control_;
 
   friend class HotRestartImpl;
 };
@@ -112,13 +115,15 @@ private:
 /**
  * Implementation of HotRestart built for Linux.
  */
-class HotRestartImpl : public HotRestart, Logger::Loggable<Logger::Id::main> {
+class HotRestartImpl : public HotRestart,
+                       public Stats::RawStatDataSegmentMapper,
+                       Logger::Loggable<Logger::Id::main> {
 public:
   HotRestartImpl(Options& options);
 
   // Server::HotRestart
   void drainParentListeners() override;
-  int duplicateParentListenSocket(const std::string& address) override;
+  int duplicateParentListenSocket(const std::string& address, uint32_t worker_index) override;
   void getParentStats(GetParentStatsInfo& info) override;
   void initialize(Event::Dispatcher& dispatcher, Server::Instance& server) override;
   void shutdownParentAdmin(ShutdownParentAdminInfo& info) override;
@@ -127,11 +132,15 @@ public:
   std::string version() override;
   Thread::BasicLockable& logLock() override { return log_lock_; }
   Thread::BasicLockable& accessLogLock() override { return access_log_lock_; }
-  Stats::RawStatDataAllocator& statsAllocator() override { return *stats_allocator_; }
+  Stats::SegmentedRawStatDataAllocator& statsAllocator() override { return *stats_allocator_; }
+
+  // Stats::RawStatDataSegmentMapper
+  uint8_t* mapSegment(uint32_t index, uint64_t size, bool create) override;
 
   /**
    * envoy --hot_restart_version doesn't initialize Envoy, but computes the version string
-   * based on the configured options.
+   * based on the configured options. The maximum number of stats only bounds the allocations and
+   * does not affect the shared memory layout, so it is not part of the version.
    */
   static std::string hotRestartVersion(uint64_t max_num_stats, uint64_t max_stat_name_len);
 
@@ -162,6 +171,7 @@ private:
                       : RpcBase(RpcMessageType::GetListenSocketRequest, sizeof(*this)) {}
 
                   char address_[256]{0};
+                  uint32_t worker_index_{0};
                 });
 
   PACKED_STRUCT(struct RpcGetListenSocketReply
@@ -172,12 +182,18 @@ private:
                   int fd_{0};
                 });
 
+  // Maximum number of shared session ticket keys handed over to the child.
+  static constexpr uint32_t MaxSessionTicketKeys = 4;
+
   PACKED_STRUCT(struct RpcShutdownAdminReply
                 : public RpcBase {
                   RpcShutdownAdminReply()
                       : RpcBase(RpcMessageType::ShutdownAdminReply, sizeof(*this)) {}
 
                   uint64_t original_start_time_{0};
+                  uint32_t num_session_ticket_keys_{0};
+                  Ssl::ServerContextConfig::SessionTicketKey
+                      session_ticket_keys_[MaxSessionTicketKeys]{};
                 });
 
   PACKED_STRUCT(struct RpcGetStatsReply
@@ -203,14 +219,11 @@ private:
   void onSocketEvent();
   RpcBase* receiveRpc(bool block);
   void sendMessage(sockaddr_un& address, RpcBase& rpc);
-  static std::string versionHelper(uint64_t max_num_stats, const Stats::StatsOptions& stats_options,
-                                   Stats::RawStatDataSet& stats_set);
+  static std::string versionHelper(const Stats::StatsOptions& stats_options);
 
   Options& options_;
-  BlockMemoryHashSetOptions stats_set_options_;
   SharedMemory& shmem_;
-  std::unique_ptr<Stats::RawStatDataSet> stats_set_ GUARDED_BY(stat_lock_);
-  std::unique_ptr<Stats::RawStatDataAllocator> stats_allocator_;
+  std::unique_ptr<Stats::SegmentedRawStatDataAllocator> stats_allocator_;
   ProcessSharedMutex log_lock_;
   ProcessSharedMutex access_log_lock_;
   ProcessSharedMutex stat_lock_;
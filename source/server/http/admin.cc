@@ -13,6 +13,7 @@
 #include "envoy/admin/v2alpha/certs.pb.h"
 #include "envoy/admin/v2alpha/clusters.pb.h"
 #include "envoy/admin/v2alpha/config_dump.pb.h"
+#include "envoy/admin/v2alpha/dispatchers.pb.h"
 #include "envoy/admin/v2alpha/memory.pb.h"
 #include "envoy/admin/v2alpha/mutex_stats.pb.h"
 #include "envoy/admin/v2alpha/server_info.pb.h"
@@ -828,6 +829,38 @@ Http::Code AdminImpl::handlerCerts(absl::string_view, Http::HeaderMap& response_
   return Http::Code::OK;
 }
 
+Http::Code AdminImpl::handlerDispatchers(absl::string_view, Http::HeaderMap& response_headers,
+                                         Buffer::Instance& response, AdminStream&) {
+  response_headers.insertContentType().value().setReference(
+      Http::Headers::get().ContentTypeValues.Json);
+  envoy::admin::v2alpha::Dispatchers dispatchers;
+  const auto add_dispatcher = [&dispatchers](const std::string& name,
+                                             Event::Dispatcher& dispatcher) {
+    envoy::admin::v2alpha::Dispatcher& dispatcher_proto = *dispatchers.add_dispatchers();
+    dispatcher_proto.set_name(name);
+    for (const Event::SlowCallback& slow_callback : dispatcher.recentSlowCallbacks()) {
+      envoy::admin::v2alpha::SlowCallback& slow_callback_proto =
+          *dispatcher_proto.add_slow_callbacks();
+      slow_callback_proto.set_kind(slow_callback.kind_);
+      slow_callback_proto.set_callback(slow_callback.description_);
+      slow_callback_proto.mutable_duration()->MergeFrom(
+          Protobuf::util::TimeUtil::MicrosecondsToDuration(slow_callback.duration_.count()));
+      const auto time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+          slow_callback.time_.time_since_epoch());
+      slow_callback_proto.mutable_time()->MergeFrom(
+          Protobuf::util::TimeUtil::MicrosecondsToTimestamp(time_us.count()));
+    }
+  };
+
+  add_dispatcher("main_thread", server_.dispatcher());
+  uint32_t worker_index = 0;
+  for (Event::Dispatcher& dispatcher : server_.listenerManager().workerDispatchers()) {
+    add_dispatcher(fmt::format("worker_{}", worker_index++), dispatcher);
+  }
+  response.add(MessageUtil::getJsonStringFromMessage(dispatchers, true, true)); // pretty-print
+  return Http::Code::OK;
+}
+
 Http::Code AdminImpl::handlerRuntime(absl::string_view url, Http::HeaderMap& response_headers,
                                      Buffer::Instance& response, AdminStream&) {
   const Http::Utility::QueryParams params = Http::Utility::parseQueryString(url);
@@ -993,6 +1026,8 @@ AdminImpl::AdminImpl(const std::string& profile_path, Server::Instance& server)
            MAKE_ADMIN_HANDLER(handlerContention), false, false},
           {"/cpuprofiler", "enable/disable the CPU profiler",
            MAKE_ADMIN_HANDLER(handlerCpuProfiler), false, true},
+          {"/dispatchers", "print recent slow callbacks of the event loops (if enabled)",
+           MAKE_ADMIN_HANDLER(handlerDispatchers), false, false},
           {"/healthcheck/fail", "cause the server to fail health checks",
            MAKE_ADMIN_HANDLER(handlerHealthcheckFail), false, true},
           {"/healthcheck/ok", "cause the server to pass health checks",
@@ -10,6 +10,7 @@
 #include "common/common/empty_string.h"
 #include "common/common/fmt.h"
 #include "common/config/utility.h"
+#include "common/network/connection_balancer_impl.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/network/resolver_impl.h"
 #include "common/network/socket_option_factory.h"
@@ -85,15 +86,16 @@ ProdListenerComponentFactory::createListenerFilterFactoryList_(
 Network::SocketSharedPtr
 ProdListenerComponentFactory::createListenSocket(Network::Address::InstanceConstSharedPtr address,
                                                  const Network::Socket::OptionsSharedPtr& options,
-                                                 bool bind_to_port) {
+                                                 bool bind_to_port, uint32_t worker_index) {
   ASSERT(address->type() == Network::Address::Type::Ip ||
          address->type() == Network::Address::Type::Pipe);
 
-  // For each listener config we share a single socket among all threaded listeners.
-  // First we try to get the socket from our parent if applicable.
+  // For each listener config we share a single socket among all threaded listeners, unless the
+  // listener uses SO_REUSEPORT in which case this is called once per worker. First we try to get
+  // the socket from our parent if applicable.
   if (address->type() == Network::Address::Type::Pipe) {
     const std::string addr = fmt::format("unix://{}", address->asString());
-    const int fd = server_.hotRestart().duplicateParentListenSocket(addr);
+    const int fd = server_.hotRestart().duplicateParentListenSocket(addr, worker_index);
     if (fd != -1) {
       ENVOY_LOG(debug, "obtained socket for address {} from parent", addr);
       return std::make_shared<Network::UdsListenSocket>(fd, address);
@@ -102,7 +104,7 @@ ProdListenerComponentFactory::createListenSocket(Network::Address::InstanceConst
   }
 
   const std::string addr = fmt::format("tcp://{}", address->asString());
-  const int fd = server_.hotRestart().duplicateParentListenSocket(addr);
+  const int fd = server_.hotRestart().duplicateParentListenSocket(addr, worker_index);
   if (fd != -1) {
     ENVOY_LOG(debug, "obtained socket for address {} from parent", addr);
     return std::make_shared<Network::TcpListenSocket>(fd, address, options);
@@ -123,6 +125,7 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, const std::st
       listener_scope_(
           parent_.server_.stats().createScope(fmt::format("listener.{}.", address_->asString()))),
       bind_to_port_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.deprecated_v1(), bind_to_port, true)),
+      reuse_port_(config.reuse_port()),
       hand_off_restored_destination_connections_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, use_original_dst, false)),
       per_connection_buffer_limit_bytes_(
@@ -145,6 +148,16 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, const std::st
     addListenSocketOptions(Network::SocketOptionFactory::buildTcpFastOpenOptions(
         config.tcp_fast_open_queue_length().value()));
   }
+  if (reuse_port_) {
+    addListenSocketOptions(Network::SocketOptionFactory::buildReusePortOptions());
+  }
+  if (config.has_connection_balance_config()) {
+    // There is only the exact balancer for now, which the config validation requires.
+    ASSERT(config.connection_balance_config().has_exact_balance());
+    connection_balancer_ = std::make_unique<Network::ExactConnectionBalancerImpl>();
+  } else {
+    connection_balancer_ = std::make_unique<Network::NopConnectionBalancerImpl>();
+  }
 
   if (config.socket_options().size() > 0) {
     addListenSocketOptions(
@@ -178,15 +191,23 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, const std::st
   bool need_tls_inspector = false;
   std::unordered_set<envoy::api::v2::listener::FilterChainMatch, MessageUtil, MessageUtil>
       filter_chains;
+  std::vector<FilterChainMatchRules> filter_chain_rules;
 
   for (const auto& filter_chain : config.filter_chains()) {
     const auto& filter_chain_match = filter_chain.filter_chain_match();
-    if (filter_chains.find(filter_chain_match) != filter_chains.end()) {
+    // A trailing dot is ignored in server names, so "example.com." matches as "example.com".
+    envoy::api::v2::listener::FilterChainMatch normalized_match = filter_chain_match;
+    for (std::string& server_name : *normalized_match.mutable_server_names()) {
+      if (absl::EndsWith(server_name, ".")) {
+        server_name.pop_back();
+      }
+    }
+    if (filter_chains.find(normalized_match) != filter_chains.end()) {
       throw EnvoyException(fmt::format("error adding listener '{}': multiple filter chains with "
                                        "the same matching rules are defined",
                                        address_->asString()));
     }
-    filter_chains.insert(filter_chain_match);
+    filter_chains.insert(normalized_match);
 
     // If the cluster doesn't have transport socket configured, then use the default "raw_buffer"
     // transport socket or BoringSSL-based "tls" transport socket if TLS settings are configured.
@@ -235,20 +256,25 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, const std::st
         parent_.server_.localInfo(), parent_.server_.dispatcher(), parent_.server_.random(),
         parent_.server_.stats());
     factory_context.setInitManager(initManager());
-    addFilterChain(
-        PROTOBUF_GET_WRAPPED_OR_DEFAULT(filter_chain_match, destination_port, 0), destination_ips,
-        server_names, filter_chain_match.transport_protocol(), application_protocols,
-        filter_chain_match.source_type(),
+    FilterChainMatchRules rules;
+    rules.destination_port_ =
+        PROTOBUF_GET_WRAPPED_OR_DEFAULT(filter_chain_match, destination_port, 0);
+    rules.destination_ips_ = destination_ips;
+    rules.server_names_ = server_names;
+    rules.transport_protocol_ = filter_chain_match.transport_protocol();
+    rules.application_protocols_ = application_protocols;
+    rules.source_type_ = filter_chain_match.source_type();
+    rules.filter_chain_ = std::make_shared<FilterChainImpl>(
         config_factory.createTransportSocketFactory(*message, factory_context, server_names),
         parent_.factory_.createNetworkFilterFactoryList(filter_chain.filters(), *this));
+    filter_chain_rules.push_back(std::move(rules));
 
     need_tls_inspector |= filter_chain_match.transport_protocol() == "tls" ||
                           (filter_chain_match.transport_protocol().empty() &&
                            (!server_names.empty() || !application_protocols.empty()));
   }
 
-  // Convert DestinationIPsMap to DestinationIPsTrie for faster lookups.
-  convertDestinationIPsMapToTrie();
+  filter_chain_index_ = std::make_unique<FilterChainIndex>(filter_chain_rules);
 
   // Automatically inject TLS Inspector if it wasn't configured explicitly and it's needed.
   if (need_tls_inspector) {
@@ -282,278 +308,16 @@ ListenerImpl::~ListenerImpl() {
   // active. This is done here explicitly by setting a boolean and then clearing the factory
   // vector for clarity.
   initialize_canceled_ = true;
-  destination_ports_map_.clear();
+  filter_chain_index_.reset();
 }
 
 bool ListenerImpl::isWildcardServerName(const std::string& name) {
   return absl::StartsWith(name, "*.");
 }
 
-void ListenerImpl::addFilterChain(
-    uint16_t destination_port, const std::vector<std::string>& destination_ips,
-    const std::vector<std::string>& server_names, const std::string& transport_protocol,
-    const std::vector<std::string>& application_protocols,
-    const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-    Network::TransportSocketFactoryPtr&& transport_socket_factory,
-    std::vector<Network::FilterFactoryCb> filters_factory) {
-  const auto filter_chain = std::make_shared<FilterChainImpl>(std::move(transport_socket_factory),
-                                                              std::move(filters_factory));
-  addFilterChainForDestinationPorts(destination_ports_map_, destination_port, destination_ips,
-                                    server_names, transport_protocol, application_protocols,
-                                    source_type, filter_chain);
-}
-
-void ListenerImpl::addFilterChainForDestinationPorts(
-    DestinationPortsMap& destination_ports_map, uint16_t destination_port,
-    const std::vector<std::string>& destination_ips, const std::vector<std::string>& server_names,
-    const std::string& transport_protocol, const std::vector<std::string>& application_protocols,
-    const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-    const Network::FilterChainSharedPtr& filter_chain) {
-  if (destination_ports_map.find(destination_port) == destination_ports_map.end()) {
-    destination_ports_map[destination_port] =
-        std::make_pair<DestinationIPsMap, DestinationIPsTriePtr>(DestinationIPsMap{}, nullptr);
-  }
-  addFilterChainForDestinationIPs(destination_ports_map[destination_port].first, destination_ips,
-                                  server_names, transport_protocol, application_protocols,
-                                  source_type, filter_chain);
-}
-
-void ListenerImpl::addFilterChainForDestinationIPs(
-    DestinationIPsMap& destination_ips_map, const std::vector<std::string>& destination_ips,
-    const std::vector<std::string>& server_names, const std::string& transport_protocol,
-    const std::vector<std::string>& application_protocols,
-    const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-    const Network::FilterChainSharedPtr& filter_chain) {
-  if (destination_ips.empty()) {
-    addFilterChainForServerNames(destination_ips_map[EMPTY_STRING], server_names,
-                                 transport_protocol, application_protocols, source_type,
-                                 filter_chain);
-  } else {
-    for (const auto& destination_ip : destination_ips) {
-      addFilterChainForServerNames(destination_ips_map[destination_ip], server_names,
-                                   transport_protocol, application_protocols, source_type,
-                                   filter_chain);
-    }
-  }
-}
-
-void ListenerImpl::addFilterChainForServerNames(
-    ServerNamesMap& server_names_map, const std::vector<std::string>& server_names,
-    const std::string& transport_protocol, const std::vector<std::string>& application_protocols,
-    const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-    const Network::FilterChainSharedPtr& filter_chain) {
-  if (server_names.empty()) {
-    addFilterChainForApplicationProtocols(server_names_map[EMPTY_STRING][transport_protocol],
-                                          application_protocols, source_type, filter_chain);
-  } else {
-    for (const auto& server_name : server_names) {
-      if (isWildcardServerName(server_name)) {
-        // Add mapping for the wildcard domain, i.e. ".example.com" for "*.example.com".
-        addFilterChainForApplicationProtocols(
-            server_names_map[server_name.substr(1)][transport_protocol], application_protocols,
-            source_type, filter_chain);
-      } else {
-        addFilterChainForApplicationProtocols(server_names_map[server_name][transport_protocol],
-                                              application_protocols, source_type, filter_chain);
-      }
-    }
-  }
-}
-
-void ListenerImpl::addFilterChainForApplicationProtocols(
-    ApplicationProtocolsMap& application_protocols_map,
-    const std::vector<std::string>& application_protocols,
-    const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-    const Network::FilterChainSharedPtr& filter_chain) {
-  if (application_protocols.empty()) {
-    addFilterChainForSourceTypes(application_protocols_map[EMPTY_STRING], source_type,
-                                 filter_chain);
-  } else {
-    for (const auto& application_protocol : application_protocols) {
-      addFilterChainForSourceTypes(application_protocols_map[application_protocol], source_type,
-                                   filter_chain);
-    }
-  }
-}
-
-void ListenerImpl::addFilterChainForSourceTypes(
-    SourceTypesArray& source_types_array,
-    const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-    const Network::FilterChainSharedPtr& filter_chain) {
-  source_types_array[source_type] = filter_chain;
-}
-
-void ListenerImpl::convertDestinationIPsMapToTrie() {
-  for (auto& port : destination_ports_map_) {
-    auto& destination_ips_pair = port.second;
-    auto& destination_ips_map = destination_ips_pair.first;
-    std::vector<std::pair<ServerNamesMapSharedPtr, std::vector<Network::Address::CidrRange>>> list;
-    for (const auto& entry : destination_ips_map) {
-      std::vector<Network::Address::CidrRange> subnets;
-      if (entry.first == EMPTY_STRING) {
-        if (Network::Address::ipFamilySupported(AF_INET)) {
-          subnets.push_back(Network::Address::CidrRange::create("0.0.0.0/0"));
-        }
-        if (Network::Address::ipFamilySupported(AF_INET6)) {
-          subnets.push_back(Network::Address::CidrRange::create("::/0"));
-        }
-      } else {
-        subnets.push_back(Network::Address::CidrRange::create(entry.first));
-      }
-      list.push_back(
-          std::make_pair<ServerNamesMapSharedPtr, std::vector<Network::Address::CidrRange>>(
-              std::make_shared<ServerNamesMap>(entry.second),
-              std::vector<Network::Address::CidrRange>(subnets)));
-    }
-    destination_ips_pair.second = std::make_unique<DestinationIPsTrie>(list, true);
-  }
-}
-
 const Network::FilterChain*
 ListenerImpl::findFilterChain(const Network::ConnectionSocket& socket) const {
-  const auto& address = socket.localAddress();
-
-  // Match on destination port (only for IP addresses).
-  if (address->type() == Network::Address::Type::Ip) {
-    const auto port_match = destination_ports_map_.find(address->ip()->port());
-    if (port_match != destination_ports_map_.end()) {
-      return findFilterChainForDestinationIP(*port_match->second.second, socket);
-    }
-  }
-
-  // Match on catch-all port 0.
-  const auto port_match = destination_ports_map_.find(0);
-  if (port_match != destination_ports_map_.end()) {
-    return findFilterChainForDestinationIP(*port_match->second.second, socket);
-  }
-
-  return nullptr;
-}
-
-const Network::FilterChain*
-ListenerImpl::findFilterChainForDestinationIP(const DestinationIPsTrie& destination_ips_trie,
-                                              const Network::ConnectionSocket& socket) const {
-  // Use invalid IP address (matching only filter chains without IP requirements) for UDS.
-  static const auto& fake_address = Network::Utility::parseInternetAddress("255.255.255.255");
-
-  auto address = socket.localAddress();
-  if (address->type() != Network::Address::Type::Ip) {
-    address = fake_address;
-  }
-
-  // Match on both: exact IP and wider CIDR ranges using LcTrie.
-  const auto& data = destination_ips_trie.getData(address);
-  if (!data.empty()) {
-    ASSERT(data.size() == 1);
-    return findFilterChainForServerName(*data.back(), socket);
-  }
-
-  return nullptr;
-}
-
-const Network::FilterChain*
-ListenerImpl::findFilterChainForServerName(const ServerNamesMap& server_names_map,
-                                           const Network::ConnectionSocket& socket) const {
-  const std::string server_name(socket.requestedServerName());
-
-  // Match on exact server name, i.e. "www.example.com" for "www.example.com".
-  const auto server_name_exact_match = server_names_map.find(server_name);
-  if (server_name_exact_match != server_names_map.end()) {
-    return findFilterChainForTransportProtocol(server_name_exact_match->second, socket);
-  }
-
-  // Match on all wildcard domains, i.e. ".example.com" and ".com" for "www.example.com".
-  size_t pos = server_name.find('.', 1);
-  while (pos < server_name.size() - 1 && pos != std::string::npos) {
-    const std::string wildcard = server_name.substr(pos);
-    const auto server_name_wildcard_match = server_names_map.find(wildcard);
-    if (server_name_wildcard_match != server_names_map.end()) {
-      return findFilterChainForTransportProtocol(server_name_wildcard_match->second, socket);
-    }
-    pos = server_name.find('.', pos + 1);
-  }
-
-  // Match on a filter chain without server name requirements.
-  const auto server_name_catchall_match = server_names_map.find(EMPTY_STRING);
-  if (server_name_catchall_match != server_names_map.end()) {
-    return findFilterChainForTransportProtocol(server_name_catchall_match->second, socket);
-  }
-
-  return nullptr;
-}
-
-const Network::FilterChain* ListenerImpl::findFilterChainForTransportProtocol(
-    const TransportProtocolsMap& transport_protocols_map,
-    const Network::ConnectionSocket& socket) const {
-  const std::string transport_protocol(socket.detectedTransportProtocol());
-
-  // Match on exact transport protocol, e.g. "tls".
-  const auto transport_protocol_match = transport_protocols_map.find(transport_protocol);
-  if (transport_protocol_match != transport_protocols_map.end()) {
-    return findFilterChainForApplicationProtocols(transport_protocol_match->second, socket);
-  }
-
-  // Match on a filter chain without transport protocol requirements.
-  const auto any_protocol_match = transport_protocols_map.find(EMPTY_STRING);
-  if (any_protocol_match != transport_protocols_map.end()) {
-    return findFilterChainForApplicationProtocols(any_protocol_match->second, socket);
-  }
-
-  return nullptr;
-}
-
-const Network::FilterChain* ListenerImpl::findFilterChainForApplicationProtocols(
-    const ApplicationProtocolsMap& application_protocols_map,
-    const Network::ConnectionSocket& socket) const {
-  // Match on exact application protocol, e.g. "h2" or "http/1.1".
-  for (const auto& application_protocol : socket.requestedApplicationProtocols()) {
-    const auto application_protocol_match = application_protocols_map.find(application_protocol);
-    if (application_protocol_match != application_protocols_map.end()) {
-      return findFilterChainForSourceTypes(application_protocol_match->second, socket);
-    }
-  }
-
-  // Match on a filter chain without application protocol requirements.
-  const auto any_protocol_match = application_protocols_map.find(EMPTY_STRING);
-  if (any_protocol_match != application_protocols_map.end()) {
-    return findFilterChainForSourceTypes(any_protocol_match->second, socket);
-  }
-
-  return nullptr;
-}
-
-const Network::FilterChain*
-ListenerImpl::findFilterChainForSourceTypes(const SourceTypesArray& source_types,
-                                            const Network::ConnectionSocket& socket) const {
-
-  auto filter_chain_local =
-      source_types[envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
-                       FilterChainMatch_ConnectionSourceType_LOCAL];
-
-  auto filter_chain_external =
-      source_types[envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
-                       FilterChainMatch_ConnectionSourceType_EXTERNAL];
-
-  // isLocalConnection can be expensive. Call it only if LOCAL or EXTERNAL are defined.
-  const bool is_local_connection = (filter_chain_local || filter_chain_external)
-                                       ? Network::Utility::isLocalConnection(socket)
-                                       : false;
-
-  if (is_local_connection) {
-    if (filter_chain_local) {
-      return filter_chain_local.get();
-    }
-  } else {
-    if (filter_chain_external) {
-      return filter_chain_external.get();
-    }
-  }
-
-  auto filter_chain_any =
-      source_types[envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
-                       FilterChainMatch_ConnectionSourceType_ANY];
-
-  return filter_chain_any.get();
+  return filter_chain_index_->findFilterChain(socket);
 }
 
 bool ListenerImpl::createNetworkFilterChain(
@@ -601,29 +365,54 @@ Init::Manager& ListenerImpl::initManager() {
   }
 }
 
-void ListenerImpl::setSocket(const Network::SocketSharedPtr& socket) {
-  ASSERT(!socket_);
-  socket_ = socket;
-  // Server config validation sets nullptr sockets.
-  if (socket_ && listen_socket_options_) {
-    // 'pre_bind = false' as bind() is never done after this.
-    bool ok = Network::Socket::applyOptions(listen_socket_options_, *socket_,
-                                            envoy::api::v2::core::SocketOption::STATE_BOUND);
-    const std::string message =
-        fmt::format("{}: Setting socket options {}", name_, ok ? "succeeded" : "failed");
-    if (!ok) {
-      ENVOY_LOG(warn, "{}", message);
-      throw EnvoyException(message);
-    } else {
-      ENVOY_LOG(debug, "{}", message);
+void ListenerImpl::setSockets(const std::vector<Network::SocketSharedPtr>& sockets) {
+  ASSERT(sockets_.empty());
+  ASSERT(!sockets.empty());
+  sockets_ = sockets;
+  for (const Network::SocketSharedPtr& socket : sockets_) {
+    // Server config validation sets nullptr sockets.
+    if (socket && listen_socket_options_) {
+      // 'pre_bind = false' as bind() is never done after this.
+      bool ok = Network::Socket::applyOptions(listen_socket_options_, *socket,
+                                              envoy::api::v2::core::SocketOption::STATE_BOUND);
+      const std::string message =
+          fmt::format("{}: Setting socket options {}", name_, ok ? "succeeded" : "failed");
+      if (!ok) {
+        ENVOY_LOG(warn, "{}", message);
+        throw EnvoyException(message);
+      } else {
+        ENVOY_LOG(debug, "{}", message);
+      }
+
+      // Add the options to the socket so that STATE_LISTENING options can be
+      // set in the worker after listen()/evconnlistener_new() is called.
+      socket->addOptions(listen_socket_options_);
     }
+  }
 
-    // Add the options to the socket_ so that STATE_LISTENING options can be
-    // set in the worker after listen()/evconnlistener_new() is called.
-    socket_->addOptions(listen_socket_options_);
+  for (uint32_t i = 1; i < sockets_.size(); i++) {
+    worker_configs_.emplace_back(
+        sockets_[i] ? std::make_unique<WorkerListenerConfig>(*this, *sockets_[i]) : nullptr);
   }
 }
 
+Network::Socket* ListenerImpl::workerSocket(uint32_t worker_index) {
+  if (!reuse_port_) {
+    return sockets_[0].get();
+  }
+  // A worker past the ones of this listener binds a new socket to the same port instead of sharing
+  // the queue of another worker's socket.
+  return worker_index < sockets_.size() ? sockets_[worker_index].get() : nullptr;
+}
+
+Network::ListenerConfig& ListenerImpl::workerConfig(uint32_t worker_index) {
+  if (worker_index == 0 || worker_index >= sockets_.size() ||
+      worker_configs_[worker_index - 1] == nullptr) {
+    return *this;
+  }
+  return *worker_configs_[worker_index - 1];
+}
+
 ListenerManagerImpl::ListenerManagerImpl(Instance& server,
                                          ListenerComponentFactory& listener_factory,
                                          WorkerFactory& worker_factory, TimeSource& time_source)
@@ -722,17 +511,30 @@ bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& co
     throw EnvoyException(message);
   }
 
+  // The sockets of the existing listener are handed over to the new one, which they only fit if
+  // both use SO_REUSEPORT or neither does.
+  if ((existing_warming_listener != warming_listeners_.end() &&
+       (*existing_warming_listener)->reusePort() != new_listener->reusePort()) ||
+      (existing_active_listener != active_listeners_.end() &&
+       (*existing_active_listener)->reusePort() != new_listener->reusePort())) {
+    const std::string message = fmt::format(
+        "error updating listener: '{}' has a different reuse_port value from existing listener",
+        name);
+    ENVOY_LOG(warn, "{}", message);
+    throw EnvoyException(message);
+  }
+
   bool added = false;
   if (existing_warming_listener != warming_listeners_.end()) {
     // In this case we can just replace inline.
     ASSERT(workers_started_);
     new_listener->debugLog("update warming listener");
-    new_listener->setSocket((*existing_warming_listener)->getSocket());
+    new_listener->setSockets((*existing_warming_listener)->getSockets());
     *existing_warming_listener = std::move(new_listener);
   } else if (existing_active_listener != active_listeners_.end()) {
     // In this case we have no warming listener, so what we do depends on whether workers
-    // have been started or not. Either way we get the socket from the existing listener.
-    new_listener->setSocket((*existing_active_listener)->getSocket());
+    // have been started or not. Either way we get the sockets from the existing listener.
+    new_listener->setSockets((*existing_active_listener)->getSockets());
     if (workers_started_) {
       new_listener->debugLog("add warming listener");
       warming_listeners_.emplace_back(std::move(new_listener));
@@ -761,21 +563,16 @@ bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& co
     // to see if there is a listener that has a socket bound to the address we are configured for.
     // This is an edge case, but may happen if a listener is removed and then added back with a same
     // or different name and intended to listen on the same address. This should work and not fail.
-    Network::SocketSharedPtr draining_listener_socket;
     auto existing_draining_listener = std::find_if(
         draining_listeners_.cbegin(), draining_listeners_.cend(),
         [&new_listener](const DrainingListener& listener) {
-          return *new_listener->address() == *listener.listener_->socket().localAddress();
+          return *new_listener->address() == *listener.listener_->socket().localAddress() &&
+                 new_listener->reusePort() == listener.listener_->reusePort();
         });
-    if (existing_draining_listener != draining_listeners_.cend()) {
-      draining_listener_socket = existing_draining_listener->listener_->getSocket();
-    }
 
-    new_listener->setSocket(draining_listener_socket
-                                ? draining_listener_socket
-                                : factory_.createListenSocket(new_listener->address(),
-                                                              new_listener->listenSocketOptions(),
-                                                              new_listener->bindToPort()));
+    new_listener->setSockets(existing_draining_listener != draining_listeners_.cend()
+                                 ? existing_draining_listener->listener_->getSockets()
+                                 : createListenSockets(*new_listener));
     if (workers_started_) {
       new_listener->debugLog("add warming listener");
       warming_listeners_.emplace_back(std::move(new_listener));
@@ -862,6 +659,46 @@ ListenerManagerImpl::getListenerByName(ListenerList& listeners, const std::strin
   return ret;
 }
 
+std::vector<Network::SocketSharedPtr>
+ListenerManagerImpl::createListenSockets(ListenerImpl& listener) {
+  const bool socket_per_worker = listener.reusePort() && listener.bindToPort() &&
+                                 listener.address()->type() == Network::Address::Type::Ip;
+  std::vector<Network::SocketSharedPtr> sockets;
+  sockets.push_back(factory_.createListenSocket(
+      listener.address(),
+      socket_per_worker ? workerListenSocketOptions(listener, 0) : listener.listenSocketOptions(),
+      listener.bindToPort(), 0));
+  if (!socket_per_worker) {
+    return sockets;
+  }
+
+  // Every other worker gets its own socket bound to the same address, and the kernel balances
+  // new connections across them. If the listener binds to port 0 the other sockets must bind to
+  // the port picked for the first one.
+  const Network::Address::InstanceConstSharedPtr address =
+      sockets[0] ? sockets[0]->localAddress() : listener.address();
+  for (uint32_t i = 1; i < workers_.size(); i++) {
+    sockets.push_back(factory_.createListenSocket(address, workerListenSocketOptions(listener, i),
+                                                  listener.bindToPort(), i));
+  }
+  return sockets;
+}
+
+Network::Socket::OptionsSharedPtr
+ListenerManagerImpl::workerListenSocketOptions(ListenerImpl& listener, uint32_t worker_index) {
+  // A worker paired with the CPU receiving its connections asks the kernel to hand it the
+  // connections received by that CPU.
+  const absl::optional<uint32_t> incoming_cpu = workers_[worker_index]->incomingCpu();
+  if (!incoming_cpu.has_value()) {
+    return listener.listenSocketOptions();
+  }
+  Network::Socket::OptionsSharedPtr options = std::make_shared<Network::Socket::Options>();
+  Network::Socket::appendOptions(options, listener.listenSocketOptions());
+  Network::Socket::appendOptions(
+      options, Network::SocketOptionFactory::buildIncomingCpuOptions(incoming_cpu.value()));
+  return options;
+}
+
 std::vector<std::reference_wrapper<Network::ListenerConfig>> ListenerManagerImpl::listeners() {
   std::vector<std::reference_wrapper<Network::ListenerConfig>> ret;
   ret.reserve(active_listeners_.size());
@@ -871,8 +708,19 @@ std::vector<std::reference_wrapper<Network::ListenerConfig>> ListenerManagerImpl
   return ret;
 }
 
-void ListenerManagerImpl::addListenerToWorker(Worker& worker, ListenerImpl& listener) {
-  worker.addListener(listener, [this, &listener](bool success) -> void {
+Network::Socket* ListenerManagerImpl::listenSocket(const Network::Address::Instance& address,
+                                                  uint32_t worker_index) {
+  for (const auto& listener : active_listeners_) {
+    if (*listener->socket().localAddress() == address) {
+      return listener->workerSocket(worker_index);
+    }
+  }
+  return nullptr;
+}
+
+void ListenerManagerImpl::addListenerToWorker(Worker& worker, uint32_t worker_index,
+                                              ListenerImpl& listener) {
+  worker.addListener(listener.workerConfig(worker_index), [this, &listener](bool success) -> void {
     // The add listener completion runs on the worker thread. Post back to the main thread to
     // avoid locking.
     server_.dispatcher().post([this, success, &listener]() -> void {
@@ -900,8 +748,9 @@ void ListenerManagerImpl::addListenerToWorker(Worker& worker, ListenerImpl& list
 void ListenerManagerImpl::onListenerWarmed(ListenerImpl& listener) {
   // The warmed listener should be added first so that the worker will accept new connections
   // when it stops listening on the old listener.
+  uint32_t worker_index = 0;
   for (const auto& worker : workers_) {
-    addListenerToWorker(*worker, listener);
+    addListenerToWorker(*worker, worker_index++, listener);
   }
 
   auto existing_active_listener = getListenerByName(active_listeners_, listener.name());
@@ -927,6 +776,14 @@ uint64_t ListenerManagerImpl::numConnections() {
   return num_connections;
 }
 
+std::vector<std::reference_wrapper<Event::Dispatcher>> ListenerManagerImpl::workerDispatchers() {
+  std::vector<std::reference_wrapper<Event::Dispatcher>> dispatchers;
+  for (const auto& worker : workers_) {
+    dispatchers.push_back(worker->dispatcher());
+  }
+  return dispatchers;
+}
+
 bool ListenerManagerImpl::removeListener(const std::string& name) {
   ENVOY_LOG(debug, "begin remove listener: name={}", name);
 
@@ -961,12 +818,14 @@ void ListenerManagerImpl::startWorkers(GuardDog& guard_dog) {
   ENVOY_LOG(info, "all dependencies initialized. starting workers");
   ASSERT(!workers_started_);
   workers_started_ = true;
+  uint32_t worker_index = 0;
   for (const auto& worker : workers_) {
     ASSERT(warming_listeners_.empty());
     for (const auto& listener : active_listeners_) {
-      addListenerToWorker(*worker, *listener);
+      addListenerToWorker(*worker, worker_index, *listener);
     }
     worker->start(guard_dog);
+    worker_index++;
   }
 }
 
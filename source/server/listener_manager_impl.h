@@ -13,8 +13,8 @@
 
 #include "common/common/logger.h"
 #include "common/network/cidr_range.h"
-#include "common/network/lc_trie.h"
 
+#include "server/filter_chain_index.h"
 #include "server/init_manager_impl.h"
 #include "server/lds_api.h"
 
@@ -62,7 +62,7 @@ public:
   }
   Network::SocketSharedPtr createListenSocket(Network::Address::InstanceConstSharedPtr address,
                                               const Network::Socket::OptionsSharedPtr& options,
-                                              bool bind_to_port) override;
+                                              bool bind_to_port, uint32_t worker_index) override;
   DrainManagerPtr createDrainManager(envoy::api::v2::Listener::DrainType drain_type) override;
   uint64_t nextListenerTag() override { return next_listener_tag_++; }
 
@@ -115,6 +115,9 @@ public:
   }
   std::vector<std::reference_wrapper<Network::ListenerConfig>> listeners() override;
   uint64_t numConnections() override;
+  std::vector<std::reference_wrapper<Event::Dispatcher>> workerDispatchers() override;
+  Network::Socket* listenSocket(const Network::Address::Instance& address,
+                                uint32_t worker_index) override;
   bool removeListener(const std::string& listener_name) override;
   void startWorkers(GuardDog& guard_dog) override;
   void stopListeners() override;
@@ -136,7 +139,10 @@ private:
     uint64_t workers_pending_removal_;
   };
 
-  void addListenerToWorker(Worker& worker, ListenerImpl& listener);
+  void addListenerToWorker(Worker& worker, uint32_t worker_index, ListenerImpl& listener);
+  std::vector<Network::SocketSharedPtr> createListenSockets(ListenerImpl& listener);
+  Network::Socket::OptionsSharedPtr workerListenSocketOptions(ListenerImpl& listener,
+                                                              uint32_t worker_index);
   ProtobufTypes::MessagePtr dumpListenerConfigs();
   static ListenerManagerStats generateStats(Stats::Scope& scope);
   static bool hasListenerWithAddress(const ListenerList& list,
@@ -228,19 +234,34 @@ public:
 
   Network::Address::InstanceConstSharedPtr address() const { return address_; }
   const envoy::api::v2::Listener& config() { return config_; }
-  const Network::SocketSharedPtr& getSocket() const { return socket_; }
+  const std::vector<Network::SocketSharedPtr>& getSockets() const { return sockets_; }
   void debugLog(const std::string& message);
   void initialize();
   DrainManager& localDrainManager() const { return *local_drain_manager_; }
-  void setSocket(const Network::SocketSharedPtr& socket);
-  void setSocketAndOptions(const Network::SocketSharedPtr& socket);
+  void setSockets(const std::vector<Network::SocketSharedPtr>& sockets);
   const Network::Socket::OptionsSharedPtr& listenSocketOptions() { return listen_socket_options_; }
   const std::string& versionInfo() { return version_info_; }
+  bool reusePort() const { return reuse_port_; }
+
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return Network::Socket* the socket accepting connections for the worker, or nullptr if the
+   *         listener uses SO_REUSEPORT and has no socket for the worker.
+   */
+  Network::Socket* workerSocket(uint32_t worker_index);
+
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return Network::ListenerConfig& the config to add to the worker. It is the listener itself,
+   *         except that with SO_REUSEPORT each worker but the first is given a view which only
+   *         differs by its socket.
+   */
+  Network::ListenerConfig& workerConfig(uint32_t worker_index);
 
   // Network::ListenerConfig
   Network::FilterChainManager& filterChainManager() override { return *this; }
   Network::FilterChainFactory& filterChainFactory() override { return *this; }
-  Network::Socket& socket() override { return *socket_; }
+  Network::Socket& socket() override { return *sockets_[0]; }
   bool bindToPort() override { return bind_to_port_; }
   bool handOffRestoredDestinationConnections() const override {
     return hand_off_restored_destination_connections_;
@@ -253,6 +274,7 @@ public:
   uint64_t listenerTag() const override { return listener_tag_; }
   const std::string& name() const override { return name_; }
   bool reverseWriteFilterOrder() const override { return reverse_write_filter_order_; }
+  Network::ConnectionBalancer& connectionBalancer() override { return *connection_balancer_; }
 
   // Server::Configuration::ListenerFactoryContext
   AccessLog::AccessLogManager& accessLogManager() override {
@@ -307,90 +329,66 @@ public:
   SystemTime last_updated_;
 
 private:
-  typedef std::array<Network::FilterChainSharedPtr, 3> SourceTypesArray;
-  typedef std::unordered_map<std::string, SourceTypesArray> ApplicationProtocolsMap;
-  typedef std::unordered_map<std::string, ApplicationProtocolsMap> TransportProtocolsMap;
-  // Both exact server names and wildcard domains are part of the same map, in which wildcard
-  // domains are prefixed with "." (i.e. ".example.com" for "*.example.com") to differentiate
-  // between exact and wildcard entries.
-  typedef std::unordered_map<std::string, TransportProtocolsMap> ServerNamesMap;
-  typedef std::unordered_map<std::string, ServerNamesMap> DestinationIPsMap;
-  typedef std::shared_ptr<ServerNamesMap> ServerNamesMapSharedPtr;
-  typedef Network::LcTrie::LcTrie<ServerNamesMapSharedPtr> DestinationIPsTrie;
-  typedef std::unique_ptr<DestinationIPsTrie> DestinationIPsTriePtr;
-  typedef std::unordered_map<uint16_t, std::pair<DestinationIPsMap, DestinationIPsTriePtr>>
-      DestinationPortsMap;
-
-  void
-  addFilterChain(uint16_t destination_port, const std::vector<std::string>& destination_ips,
-                 const std::vector<std::string>& server_names,
-                 const std::string& transport_protocol,
-                 const std::vector<std::string>& application_protocols,
-                 const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-                 Network::TransportSocketFactoryPtr&& transport_socket_factory,
-                 std::vector<Network::FilterFactoryCb> filters_factory);
-  void addFilterChainForDestinationPorts(
-      DestinationPortsMap& destination_ports_map, uint16_t destination_port,
-      const std::vector<std::string>& destination_ips, const std::vector<std::string>& server_names,
-      const std::string& transport_protocol, const std::vector<std::string>& application_protocols,
-      const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-      const Network::FilterChainSharedPtr& filter_chain);
-  void addFilterChainForDestinationIPs(
-      DestinationIPsMap& destination_ips_map, const std::vector<std::string>& destination_ips,
-      const std::vector<std::string>& server_names, const std::string& transport_protocol,
-      const std::vector<std::string>& application_protocols,
-      const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-      const Network::FilterChainSharedPtr& filter_chain);
-  void addFilterChainForServerNames(
-      ServerNamesMap& server_names_map, const std::vector<std::string>& server_names,
-      const std::string& transport_protocol, const std::vector<std::string>& application_protocols,
-      const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-      const Network::FilterChainSharedPtr& filter_chain);
-  void addFilterChainForApplicationProtocols(
-      ApplicationProtocolsMap& application_protocol_map,
-      const std::vector<std::string>& application_protocols,
-      const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-      const Network::FilterChainSharedPtr& filter_chain);
-  void addFilterChainForSourceTypes(
-      SourceTypesArray& source_types_array,
-      const envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType source_type,
-      const Network::FilterChainSharedPtr& filter_chain);
-
-  void convertDestinationIPsMapToTrie();
-
-  const Network::FilterChain*
-  findFilterChainForDestinationIP(const DestinationIPsTrie& destination_ips_trie,
-                                  const Network::ConnectionSocket& socket) const;
-  const Network::FilterChain*
-  findFilterChainForServerName(const ServerNamesMap& server_names_map,
-                               const Network::ConnectionSocket& socket) const;
-  const Network::FilterChain*
-  findFilterChainForTransportProtocol(const TransportProtocolsMap& transport_protocols_map,
-                                      const Network::ConnectionSocket& socket) const;
-  const Network::FilterChain*
-  findFilterChainForApplicationProtocols(const ApplicationProtocolsMap& application_protocols_map,
-                                         const Network::ConnectionSocket& socket) const;
-  const Network::FilterChain*
-  findFilterChainForSourceTypes(const SourceTypesArray& source_types,
-                                const Network::ConnectionSocket& socket) const;
+  /**
+   * Config of the listener on a worker which has its own SO_REUSEPORT socket. Everything but the
+   * socket is the listener's, including its tag, so that the worker stops and removes it along
+   * with the listener.
+   */
+  class WorkerListenerConfig : public Network::ListenerConfig {
+  public:
+    WorkerListenerConfig(ListenerImpl& parent, Network::Socket& socket)
+        : parent_(parent), socket_(socket) {}
+
+    // Network::ListenerConfig
+    Network::FilterChainManager& filterChainManager() override {
+      return parent_.filterChainManager();
+    }
+    Network::FilterChainFactory& filterChainFactory() override {
+      return parent_.filterChainFactory();
+    }
+    Network::Socket& socket() override { return socket_; }
+    bool bindToPort() override { return parent_.bindToPort(); }
+    bool handOffRestoredDestinationConnections() const override {
+      return parent_.handOffRestoredDestinationConnections();
+    }
+    uint32_t perConnectionBufferLimitBytes() override {
+      return parent_.perConnectionBufferLimitBytes();
+    }
+    std::chrono::milliseconds listenerFiltersTimeout() const override {
+      return parent_.listenerFiltersTimeout();
+    }
+    Stats::Scope& listenerScope() override { return parent_.listenerScope(); }
+    uint64_t listenerTag() const override { return parent_.listenerTag(); }
+    const std::string& name() const override { return parent_.name(); }
+    bool reverseWriteFilterOrder() const override { return parent_.reverseWriteFilterOrder(); }
+    Network::ConnectionBalancer& connectionBalancer() override {
+      return parent_.connectionBalancer();
+    }
 
-  static bool isWildcardServerName(const std::string& name);
+  private:
+    ListenerImpl& parent_;
+    Network::Socket& socket_;
+  };
 
-  // Mapping of FilterChain's configured destination ports, IPs, server names, transport protocols
-  // and application protocols, using structures defined above.
-  DestinationPortsMap destination_ports_map_;
+  // Index of the filter chains, compiled once all of them are known.
+  FilterChainIndexConstPtr filter_chain_index_;
 
   ListenerManagerImpl& parent_;
   Network::Address::InstanceConstSharedPtr address_;
-  Network::SocketSharedPtr socket_;
+  // A single socket shared by all workers, or one socket per worker with SO_REUSEPORT.
+  std::vector<Network::SocketSharedPtr> sockets_;
+  std::vector<std::unique_ptr<WorkerListenerConfig>> worker_configs_;
   Stats::ScopePtr global_scope_;   // Stats with global named scope, but needed for LDS cleanup.
   Stats::ScopePtr listener_scope_; // Stats with listener named scope.
   const bool bind_to_port_;
+  const bool reuse_port_;
   const bool hand_off_restored_destination_connections_;
   const uint32_t per_connection_buffer_limit_bytes_;
   const uint64_t listener_tag_;
   const std::string name_;
   const bool reverse_write_filter_order_;
+  // Shared by the workers, so that every worker's connections are balanced against the others.
+  Network::ConnectionBalancerPtr connection_balancer_;
   const bool modifiable_;
   const bool workers_started_;
   const uint64_t hash_;
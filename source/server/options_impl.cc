@@ -15,9 +15,10 @@
 #include "spdlog/spdlog.h"
 #include "tclap/CmdLine.h"
 
-// Can be overridden at compile time
+// Can be overridden at compile time. 0 means that the number of stats is only bounded by the
+// shared memory segments.
 #ifndef ENVOY_DEFAULT_MAX_STATS
-#define ENVOY_DEFAULT_MAX_STATS 16384
+#define ENVOY_DEFAULT_MAX_STATS 0
 #endif
 
 // Can be overridden at compile time
@@ -108,7 +109,8 @@ OptionsImpl::OptionsImpl(int argc, const char* const* argv,
                                     false, "serve", "string", cmd);
   TCLAP::ValueArg<uint64_t> max_stats("", "max-stats",
                                       "Maximum number of stats gauges and counters "
-                                      "that can be allocated in shared memory.",
+                                      "that can be allocated in shared memory, "
+                                      "0 for no maximum.",
                                       false, ENVOY_DEFAULT_MAX_STATS, "uint64_t", cmd);
   TCLAP::ValueArg<uint64_t> max_obj_name_len("", "max-obj-name-len",
                                              "Maximum name length for a field in the config "
@@ -20,6 +20,7 @@
 
 #include "common/api/api_impl.h"
 #include "common/api/os_sys_calls_impl.h"
+#include "common/common/fmt.h"
 #include "common/common/mutex_tracer_impl.h"
 #include "common/common/utility.h"
 #include "common/common/version.h"
@@ -41,6 +42,7 @@
 #include "server/connection_handler_impl.h"
 #include "server/guarddog_impl.h"
 #include "server/test_hooks.h"
+#include "server/worker_placement.h"
 
 namespace Envoy {
 namespace Server {
@@ -107,7 +109,7 @@ InstanceImpl::~InstanceImpl() {
   // Destruct the ListenerManager explicitly, before InstanceImpl's local init_manager_ is
   // destructed.
   //
-  // The ListenerManager's DestinationPortsMap contains FilterChainSharedPtrs. There is a rare race
+  // The FilterChainIndex of each listener contains FilterChainSharedPtrs. There is a rare race
   // condition where one of these FilterChains contains an HttpConnectionManager, which contains an
   // RdsRouteConfigProvider, which contains an RdsRouteConfigSubscriptionSharedPtr. Since
   // RdsRouteConfigSubscription is an Init::Target, ~RdsRouteConfigSubscription triggers a callback
@@ -287,6 +289,13 @@ void InstanceImpl::initialize(Options& options,
   overload_manager_ = std::make_unique<OverloadManagerImpl>(dispatcher(), stats(), threadLocal(),
                                                             bootstrap_.overload_manager());
 
+  if (bootstrap_.has_worker_placement()) {
+    worker_factory_.setPlacement(
+        std::make_unique<WorkerPlacement>(bootstrap_.worker_placement(),
+                                          WorkerPlacement::hostTopology()),
+        stats_store_);
+  }
+
   // Workers get created first so they register for thread local updates.
   listener_manager_ = std::make_unique<ListenerManagerImpl>(*this, listener_component_factory_,
                                                             worker_factory_, time_system_);
@@ -297,6 +306,18 @@ void InstanceImpl::initialize(Options& options,
 
   // We can now initialize stats for threading.
   stats_store_.initializeThreading(*dispatcher_, thread_local_);
+  thread_local_.initializeStats(stats_store_);
+
+  if (bootstrap_.enable_dispatcher_stats()) {
+    const std::chrono::milliseconds slow_callback_threshold(
+        PROTOBUF_GET_MS_OR_DEFAULT(bootstrap_.watchdog(), slow_callback_threshold, 50));
+    dispatcher_->initializeStats(stats_store_, "main_thread.", slow_callback_threshold);
+    uint32_t worker_index = 0;
+    for (Event::Dispatcher& worker_dispatcher : listener_manager_->workerDispatchers()) {
+      worker_dispatcher.initializeStats(stats_store_, fmt::format("worker_{}.", worker_index++),
+                                        slow_callback_threshold);
+    }
+  }
 
   // Runtime gets initialized before the main configuration since during main configuration
   // load things may grab a reference to the loader for later use.
@@ -304,6 +325,7 @@ void InstanceImpl::initialize(Options& options,
 
   // Once we have runtime we can initialize the SSL context manager.
   ssl_context_manager_ = std::make_unique<Ssl::ContextManagerImpl>(time_system_);
+  ssl_context_manager_->setSessionTicketKeys(info.session_ticket_keys_);
 
   cluster_manager_factory_ = std::make_unique<Upstream::ProdClusterManagerFactory>(
       runtime(), stats(), threadLocal(), random(), dnsResolver(), sslContextManager(), dispatcher(),
@@ -1,5 +1,6 @@
 #include "server/worker_impl.h"
 
+#include <chrono>
 #include <functional>
 #include <memory>
 
@@ -15,19 +16,41 @@
 namespace Envoy {
 namespace Server {
 
+namespace {
+// Interval at which a placed worker records where it runs.
+const std::chrono::milliseconds PlacementRecordInterval(1000);
+} // namespace
+
+void ProdWorkerFactory::setPlacement(WorkerPlacementConstPtr&& placement, Stats::Scope& scope) {
+  placement_ = std::move(placement);
+  placement_scope_ = &scope;
+}
+
 WorkerPtr ProdWorkerFactory::createWorker(OverloadManager& overload_manager) {
+  const uint32_t worker_index = next_worker_index_++;
+  WorkerAffinityPtr affinity;
+  if (placement_ != nullptr) {
+    affinity = placement_->createWorkerAffinity(worker_index, *placement_scope_);
+  }
+  // The worker thread does not run yet, so its dispatcher and connection handler are allocated by
+  // the calling thread, preferring the memory of the NUMA node the worker is placed on.
+  ScopedNumaMemoryPolicy memory_policy(affinity != nullptr
+                                           ? absl::optional<uint32_t>(affinity->numaNode())
+                                           : absl::nullopt);
   Event::DispatcherPtr dispatcher(api_.allocateDispatcher(time_system_));
   return WorkerPtr{new WorkerImpl(
       tls_, hooks_, std::move(dispatcher),
-      Network::ConnectionHandlerPtr{new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher)},
-      overload_manager, api_)};
+      Network::ConnectionHandlerPtr{
+          new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher, worker_index)},
+      overload_manager, api_, std::move(affinity))};
 }
 
 WorkerImpl::WorkerImpl(ThreadLocal::Instance& tls, TestHooks& hooks,
                        Event::DispatcherPtr&& dispatcher, Network::ConnectionHandlerPtr handler,
-                       OverloadManager& overload_manager, Api::Api& api)
+                       OverloadManager& overload_manager, Api::Api& api,
+                       WorkerAffinityPtr&& affinity)
     : tls_(tls), hooks_(hooks), dispatcher_(std::move(dispatcher)), handler_(std::move(handler)),
-      api_(api) {
+      api_(api), affinity_(std::move(affinity)) {
   tls_.registerThread(*dispatcher_, false);
   overload_manager.registerForAction(
       OverloadActionNames::get().StopAcceptingConnections, *dispatcher_,
@@ -95,6 +118,16 @@ void WorkerImpl::stopListeners() {
 }
 
 void WorkerImpl::threadRoutine(GuardDog& guard_dog) {
+  if (affinity_ != nullptr) {
+    // Pin the thread before it runs its dispatcher, so that the memory it allocates from then on,
+    // such as its connections, buffers and thread local objects, is local to the NUMA node it runs
+    // on. The dispatcher and connection handler were allocated on that node when the worker was
+    // created, see ProdWorkerFactory::createWorker().
+    affinity_->pinCurrentThread();
+    placement_timer_ = dispatcher_->createTimer([this]() -> void { onPlacementTimer(); });
+    onPlacementTimer();
+  }
+
   ENVOY_LOG(debug, "worker entering dispatch loop");
   auto watchdog = guard_dog.createWatchDog(Thread::currentThreadId());
   watchdog->startWatchdog(*dispatcher_);
@@ -107,10 +140,16 @@ void WorkerImpl::threadRoutine(GuardDog& guard_dog) {
   // the handler does this as well as destroying the dispatcher which purges the delayed deletion
   // list.
   handler_.reset();
+  placement_timer_.reset();
   tls_.shutdownThread();
   watchdog.reset();
 }
 
+void WorkerImpl::onPlacementTimer() {
+  affinity_->recordPlacement();
+  placement_timer_->enableTimer(PlacementRecordInterval);
+}
+
 void WorkerImpl::stopAcceptingConnectionsCb(OverloadActionState state) {
   switch (state) {
   case OverloadActionState::Active:
@@ -4,16 +4,19 @@
 #include <memory>
 
 #include "envoy/api/api.h"
+#include "envoy/event/timer.h"
 #include "envoy/network/connection_handler.h"
 #include "envoy/server/guarddog.h"
 #include "envoy/server/listener_manager.h"
 #include "envoy/server/worker.h"
+#include "envoy/stats/scope.h"
 #include "envoy/thread_local/thread_local.h"
 
 #include "common/common/logger.h"
 #include "common/common/thread.h"
 
 #include "server/test_hooks.h"
+#include "server/worker_placement.h"
 
 namespace Envoy {
 namespace Server {
@@ -24,6 +27,13 @@ public:
                     Event::TimeSystem& time_system)
       : tls_(tls), api_(api), hooks_(hooks), time_system_(time_system) {}
 
+  /**
+   * Place the workers created from now on.
+   * @param placement supplies the placement of the workers.
+   * @param scope supplies the scope of the placement stats of the workers.
+   */
+  void setPlacement(WorkerPlacementConstPtr&& placement, Stats::Scope& scope);
+
   // Server::WorkerFactory
   WorkerPtr createWorker(OverloadManager& overload_manager) override;
 
@@ -32,6 +42,9 @@ private:
   Api::Api& api_;
   TestHooks& hooks_;
   Event::TimeSystem& time_system_;
+  uint32_t next_worker_index_{};
+  WorkerPlacementConstPtr placement_;
+  Stats::Scope* placement_scope_{};
 };
 
 /**
@@ -41,11 +54,15 @@ class WorkerImpl : public Worker, Logger::Loggable<Logger::Id::main> {
 public:
   WorkerImpl(ThreadLocal::Instance& tls, TestHooks& hooks, Event::DispatcherPtr&& dispatcher,
              Network::ConnectionHandlerPtr handler, OverloadManager& overload_manager,
-             Api::Api& api);
+             Api::Api& api, WorkerAffinityPtr&& affinity);
 
   // Server::Worker
   void addListener(Network::ListenerConfig& listener, AddListenerCompletion completion) override;
   uint64_t numConnections() override;
+  Event::Dispatcher& dispatcher() override { return *dispatcher_; }
+  absl::optional<uint32_t> incomingCpu() const override {
+    return affinity_ != nullptr ? affinity_->incomingCpu() : absl::nullopt;
+  }
   void removeListener(Network::ListenerConfig& listener, std::function<void()> completion) override;
   void start(GuardDog& guard_dog) override;
   void stop() override;
@@ -55,12 +72,16 @@ public:
 private:
   void threadRoutine(GuardDog& guard_dog);
   void stopAcceptingConnectionsCb(OverloadActionState state);
+  void onPlacementTimer();
 
   ThreadLocal::Instance& tls_;
   TestHooks& hooks_;
   Event::DispatcherPtr dispatcher_;
   Network::ConnectionHandlerPtr handler_;
   Api::Api& api_;
+  // The placement of the worker, if it is placed.
+  WorkerAffinityPtr affinity_;
+  Event::TimerPtr placement_timer_;
   Thread::ThreadPtr thread_;
 };
 
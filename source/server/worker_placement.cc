@@ -0,0 +1,207 @@
+#include "server/worker_placement.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/fmt.h"
+#include "common/common/macros.h"
+#include "common/common/utility.h"
+#include "common/filesystem/filesystem_impl.h"
+
+#include "absl/strings/str_join.h"
+
+namespace Envoy {
+namespace Server {
+
+const uint32_t WorkerPlacement::MaxCpus;
+const uint32_t ScopedNumaMemoryPolicy::MaxNumaNodes;
+
+WorkerAffinity::WorkerAffinity(const std::vector<uint32_t>& cpus, uint32_t numa_node,
+                               absl::optional<uint32_t> incoming_cpu, Stats::Scope& scope,
+                               const std::string& prefix)
+    : cpus_(cpus), numa_node_(numa_node), incoming_cpu_(incoming_cpu),
+      stats_{ALL_WORKER_PLACEMENT_STATS(POOL_COUNTER_PREFIX(scope, prefix),
+                                        POOL_GAUGE_PREFIX(scope, prefix))} {}
+
+void WorkerAffinity::pinCurrentThread() {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (uint32_t cpu : cpus_) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  // The CPUs were checked against those the process may run on at startup, so this only fails if
+  // the CPUs of the process changed since.
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    ENVOY_LOG(error, "unable to pin worker to CPUs {}: {}", absl::StrJoin(cpus_, ","),
+              strerror(errno));
+    return;
+  }
+  ENVOY_LOG(debug, "worker pinned to CPUs {}", absl::StrJoin(cpus_, ","));
+#endif
+}
+
+void WorkerAffinity::recordPlacement() {
+#ifdef __linux__
+  unsigned cpu;
+  unsigned node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return;
+  }
+  stats_.cpu_.set(cpu);
+  stats_.numa_node_.set(node);
+  if (current_numa_node_.has_value() && current_numa_node_.value() != node) {
+    stats_.numa_node_changes_.inc();
+  }
+  current_numa_node_ = node;
+#endif
+}
+
+ScopedNumaMemoryPolicy::ScopedNumaMemoryPolicy(absl::optional<uint32_t> node) {
+#ifdef __linux__
+  if (!node.has_value() || node.value() >= MaxNumaNodes) {
+    return;
+  }
+  // The node masks are passed with their size in bits, plus one, see set_mempolicy(2).
+  if (syscall(SYS_get_mempolicy, &previous_mode_, previous_nodes_.data(), MaxNumaNodes + 1,
+              nullptr, 0) != 0) {
+    ENVOY_LOG(debug, "unable to get the memory policy: {}", strerror(errno));
+    return;
+  }
+  std::array<unsigned long, MaxNumaNodes / 64> nodes{};
+  nodes[node.value() / 64] = 1UL << (node.value() % 64);
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodes.data(), MaxNumaNodes + 1) != 0) {
+    ENVOY_LOG(debug, "unable to prefer the memory of NUMA node {}: {}", node.value(),
+              strerror(errno));
+    return;
+  }
+  active_ = true;
+#else
+  UNREFERENCED_PARAMETER(node);
+#endif
+}
+
+ScopedNumaMemoryPolicy::~ScopedNumaMemoryPolicy() {
+#ifdef __linux__
+  if (active_ &&
+      syscall(SYS_set_mempolicy, previous_mode_, previous_nodes_.data(), MaxNumaNodes + 1) != 0) {
+    ENVOY_LOG(error, "unable to restore the memory policy: {}", strerror(errno));
+  }
+#endif
+}
+
+WorkerPlacement::WorkerPlacement(const envoy::config::bootstrap::v2::WorkerPlacement& config,
+                                 const Topology& topology)
+    : cpus_(parseCpuList(config.cpus())), numa_node_affinity_(config.numa_node_affinity()),
+      incoming_cpu_(config.incoming_cpu()) {
+  if (cpus_.empty()) {
+    throw EnvoyException(fmt::format("worker_placement: no CPU in '{}'", config.cpus()));
+  }
+  for (uint32_t cpu : cpus_) {
+    if (topology.allowed_cpus_.count(cpu) == 0) {
+      throw EnvoyException(
+          fmt::format("worker_placement: CPU {} is not one the process may run on", cpu));
+    }
+  }
+
+  for (uint32_t cpu : cpus_) {
+    const auto node = topology.cpu_nodes_.find(cpu);
+    cpu_nodes_[cpu] = node != topology.cpu_nodes_.end() ? node->second : 0;
+    if (numa_node_affinity_) {
+      node_cpus_[cpu_nodes_[cpu]].push_back(cpu);
+    }
+  }
+}
+
+std::vector<uint32_t> WorkerPlacement::workerCpus(uint32_t worker_index) const {
+  const uint32_t cpu = cpus_[worker_index % cpus_.size()];
+  if (numa_node_affinity_) {
+    return node_cpus_.at(cpu_nodes_.at(cpu));
+  }
+  return {cpu};
+}
+
+absl::optional<uint32_t> WorkerPlacement::workerIncomingCpu(uint32_t worker_index) const {
+  if (!incoming_cpu_) {
+    return absl::nullopt;
+  }
+  return cpus_[worker_index % cpus_.size()];
+}
+
+uint32_t WorkerPlacement::workerNumaNode(uint32_t worker_index) const {
+  return cpu_nodes_.at(cpus_[worker_index % cpus_.size()]);
+}
+
+WorkerAffinityPtr WorkerPlacement::createWorkerAffinity(uint32_t worker_index,
+                                                        Stats::Scope& scope) const {
+  return std::make_unique<WorkerAffinity>(
+      workerCpus(worker_index), workerNumaNode(worker_index), workerIncomingCpu(worker_index),
+      scope, fmt::format("worker_{}.placement.", worker_index));
+}
+
+WorkerPlacement::Topology WorkerPlacement::hostTopology() {
+#ifdef __linux__
+  Topology topology;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    throw EnvoyException(
+        fmt::format("worker_placement: unable to get the CPUs of the process: {}", strerror(errno)));
+  }
+  for (uint32_t cpu = 0; cpu < MaxCpus; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) {
+      topology.allowed_cpus_.insert(cpu);
+    }
+  }
+
+  // Kernels built without NUMA support have no nodes, in which case every CPU is on node 0.
+  const std::string nodes_path = "/sys/devices/system/node/online";
+  if (!Filesystem::fileExists(nodes_path)) {
+    return topology;
+  }
+  for (uint32_t node : parseCpuList(Filesystem::fileReadToEnd(nodes_path))) {
+    const std::string cpus_path = fmt::format("/sys/devices/system/node/node{}/cpulist", node);
+    if (!Filesystem::fileExists(cpus_path)) {
+      continue;
+    }
+    for (uint32_t cpu : parseCpuList(Filesystem::fileReadToEnd(cpus_path))) {
+      topology.cpu_nodes_[cpu] = node;
+    }
+  }
+  return topology;
+#else
+  throw EnvoyException("worker_placement is only supported on Linux");
+#endif
+}
+
+std::vector<uint32_t> WorkerPlacement::parseCpuList(absl::string_view list) {
+  std::set<uint32_t> cpus;
+  for (absl::string_view range : StringUtil::splitToken(StringUtil::trim(list), ",")) {
+    const std::vector<absl::string_view> bounds = StringUtil::splitToken(range, "-", true);
+    uint64_t first;
+    uint64_t last;
+    if (bounds.empty() || bounds.size() > 2 ||
+        !StringUtil::atoul(std::string(bounds.front()).c_str(), first) ||
+        !StringUtil::atoul(std::string(bounds.back()).c_str(), last) || first > last ||
+        last >= MaxCpus) {
+      throw EnvoyException(fmt::format("invalid CPU list '{}'", list));
+    }
+    for (uint64_t cpu = first; cpu <= last; ++cpu) {
+      cpus.insert(cpu);
+    }
+  }
+  return std::vector<uint32_t>(cpus.begin(), cpus.end());
+}
+
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/config/bootstrap/v2/bootstrap.pb.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "common/common/logger.h"
+#include "common/common/non_copyable.h"
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace Envoy {
+namespace Server {
+
+/**
+ * All worker placement stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_WORKER_PLACEMENT_STATS(COUNTER, GAUGE)                                                 \
+  COUNTER(numa_node_changes)                                                                       \
+  GAUGE  (cpu)                                                                                     \
+  GAUGE  (numa_node)
+// clang-format on
+
+/**
+ * Struct definition for all worker placement stats. @see stats_macros.h
+ */
+struct WorkerPlacementStats {
+  ALL_WORKER_PLACEMENT_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * Placement of a single worker thread. The worker thread pins itself with it before running its
+ * dispatcher, and periodically records where it runs.
+ */
+class WorkerAffinity : Logger::Loggable<Logger::Id::main> {
+public:
+  WorkerAffinity(const std::vector<uint32_t>& cpus, uint32_t numa_node,
+                 absl::optional<uint32_t> incoming_cpu, Stats::Scope& scope,
+                 const std::string& prefix);
+
+  /**
+   * Pin the calling thread to the CPUs of the worker.
+   */
+  void pinCurrentThread();
+
+  /**
+   * Record the CPU and the NUMA node the calling thread runs on, counting the changes of node.
+   */
+  void recordPlacement();
+
+  /**
+   * @return const std::vector<uint32_t>& the CPUs the worker is pinned to.
+   */
+  const std::vector<uint32_t>& cpus() const { return cpus_; }
+
+  /**
+   * @return uint32_t the NUMA node of the CPUs of the worker.
+   */
+  uint32_t numaNode() const { return numa_node_; }
+
+  /**
+   * @return absl::optional<uint32_t> the CPU to set as SO_INCOMING_CPU of the sockets of the
+   *         worker, if any.
+   */
+  absl::optional<uint32_t> incomingCpu() const { return incoming_cpu_; }
+
+private:
+  const std::vector<uint32_t> cpus_;
+  const uint32_t numa_node_;
+  const absl::optional<uint32_t> incoming_cpu_;
+  WorkerPlacementStats stats_;
+  absl::optional<uint32_t> current_numa_node_;
+};
+
+typedef std::unique_ptr<WorkerAffinity> WorkerAffinityPtr;
+
+/**
+ * Makes the calling thread prefer the memory of a NUMA node for its allocations, until it is
+ * destroyed and the previous memory policy of the thread is restored. The policy applies to the
+ * pages the thread touches first, memory which the allocator already holds stays where it is.
+ */
+class ScopedNumaMemoryPolicy : NonCopyable, Logger::Loggable<Logger::Id::main> {
+public:
+  /**
+   * @param node supplies the NUMA node to prefer, if any.
+   */
+  explicit ScopedNumaMemoryPolicy(absl::optional<uint32_t> node);
+  ~ScopedNumaMemoryPolicy();
+
+  /**
+   * @return bool whether the node is preferred, which fails on hosts without NUMA support.
+   */
+  bool active() const { return active_; }
+
+  static const uint32_t MaxNumaNodes = 1024;
+
+private:
+  bool active_{};
+  int previous_mode_{};
+  std::array<unsigned long, MaxNumaNodes / 64> previous_nodes_{};
+};
+
+/**
+ * Placement of the worker threads on the CPUs and NUMA nodes of the host, as configured by the
+ * bootstrap's worker_placement.
+ */
+class WorkerPlacement {
+public:
+  /**
+   * CPUs of the host.
+   */
+  struct Topology {
+    // CPUs the process is allowed to run on.
+    std::set<uint32_t> allowed_cpus_;
+    // NUMA node of each CPU. CPUs which are missing are considered to be on node 0.
+    std::unordered_map<uint32_t, uint32_t> cpu_nodes_;
+  };
+
+  /**
+   * @param config supplies the placement configuration.
+   * @param topology supplies the CPUs of the host.
+   * @throw EnvoyException if the configuration is invalid for the host.
+   */
+  WorkerPlacement(const envoy::config::bootstrap::v2::WorkerPlacement& config,
+                  const Topology& topology);
+
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return std::vector<uint32_t> the CPUs the worker is pinned to.
+   */
+  std::vector<uint32_t> workerCpus(uint32_t worker_index) const;
+
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return absl::optional<uint32_t> the CPU to set as SO_INCOMING_CPU of the sockets of the
+   *         worker, if any.
+   */
+  absl::optional<uint32_t> workerIncomingCpu(uint32_t worker_index) const;
+
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return uint32_t the NUMA node of the CPUs the worker is pinned to.
+   */
+  uint32_t workerNumaNode(uint32_t worker_index) const;
+
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @param scope supplies the scope of the worker's placement stats.
+   * @return WorkerAffinityPtr the placement of the worker.
+   */
+  WorkerAffinityPtr createWorkerAffinity(uint32_t worker_index, Stats::Scope& scope) const;
+
+  /**
+   * @return Topology the CPUs of the host, read from sysfs.
+   * @throw EnvoyException if the platform does not support worker placement.
+   */
+  static Topology hostTopology();
+
+  /**
+   * Parse a list of CPUs in the format of the Linux cpuset lists, e.g. "0-3,8,10-11".
+   * @param list supplies the list to parse.
+   * @return std::vector<uint32_t> the sorted CPUs of the list, without duplicates.
+   * @throw EnvoyException if the list is malformed.
+   */
+  static std::vector<uint32_t> parseCpuList(absl::string_view list);
+
+  // CPUs are identified by their index in a cpu_set_t.
+  static const uint32_t MaxCpus = 1024;
+
+private:
+  std::vector<uint32_t> cpus_;
+  const bool numa_node_affinity_;
+  const bool incoming_cpu_;
+  // The NUMA node of each CPU of the list, and with numa_node_affinity, the CPUs of the list on
+  // each of these nodes.
+  std::unordered_map<uint32_t, uint32_t> cpu_nodes_;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> node_cpus_;
+};
+
+typedef std::unique_ptr<const WorkerPlacement> WorkerPlacementConstPtr;
+
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,69 @@
+// Note: this should be run with --compilation_mode=opt, and would benefit from a
+// quiescent system with disabled cstate power management.
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "common/common/thread.h"
+#include "common/event/dispatcher_impl.h"
+#include "common/event/libevent.h"
+#include "common/event/real_time_system.h"
+
+#include "testing/base/public/benchmark.h"
+
+namespace Envoy {
+
+// Measures the throughput of callbacks posted to a dispatcher by state.range(0) threads, as done
+// by thread local slot updates, while the dispatcher runs them on its own thread.
+static void BM_CrossThreadPost(benchmark::State& state) {
+  const uint32_t num_producers = state.range(0);
+  const uint64_t posts_per_producer = 10000;
+  const uint64_t num_posts = num_producers * posts_per_producer;
+
+  Event::RealTimeSystem time_system;
+  Event::DispatcherImpl dispatcher(time_system);
+  Thread::ThreadFactoryImpl thread_factory;
+  // Keeps the dispatcher running until every callback ran, as it would otherwise return as soon as
+  // it has no pending events.
+  Event::TimerPtr keepalive = dispatcher.createTimer([]() {});
+
+  for (auto _ : state) {
+    uint64_t ran = 0;
+    keepalive->enableTimer(std::chrono::hours(1));
+
+    std::vector<Thread::ThreadPtr> producers;
+    for (uint32_t i = 0; i < num_producers; ++i) {
+      producers.push_back(thread_factory.createThread([&]() {
+        for (uint64_t j = 0; j < posts_per_producer; ++j) {
+          dispatcher.post([&]() {
+            if (++ran == num_posts) {
+              keepalive->disableTimer();
+              dispatcher.exit();
+            }
+          });
+        }
+      }));
+    }
+
+    dispatcher.run(Event::Dispatcher::RunType::Block);
+    for (Thread::ThreadPtr& producer : producers) {
+      producer->join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_posts);
+}
+BENCHMARK(BM_CrossThreadPost)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+} // namespace Envoy
+
+// Boilerplate main(), which discovers benchmarks in the same file and runs them.
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  Envoy::Event::Libevent::Global::initialize();
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+}
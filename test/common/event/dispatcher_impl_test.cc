@@ -3,18 +3,24 @@
 #include "envoy/thread/thread.h"
 
 #include "common/api/api_impl.h"
+#include "common/common/fmt.h"
 #include "common/common/lock_guard.h"
 #include "common/event/dispatcher_impl.h"
 #include "common/stats/isolated_store_impl.h"
 
 #include "test/mocks/common.h"
+#include "test/mocks/stats/mocks.h"
+#include "test/test_common/simulated_time_system.h"
 #include "test/test_common/test_time.h"
 #include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using testing::HasSubstr;
 using testing::InSequence;
+using testing::NiceMock;
+using testing::Property;
 
 namespace Envoy {
 namespace Event {
@@ -126,7 +132,7 @@ TEST_F(DispatcherImplTest, RunPostCallbacksLocking) {
     // Block dispatcher first to ensure that both posted events below are handled
     // by a single call to runPostCallbacks().
     //
-    // This also ensures that the post_lock_ is not held while callbacks are called,
+    // This also ensures that no lock is held while callbacks are called,
     // or else this would deadlock.
     Thread::LockGuard lock(mu_);
     dispatcher_->post([this]() { Thread::LockGuard lock(mu_); });
@@ -175,5 +181,101 @@ TEST_F(DispatcherImplTest, Timer) {
   }
 }
 
+TEST_F(DispatcherImplTest, CoarseTimer) {
+  TimerPtr timer;
+  dispatcher_->post([this, &timer]() {
+    // Coarse timers are not thread safe, so the timer is armed on the dispatcher thread.
+    timer = dispatcher_->createCoarseTimer([this]() {
+      {
+        Thread::LockGuard lock(mu_);
+        work_finished_ = true;
+      }
+      cv_.notifyOne();
+    });
+    timer->enableTimer(std::chrono::milliseconds(50));
+  });
+
+  Thread::LockGuard lock(mu_);
+  while (!work_finished_) {
+    cv_.wait(mu_);
+  }
+}
+
+// Callbacks are timed once stats are initialized, and slow ones are recorded with the function
+// defining them.
+TEST(DispatcherStatsTest, SlowCallbacks) {
+  SimulatedTimeSystem time_system;
+  NiceMock<Stats::MockIsolatedStatsStore> store;
+  DispatcherImpl dispatcher(time_system);
+  dispatcher.initializeStats(store, "test.", std::chrono::milliseconds(10));
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  ASSERT_EQ(1, write(fds[1], "x", 1));
+  FileEventPtr file_event = dispatcher.createFileEvent(
+      fds[0], [&](uint32_t) { time_system.sleep(std::chrono::milliseconds(30)); },
+      FileTriggerType::Level, FileReadyType::Read);
+  TimerPtr fast_timer = dispatcher.createTimer([]() {});
+  TimerPtr slow_timer =
+      dispatcher.createTimer([&]() { time_system.sleep(std::chrono::milliseconds(20)); });
+  dispatcher.post([&]() { time_system.sleep(std::chrono::milliseconds(15)); });
+  dispatcher.post([]() {});
+  fast_timer->enableTimer(std::chrono::milliseconds(0));
+  slow_timer->enableTimer(std::chrono::milliseconds(0));
+
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.post_queue_depth"), 2));
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.loop_events"), 3));
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.loop_poll_us"), 0));
+  EXPECT_CALL(store, deliverHistogramToSinks(
+                         Property(&Stats::Metric::name, "test.dispatcher.loop_processing_us"),
+                         50000));
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+
+  EXPECT_EQ(3, store.counter("test.dispatcher.slow_callbacks").value());
+  const std::vector<SlowCallback> slow_callbacks = dispatcher.recentSlowCallbacks();
+  ASSERT_EQ(3, slow_callbacks.size());
+  EXPECT_EQ("post", slow_callbacks[2].kind_);
+  EXPECT_EQ(std::chrono::microseconds(15000), slow_callbacks[2].duration_);
+  for (const SlowCallback& slow_callback : slow_callbacks) {
+    EXPECT_THAT(slow_callback.description_,
+                HasSubstr("DispatcherStatsTest_SlowCallbacks_Test::TestBody()"));
+  }
+  // The file event and the slow timer ran in either order.
+  const SlowCallback& file_callback =
+      slow_callbacks[0].kind_ == "file_event" ? slow_callbacks[0] : slow_callbacks[1];
+  EXPECT_EQ("file_event", file_callback.kind_);
+  EXPECT_THAT(file_callback.description_, HasSubstr(fmt::format("(fd {})", fds[0])));
+  EXPECT_EQ(std::chrono::microseconds(30000), file_callback.duration_);
+
+  file_event.reset();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// Only the most recent slow callbacks are kept, and a zero threshold disables their detection.
+TEST(DispatcherStatsTest, SlowCallbackThreshold) {
+  SimulatedTimeSystem time_system;
+  NiceMock<Stats::MockIsolatedStatsStore> store;
+  DispatcherImpl dispatcher(time_system);
+  dispatcher.initializeStats(store, "test.", std::chrono::milliseconds(10));
+  for (size_t i = 0; i < DispatcherImpl::MaxRecentSlowCallbacks + 1; ++i) {
+    dispatcher.post([&]() { time_system.sleep(std::chrono::milliseconds(10)); });
+  }
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(DispatcherImpl::MaxRecentSlowCallbacks + 1,
+            store.counter("test.dispatcher.slow_callbacks").value());
+  EXPECT_EQ(DispatcherImpl::MaxRecentSlowCallbacks, dispatcher.recentSlowCallbacks().size());
+
+  DispatcherImpl disabled(time_system);
+  disabled.initializeStats(store, "disabled.", std::chrono::milliseconds(0));
+  disabled.post([&]() { time_system.sleep(std::chrono::milliseconds(100)); });
+  disabled.run(Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(0, store.counter("disabled.dispatcher.slow_callbacks").value());
+  EXPECT_TRUE(disabled.recentSlowCallbacks().empty());
+}
+
 } // namespace Event
 } // namespace Envoy
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "common/common/thread.h"
+#include "common/event/post_queue.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Event {
+
+TEST(PostQueueTest, RunInOrder) {
+  PostQueue queue;
+  std::vector<int> ran;
+  EXPECT_TRUE(queue.push([&ran]() { ran.push_back(1); }));
+  EXPECT_FALSE(queue.push([&ran]() { ran.push_back(2); }));
+  EXPECT_FALSE(queue.push([&ran]() { ran.push_back(3); }));
+  queue.runAll();
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), ran);
+
+  // Running the callbacks asks for the next push to wake the consumer up.
+  EXPECT_TRUE(queue.push([&ran]() { ran.push_back(4); }));
+  queue.runAll();
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), ran);
+
+  queue.runAll();
+  EXPECT_TRUE(queue.push([]() {}));
+}
+
+// Callbacks pushed while the pool is exhausted use heap allocated nodes, and released nodes are
+// reused.
+TEST(PostQueueTest, PoolExhausted) {
+  PostQueue queue(2);
+  std::vector<int> ran;
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 5; ++i) {
+      queue.push([&ran, i]() { ran.push_back(i); });
+    }
+    queue.runAll();
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), ran);
+    ran.clear();
+  }
+
+  PostQueue empty_pool(0);
+  empty_pool.push([&ran]() { ran.push_back(1); });
+  empty_pool.runAll();
+  EXPECT_EQ(std::vector<int>({1}), ran);
+}
+
+// Callbacks pushed while running, including by the destruction of a callback, run in the same
+// call.
+TEST(PostQueueTest, PushWhileRunning) {
+  PostQueue queue;
+  std::vector<int> ran;
+
+  class PushOnDestroy {
+  public:
+    PushOnDestroy(PostQueue& queue, std::vector<int>& ran) : queue_(queue), ran_(ran) {}
+    ~PushOnDestroy() {
+      queue_.push([&ran = ran_]() { ran.push_back(3); });
+    }
+
+  private:
+    PostQueue& queue_;
+    std::vector<int>& ran_;
+  };
+  auto push_on_destroy = std::make_shared<PushOnDestroy>(queue, ran);
+
+  queue.push([&queue, &ran]() {
+    ran.push_back(1);
+    queue.push([&ran]() { ran.push_back(2); });
+  });
+  queue.push([push_on_destroy]() {});
+  push_on_destroy.reset();
+  queue.runAll();
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), ran);
+}
+
+// Callbacks which are never run are destroyed with the queue.
+TEST(PostQueueTest, DestroyPending) {
+  auto state = std::make_shared<int>(0);
+  {
+    PostQueue queue(1);
+    queue.push([state]() {});
+    queue.push([state]() {});
+    EXPECT_EQ(3, state.use_count());
+  }
+  EXPECT_EQ(1, state.use_count());
+}
+
+// Callbacks pushed by several threads while the consumer runs them all run exactly once, in the
+// order each thread pushed them.
+TEST(PostQueueTest, ConcurrentProducers) {
+  const int num_producers = 4;
+  const int num_callbacks = 20000;
+  PostQueue queue(64);
+  std::vector<int> last(num_producers, -1);
+  std::atomic<int> done{};
+  int ran = 0;
+
+  Thread::ThreadFactoryImpl thread_factory;
+  std::vector<Thread::ThreadPtr> producers;
+  for (int producer = 0; producer < num_producers; ++producer) {
+    producers.push_back(thread_factory.createThread([&, producer]() {
+      for (int i = 0; i < num_callbacks; ++i) {
+        queue.push([&, producer, i]() {
+          EXPECT_EQ(last[producer] + 1, i);
+          last[producer] = i;
+          ++ran;
+        });
+      }
+      ++done;
+    }));
+  }
+
+  while (done < num_producers) {
+    queue.runAll();
+  }
+  for (Thread::ThreadPtr& producer : producers) {
+    producer->join();
+  }
+  queue.runAll();
+  EXPECT_EQ(num_producers * num_callbacks, ran);
+}
+
+} // namespace Event
+} // namespace Envoy
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "common/event/libevent.h"
+#include "common/event/timer_wheel_impl.h"
+
+#include "test/test_common/simulated_time_system.h"
+
+#include "event2/event.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Event {
+namespace {
+
+class TimerWheelTest : public testing::Test {
+protected:
+  TimerWheelTest()
+      : event_system_(event_base_new()), scheduler_(time_system_.createScheduler(event_system_)),
+        wheel_(*scheduler_, time_system_, std::chrono::milliseconds(10)),
+        start_(time_system_.monotonicTime()) {}
+
+  TimerPtr createTimer(char marker) {
+    return wheel_.createTimer([this, marker]() -> void {
+      output_.append(1, marker);
+      fire_times_.push_back(time_system_.monotonicTime() - start_);
+    });
+  }
+
+  template <class Duration> void sleepAndLoop(const Duration& duration) {
+    time_system_.sleep(duration);
+    event_base_loop(event_system_.get(), EVLOOP_NONBLOCK);
+  }
+
+  SimulatedTimeSystem time_system_;
+  Libevent::BasePtr event_system_;
+  SchedulerPtr scheduler_;
+  TimerWheel wheel_;
+  const MonotonicTime start_;
+  std::string output_;
+  std::vector<MonotonicTime::duration> fire_times_;
+};
+
+// Timers fire at the first tick after their timeout, in order.
+TEST_F(TimerWheelTest, FireInOrder) {
+  TimerPtr timer_a = createTimer('a');
+  TimerPtr timer_b = createTimer('b');
+  TimerPtr timer_c = createTimer('c');
+  timer_b->enableTimer(std::chrono::milliseconds(45));
+  timer_a->enableTimer(std::chrono::milliseconds(25));
+  timer_c->enableTimer(std::chrono::milliseconds(50));
+
+  sleepAndLoop(std::chrono::milliseconds(25));
+  EXPECT_EQ("", output_);
+  sleepAndLoop(std::chrono::milliseconds(5));
+  EXPECT_EQ("a", output_);
+  sleepAndLoop(std::chrono::milliseconds(20));
+  EXPECT_EQ("abc", output_);
+  EXPECT_EQ(std::chrono::milliseconds(30), fire_times_[0]);
+  EXPECT_EQ(std::chrono::milliseconds(50), fire_times_[1]);
+}
+
+TEST_F(TimerWheelTest, Disable) {
+  TimerPtr timer_a = createTimer('a');
+  TimerPtr timer_b = createTimer('b');
+  timer_a->enableTimer(std::chrono::milliseconds(20));
+  timer_b->enableTimer(std::chrono::milliseconds(20));
+  timer_a->disableTimer();
+  timer_b.reset();
+  sleepAndLoop(std::chrono::seconds(1));
+  EXPECT_EQ("", output_);
+
+  timer_a->enableTimer(std::chrono::milliseconds(20));
+  sleepAndLoop(std::chrono::milliseconds(20));
+  EXPECT_EQ("a", output_);
+}
+
+// Re-arming an armed timer replaces its timeout, whether later or earlier.
+TEST_F(TimerWheelTest, Rearm) {
+  TimerPtr timer = createTimer('a');
+  timer->enableTimer(std::chrono::milliseconds(100));
+  sleepAndLoop(std::chrono::milliseconds(50));
+  timer->enableTimer(std::chrono::milliseconds(100));
+  sleepAndLoop(std::chrono::milliseconds(60));
+  EXPECT_EQ("", output_);
+  sleepAndLoop(std::chrono::milliseconds(40));
+  EXPECT_EQ("a", output_);
+
+  timer->enableTimer(std::chrono::seconds(100));
+  timer->enableTimer(std::chrono::milliseconds(10));
+  sleepAndLoop(std::chrono::milliseconds(10));
+  EXPECT_EQ("aa", output_);
+}
+
+// Timers beyond the first level are moved down the wheel and fire at their timeout.
+TEST_F(TimerWheelTest, HigherLevels) {
+  TimerPtr timer_a = createTimer('a');
+  TimerPtr timer_b = createTimer('b');
+  TimerPtr timer_c = createTimer('c');
+  timer_a->enableTimer(std::chrono::seconds(5));
+  timer_b->enableTimer(std::chrono::hours(1));
+  timer_c->enableTimer(std::chrono::hours(24 * 30));
+
+  sleepAndLoop(std::chrono::milliseconds(4990));
+  EXPECT_EQ("", output_);
+  sleepAndLoop(std::chrono::milliseconds(10));
+  EXPECT_EQ("a", output_);
+  sleepAndLoop(std::chrono::hours(1) - std::chrono::seconds(6));
+  EXPECT_EQ("a", output_);
+  sleepAndLoop(std::chrono::seconds(1));
+  EXPECT_EQ("ab", output_);
+  EXPECT_EQ(std::chrono::hours(1), fire_times_[1]);
+  sleepAndLoop(std::chrono::hours(24 * 30 - 2));
+  EXPECT_EQ("ab", output_);
+  sleepAndLoop(std::chrono::hours(1));
+  EXPECT_EQ("abc", output_);
+  EXPECT_EQ(std::chrono::hours(24 * 30), fire_times_[2]);
+}
+
+// Timers further than the wheel covers wait at its end until they can be placed.
+TEST_F(TimerWheelTest, BeyondWheel) {
+  TimerWheel wheel(*scheduler_, time_system_, std::chrono::milliseconds(1));
+  TimerPtr timer = wheel.createTimer([this]() -> void { output_.append("a"); });
+  timer->enableTimer(std::chrono::hours(24 * 60));
+  sleepAndLoop(std::chrono::hours(24 * 50));
+  EXPECT_EQ("", output_);
+  sleepAndLoop(std::chrono::hours(24 * 10) - std::chrono::milliseconds(1));
+  EXPECT_EQ("", output_);
+  sleepAndLoop(std::chrono::milliseconds(1));
+  EXPECT_EQ("a", output_);
+}
+
+// Callbacks may re-arm, disarm or destroy timers due at the same tick.
+TEST_F(TimerWheelTest, ModifyFromCallback) {
+  TimerPtr timer_b;
+  TimerPtr timer_c;
+  TimerPtr timer_a = wheel_.createTimer([&]() -> void {
+    output_.append("a");
+    timer_a->enableTimer(std::chrono::milliseconds(10));
+    timer_b->disableTimer();
+    timer_c.reset();
+  });
+  timer_b = createTimer('b');
+  timer_c = createTimer('c');
+  timer_a->enableTimer(std::chrono::milliseconds(10));
+  timer_b->enableTimer(std::chrono::milliseconds(10));
+  timer_c->enableTimer(std::chrono::milliseconds(10));
+
+  sleepAndLoop(std::chrono::milliseconds(10));
+  EXPECT_EQ("a", output_);
+  sleepAndLoop(std::chrono::milliseconds(10));
+  EXPECT_EQ("aa", output_);
+}
+
+// Timers armed after the wheel has been idle are placed relative to the current time.
+TEST_F(TimerWheelTest, ArmAfterIdle) {
+  TimerPtr timer = createTimer('a');
+  sleepAndLoop(std::chrono::hours(10));
+  timer->enableTimer(std::chrono::milliseconds(30));
+  sleepAndLoop(std::chrono::milliseconds(20));
+  EXPECT_EQ("", output_);
+  sleepAndLoop(std::chrono::milliseconds(10));
+  EXPECT_EQ("a", output_);
+}
+
+} // namespace
+} // namespace Event
+} // namespace Envoy
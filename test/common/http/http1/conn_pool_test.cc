@@ -722,6 +722,80 @@ TEST_F(Http1ConnPoolImplTest, RemoteCloseToCompleteResponse) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+/**
+ * Test that warming up opens the warm connections of the cluster, which then serve requests
+ * without connecting.
+ */
+TEST_F(Http1ConnPoolImplTest, WarmUp) {
+  cluster_->resetResourceManager(2, 1024, 1024, 1);
+  cluster_->warm_connections_ = 2;
+  InSequence s;
+
+  conn_pool_.expectClientCreate();
+  conn_pool_.expectClientCreate();
+  conn_pool_.warmUp();
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_preconnect_.value());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  // The pool already has its warm connections.
+  conn_pool_.warmUp();
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  ActiveTestRequest r1(*this, 1, ActiveTestRequest::Type::Immediate);
+  r1.startRequest();
+  r1.completeResponse(false);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_preconnect_.value());
+}
+
+/**
+ * Test that the preconnect ratio opens connections ahead of the requests, within the connection
+ * circuit breaker.
+ */
+TEST_F(Http1ConnPoolImplTest, PreconnectRatio) {
+  cluster_->resetResourceManager(2, 1024, 1024, 1);
+  cluster_->per_upstream_preconnect_ratio_ = 2;
+  InSequence s;
+
+  // The first request opens its connection, and a second one for the next request.
+  conn_pool_.expectClientCreate();
+  conn_pool_.expectClientCreate();
+  NiceMock<Http::MockStreamDecoder> outer_decoder;
+  ConnPoolCallbacks callbacks;
+  Http::ConnectionPool::Cancellable* handle = conn_pool_.newStream(outer_decoder, callbacks);
+  EXPECT_NE(nullptr, handle);
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  NiceMock<Http::MockStreamEncoder> request_encoder;
+  Http::StreamDecoder* inner_decoder;
+  EXPECT_CALL(*conn_pool_.test_clients_[0].codec_, newStream(_))
+      .WillOnce(DoAll(SaveArgAddress(&inner_decoder), ReturnRef(request_encoder)));
+  EXPECT_CALL(callbacks.pool_ready_, ready());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  // The second request does not wait for a connection. The ratio asks for 2 more connections, but
+  // the circuit breaker is reached.
+  ActiveTestRequest r2(*this, 1, ActiveTestRequest::Type::Immediate);
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_.value());
+  EXPECT_EQ(0U, cluster_->stats_.upstream_cx_overflow_.value());
+
+  callbacks.outer_encoder_->encodeHeaders(TestHeaderMapImpl{}, true);
+  inner_decoder->decodeHeaders(HeaderMapPtr{new TestHeaderMapImpl{{":status", "200"}}}, true);
+  r2.startRequest();
+  r2.completeResponse(false);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
 } // namespace Http1
 } // namespace Http
 } // namespace Envoy
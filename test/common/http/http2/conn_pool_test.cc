@@ -626,6 +626,56 @@ TEST_F(Http2ConnPoolImplTest, GoAway) {
   EXPECT_EQ(1U, cluster_->stats_.upstream_cx_close_notify_.value());
 }
 
+/**
+ * Test that warming up opens the primary connection, which then serves the requests without
+ * connecting.
+ */
+TEST_F(Http2ConnPoolImplTest, WarmUp) {
+  InSequence s;
+
+  // Nothing is opened without warm connections.
+  pool_.warmUp();
+  EXPECT_EQ(0U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  cluster_->warm_connections_ = 2;
+  expectClientCreate();
+  pool_.warmUp();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  // The primary connection serves all the streams, so there is no second connection to open.
+  pool_.warmUp();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  EXPECT_CALL(*test_clients_[0].connect_timer_, disableTimer());
+  test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  ActiveTestRequest r1(*this, 0, true);
+  EXPECT_CALL(r1.inner_encoder_, encodeHeaders(_, true));
+  r1.callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+  EXPECT_CALL(r1.decoder_, decodeHeaders_(_, true));
+  r1.inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+
+  test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(*this, onClientDestroy());
+  dispatcher_.clearDeferredDeleteList();
+}
+
+/**
+ * Test that a draining pool is not warmed up.
+ */
+TEST_F(Http2ConnPoolImplTest, NoWarmUpWhileDraining) {
+  InSequence s;
+  cluster_->warm_connections_ = 1;
+
+  ReadyWatcher drained;
+  EXPECT_CALL(drained, ready());
+  pool_.addDrainedCallback([&]() -> void { drained.ready(); });
+
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _, _, _)).Times(0);
+  pool_.warmUp();
+  EXPECT_EQ(0U, cluster_->stats_.upstream_cx_preconnect_.value());
+}
+
 } // namespace Http2
 } // namespace Http
 } // namespace Envoy
@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <vector>
+
+#include "common/network/connection_balancer_impl.h"
+
+#include "test/mocks/network/mocks.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Network {
+namespace {
+
+using testing::NiceMock;
+
+class TestHandler : public BalancedConnectionHandler {
+public:
+  TestHandler(uint64_t num_connections) : num_connections_(num_connections) {}
+
+  // Network::BalancedConnectionHandler
+  uint64_t numConnections() const override { return num_connections_; }
+  void incNumConnections() override { ++num_connections_; }
+  void post(ConnectionSocketPtr&& socket) override { posted_.push_back(std::move(socket)); }
+
+  uint64_t num_connections_;
+  std::vector<ConnectionSocketPtr> posted_;
+};
+
+TEST(NopConnectionBalancerImplTest, PickCurrent) {
+  NopConnectionBalancerImpl balancer;
+  TestHandler handler_1(5);
+  TestHandler handler_2(0);
+  balancer.registerHandler(handler_1);
+  balancer.registerHandler(handler_2);
+
+  ConnectionSocketPtr socket = std::make_unique<NiceMock<MockConnectionSocket>>();
+  EXPECT_FALSE(balancer.balanceConnection(handler_1, socket));
+  EXPECT_NE(nullptr, socket);
+  EXPECT_EQ(6, handler_1.numConnections());
+  EXPECT_TRUE(handler_2.posted_.empty());
+}
+
+TEST(ExactConnectionBalancerImplTest, PickFewestConnections) {
+  ExactConnectionBalancerImpl balancer;
+  TestHandler handler_1(2);
+  TestHandler handler_2(1);
+  TestHandler handler_3(1);
+  balancer.registerHandler(handler_1);
+  balancer.registerHandler(handler_2);
+  balancer.registerHandler(handler_3);
+
+  // The socket is posted to the picked handler.
+  ConnectionSocketPtr socket = std::make_unique<NiceMock<MockConnectionSocket>>();
+  Network::ConnectionSocket* socket_ptr = socket.get();
+  EXPECT_TRUE(balancer.balanceConnection(handler_1, socket));
+  EXPECT_EQ(nullptr, socket);
+  EXPECT_EQ(2, handler_2.numConnections());
+  ASSERT_EQ(1, handler_2.posted_.size());
+  EXPECT_EQ(socket_ptr, handler_2.posted_[0].get());
+  socket = std::make_unique<NiceMock<MockConnectionSocket>>();
+  EXPECT_TRUE(balancer.balanceConnection(handler_1, socket));
+  EXPECT_EQ(2, handler_3.numConnections());
+  EXPECT_EQ(1, handler_3.posted_.size());
+
+  // Ties go to the current handler, which keeps the socket.
+  socket = std::make_unique<NiceMock<MockConnectionSocket>>();
+  EXPECT_FALSE(balancer.balanceConnection(handler_3, socket));
+  EXPECT_NE(nullptr, socket);
+  EXPECT_EQ(3, handler_3.numConnections());
+  EXPECT_FALSE(balancer.balanceConnection(handler_1, socket));
+  EXPECT_EQ(3, handler_1.numConnections());
+  EXPECT_TRUE(handler_1.posted_.empty());
+  EXPECT_EQ(1, handler_3.posted_.size());
+}
+
+TEST(ExactConnectionBalancerImplTest, Unregister) {
+  ExactConnectionBalancerImpl balancer;
+  TestHandler handler_1(2);
+  TestHandler handler_2(0);
+  balancer.registerHandler(handler_1);
+  balancer.registerHandler(handler_2);
+
+  balancer.unregisterHandler(handler_2);
+  ConnectionSocketPtr socket = std::make_unique<NiceMock<MockConnectionSocket>>();
+  EXPECT_FALSE(balancer.balanceConnection(handler_1, socket));
+  EXPECT_EQ(0, handler_2.numConnections());
+  EXPECT_TRUE(handler_2.posted_.empty());
+
+  // An unregistered handler is only picked if no handler is registered.
+  EXPECT_TRUE(balancer.balanceConnection(handler_2, socket));
+  EXPECT_EQ(1, handler_1.posted_.size());
+  balancer.unregisterHandler(handler_1);
+  socket = std::make_unique<NiceMock<MockConnectionSocket>>();
+  EXPECT_FALSE(balancer.balanceConnection(handler_2, socket));
+  EXPECT_EQ(1, handler_2.numConnections());
+
+  // Unregistering a handler which is not registered has no effect.
+  balancer.unregisterHandler(handler_1);
+}
+
+} // namespace
+} // namespace Network
+} // namespace Envoy
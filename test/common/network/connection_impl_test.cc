@@ -914,6 +914,40 @@ TEST_P(ConnectionImplTest, EmptyReadOnCloseTest) {
   disconnect(true);
 }
 
+// Test that the bytes read from the socket by the listener filters are delivered to the read filters
+// first, without waiting for the socket to be readable again.
+TEST_P(ConnectionImplTest, PreReadData) {
+  setUpBasicConnection();
+  client_connection_->connect();
+  read_filter_.reset(new NiceMock<MockReadFilter>());
+  EXPECT_CALL(listener_callbacks_, onAccept_(_, _))
+      .WillOnce(Invoke([&](Network::ConnectionSocketPtr& socket, bool) -> void {
+        socket->preReadData().add("hello ");
+        server_connection_ = dispatcher_->createServerConnection(
+            std::move(socket), Network::Test::createRawBufferSocket());
+        server_connection_->addConnectionCallbacks(server_callbacks_);
+        server_connection_->addReadFilter(read_filter_);
+      }));
+  EXPECT_CALL(client_callbacks_, onEvent(ConnectionEvent::Connected));
+  EXPECT_CALL(*read_filter_, onNewConnection());
+  EXPECT_CALL(*read_filter_, onData(_, false))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) -> FilterStatus {
+        EXPECT_EQ("hello ", data.toString());
+        data.drain(data.length());
+        Buffer::OwnedImpl more_data("world");
+        client_connection_->write(more_data, false);
+        return FilterStatus::StopIteration;
+      }))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) -> FilterStatus {
+        EXPECT_EQ("world", data.toString());
+        dispatcher_->exit();
+        return FilterStatus::StopIteration;
+      }));
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+  disconnect(true);
+}
+
 // Test that a FlushWrite close immediately triggers a close after the write buffer is flushed.
 TEST_P(ConnectionImplTest, FlushWriteCloseTest) {
   setUpBasicConnection();
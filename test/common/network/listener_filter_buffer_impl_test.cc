@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "common/network/listener_filter_buffer_impl.h"
+
+#include "test/mocks/api/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/test_common/threadsafe_singleton_injector.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Network {
+namespace {
+
+class ListenerFilterBufferImplTest : public testing::Test {
+public:
+  ListenerFilterBufferImplTest() : buffer_(socket_) {
+    ON_CALL(socket_, fd()).WillByDefault(Return(42));
+  }
+
+  // Make the next read from the socket return the given data, and check that it asks for
+  // max_length bytes.
+  void expectRead(const std::string& data, size_t max_length) {
+    EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+        .WillOnce(Invoke([data, max_length](int, const iovec* iov, int num_iov) {
+          size_t length = 0;
+          for (int i = 0; i < num_iov; i++) {
+            length += iov[i].iov_len;
+          }
+          EXPECT_EQ(max_length, length);
+          size_t copied = 0;
+          for (int i = 0; i < num_iov && copied < data.size(); i++) {
+            const size_t slice_length = std::min(iov[i].iov_len, data.size() - copied);
+            memcpy(iov[i].iov_base, data.data() + copied, slice_length);
+            copied += slice_length;
+          }
+          return Api::SysCallSizeResult{ssize_t(copied), 0};
+        }));
+  }
+
+  NiceMock<Api::MockOsSysCalls> os_sys_calls_;
+  TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls_{&os_sys_calls_};
+  NiceMock<MockConnectionSocket> socket_;
+  ListenerFilterBufferImpl buffer_;
+};
+
+// Test that each read appends the new bytes only.
+TEST_F(ListenerFilterBufferImplTest, IncrementalRead) {
+  expectRead("hello", 1024);
+  EXPECT_EQ(5, buffer_.readFromSocket(1024).rc_);
+  EXPECT_EQ("hello", buffer_.data());
+
+  expectRead(" world", 1019);
+  EXPECT_EQ(6, buffer_.readFromSocket(1024).rc_);
+  EXPECT_EQ("hello world", buffer_.data());
+}
+
+// Test that nothing is read once the requested length is buffered.
+TEST_F(ListenerFilterBufferImplTest, MaxLength) {
+  expectRead("hello", 5);
+  EXPECT_EQ(5, buffer_.readFromSocket(5).rc_);
+  EXPECT_EQ("hello", buffer_.data());
+
+  EXPECT_CALL(os_sys_calls_, readv(_, _, _)).Times(0);
+  EXPECT_EQ(0, buffer_.readFromSocket(5).rc_);
+  EXPECT_EQ("hello", buffer_.data());
+}
+
+// Test that errors are returned and leave the buffer untouched.
+TEST_F(ListenerFilterBufferImplTest, ReadError) {
+  expectRead("hello", 1024);
+  buffer_.readFromSocket(1024);
+
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(-1), EAGAIN}));
+  const Api::SysCallIntResult result = buffer_.readFromSocket(1024);
+  EXPECT_EQ(-1, result.rc_);
+  EXPECT_EQ(EAGAIN, result.errno_);
+  EXPECT_EQ("hello", buffer_.data());
+}
+
+// Test that draining drops the bytes from the front of the buffer, and that the following reads
+// append to what is left.
+TEST_F(ListenerFilterBufferImplTest, Drain) {
+  expectRead("hello world", 1024);
+  buffer_.readFromSocket(1024);
+
+  buffer_.drain(6);
+  EXPECT_EQ("world", buffer_.data());
+
+  expectRead("!", 1019);
+  EXPECT_EQ(1, buffer_.readFromSocket(1024).rc_);
+  EXPECT_EQ("world!", buffer_.data());
+
+  buffer_.drain(6);
+  EXPECT_TRUE(buffer_.data().empty());
+}
+
+// Test that the bytes are kept by the socket, for the buffers of the listeners the socket is
+// handed off to, and for the transport socket of its connection.
+TEST_F(ListenerFilterBufferImplTest, KeptBySocket) {
+  expectRead("hello", 1024);
+  buffer_.readFromSocket(1024);
+  EXPECT_EQ("hello", socket_.pre_read_data_.toString());
+
+  ListenerFilterBufferImpl other_buffer(socket_);
+  EXPECT_EQ("hello", other_buffer.data());
+  other_buffer.drain(1);
+  EXPECT_EQ("ello", buffer_.data());
+}
+
+} // namespace
+} // namespace Network
+} // namespace Envoy
@@ -23,6 +23,7 @@
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/environment.h"
 #include "test/test_common/printers.h"
+#include "test/test_common/simulated_time_system.h"
 #include "test/test_common/test_time.h"
 #include "test/test_common/utility.h"
 
@@ -1985,6 +1986,110 @@ TEST_F(RouterTest, AltStatName) {
                     .value());
 }
 
+class RouterPeakEwmaTest : public RouterTest {
+public:
+  RouterPeakEwmaTest() {
+    cm_.thread_local_cluster_.cluster_.info_->lb_type_ = Upstream::LoadBalancerType::PeakEwma;
+    callbacks_.dispatcher_.setTimeSystem(time_system_);
+  }
+
+  Event::SimulatedTimeSystem time_system_;
+};
+
+// The response times are reported to the load balancer of the cluster when it uses them, from the
+// start of the attempt.
+TEST_F(RouterPeakEwmaTest, ResponseTime) {
+  NiceMock<Http::MockStreamEncoder> encoder;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, false);
+  time_system_.sleep(std::chrono::milliseconds(10));
+  Buffer::OwnedImpl data;
+  router_.decodeData(data, true);
+  time_system_.sleep(std::chrono::milliseconds(5));
+
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_,
+              onHostResponse(Ref(*cm_.conn_pool_.host_), std::chrono::microseconds(15000), true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+}
+
+// The time of a request which times out is reported as a lower bound of the response time, so that
+// a host which hangs does not get cheaper.
+TEST_F(RouterPeakEwmaTest, Timeout) {
+  NiceMock<Http::MockStreamEncoder> encoder;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder&, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+  time_system_.sleep(std::chrono::milliseconds(100));
+
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_,
+              onHostResponse(Ref(*cm_.conn_pool_.host_), std::chrono::microseconds(100000), false));
+  EXPECT_CALL(encoder.stream_, resetStream(Http::StreamResetReason::LocalReset));
+  response_timeout_->callback_();
+  EXPECT_EQ(1UL, cm_.conn_pool_.host_->stats().rq_timeout_.value());
+}
+
+// A reset attempt is reported as a lower bound of the response time, and the retry is charged its
+// own time only.
+TEST_F(RouterPeakEwmaTest, RetryUpstreamReset) {
+  NiceMock<Http::MockStreamEncoder> encoder1;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder&, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(encoder1, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers{{"x-envoy-retry-on", "5xx"}, {"x-envoy-internal", "true"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+  time_system_.sleep(std::chrono::milliseconds(20));
+
+  router_.retry_state_->expectRetry();
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_,
+              onHostResponse(Ref(*cm_.conn_pool_.host_), std::chrono::microseconds(20000), false));
+  encoder1.stream_.resetStream(Http::StreamResetReason::RemoteReset);
+  time_system_.sleep(std::chrono::milliseconds(25));
+
+  NiceMock<Http::MockStreamEncoder> encoder2;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder2, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  router_.retry_state_->callback_();
+  time_system_.sleep(std::chrono::milliseconds(5));
+
+  EXPECT_CALL(*router_.retry_state_, shouldRetry(_, _, _)).WillOnce(Return(RetryStatus::No));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_,
+              onHostResponse(Ref(*cm_.conn_pool_.host_), std::chrono::microseconds(5000), true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+}
+
 TEST_F(RouterTest, Redirect) {
   MockDirectResponseEntry direct_response;
   EXPECT_CALL(direct_response, newPath(_)).WillOnce(Return("hello"));
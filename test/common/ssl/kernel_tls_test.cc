@@ -0,0 +1,142 @@
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "common/ssl/kernel_tls.h"
+
+#include "test/mocks/api/mocks.h"
+#include "test/test_common/threadsafe_singleton_injector.h"
+
+#ifdef __linux__
+#include <linux/tls.h>
+#endif
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Ssl {
+namespace {
+
+// The control records are only read and sent when the kernel headers support kTLS receive.
+#ifdef TLS_RX
+class KernelTlsTest : public testing::Test {
+public:
+  // Make the next recvmsg() return a record of the given type and content.
+  void receiveRecord(uint8_t type, const std::vector<uint8_t>& content) {
+    EXPECT_CALL(os_sys_calls_, recvmsg(42, _, 0))
+        .WillOnce(Invoke([type, content](int, msghdr* message, int) {
+          const size_t size = std::min(content.size(), message->msg_iov[0].iov_len);
+          memcpy(message->msg_iov[0].iov_base, content.data(), size);
+          cmsghdr* cmsg = CMSG_FIRSTHDR(message);
+          cmsg->cmsg_level = SOL_TLS;
+          cmsg->cmsg_type = TLS_GET_RECORD_TYPE;
+          cmsg->cmsg_len = CMSG_LEN(sizeof(uint8_t));
+          *CMSG_DATA(cmsg) = type;
+          return Api::SysCallSizeResult{ssize_t(size), 0};
+        }));
+  }
+
+  NiceMock<Api::MockOsSysCalls> os_sys_calls_;
+  TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls_{&os_sys_calls_};
+};
+
+// TLS record types and alerts of RFC 5246.
+constexpr uint8_t RecordTypeAlert = 21;
+constexpr uint8_t RecordTypeHandshake = 22;
+constexpr uint8_t AlertLevelWarning = 1;
+constexpr uint8_t AlertLevelFatal = 2;
+constexpr uint8_t AlertCloseNotify = 0;
+constexpr uint8_t AlertHandshakeFailure = 40;
+constexpr uint8_t AlertNoRenegotiation = 100;
+
+TEST_F(KernelTlsTest, ReadCloseNotify) {
+  receiveRecord(RecordTypeAlert, {AlertLevelWarning, AlertCloseNotify});
+  EXPECT_EQ(KernelTls::ControlRecord::CloseNotify, KernelTls::readControlRecord(42));
+}
+
+// Warning alerts other than close_notify are ignored.
+TEST_F(KernelTlsTest, ReadWarningAlert) {
+  receiveRecord(RecordTypeAlert, {AlertLevelWarning, AlertNoRenegotiation});
+  EXPECT_EQ(KernelTls::ControlRecord::Again, KernelTls::readControlRecord(42));
+}
+
+TEST_F(KernelTlsTest, ReadFatalAlert) {
+  receiveRecord(RecordTypeAlert, {AlertLevelFatal, AlertHandshakeFailure});
+  EXPECT_EQ(KernelTls::ControlRecord::Error, KernelTls::readControlRecord(42));
+}
+
+// Renegotiation is not supported.
+TEST_F(KernelTlsTest, ReadHandshakeRecord) {
+  receiveRecord(RecordTypeHandshake, {0, 0});
+  EXPECT_EQ(KernelTls::ControlRecord::Error, KernelTls::readControlRecord(42));
+}
+
+TEST_F(KernelTlsTest, ReadTruncatedAlert) {
+  receiveRecord(RecordTypeAlert, {AlertLevelWarning});
+  EXPECT_EQ(KernelTls::ControlRecord::Error, KernelTls::readControlRecord(42));
+}
+
+// A record without its type is an error.
+TEST_F(KernelTlsTest, ReadWithoutRecordType) {
+  EXPECT_CALL(os_sys_calls_, recvmsg(42, _, 0)).WillOnce(Invoke([](int, msghdr* message, int) {
+    message->msg_controllen = 0;
+    return Api::SysCallSizeResult{ssize_t(2), 0};
+  }));
+  EXPECT_EQ(KernelTls::ControlRecord::Error, KernelTls::readControlRecord(42));
+}
+
+TEST_F(KernelTlsTest, ReadAgain) {
+  EXPECT_CALL(os_sys_calls_, recvmsg(42, _, 0))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(-1), EAGAIN}));
+  EXPECT_EQ(KernelTls::ControlRecord::Again, KernelTls::readControlRecord(42));
+}
+
+TEST_F(KernelTlsTest, ReadError) {
+  EXPECT_CALL(os_sys_calls_, recvmsg(42, _, 0))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(-1), ECONNRESET}));
+  EXPECT_EQ(KernelTls::ControlRecord::Error, KernelTls::readControlRecord(42));
+}
+
+// close_notify is sent as a warning alert record, which the kernel encrypts.
+TEST_F(KernelTlsTest, SendCloseNotify) {
+  EXPECT_CALL(os_sys_calls_, sendmsg(42, _, 0))
+      .WillOnce(Invoke([](int, const msghdr* message, int) {
+        EXPECT_EQ(1, message->msg_iovlen);
+        EXPECT_EQ(2, message->msg_iov[0].iov_len);
+        const uint8_t* data = static_cast<const uint8_t*>(message->msg_iov[0].iov_base);
+        EXPECT_EQ(AlertLevelWarning, data[0]);
+        EXPECT_EQ(AlertCloseNotify, data[1]);
+        const cmsghdr* cmsg = CMSG_FIRSTHDR(message);
+        EXPECT_NE(nullptr, cmsg);
+        EXPECT_EQ(SOL_TLS, cmsg->cmsg_level);
+        EXPECT_EQ(TLS_SET_RECORD_TYPE, cmsg->cmsg_type);
+        EXPECT_EQ(RecordTypeAlert, *CMSG_DATA(cmsg));
+        return Api::SysCallSizeResult{ssize_t(2), 0};
+      }));
+  EXPECT_EQ(2, KernelTls::sendCloseNotify(42).rc_);
+}
+
+TEST_F(KernelTlsTest, SendCloseNotifyError) {
+  EXPECT_CALL(os_sys_calls_, sendmsg(42, _, 0))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(-1), EPIPE}));
+  const Api::SysCallSizeResult result = KernelTls::sendCloseNotify(42);
+  EXPECT_EQ(-1, result.rc_);
+  EXPECT_EQ(EPIPE, result.errno_);
+}
+#endif
+
+} // namespace
+} // namespace Ssl
+} // namespace Envoy
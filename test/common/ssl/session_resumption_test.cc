@@ -0,0 +1,130 @@
+#include <string>
+
+#include "common/ssl/session_resumption.h"
+
+#include "test/test_common/simulated_time_system.h"
+
+#include "gtest/gtest.h"
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+namespace {
+
+class SessionCacheTest : public testing::Test {
+public:
+  SessionCacheTest() : ssl_ctx_(SSL_CTX_new(TLS_method())) {}
+
+  SSL_SESSION* newSession(const std::string& session_id_context, const std::string& session_id) {
+    SSL_SESSION* session = SSL_SESSION_new(ssl_ctx_.get());
+    EXPECT_EQ(1, SSL_SESSION_set1_id_context(
+                     session, reinterpret_cast<const uint8_t*>(session_id_context.data()),
+                     session_id_context.size()));
+    EXPECT_EQ(1, SSL_SESSION_set1_id(session, reinterpret_cast<const uint8_t*>(session_id.data()),
+                                     session_id.size()));
+    return session;
+  }
+
+  bssl::UniquePtr<SSL_SESSION> lookup(SessionCache& cache, const std::string& session_id_context,
+                                      const std::string& session_id) {
+    return bssl::UniquePtr<SSL_SESSION>(
+        cache.lookup(session_id_context, reinterpret_cast<const uint8_t*>(session_id.data()),
+                     session_id.size()));
+  }
+
+  bssl::UniquePtr<SSL_CTX> ssl_ctx_;
+};
+
+TEST_F(SessionCacheTest, InsertLookupRemove) {
+  SessionCache cache(1024);
+  SSL_SESSION* session = newSession("context", "id1");
+  cache.insert(session);
+  EXPECT_EQ(1UL, cache.size());
+
+  bssl::UniquePtr<SSL_SESSION> found = lookup(cache, "context", "id1");
+  EXPECT_EQ(session, found.get());
+  // Sessions are only resumed by the contexts with the same identity.
+  EXPECT_EQ(nullptr, lookup(cache, "other context", "id1"));
+  EXPECT_EQ(nullptr, lookup(cache, "context", "id2"));
+
+  cache.remove(found.get());
+  EXPECT_EQ(0UL, cache.size());
+  EXPECT_EQ(nullptr, lookup(cache, "context", "id1"));
+}
+
+TEST_F(SessionCacheTest, ReplaceSession) {
+  SessionCache cache(1024);
+  cache.insert(newSession("context", "id1"));
+  SSL_SESSION* session = newSession("context", "id1");
+  cache.insert(session);
+  EXPECT_EQ(1UL, cache.size());
+  EXPECT_EQ(session, lookup(cache, "context", "id1").get());
+}
+
+TEST_F(SessionCacheTest, SessionWithoutId) {
+  SessionCache cache(1024);
+  cache.insert(newSession("context", ""));
+  EXPECT_EQ(0UL, cache.size());
+}
+
+TEST_F(SessionCacheTest, EvictLeastRecentlyUsed) {
+  // One session per shard.
+  SessionCache cache(1);
+  for (int i = 0; i < 1000; i++) {
+    cache.insert(newSession("context", std::to_string(i)));
+  }
+  EXPECT_GE(16UL, cache.size());
+  EXPECT_NE(nullptr, lookup(cache, "context", "999"));
+}
+
+TEST(SessionTicketKeyRotatorTest, Rotate) {
+  Event::SimulatedTimeSystem time_system;
+  SessionTicketKeyRotator rotator(time_system, std::chrono::seconds(3600), 3);
+
+  SessionTicketKeyRotator::KeysConstSharedPtr keys = rotator.keys();
+  ASSERT_EQ(1UL, keys->size());
+  const ServerContextConfig::SessionTicketKey first_key = keys->front();
+
+  time_system.sleep(std::chrono::seconds(3599));
+  EXPECT_EQ(keys, rotator.keys());
+
+  time_system.sleep(std::chrono::seconds(1));
+  keys = rotator.keys();
+  ASSERT_EQ(2UL, keys->size());
+  EXPECT_NE(first_key.name_, keys->front().name_);
+  EXPECT_EQ(first_key.name_, (*keys)[1].name_);
+
+  time_system.sleep(std::chrono::seconds(3600));
+  EXPECT_EQ(3UL, rotator.keys()->size());
+  time_system.sleep(std::chrono::seconds(3600));
+  keys = rotator.keys();
+  ASSERT_EQ(3UL, keys->size());
+  // The first key is too old to decrypt tickets.
+  for (const ServerContextConfig::SessionTicketKey& key : *keys) {
+    EXPECT_NE(first_key.name_, key.name_);
+  }
+}
+
+TEST(SessionTicketKeyRotatorTest, SetKeys) {
+  Event::SimulatedTimeSystem time_system;
+  SessionTicketKeyRotator rotator(time_system, std::chrono::seconds(3600), 2);
+
+  // The keys of the parent process replace the new keys.
+  SessionTicketKeyRotator::Keys parent_keys(3);
+  for (size_t i = 0; i < parent_keys.size(); i++) {
+    parent_keys[i].name_.fill(static_cast<uint8_t>(i));
+  }
+  rotator.setKeys(parent_keys);
+  SessionTicketKeyRotator::KeysConstSharedPtr keys = rotator.keys();
+  ASSERT_EQ(2UL, keys->size());
+  EXPECT_EQ(parent_keys[0].name_, (*keys)[0].name_);
+  EXPECT_EQ(parent_keys[1].name_, (*keys)[1].name_);
+
+  // An empty parent is ignored.
+  rotator.setKeys({});
+  EXPECT_EQ(keys, rotator.keys());
+}
+
+} // namespace
+} // namespace Ssl
+} // namespace Envoy
@@ -1,4 +1,10 @@
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 
@@ -10,6 +16,8 @@
 #include "common/json/json_loader.h"
 #include "common/network/address_impl.h"
 #include "common/network/listen_socket_impl.h"
+#include "common/network/listener_filter_buffer_impl.h"
+#include "common/network/socket_option_impl.h"
 #include "common/network/transport_socket_options_impl.h"
 #include "common/network/utility.h"
 #include "common/ssl/context_config_impl.h"
@@ -19,6 +27,7 @@
 #include "extensions/filters/listener/tls_inspector/tls_inspector.h"
 
 #include "test/common/ssl/ssl_certs_test.h"
+#include "test/mocks/api/mocks.h"
 #include "test/mocks/buffer/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/secret/mocks.h"
@@ -27,8 +36,21 @@
 #include "test/test_common/environment.h"
 #include "test/test_common/network_utility.h"
 #include "test/test_common/simulated_time_system.h"
+#include "test/test_common/threadsafe_singleton_injector.h"
 #include "test/test_common/utility.h"
 
+#ifdef __linux__
+#include <linux/tls.h>
+#endif
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "openssl/ssl.h"
@@ -1245,6 +1267,63 @@ TEST_P(SslSocketTest, CertificatesWithPassword) {
              nullptr);
 }
 
+// Validate that handshakes complete when the private key operations of both sides are performed
+// by signing threads.
+TEST_P(SslSocketTest, PrivateKeyOffload) {
+  envoy::api::v2::Listener listener;
+  envoy::api::v2::listener::FilterChain* filter_chain = listener.add_filter_chains();
+  envoy::api::v2::auth::CommonTlsContext* server_ctx =
+      filter_chain->mutable_tls_context()->mutable_common_tls_context();
+  envoy::api::v2::auth::TlsCertificate* server_cert = server_ctx->add_tls_certificates();
+  server_cert->mutable_certificate_chain()->set_filename(TestEnvironment::substitute(
+      "{{ test_rundir }}/test/common/ssl/test_data/san_dns_cert.pem"));
+  server_cert->mutable_private_key()->set_filename(TestEnvironment::substitute(
+      "{{ test_rundir }}/test/common/ssl/test_data/san_dns_key.pem"));
+  server_ctx->mutable_private_key_offload()->mutable_signing_threads()->set_value(2);
+  server_ctx->mutable_validation_context()->mutable_trusted_ca()->set_filename(
+      TestEnvironment::substitute("{{ test_rundir }}/test/common/ssl/test_data/ca_cert.pem"));
+
+  envoy::api::v2::auth::UpstreamTlsContext client;
+  envoy::api::v2::auth::TlsCertificate* client_cert =
+      client.mutable_common_tls_context()->add_tls_certificates();
+  client_cert->mutable_certificate_chain()->set_filename(TestEnvironment::substitute(
+      "{{ test_rundir }}/test/common/ssl/test_data/san_uri_cert.pem"));
+  client_cert->mutable_private_key()->set_filename(TestEnvironment::substitute(
+      "{{ test_rundir }}/test/common/ssl/test_data/san_uri_key.pem"));
+  client.mutable_common_tls_context()->mutable_private_key_offload();
+
+  // The server signs its key exchange, and the client its certificate verify.
+  testUtilV2(listener, client, "", true, "", "", "spiffe://lyft.com/test-team", "", "",
+             "ssl.private_key_op", "ssl.private_key_op", GetParam(), nullptr);
+
+  // The server decrypts the premaster secret of the RSA key exchange.
+  client.mutable_common_tls_context()->mutable_tls_params()->add_cipher_suites("AES128-SHA");
+  testUtilV2(listener, client, "", true, "", "", "spiffe://lyft.com/test-team", "", "",
+             "ssl.private_key_op", "ssl.private_key_op", GetParam(), nullptr);
+}
+
+// Validate that handshakes complete with an ECDSA certificate whose private key operations are
+// performed by a signing thread.
+TEST_P(SslSocketTest, PrivateKeyOffloadEcdsa) {
+  envoy::api::v2::Listener listener;
+  envoy::api::v2::listener::FilterChain* filter_chain = listener.add_filter_chains();
+  envoy::api::v2::auth::CommonTlsContext* server_ctx =
+      filter_chain->mutable_tls_context()->mutable_common_tls_context();
+  envoy::api::v2::auth::TlsCertificate* server_cert = server_ctx->add_tls_certificates();
+  server_cert->mutable_certificate_chain()->set_filename(TestEnvironment::substitute(
+      "{{ test_rundir }}/test/common/ssl/test_data/selfsigned_cert_ecdsa_p256.pem"));
+  server_cert->mutable_private_key()->set_filename(TestEnvironment::substitute(
+      "{{ test_rundir }}/test/common/ssl/test_data/selfsigned_key_ecdsa_p256.pem"));
+  server_ctx->mutable_private_key_offload();
+
+  envoy::api::v2::auth::UpstreamTlsContext client;
+  client.mutable_common_tls_context()->mutable_tls_params()->add_cipher_suites(
+      "ECDHE-ECDSA-AES128-GCM-SHA256");
+
+  testUtilV2(listener, client, "", true, "", "", "", "", "", "ssl.private_key_op", "",
+             GetParam(), nullptr);
+}
+
 TEST_P(SslSocketTest, ClientCertificateSpkiVerification) {
   envoy::api::v2::Listener listener;
   envoy::api::v2::listener::FilterChain* filter_chain = listener.add_filter_chains();
@@ -2135,6 +2214,26 @@ TEST_P(SslSocketTest, TicketSessionResumption) {
                               GetParam());
 }
 
+// Without configured keys, tickets are protected by the keys shared by the contexts, and a ticket
+// issued by a context is accepted by a new context with the same identity.
+TEST_P(SslSocketTest, TicketSessionResumptionSharedKeys) {
+  const std::string server_ctx_yaml = R"EOF(
+  common_tls_context:
+    tls_certificates:
+      certificate_chain:
+        filename: "{{ test_tmpdir }}/unittestcert.pem"
+      private_key:
+        filename: "{{ test_tmpdir }}/unittestkey.pem"
+)EOF";
+
+  const std::string client_ctx_yaml = R"EOF(
+    common_tls_context:
+  )EOF";
+
+  testTicketSessionResumption(server_ctx_yaml, {}, server_ctx_yaml, {}, client_ctx_yaml, true,
+                              GetParam());
+}
+
 TEST_P(SslSocketTest, TicketSessionResumptionWithClientCA) {
   const std::string server_ctx_yaml = R"EOF(
   common_tls_context:
@@ -3300,6 +3399,7 @@ public:
   void initialize() {
     MessageUtil::loadFromYaml(TestEnvironment::substitute(server_ctx_yaml_),
                               downstream_tls_context_);
+    downstream_tls_context_.mutable_common_tls_context()->set_kernel_tls_offload(kernel_tls_);
     auto server_cfg =
         std::make_unique<ServerContextConfigImpl>(downstream_tls_context_, factory_context_);
     Event::SimulatedTimeSystem time_system;
@@ -3310,6 +3410,13 @@ public:
     listener_ = dispatcher_->createListener(socket_, listener_callbacks_, true, false);
 
     MessageUtil::loadFromYaml(TestEnvironment::substitute(client_ctx_yaml_), upstream_tls_context_);
+    upstream_tls_context_.mutable_common_tls_context()->set_kernel_tls_offload(kernel_tls_);
+    if (kernel_tls_) {
+      // Negotiate a connection which can be offloaded.
+      auto* tls_params = upstream_tls_context_.mutable_common_tls_context()->mutable_tls_params();
+      tls_params->set_tls_maximum_protocol_version(envoy::api::v2::auth::TlsParameters::TLSv1_2);
+      tls_params->add_cipher_suites("ECDHE-RSA-AES128-GCM-SHA256");
+    }
     auto client_cfg =
         std::make_unique<ClientContextConfigImpl>(upstream_tls_context_, factory_context_);
 
@@ -3317,7 +3424,7 @@ public:
         std::move(client_cfg), *manager_, client_stats_store_);
     client_connection_ = dispatcher_->createClientConnection(
         socket_.localAddress(), source_address_,
-        client_ssl_socket_factory_->createTransportSocket(nullptr), nullptr);
+        client_ssl_socket_factory_->createTransportSocket(nullptr), client_socket_options_);
     client_connection_->addConnectionCallbacks(client_callbacks_);
     client_connection_->connect();
     read_filter_.reset(new Network::MockReadFilter());
@@ -3367,8 +3474,20 @@ public:
           dispatcher_->exit();
         }));
 
+    const std::string fragment(write_fragment_size_, 'a');
+    std::vector<std::unique_ptr<Buffer::BufferFragmentImpl>> fragments;
     for (uint32_t i = 0; i < num_writes; i++) {
-      Buffer::OwnedImpl data(std::string(write_size, 'a'));
+      Buffer::OwnedImpl data;
+      if (write_fragment_size_ > 0) {
+        // Write a buffer made of many small slices.
+        for (uint32_t written = 0; written < write_size; written += write_fragment_size_) {
+          fragments.push_back(std::make_unique<Buffer::BufferFragmentImpl>(
+              fragment.data(), std::min(write_fragment_size_, write_size - written), nullptr));
+          data.addBufferFragment(*fragments.back());
+        }
+      } else {
+        data.add(std::string(write_size, 'a'));
+      }
 
       // Incredibly contrived way of making sure that the write buffer has an empty chain in it.
       if (reserve_write_space) {
@@ -3499,6 +3618,9 @@ public:
   std::shared_ptr<Network::MockReadFilter> read_filter_;
   StrictMock<Network::MockConnectionCallbacks> client_callbacks_;
   Network::Address::InstanceConstSharedPtr source_address_;
+  bool kernel_tls_{};
+  uint32_t write_fragment_size_{};
+  Network::ConnectionSocket::OptionsSharedPtr client_socket_options_;
 };
 
 INSTANTIATE_TEST_CASE_P(IpVersions, SslReadBufferLimitTest,
@@ -3511,6 +3633,80 @@ TEST_P(SslReadBufferLimitTest, NoLimit) {
 
 TEST_P(SslReadBufferLimitTest, NoLimitReserveSpace) { readBufferLimitTest(0, 512, 512, 1, true); }
 
+// The first 64K of the connection are written in records fitting in a TCP segment, and the rest
+// in full size records.
+TEST_P(SslReadBufferLimitTest, RecordSizing) {
+  readBufferLimitTest(0, 256 * 1024, 256 * 1024, 1, false);
+  // 47 records of 1400 bytes, then 12 records of up to 16K.
+  EXPECT_EQ(47UL, client_stats_store_.counter("ssl.write_small_records").value());
+  EXPECT_EQ(59UL, client_stats_store_.counter("ssl.write_records").value());
+  EXPECT_EQ(0UL, client_stats_store_.counter("ssl.write_coalesced_bytes").value());
+}
+
+// Small slices are coalesced into records.
+TEST_P(SslReadBufferLimitTest, RecordCoalescing) {
+  write_fragment_size_ = 100;
+  readBufferLimitTest(0, 256 * 1024, 256 * 1024, 1, false);
+  EXPECT_EQ(59UL, client_stats_store_.counter("ssl.write_records").value());
+  EXPECT_EQ(256 * 1024UL, client_stats_store_.counter("ssl.write_coalesced_bytes").value());
+}
+
+// A coalesced record which the socket does not accept at once is copied again for the retry, and
+// the retry succeeds.
+TEST_P(SslReadBufferLimitTest, RecordCoalescingWriteRetry) {
+  // Fill the small client send buffer and the server receive window within a single write.
+  client_socket_options_ = std::make_shared<Network::Socket::Options>();
+  client_socket_options_->push_back(std::make_shared<Network::SocketOptionImpl>(
+      envoy::api::v2::core::SocketOption::STATE_PREBIND,
+      Network::SocketOptionName(std::make_pair(SOL_SOCKET, SO_SNDBUF)), 4096));
+  write_fragment_size_ = 100;
+  readBufferLimitTest(0, 1024 * 1024, 1024 * 1024, 1, false);
+  EXPECT_GT(client_stats_store_.counter("ssl.write_coalesced_bytes").value(), 1024 * 1024UL);
+}
+
+// Returns whether the kernel accepts the tls upper layer protocol on a TCP connection. Without
+// kTLS receive support in the kernel headers, connections are never offloaded.
+bool kernelTlsSupported(Network::Address::IpVersion version) {
+  Network::TcpListenSocket listen_socket(Network::Test::getCanonicalLoopbackAddress(version),
+                                         nullptr, true);
+  if (::listen(listen_socket.fd(), 1) != 0) {
+    return false;
+  }
+  const int fd = listen_socket.localAddress()->socket(Network::Address::SocketType::Stream);
+  bool supported = false;
+#ifdef TLS_RX
+  if (listen_socket.localAddress()->connect(fd).rc_ == 0) {
+    static const char ulp[] = "tls";
+    supported = ::setsockopt(fd, IPPROTO_TCP, TCP_ULP, ulp, sizeof(ulp)) == 0;
+  }
+#endif
+  ::close(fd);
+  return supported;
+}
+
+// The record layer is offloaded to the kernel when it supports kTLS, and stays on BoringSSL
+// otherwise: the data is the same either way.
+TEST_P(SslReadBufferLimitTest, KernelTlsOffload) {
+  kernel_tls_ = true;
+  readBufferLimitTest(0, 256 * 1024, 256 * 1024, 1, false);
+
+  if (!kernelTlsSupported(GetParam())) {
+    ENVOY_LOG_MISC(info, "kernel TLS is not supported, checking the fallback instead");
+    EXPECT_EQ(0UL, client_stats_store_.counter("ssl.kernel_tls_tx").value());
+    EXPECT_EQ(1UL, client_stats_store_.counter("ssl.kernel_tls_fallback").value());
+    EXPECT_EQ(0UL, server_stats_store_.counter("ssl.kernel_tls_rx").value());
+    EXPECT_EQ(1UL, server_stats_store_.counter("ssl.kernel_tls_fallback").value());
+    return;
+  }
+  for (Stats::IsolatedStoreImpl* store : {&client_stats_store_, &server_stats_store_}) {
+    EXPECT_EQ(1UL, store->counter("ssl.kernel_tls_tx").value());
+    EXPECT_EQ(1UL, store->counter("ssl.kernel_tls_rx").value());
+    EXPECT_EQ(0UL, store->counter("ssl.kernel_tls_fallback").value());
+  }
+  // The records were written by the kernel.
+  EXPECT_EQ(0UL, client_stats_store_.counter("ssl.write_records").value());
+}
+
 TEST_P(SslReadBufferLimitTest, NoLimitSmallWrites) {
   readBufferLimitTest(0, 256 * 1024, 1, 256 * 1024, false);
 }
@@ -3560,5 +3756,213 @@ TEST_P(SslReadBufferLimitTest, TestBind) {
   disconnect();
 }
 
+// The first bytes of the ClientHello, read from the socket by the listener filters, are handed to
+// the server transport socket, which reads the rest of the handshake from the socket.
+TEST_P(SslReadBufferLimitTest, PreReadClientHello) {
+  initialize();
+
+  Network::ConnectionSocketPtr accepted_socket;
+  Event::FileEventPtr file_event;
+  EXPECT_CALL(listener_callbacks_, onAccept_(_, _))
+      .WillOnce(Invoke([&](Network::ConnectionSocketPtr& socket, bool) -> void {
+        accepted_socket = std::move(socket);
+        file_event = dispatcher_->createFileEvent(
+            accepted_socket->fd(),
+            [&](uint32_t) -> void {
+              Network::ListenerFilterBufferImpl buffer(*accepted_socket);
+              buffer.readFromSocket(10);
+              if (buffer.data().size() < 10) {
+                return;
+              }
+              listener_callbacks_.onNewConnection(dispatcher_->createServerConnection(
+                  std::move(accepted_socket),
+                  server_ssl_socket_factory_->createTransportSocket(nullptr)));
+              file_event.reset();
+            },
+            Event::FileTriggerType::Edge, Event::FileReadyType::Read);
+      }));
+  EXPECT_CALL(listener_callbacks_, onNewConnection_(_))
+      .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+        server_connection_ = std::move(conn);
+        server_connection_->addConnectionCallbacks(server_callbacks_);
+        server_connection_->addReadFilter(read_filter_);
+      }));
+
+  EXPECT_CALL(client_callbacks_, onEvent(Network::ConnectionEvent::Connected))
+      .WillOnce(Invoke([&](Network::ConnectionEvent) -> void { dispatcher_->exit(); }));
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+  EXPECT_EQ(1UL, client_stats_store_.counter("ssl.handshake").value());
+  EXPECT_EQ(0UL, server_stats_store_.counter("ssl.connection_error").value());
+
+  disconnect();
+}
+
+// The control records are only read and sent when the kernel headers support kTLS receive.
+#ifdef TLS_RX
+// Connections whose record layer is offloaded to the kernel, which is driven by mock system calls.
+class SslKernelTlsSocketTest : public SslCertsTest {
+public:
+  SslKernelTlsSocketTest() {
+    envoy::api::v2::auth::UpstreamTlsContext tls_context;
+    auto client_cfg = std::make_unique<ClientContextConfigImpl>(tls_context, factory_context_);
+    manager_ = std::make_unique<ContextManagerImpl>(time_system_);
+    socket_factory_ =
+        std::make_unique<ClientSslSocketFactory>(std::move(client_cfg), *manager_, stats_store_);
+    transport_socket_ = socket_factory_->createTransportSocket(nullptr);
+    ON_CALL(callbacks_, fd()).WillByDefault(Return(42));
+    transport_socket_->setTransportSocketCallbacks(callbacks_);
+    dynamic_cast<SslSocket&>(*transport_socket_).enableKernelTlsForTest({true, true});
+  }
+
+  // Make the next readv() return the given data, or fail with the given error if it is empty.
+  void readData(const std::string& data, int error = 0) {
+    EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+        .WillOnce(Invoke([data, error](int, const iovec* iov, int) -> Api::SysCallSizeResult {
+          if (data.empty()) {
+            return {error == 0 ? 0 : -1, error};
+          }
+          memcpy(iov[0].iov_base, data.data(), data.size());
+          return {ssize_t(data.size()), 0};
+        }))
+        .RetiresOnSaturation();
+  }
+
+  // Make the next recvmsg() return an alert.
+  void receiveAlert(uint8_t level, uint8_t description) {
+    EXPECT_CALL(os_sys_calls_, recvmsg(42, _, 0))
+        .WillOnce(Invoke([level, description](int, msghdr* message, int) {
+          uint8_t* data = static_cast<uint8_t*>(message->msg_iov[0].iov_base);
+          data[0] = level;
+          data[1] = description;
+          cmsghdr* cmsg = CMSG_FIRSTHDR(message);
+          cmsg->cmsg_level = SOL_TLS;
+          cmsg->cmsg_type = TLS_GET_RECORD_TYPE;
+          cmsg->cmsg_len = CMSG_LEN(sizeof(uint8_t));
+          // An alert record.
+          *CMSG_DATA(cmsg) = 21;
+          return Api::SysCallSizeResult{ssize_t(2), 0};
+        }));
+  }
+
+  NiceMock<Api::MockOsSysCalls> os_sys_calls_;
+  TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls_{&os_sys_calls_};
+  Event::SimulatedTimeSystem time_system_;
+  Stats::IsolatedStoreImpl stats_store_;
+  std::unique_ptr<ContextManagerImpl> manager_;
+  Network::TransportSocketFactoryPtr socket_factory_;
+  NiceMock<Network::MockTransportSocketCallbacks> callbacks_;
+  Network::TransportSocketPtr transport_socket_;
+};
+
+TEST_F(SslKernelTlsSocketTest, Read) {
+  InSequence s;
+  readData("hello");
+  readData("", EAGAIN);
+  Buffer::OwnedImpl buffer;
+  const Network::IoResult result = transport_socket_->doRead(buffer);
+  EXPECT_EQ(Network::PostIoAction::KeepOpen, result.action_);
+  EXPECT_EQ(5, result.bytes_processed_);
+  EXPECT_FALSE(result.end_stream_read_);
+  EXPECT_EQ("hello", buffer.toString());
+}
+
+// A read fails with EIO when the next record is an alert.
+TEST_F(SslKernelTlsSocketTest, ReadCloseNotify) {
+  InSequence s;
+  readData("hello");
+  readData("", EIO);
+  receiveAlert(1, 0);
+  Buffer::OwnedImpl buffer;
+  const Network::IoResult result = transport_socket_->doRead(buffer);
+  EXPECT_EQ(Network::PostIoAction::KeepOpen, result.action_);
+  EXPECT_EQ(5, result.bytes_processed_);
+  EXPECT_TRUE(result.end_stream_read_);
+}
+
+// Warning alerts are skipped and the read goes on.
+TEST_F(SslKernelTlsSocketTest, ReadWarningAlert) {
+  InSequence s;
+  readData("", EIO);
+  // no_renegotiation.
+  receiveAlert(1, 100);
+  readData("hello");
+  readData("", EAGAIN);
+  Buffer::OwnedImpl buffer;
+  const Network::IoResult result = transport_socket_->doRead(buffer);
+  EXPECT_EQ(Network::PostIoAction::KeepOpen, result.action_);
+  EXPECT_EQ(5, result.bytes_processed_);
+  EXPECT_FALSE(result.end_stream_read_);
+  EXPECT_EQ(0UL, stats_store_.counter("ssl.connection_error").value());
+}
+
+TEST_F(SslKernelTlsSocketTest, ReadFatalAlert) {
+  InSequence s;
+  readData("", EIO);
+  // handshake_failure.
+  receiveAlert(2, 40);
+  Buffer::OwnedImpl buffer;
+  const Network::IoResult result = transport_socket_->doRead(buffer);
+  EXPECT_EQ(Network::PostIoAction::Close, result.action_);
+  EXPECT_EQ(1UL, stats_store_.counter("ssl.connection_error").value());
+}
+
+// The kernel fails a read with EBADMSG when a record does not decrypt.
+TEST_F(SslKernelTlsSocketTest, ReadDecryptError) {
+  readData("", EBADMSG);
+  Buffer::OwnedImpl buffer;
+  const Network::IoResult result = transport_socket_->doRead(buffer);
+  EXPECT_EQ(Network::PostIoAction::Close, result.action_);
+  EXPECT_EQ(1UL, stats_store_.counter("ssl.connection_error").value());
+}
+
+// The peer closed the connection without close_notify.
+TEST_F(SslKernelTlsSocketTest, ReadTruncated) {
+  readData("");
+  Buffer::OwnedImpl buffer;
+  const Network::IoResult result = transport_socket_->doRead(buffer);
+  EXPECT_EQ(Network::PostIoAction::Close, result.action_);
+  EXPECT_FALSE(result.end_stream_read_);
+  EXPECT_EQ(0UL, stats_store_.counter("ssl.connection_error").value());
+}
+
+// close_notify is sent through the kernel once the data is written.
+TEST_F(SslKernelTlsSocketTest, WriteEndStream) {
+  InSequence s;
+  EXPECT_CALL(os_sys_calls_, writev(42, _, _))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(5), 0}));
+  EXPECT_CALL(os_sys_calls_, sendmsg(42, _, 0))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(2), 0}));
+  Buffer::OwnedImpl buffer("hello");
+  const Network::IoResult result = transport_socket_->doWrite(buffer, true);
+  EXPECT_EQ(Network::PostIoAction::KeepOpen, result.action_);
+  EXPECT_EQ(5, result.bytes_processed_);
+  EXPECT_EQ(0, buffer.length());
+
+  // close_notify is only sent once.
+  EXPECT_CALL(os_sys_calls_, sendmsg(_, _, _)).Times(0);
+  transport_socket_->closeSocket(Network::ConnectionEvent::LocalClose);
+}
+
+TEST_F(SslKernelTlsSocketTest, WriteAgain) {
+  EXPECT_CALL(os_sys_calls_, writev(42, _, _))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(-1), EAGAIN}));
+  EXPECT_CALL(os_sys_calls_, sendmsg(_, _, _)).Times(0);
+  Buffer::OwnedImpl buffer("hello");
+  const Network::IoResult result = transport_socket_->doWrite(buffer, true);
+  EXPECT_EQ(Network::PostIoAction::KeepOpen, result.action_);
+  EXPECT_EQ(0, result.bytes_processed_);
+  EXPECT_EQ(5, buffer.length());
+}
+
+TEST_F(SslKernelTlsSocketTest, WriteError) {
+  EXPECT_CALL(os_sys_calls_, writev(42, _, _))
+      .WillOnce(Return(Api::SysCallSizeResult{ssize_t(-1), EPIPE}));
+  Buffer::OwnedImpl buffer("hello");
+  const Network::IoResult result = transport_socket_->doWrite(buffer, false);
+  EXPECT_EQ(Network::PostIoAction::Close, result.action_);
+}
+#endif
+
 } // namespace Ssl
 } // namespace Envoy
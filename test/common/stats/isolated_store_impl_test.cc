@@ -66,6 +66,33 @@ TEST(StatsIsolatedStoreImplTest, LongStatName) {
   EXPECT_EQ(absl::StrCat("scope.", long_string), counter.name());
 }
 
+TEST(StatsIsolatedStoreImplTest, LazyStats) {
+  IsolatedStoreImpl store;
+  ScopePtr scope = store.createScope("scope.");
+  Counter& c1 = scope->lazyCounter("c1");
+  Gauge& g1 = scope->lazyGauge("g1");
+  EXPECT_EQ(&c1, &scope->lazyCounter("c1"));
+  EXPECT_EQ("scope.c1", c1.name());
+  EXPECT_EQ("scope.g1", g1.name());
+  ASSERT_EQ(1UL, store.counters().size());
+  EXPECT_EQ(&c1, store.counters().front().get());
+  EXPECT_EQ(0, c1.value());
+  ASSERT_EQ(1UL, store.gauges().size());
+  EXPECT_EQ(&g1, store.gauges().front().get());
+
+  c1.add(2);
+  g1.inc();
+  EXPECT_EQ(2, c1.value());
+  EXPECT_EQ(1, g1.value());
+
+  // The counter shares its value with the lazy counter, and is listed instead.
+  Counter& c1_prime = store.counter("scope.c1");
+  EXPECT_EQ(2, c1_prime.value());
+  ASSERT_EQ(1UL, store.counters().size());
+  EXPECT_EQ(&c1_prime, store.counters().front().get());
+  EXPECT_EQ(&c1_prime, &scope->lazyCounter("c1"));
+}
+
 /**
  * Test stats macros. @see stats_macros.h
  */
@@ -96,5 +123,17 @@ TEST(StatsMacros, All) {
   EXPECT_EQ("test.test_histogram", histogram.name());
 }
 
+TEST(StatsMacros, Lazy) {
+  IsolatedStoreImpl stats_store;
+  TestStats test_stats{ALL_TEST_STATS(POOL_LAZY_COUNTER_PREFIX(stats_store, "test."),
+                                      POOL_LAZY_GAUGE_PREFIX(stats_store, "test."),
+                                      POOL_HISTOGRAM_PREFIX(stats_store, "test."))};
+
+  EXPECT_EQ("test.test_counter", test_stats.test_counter_.name());
+  EXPECT_EQ("test.test_gauge", test_stats.test_gauge_.name());
+  EXPECT_EQ(&test_stats.test_counter_, &stats_store.lazyCounter("test.test_counter"));
+  EXPECT_EQ(&test_stats.test_gauge_, &stats_store.lazyGauge("test.test_gauge"));
+}
+
 } // namespace Stats
 } // namespace Envoy
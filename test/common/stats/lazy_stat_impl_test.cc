@@ -0,0 +1,162 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/stats/heap_stat_data.h"
+#include "common/stats/lazy_stat_impl.h"
+
+#include "absl/strings/str_cat.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+
+class LazyStatImplTest : public testing::Test {
+public:
+  std::vector<Tag> tags() { return {{"tag_name", "tag_value"}}; }
+
+  LazyStatName name(const std::string& name, std::string&& tag_extracted_name,
+                    std::vector<Tag>&& tags) {
+    return LazyStatName(name, tag_table_.tagExtractedName(name, std::move(tag_extracted_name)),
+                        tag_table_.tags(std::move(tags)));
+  }
+
+  HeapStatDataAllocator alloc_;
+  LazyStatTagTable tag_table_;
+};
+
+TEST_F(LazyStatImplTest, Counter) {
+  LazyCounterImpl counter(alloc_, name("cluster.foo.counter", "cluster.counter", tags()));
+  EXPECT_FALSE(counter.materialized());
+  EXPECT_EQ("cluster.foo.counter", counter.name());
+  EXPECT_STREQ("cluster.foo.counter", counter.nameCStr());
+  EXPECT_EQ("cluster.counter", counter.tagExtractedName());
+  ASSERT_EQ(1, counter.tags().size());
+  EXPECT_EQ("tag_name", counter.tags()[0].name_);
+  EXPECT_EQ("tag_value", counter.tags()[0].value_);
+
+  // Reads do not materialize the counter.
+  EXPECT_EQ(0, counter.value());
+  EXPECT_EQ(0, counter.latch());
+  EXPECT_FALSE(counter.used());
+  counter.reset();
+  EXPECT_FALSE(counter.materialized());
+
+  counter.inc();
+  EXPECT_TRUE(counter.materialized());
+  counter.add(2);
+  EXPECT_EQ(3, counter.value());
+  EXPECT_TRUE(counter.used());
+  EXPECT_EQ(3, counter.latch());
+  EXPECT_EQ("cluster.foo.counter", counter.name());
+  EXPECT_EQ("cluster.counter", counter.tagExtractedName());
+
+  // The counter shares its data with any counter of the same name.
+  CounterSharedPtr other = alloc_.makeCounter("cluster.foo.counter", "", {});
+  EXPECT_EQ(3, other->value());
+  other->inc();
+  EXPECT_EQ(4, counter.value());
+}
+
+TEST_F(LazyStatImplTest, Gauge) {
+  LazyGaugeImpl gauge(alloc_, name("cluster.foo.gauge", "cluster.gauge", tags()));
+  EXPECT_FALSE(gauge.materialized());
+  EXPECT_EQ("cluster.foo.gauge", gauge.name());
+  EXPECT_EQ("cluster.gauge", gauge.tagExtractedName());
+  ASSERT_EQ(1, gauge.tags().size());
+  EXPECT_EQ("tag_name", gauge.tags()[0].name_);
+  EXPECT_EQ(0, gauge.value());
+  EXPECT_FALSE(gauge.used());
+  EXPECT_FALSE(gauge.materialized());
+
+  gauge.set(5);
+  EXPECT_TRUE(gauge.materialized());
+  EXPECT_EQ(5, gauge.value());
+  gauge.inc();
+  gauge.add(2);
+  gauge.dec();
+  gauge.sub(3);
+  EXPECT_EQ(4, gauge.value());
+  EXPECT_TRUE(gauge.used());
+}
+
+// Each modification of the gauge must materialize it.
+TEST_F(LazyStatImplTest, GaugeMaterializedByAnyModification) {
+  LazyGaugeImpl add(alloc_, name("add", "add", {}));
+  add.add(1);
+  EXPECT_TRUE(add.materialized());
+  LazyGaugeImpl inc(alloc_, name("inc", "inc", {}));
+  inc.inc();
+  EXPECT_TRUE(inc.materialized());
+  LazyGaugeImpl dec(alloc_, name("dec", "dec", {}));
+  dec.inc();
+  dec.dec();
+  EXPECT_EQ(0, dec.value());
+  LazyGaugeImpl sub(alloc_, name("sub", "sub", {}));
+  sub.set(1);
+  sub.sub(1);
+  EXPECT_EQ(0, sub.value());
+}
+
+// Lazy stats only own their name: tag extracted names and tags are shared between them.
+TEST_F(LazyStatImplTest, SharedTags) {
+  LazyCounterImpl foo_a(alloc_, name("cluster.foo.a", "cluster.a", {{"cluster_name", "foo"}}));
+  LazyCounterImpl foo_b(alloc_, name("cluster.foo.b", "cluster.b", {{"cluster_name", "foo"}}));
+  LazyCounterImpl bar_a(alloc_, name("cluster.bar.a", "cluster.a", {{"cluster_name", "bar"}}));
+  EXPECT_EQ(&foo_a.tags(), &foo_b.tags());
+  EXPECT_NE(&foo_a.tags(), &bar_a.tags());
+  EXPECT_EQ("bar", bar_a.tags()[0].value_);
+  EXPECT_EQ(&foo_a.tagExtractedName(), &bar_a.tagExtractedName());
+  EXPECT_NE(&foo_a.tagExtractedName(), &foo_b.tagExtractedName());
+  EXPECT_EQ("cluster.b", foo_b.tagExtractedName());
+
+  // A stat without tags reports its name as its tag extracted name.
+  LazyGaugeImpl untagged(alloc_, name("untagged", "untagged", {}));
+  EXPECT_EQ(untagged.nameCStr(), untagged.tagExtractedName().c_str());
+  EXPECT_TRUE(untagged.tags().empty());
+
+  // The counter allocated on the first modification keeps reporting the tags of the handle.
+  foo_a.inc();
+  EXPECT_EQ("cluster.a", foo_a.tagExtractedName());
+  EXPECT_EQ(&foo_b.tags(), &foo_a.tags());
+}
+
+// Tags which are no longer referenced by any stat are dropped from the table.
+TEST_F(LazyStatImplTest, TagTableDropsUnusedEntries) {
+  for (uint32_t i = 0; i < 1000; ++i) {
+    const std::string cluster = absl::StrCat("cluster_", i);
+    LazyCounterImpl counter(alloc_, name(absl::StrCat("cluster.", cluster, ".a"), "cluster.a",
+                                         {{"cluster_name", cluster}}));
+    EXPECT_EQ(cluster, counter.tags()[0].value_);
+    EXPECT_EQ("cluster.a", counter.tagExtractedName());
+  }
+  EXPECT_GE(64, tag_table_.numTagsForTest());
+}
+
+// Threads racing to first modify a counter all apply their increments to the same counter.
+TEST_F(LazyStatImplTest, ConcurrentMaterialization) {
+  LazyCounterImpl counter(alloc_, name("counter", "counter", {}));
+  const uint32_t num_threads = 8;
+  const uint32_t num_increments = 1000;
+  std::atomic<bool> start{};
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&] {
+      while (!start) {
+      }
+      for (uint32_t j = 0; j < num_increments; ++j) {
+        counter.inc();
+      }
+    });
+  }
+  start = true;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * num_increments, counter.value());
+}
+
+} // namespace Stats
+} // namespace Envoy
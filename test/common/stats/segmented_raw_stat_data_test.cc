@@ -0,0 +1,255 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/common/fmt.h"
+#include "common/common/thread.h"
+#include "common/stats/segmented_raw_stat_data.h"
+#include "common/stats/stats_options_impl.h"
+
+#include "test/test_common/logging.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+
+// Maps segments from heap memory shared by every allocator of a test, emulating processes sharing
+// shared memory segments.
+class TestSegmentMapper : public RawStatDataSegmentMapper {
+public:
+  uint8_t* mapSegment(uint32_t index, uint64_t size, bool create) override {
+    if (fail_create_ && create) {
+      return nullptr;
+    }
+    std::vector<uint8_t>& segment = segments_[index];
+    if (create) {
+      EXPECT_TRUE(segment.empty());
+      segment.resize(size);
+    }
+    EXPECT_EQ(size, segment.size());
+    return segment.data();
+  }
+
+  std::map<uint32_t, std::vector<uint8_t>> segments_;
+  bool fail_create_{};
+};
+
+class SegmentedRawStatDataTest : public testing::Test {
+public:
+  SegmentedRawStatDataTest() { memset(&control_, 0, sizeof(control_)); }
+
+  std::unique_ptr<SegmentedRawStatDataAllocator> makeAllocator(bool init,
+                                                               uint64_t max_stats = 1000000) {
+    return std::make_unique<SegmentedRawStatDataAllocator>(mutex_, control_, mapper_, init,
+                                                           max_stats, stats_options_);
+  }
+
+  StatsOptionsImpl stats_options_;
+  Thread::MutexBasicLockable mutex_;
+  SegmentedRawStatDataControl control_;
+  TestSegmentMapper mapper_;
+};
+
+TEST_F(SegmentedRawStatDataTest, AllocFree) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  EXPECT_EQ(0, allocator->numSegments());
+
+  RawStatData* stat_1 = allocator->alloc("ref_name");
+  ASSERT_NE(stat_1, nullptr);
+  RawStatData* stat_2 = allocator->alloc("ref_name");
+  RawStatData* stat_3 = allocator->alloc("not_ref_name");
+  ASSERT_NE(stat_3, nullptr);
+  EXPECT_EQ(stat_1, stat_2);
+  EXPECT_NE(stat_1, stat_3);
+  EXPECT_EQ("ref_name", stat_1->key());
+  EXPECT_EQ(2, stat_1->ref_count_);
+  EXPECT_EQ(2, allocator->numStats());
+  EXPECT_EQ(1, allocator->numSegments());
+
+  allocator->free(*stat_1);
+  EXPECT_EQ(2, allocator->numStats());
+  allocator->free(*stat_2);
+  allocator->free(*stat_3);
+  EXPECT_EQ(0, allocator->numStats());
+}
+
+TEST_F(SegmentedRawStatDataTest, Truncate) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  const std::string long_string(stats_options_.maxNameLength() + 1, 'A');
+  RawStatData* stat{};
+  EXPECT_LOG_CONTAINS("warning", " is too long ", stat = allocator->alloc(long_string));
+  EXPECT_EQ(long_string.substr(0, stats_options_.maxNameLength()), stat->key());
+  EXPECT_EQ(stat, allocator->alloc(long_string + " ignored"));
+}
+
+// A freed stat keeps its block, and is found again with reset values when re-allocated.
+TEST_F(SegmentedRawStatDataTest, ReallocSameName) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  RawStatData* stat = allocator->alloc("stat");
+  stat->value_ = 5;
+  stat->pending_increment_ = 5;
+  stat->flags_ = 1;
+  allocator->free(*stat);
+
+  // A name of a different length does not reuse the freed block.
+  RawStatData* other = allocator->alloc("other_stat_with_a_much_longer_name");
+  EXPECT_NE(stat, other);
+  EXPECT_EQ(stat, allocator->alloc("stat"));
+  EXPECT_EQ(0, stat->value_);
+  EXPECT_EQ(0, stat->pending_increment_);
+  EXPECT_EQ(0, stat->flags_);
+  EXPECT_EQ(1, stat->ref_count_);
+  EXPECT_EQ(2, allocator->numStats());
+}
+
+// A freed block is reused for a name of similar length.
+TEST_F(SegmentedRawStatDataTest, ReuseFreedBlock) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  RawStatData* stat_1 = allocator->alloc("stat_1");
+  RawStatData* stat_2 = allocator->alloc("stat_2");
+  RawStatData* long_stat = allocator->alloc(std::string(100, 'x'));
+  allocator->free(*stat_1);
+  allocator->free(*long_stat);
+
+  RawStatData* stat_3 = allocator->alloc("stat_3");
+  EXPECT_EQ(stat_1, stat_3);
+  EXPECT_EQ("stat_3", stat_3->key());
+  EXPECT_EQ(1, stat_3->ref_count_);
+
+  // The reused block is no longer found by its previous name.
+  RawStatData* stat_1_prime = allocator->alloc("stat_1");
+  EXPECT_NE(stat_1, stat_1_prime);
+  EXPECT_NE(stat_2, stat_1_prime);
+  EXPECT_NE(long_stat, stat_1_prime);
+  EXPECT_EQ("stat_1", stat_1_prime->key());
+}
+
+// Segments are mapped as stats are allocated, and never overlap.
+TEST_F(SegmentedRawStatDataTest, Growth) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  std::set<RawStatData*> stats;
+  for (uint64_t i = 0; allocator->numSegments() < 3; ++i) {
+    RawStatData* stat = allocator->alloc(fmt::format("cluster.cluster_{}.upstream_rq_total", i));
+    ASSERT_NE(stat, nullptr);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(stat) % alignof(RawStatData));
+    EXPECT_TRUE(stats.insert(stat).second);
+    stat->value_ = i;
+  }
+
+  uint64_t i = 0;
+  for (const auto& segment : mapper_.segments_) {
+    EXPECT_EQ(64 * 1024 << i++, segment.second.size());
+  }
+  for (RawStatData* stat : stats) {
+    EXPECT_EQ(fmt::format("cluster.cluster_{}.upstream_rq_total", stat->value_.load()),
+              stat->key());
+  }
+}
+
+TEST_F(SegmentedRawStatDataTest, MaxStats) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true, 2);
+  RawStatData* stat_1 = allocator->alloc("1");
+  RawStatData* stat_2 = allocator->alloc("2");
+  EXPECT_NE(stat_1, nullptr);
+  EXPECT_NE(stat_2, nullptr);
+  EXPECT_EQ(nullptr, allocator->alloc("3"));
+  EXPECT_EQ(stat_1, allocator->alloc("1"));
+
+  allocator->free(*stat_2);
+  EXPECT_NE(nullptr, allocator->alloc("3"));
+  EXPECT_EQ(nullptr, allocator->alloc("2"));
+}
+
+// Without a maximum, stats are allocated as long as segments can be mapped.
+TEST_F(SegmentedRawStatDataTest, NoMaxStats) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true, 0);
+  for (uint32_t i = 0; i < 100000; ++i) {
+    ASSERT_NE(nullptr, allocator->alloc(fmt::format("cluster.cluster_{}.upstream_rq_total", i)));
+  }
+  EXPECT_EQ(100000, allocator->numStats());
+
+  mapper_.fail_create_ = true;
+  uint32_t num_allocated = 0;
+  while (allocator->alloc(fmt::format("stat_{}", num_allocated)) != nullptr) {
+    ++num_allocated;
+  }
+  EXPECT_EQ(100000 + num_allocated, allocator->numStats());
+}
+
+TEST_F(SegmentedRawStatDataTest, MapFailure) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  mapper_.fail_create_ = true;
+  EXPECT_EQ(nullptr, allocator->alloc("stat"));
+
+  mapper_.fail_create_ = false;
+  EXPECT_NE(nullptr, allocator->alloc("stat"));
+}
+
+TEST_F(SegmentedRawStatDataTest, MaxSegments) {
+  makeAllocator(true);
+  for (uint32_t i = 0; i < SegmentedRawStatDataControl::MaxSegments; ++i) {
+    mapper_.segments_[i].resize(64);
+    control_.segment_sizes_[i] = 64;
+  }
+  control_.num_segments_ = SegmentedRawStatDataControl::MaxSegments;
+  control_.tail_offset_ = 64;
+
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(false);
+  EXPECT_EQ(nullptr, allocator->alloc("stat"));
+}
+
+TEST_F(SegmentedRawStatDataTest, IncompatibleControl) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> allocator = makeAllocator(true);
+  control_.signature_ = 0;
+  EXPECT_THROW_WITH_MESSAGE(makeAllocator(false), EnvoyException,
+                            "SegmentedRawStatDataAllocator: incompatible memory block");
+}
+
+// Allocators attached to the same control block, as in a hot restart, share stats and see the
+// segments mapped by each other.
+TEST_F(SegmentedRawStatDataTest, Attach) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> parent = makeAllocator(true);
+  RawStatData* stat_a = parent->alloc("a");
+  RawStatData* stat_freed = parent->alloc("freed");
+  parent->free(*stat_freed);
+
+  std::unique_ptr<SegmentedRawStatDataAllocator> child = makeAllocator(false);
+  EXPECT_EQ(stat_a, child->alloc("a"));
+  EXPECT_EQ(2, stat_a->ref_count_);
+  EXPECT_EQ(stat_freed, child->alloc("freed"));
+
+  // Stats allocated by the child in new segments are found by the parent.
+  std::vector<RawStatData*> child_stats;
+  for (uint64_t i = 0; child->numSegments() < 2; ++i) {
+    child_stats.push_back(child->alloc(fmt::format("child.{}", i)));
+  }
+  for (uint64_t i = 0; i < child_stats.size(); ++i) {
+    EXPECT_EQ(child_stats[i], parent->alloc(fmt::format("child.{}", i)));
+  }
+  EXPECT_EQ(1 + 1 + child_stats.size(), parent->numStats());
+}
+
+// Reusing a block for another name in one process is seen by the other.
+TEST_F(SegmentedRawStatDataTest, AttachReuse) {
+  std::unique_ptr<SegmentedRawStatDataAllocator> parent = makeAllocator(true);
+  RawStatData* stat_1 = parent->alloc("stat_1");
+  std::unique_ptr<SegmentedRawStatDataAllocator> child = makeAllocator(false);
+
+  parent->free(*stat_1);
+  RawStatData* stat_2 = child->alloc("stat_2");
+  EXPECT_EQ(stat_1, stat_2);
+
+  EXPECT_EQ(stat_2, parent->alloc("stat_2"));
+  EXPECT_EQ(2, stat_2->ref_count_);
+  RawStatData* stat_1_prime = parent->alloc("stat_1");
+  EXPECT_NE(stat_1, stat_1_prime);
+  EXPECT_EQ(stat_1_prime, child->alloc("stat_1"));
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,94 @@
+// Note: this should be run with --compilation_mode=opt, and would benefit from a
+// quiescent system with disabled cstate power management.
+
+#include <string>
+#include <vector>
+
+#include "envoy/config/metrics/v2/stats.pb.h"
+
+#include "common/stats/tag_producer_impl.h"
+
+#include "test/common/stats/stat_test_utility.h"
+
+#include "testing/base/public/benchmark.h"
+
+namespace Envoy {
+namespace {
+
+// Stat names covering each family of default tags, in addition to the per-cluster sample stats.
+const char* const kTaggedStatNames[] = {
+    "listener.127.0.0.1_3012.http.http_prefix.downstream_rq_5xx",
+    "listener.[__1]_0.ssl.cipher.AES256-SHA",
+    "listener.127.0.0.1_0.downstream_cx_total",
+    "http.ingress_http.downstream_rq_2xx",
+    "http.ingress_http.user_agent.ios.downstream_cx_total",
+    "http.ingress_http.fault.fault_cluster.aborts_injected",
+    "http.egress_dynamodb_iad.dynamodb.operation.Query.upstream_rq_time",
+    "http.egress_dynamodb_iad.dynamodb.table.bar_table.capacity.Query.__partition_id=ABC1234",
+    "cluster.grpc_cluster.grpc.grpc_service_1.grpc_method_1.success",
+    "cluster.ratelimit.ssl.ciphers.ECDHE-RSA-AES128-GCM-SHA256",
+    "vhost.vhost_1.vcluster.vcluster_1.upstream_rq_200",
+    "mongo.mongo_filter.collection.bar_collection.callsite.baz_callsite.query.scatter_get",
+    "mongo.mongo_filter.cmd.foo_cmd.reply_size",
+    "tcp.tcp_prefix.downstream_flow_control_resumed_reading_total",
+    "auth.clientssl.clientssl_prefix.auth_ip_white_list",
+    "ratelimit.foo_ratelimiter.over_limit",
+    "server.memory_allocated",
+};
+
+std::vector<std::string> statNames() {
+  std::vector<std::string> names(std::begin(kTaggedStatNames), std::end(kTaggedStatNames));
+  Stats::TestUtil::forEachSampleStat(
+      10, [&names](absl::string_view name) { names.emplace_back(std::string(name)); });
+  return names;
+}
+
+} // namespace
+} // namespace Envoy
+
+// Measures extraction of the default tag set from a representative mix of stat names.
+static void BM_ExtractDefaultTags(benchmark::State& state) {
+  const Envoy::Stats::TagProducerImpl tag_producer{envoy::config::metrics::v2::StatsConfig()};
+  const std::vector<std::string> names = Envoy::statNames();
+  std::vector<Envoy::Stats::Tag> tags;
+
+  for (auto _ : state) {
+    for (const std::string& name : names) {
+      tags.clear();
+      benchmark::DoNotOptimize(tag_producer.produceTags(name, tags));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_ExtractDefaultTags);
+
+// Measures extraction of the default tag set along with a custom regex tag, which should only be
+// run on stat names sharing its prefix.
+static void BM_ExtractDefaultAndCustomTags(benchmark::State& state) {
+  envoy::config::metrics::v2::StatsConfig config;
+  auto* tag_specifier = config.mutable_stats_tags()->Add();
+  tag_specifier->set_tag_name("custom.route");
+  tag_specifier->set_regex("^vhost\\.(?:.*?)\\.route\\.((.*?)\\.)");
+  const Envoy::Stats::TagProducerImpl tag_producer{config};
+  const std::vector<std::string> names = Envoy::statNames();
+  std::vector<Envoy::Stats::Tag> tags;
+
+  for (auto _ : state) {
+    for (const std::string& name : names) {
+      tags.clear();
+      benchmark::DoNotOptimize(tag_producer.produceTags(name, tags));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_ExtractDefaultAndCustomTags);
+
+// Boilerplate main(), which discovers benchmarks in the same file and runs them.
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+}
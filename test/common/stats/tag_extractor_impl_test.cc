@@ -101,7 +101,7 @@ public:
   }
 
   /**
-   * Reimplements TagProducerImpl::produceTags, but extracts the tags in reverse order.
+   * Reimplements TagProducerImpl::produceTags, but runs the regex extractors in reverse order.
    * This helps demonstrate that the order of extractors does not matter to the end result,
    * assuming we don't care about tag-order. This is in large part correct by design because
    * stat_name is not mutated until all the extraction is done.
@@ -120,6 +120,7 @@ public:
                                              });
 
     IntervalSetImpl<size_t> remove_characters;
+    tag_extractors_.tag_token_matcher_.extractTags(metric_name, tags, remove_characters);
     for (const TagExtractor* tag_extractor : extractors) {
       tag_extractor->extractTag(metric_name, tags, remove_characters);
     }
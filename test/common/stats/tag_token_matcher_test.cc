@@ -0,0 +1,261 @@
+#include <string>
+#include <vector>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/utility.h"
+#include "common/config/well_known_names.h"
+#include "common/stats/tag_extractor_impl.h"
+#include "common/stats/tag_token_matcher.h"
+
+#include "test/common/stats/stat_test_utility.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+namespace {
+
+class TagTokenMatcherTest : public testing::Test {
+protected:
+  // Returns the tag-extracted name, and populates tags_.
+  std::string extract(const std::string& name) {
+    tags_.clear();
+    IntervalSetImpl<size_t> remove_characters;
+    matcher_.extractTags(name, tags_, remove_characters);
+    return StringUtil::removeCharacters(name, remove_characters);
+  }
+
+  TagTokenMatcher matcher_;
+  std::vector<Tag> tags_;
+};
+
+TEST_F(TagTokenMatcherTest, SingleTokenCapture) {
+  matcher_.addPattern("cluster_name", "cluster.$.*.**");
+  EXPECT_FALSE(matcher_.empty());
+
+  EXPECT_EQ("cluster.upstream_cx_total", extract("cluster.foo.upstream_cx_total"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("cluster_name", tags_[0].name_);
+  EXPECT_EQ("foo", tags_[0].value_);
+
+  EXPECT_EQ("cluster.outlier_detection.ejections_total",
+            extract("cluster.foo.outlier_detection.ejections_total"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("foo", tags_[0].value_);
+
+  // A token must follow the capture.
+  EXPECT_EQ("cluster.foo", extract("cluster.foo"));
+  EXPECT_TRUE(tags_.empty());
+
+  // The leading literal must match a whole token.
+  EXPECT_EQ("clusters.foo.bar", extract("clusters.foo.bar"));
+  EXPECT_TRUE(tags_.empty());
+  EXPECT_EQ("listener.foo.bar", extract("listener.foo.bar"));
+  EXPECT_TRUE(tags_.empty());
+}
+
+TEST_F(TagTokenMatcherTest, MultiTokenCapture) {
+  matcher_.addPattern("tcp_prefix", "tcp.$$.*");
+
+  EXPECT_EQ("tcp.downstream_cx_total", extract("tcp.ingress.downstream_cx_total"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("ingress", tags_[0].value_);
+
+  EXPECT_EQ("tcp.downstream_cx_total", extract("tcp.ingress.tcp.downstream_cx_total"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("ingress.tcp", tags_[0].value_);
+
+  EXPECT_EQ("tcp.downstream_cx_total", extract("tcp.downstream_cx_total"));
+  EXPECT_TRUE(tags_.empty());
+}
+
+TEST_F(TagTokenMatcherTest, TrailingMultiTokenCapture) {
+  matcher_.addPattern("cipher", "listener.**.ssl.cipher.$$");
+
+  EXPECT_EQ("listener.127.0.0.1_0.ssl.cipher", extract("listener.127.0.0.1_0.ssl.cipher.AES256"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("AES256", tags_[0].value_);
+
+  EXPECT_EQ("listener.ssl.cipher", extract("listener.ssl.cipher.A.B"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("A.B", tags_[0].value_);
+
+  EXPECT_EQ("listener.ssl.cipher", extract("listener.ssl.cipher"));
+  EXPECT_TRUE(tags_.empty());
+}
+
+TEST_F(TagTokenMatcherTest, PrefixCapture) {
+  matcher_.addPattern("partition", "http.**.capacity.**.__partition_id=$");
+
+  EXPECT_EQ("http.a.capacity.Query", extract("http.a.capacity.Query.__partition_id=ABC1234"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("ABC1234", tags_[0].value_);
+
+  EXPECT_EQ("http.a.capacity.Query.partition_id=ABC1234",
+            extract("http.a.capacity.Query.partition_id=ABC1234"));
+  EXPECT_TRUE(tags_.empty());
+}
+
+TEST_F(TagTokenMatcherTest, AnyTokensPrefersShortestMatch) {
+  matcher_.addPattern("prefix", "listener.**.http.$.*.**");
+
+  // The first 'http' token following 'listener' is used.
+  EXPECT_EQ("listener.1.http.http.rq_total", extract("listener.1.http.http.http.rq_total"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("http", tags_[0].value_);
+}
+
+TEST_F(TagTokenMatcherTest, SharedPrefixesReportTagsInPatternOrder) {
+  matcher_.addPattern("service", "cluster.**.grpc.$.*.**");
+  matcher_.addPattern("method", "cluster.**.grpc.**.$.*");
+  matcher_.addPattern("cluster", "cluster.$.*.**");
+  matcher_.addPattern("stat_prefix", "auth.clientssl.$$.*");
+
+  EXPECT_EQ("cluster.grpc.success", extract("cluster.c.grpc.service.method.success"));
+  ASSERT_EQ(3, tags_.size());
+  EXPECT_EQ("service", tags_[0].name_);
+  EXPECT_EQ("service", tags_[0].value_);
+  EXPECT_EQ("method", tags_[1].name_);
+  EXPECT_EQ("method", tags_[1].value_);
+  EXPECT_EQ("cluster", tags_[2].name_);
+  EXPECT_EQ("c", tags_[2].value_);
+
+  EXPECT_EQ("auth.clientssl.auth_no_ssl", extract("auth.clientssl.prefix.auth_no_ssl"));
+  ASSERT_EQ(1, tags_.size());
+  EXPECT_EQ("prefix", tags_[0].value_);
+
+  EXPECT_EQ("auth.prefix.auth_no_ssl", extract("auth.prefix.auth_no_ssl"));
+  EXPECT_TRUE(tags_.empty());
+}
+
+TEST_F(TagTokenMatcherTest, InvalidPatterns) {
+  EXPECT_TRUE(matcher_.empty());
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("", "cluster.$.**"), EnvoyException,
+                            "tag_name cannot be empty");
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("name", "cluster..$"), EnvoyException,
+                            "Empty token in tag pattern 'cluster..$'");
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("name", "**.$"), EnvoyException,
+                            "Tag pattern '**.$' must start with a literal token");
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("name", "cluster.**"), EnvoyException,
+                            "Tag pattern 'cluster.**' must contain exactly one capture token");
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("name", "cluster.$.$"), EnvoyException,
+                            "Tag pattern 'cluster.$.$' must contain exactly one capture token");
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("name", "cluster.a*b.$"), EnvoyException,
+                            "Invalid token 'a*b' in tag pattern 'cluster.a*b.$'");
+  EXPECT_THROW_WITH_MESSAGE(matcher_.addPattern("name", "cluster.a*$"), EnvoyException,
+                            "Invalid token 'a*$' in tag pattern 'cluster.a*$'");
+}
+
+// The token patterns in well_known_names.cc replaced regexes; verify that they extract the same
+// tags and tag-extracted names as those regexes did.
+TEST(TagTokenMatcherEquivalenceTest, DefaultPatternsMatchLegacyRegexes) {
+  const auto& names = Config::TagNames::get();
+  struct LegacyRegex {
+    const std::string& name_;
+    std::string regex_;
+  };
+  const std::vector<LegacyRegex> legacy_regexes = {
+      {names.DYNAMO_PARTITION_ID, "^http(?=\\.).*?\\.dynamodb\\.table(?=\\.).*?\\."
+                                  "capacity(?=\\.).*?(\\.__partition_id=(\\w{7}))$"},
+      {names.DYNAMO_OPERATION, "^http(?=\\.).*?\\.dynamodb.(?:operation|table(?="
+                               "\\.).*?\\.capacity)(\\.(.*?))(?:\\.|$)"},
+      {names.MONGO_CALLSITE,
+       "^mongo(?=\\.).*?\\.collection(?=\\.).*?\\.callsite\\.((.*?)\\.).*?query.\\w+?$"},
+      {names.DYNAMO_TABLE, "^http(?=\\.).*?\\.dynamodb.(?:table|error)\\.((.*?)\\.)"},
+      {names.MONGO_COLLECTION, "^mongo(?=\\.).*?\\.collection\\.((.*?)\\.).*?query.\\w+?$"},
+      {names.MONGO_CMD, "^mongo(?=\\.).*?\\.cmd\\.((.*?)\\.)\\w+?$"},
+      {names.GRPC_BRIDGE_METHOD, "^cluster(?=\\.).*?\\.grpc(?=\\.).*\\.((.*?)\\.)\\w+?$"},
+      {names.HTTP_USER_AGENT, "^http(?=\\.).*?\\.user_agent\\.((.*?)\\.)\\w+?$"},
+      {names.VIRTUAL_CLUSTER, "^vhost(?=\\.).*?\\.vcluster\\.((.*?)\\.)\\w+?$"},
+      {names.FAULT_DOWNSTREAM_CLUSTER, "^http(?=\\.).*?\\.fault\\.((.*?)\\.)\\w+?$"},
+      {names.SSL_CIPHER, "^listener(?=\\.).*?\\.ssl\\.cipher(\\.(.*?))$"},
+      {names.SSL_CIPHER_SUITE, "^cluster(?=\\.).*?\\.ssl\\.ciphers(\\.(.*?))$"},
+      {names.GRPC_BRIDGE_SERVICE, "^cluster(?=\\.).*?\\.grpc\\.((.*?)\\.)"},
+      {names.TCP_PREFIX, "^tcp\\.((.*?)\\.)\\w+?$"},
+      {names.CLIENTSSL_PREFIX, "^auth\\.clientssl\\.((.*?)\\.)\\w+?$"},
+      {names.RATELIMIT_PREFIX, "^ratelimit\\.((.*?)\\.)\\w+?$"},
+      {names.CLUSTER_NAME, "^cluster\\.((.*?)\\.)"},
+      {names.HTTP_CONN_MANAGER_PREFIX, "^listener(?=\\.).*?\\.http\\.((.*?)\\.)"},
+      {names.HTTP_CONN_MANAGER_PREFIX, "^http\\.((.*?)\\.)"},
+      {names.VIRTUAL_HOST, "^vhost\\.((.*?)\\.)"},
+      {names.MONGO_PREFIX, "^mongo\\.((.*?)\\.)"},
+  };
+
+  std::vector<TagExtractorPtr> extractors;
+  for (const LegacyRegex& legacy_regex : legacy_regexes) {
+    extractors.emplace_back(TagExtractorImpl::createTagExtractor(legacy_regex.name_,
+                                                                 legacy_regex.regex_));
+  }
+  TagTokenMatcher matcher;
+  for (const auto& desc : names.tokenizedDescriptorVec()) {
+    matcher.addPattern(desc.name_, desc.pattern_);
+  }
+
+  std::vector<std::string> stat_names = {
+      "cluster.ratelimit.upstream_rq_timeout",
+      "cluster.ratelimit.ssl.ciphers.ECDHE-RSA-AES128-GCM-SHA256",
+      "cluster.grpc_cluster.grpc.grpc_service_1.grpc_method_1.success",
+      "cluster.grpc_cluster.grpc.grpc_service_1.success",
+      "cluster.c.outlier_detection.ejections_active",
+      "listener.127.0.0.1_0.ssl.cipher.AES256-SHA",
+      "listener.[__1]_0.ssl.handshake",
+      "listener.127.0.0.1_3012.http.http_prefix.downstream_rq_5xx",
+      "listener.admin.http.admin.downstream_rq_2xx",
+      "mongo.mongo_filter.op_reply",
+      "mongo.mongo_filter.cmd.foo_cmd.reply_size",
+      "mongo.mongo_filter.cmd.foo.bar.reply_size",
+      "mongo.mongo_filter.collection.bar_collection.query.multi_get",
+      "mongo.mongo_filter.collection.bar_collection.callsite.baz_callsite.query.scatter_get",
+      "ratelimit.foo_ratelimiter.over_limit",
+      "ratelimit.foo.ratelimiter.over_limit",
+      "http.egress_dynamodb_iad.downstream_cx_total",
+      "http.egress_dynamodb_iad.dynamodb.operation.Query.upstream_rq_time",
+      "http.egress_dynamodb_iad.dynamodb.operation.Query",
+      "http.egress_dynamodb_iad.dynamodb.table.bar_table.upstream_rq_time",
+      "http.egress_dynamodb_iad.dynamodb.error.bar_table.ValidationException",
+      "http.egress_dynamodb_iad.dynamodb.table.bar_table.capacity.Query.__partition_id=ABC1234",
+      "http.egress_dynamodb_iad.dynamodb.table.bar_table.capacity.Query",
+      "http.egress_dynamodb_iad.user_agent.ios.downstream_cx_total",
+      "http.egress.user_agent.android.downstream_rq_total",
+      "http.fault_connection_manager.fault.fault_cluster.aborts_injected",
+      "http.admin.downstream_rq_2xx",
+      "vhost.vhost_1.vcluster.vcluster_1.upstream_rq_2xx",
+      "vhost.vhost_1.vcluster.vcluster_1.upstream_rq_time",
+      "auth.clientssl.clientssl_prefix.auth_ip_white_list",
+      "tcp.tcp_prefix.downstream_flow_control_resumed_reading_total",
+      "tcp.ingress.tcp.downstream_cx_total",
+      "server.live",
+      "runtime.load_success",
+      "cluster_manager.cds.update_success",
+  };
+  TestUtil::forEachSampleStat(
+      2, [&stat_names](absl::string_view name) { stat_names.emplace_back(std::string(name)); });
+
+  auto cmp = [](const Tag& lhs, const Tag& rhs) {
+    return lhs.name_ == rhs.name_ && lhs.value_ == rhs.value_;
+  };
+  for (const std::string& stat_name : stat_names) {
+    std::vector<Tag> expected_tags;
+    IntervalSetImpl<size_t> expected_remove_characters;
+    for (const TagExtractorPtr& extractor : extractors) {
+      extractor->extractTag(stat_name, expected_tags, expected_remove_characters);
+    }
+
+    std::vector<Tag> tags;
+    IntervalSetImpl<size_t> remove_characters;
+    matcher.extractTags(stat_name, tags, remove_characters);
+
+    EXPECT_EQ(StringUtil::removeCharacters(stat_name, expected_remove_characters),
+              StringUtil::removeCharacters(stat_name, remove_characters))
+        << stat_name;
+    ASSERT_EQ(expected_tags.size(), tags.size()) << stat_name;
+    EXPECT_TRUE(std::is_permutation(expected_tags.begin(), expected_tags.end(), tags.begin(), cmp))
+        << stat_name;
+  }
+}
+
+} // namespace
+} // namespace Stats
+} // namespace Envoy
@@ -1,6 +1,8 @@
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "envoy/config/metrics/v2/stats.pb.h"
@@ -423,6 +425,57 @@ TEST_F(StatsThreadLocalStoreTest, AllocFailed) {
   EXPECT_CALL(*alloc_, free(_));
 }
 
+TEST_F(StatsThreadLocalStoreTest, LazyStats) {
+  InSequence s;
+  store_->initializeThreading(main_thread_dispatcher_, tls_);
+
+  ScopePtr scope = store_->createScope("scope.");
+  EXPECT_CALL(*alloc_, alloc(_)).Times(0);
+  Counter& c1 = scope->lazyCounter("c1");
+  EXPECT_EQ(&c1, &scope->lazyCounter("c1"));
+  Gauge& g1 = scope->lazyGauge("g1");
+  EXPECT_EQ(&g1, &scope->lazyGauge("g1"));
+
+  // Lazy stats are listed with a zero value until they are modified.
+  EXPECT_EQ(2UL, store_->counters().size());
+  EXPECT_EQ(&c1, TestUtility::findCounter(*store_, "scope.c1").get());
+  EXPECT_EQ(0, c1.value());
+  EXPECT_EQ(1UL, store_->gauges().size());
+  EXPECT_EQ(&g1, store_->gauges().front().get());
+  EXPECT_EQ(0, g1.value());
+
+  EXPECT_CALL(*alloc_, alloc(absl::string_view("scope.c1")));
+  c1.inc();
+  EXPECT_CALL(*alloc_, alloc(absl::string_view("scope.g1")));
+  g1.set(5);
+  EXPECT_EQ(1, c1.value());
+  EXPECT_EQ(5, g1.value());
+  EXPECT_EQ(&c1, TestUtility::findCounter(*store_, "scope.c1").get());
+
+  // The stat itself is listed instead of the lazy stat once both exist.
+  EXPECT_CALL(*alloc_, alloc(absl::string_view("scope.c1")));
+  Counter& c1_prime = scope->counter("c1");
+  EXPECT_NE(&c1, &c1_prime);
+  EXPECT_EQ(1, c1_prime.value());
+  EXPECT_EQ(2UL, store_->counters().size());
+  EXPECT_EQ(&c1_prime, TestUtility::findCounter(*store_, "scope.c1").get());
+  EXPECT_EQ(&c1_prime, &scope->lazyCounter("c1"));
+
+  // Failed allocations fall back to the heap as for other stats.
+  EXPECT_CALL(*alloc_, alloc(absl::string_view("scope.c2"))).WillOnce(Return(nullptr));
+  Counter& c2 = scope->lazyCounter("c2");
+  c2.inc();
+  EXPECT_EQ(1, c2.value());
+  EXPECT_EQ(1UL, store_->counter("stats.overflow").value());
+
+  store_->shutdownThreading();
+  tls_.shutdownThread();
+
+  // Includes overflow stat.
+  EXPECT_CALL(*alloc_, free(_)).Times(4);
+  scope.reset();
+}
+
 TEST_F(StatsThreadLocalStoreTest, HotRestartTruncation) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -660,6 +713,27 @@ TEST_F(HeapStatsThreadLocalStoreTest, RemoveRejectedStats) {
   histogram.recordValue(42);
 }
 
+TEST_F(HeapStatsThreadLocalStoreTest, RemoveRejectedLazyStats) {
+  Counter& counter = store_->lazyCounter("c1");
+  Gauge& gauge = store_->lazyGauge("g1");
+  ASSERT_EQ(2, store_->counters().size()); // "stats.overflow" and "c1".
+  ASSERT_EQ(1, store_->gauges().size());
+
+  envoy::config::metrics::v2::StatsConfig stats_config;
+  stats_config.mutable_stats_matcher()->mutable_inclusion_list()->add_patterns()->set_exact(
+      "no-such-stat");
+  store_->setStatsMatcher(std::make_unique<StatsMatcherImpl>(stats_config));
+
+  EXPECT_EQ(0, store_->counters().size());
+  EXPECT_EQ(0, store_->gauges().size());
+  EXPECT_EQ(&store_->lazyCounter("c1"), &store_->counter("c1"));
+
+  // Materializing the previously declared stats will not crash.
+  counter.inc();
+  gauge.inc();
+  EXPECT_EQ(1, counter.value());
+}
+
 TEST_F(HeapStatsThreadLocalStoreTest, NonHotRestartNoTruncation) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -721,6 +795,34 @@ TEST_F(HeapStatsThreadLocalStoreTest, MemoryWithTls) {
   EXPECT_LT(end_mem - start_mem, 31 * million); // actual value: 30482576 as of Oct 29, 2018
 }
 
+// Lazy stats which are never modified only take a fraction of the memory of the stats.
+TEST_F(HeapStatsThreadLocalStoreTest, LazyMemoryWithoutTls) {
+  if (!TestUtil::hasDeterministicMallocStats()) {
+    return;
+  }
+
+  // Use a tag producer that will produce tags.
+  envoy::config::metrics::v2::StatsConfig stats_config;
+  store_->setTagProducer(std::make_unique<TagProducerImpl>(stats_config));
+
+  const size_t start_mem = Memory::Stats::totalCurrentlyAllocated();
+  if (start_mem == 0) {
+    // Skip this test for platforms where we can't measure memory.
+    return;
+  }
+  TestUtil::forEachSampleStat(
+      1000, [this](absl::string_view name) { store_->counter(std::string(name)); });
+  const size_t counter_mem = Memory::Stats::totalCurrentlyAllocated() - start_mem;
+
+  resetStoreWithAlloc(heap_alloc_);
+  store_->setTagProducer(std::make_unique<TagProducerImpl>(stats_config));
+  const size_t lazy_start_mem = Memory::Stats::totalCurrentlyAllocated();
+  TestUtil::forEachSampleStat(
+      1000, [this](absl::string_view name) { store_->lazyCounter(std::string(name)); });
+  const size_t lazy_counter_mem = Memory::Stats::totalCurrentlyAllocated() - lazy_start_mem;
+  EXPECT_LT(lazy_counter_mem, counter_mem * 3 / 4);
+}
+
 TEST_F(StatsThreadLocalStoreTest, ShuttingDown) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -916,6 +1018,78 @@ TEST_F(HistogramTest, BasicHistogramUsed) {
   }
 }
 
+// Validates that the interval statistics are reset after an interval without values while the
+// cumulative statistics are retained.
+TEST_F(HistogramTest, EmptyIntervalAfterValues) {
+  Histogram& h1 = store_->histogram("h1");
+
+  expectCallAndAccumulate(h1, 100);
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(1, validateMerge());
+
+  expectCallAndAccumulate(h1, 5);
+  EXPECT_EQ(1, validateMerge());
+  EXPECT_EQ(1, validateMerge());
+}
+
+// Validates that merging only moves non-empty bins into the target histogram.
+TEST(ThreadLocalHistogramImplTest, MergeIsSparse) {
+  ThreadLocalHistogramImpl histogram("h1", "h1", {});
+  histogram.recordValue(1);
+  histogram.recordValue(1000);
+
+  CSmartPtr<histogram_t, hist_free> target(hist_alloc());
+  EXPECT_EQ(2, histogram.merge(target.get()));
+  EXPECT_EQ(2, hist_bucket_count(target.get()));
+
+  // The harvested histogram still has bins for 1 and 1000, but they are empty.
+  histogram.recordValue(7);
+  histogram.recordValue(7);
+  EXPECT_EQ(2, histogram.merge(target.get()));
+  EXPECT_EQ(3, hist_bucket_count(target.get()));
+
+  target.reset(hist_alloc());
+  EXPECT_EQ(0, histogram.merge(target.get()));
+  EXPECT_EQ(0, hist_bucket_count(target.get()));
+
+  histogram.recordValue(1000);
+  EXPECT_EQ(1, histogram.merge(target.get()));
+  EXPECT_EQ(1, hist_bucket_count(target.get()));
+  EXPECT_TRUE(histogram.used());
+}
+
+// Validates that no values are lost when merging concurrently with recording on another thread.
+TEST(ThreadLocalHistogramImplTest, MergeConcurrentlyWithRecording) {
+  const uint64_t num_values = 100000;
+  std::unique_ptr<ThreadLocalHistogramImpl> histogram;
+  std::atomic<bool> created{false};
+  std::atomic<bool> done{false};
+
+  Thread::ThreadPtr thread = Thread::threadFactoryForTest().createThread([&]() {
+    histogram = std::make_unique<ThreadLocalHistogramImpl>("h1", "h1", std::vector<Tag>());
+    created = true;
+    for (uint64_t i = 0; i < num_values; ++i) {
+      histogram->recordValue(i % 1000);
+    }
+    done = true;
+  });
+  while (!created) {
+    std::this_thread::yield();
+  }
+
+  CSmartPtr<histogram_t, hist_free> target(hist_alloc());
+  uint64_t merged = 0;
+  while (!done) {
+    merged += histogram->merge(target.get());
+  }
+  thread->join();
+  merged += histogram->merge(target.get());
+
+  EXPECT_EQ(num_values, merged);
+  EXPECT_EQ(num_values, hist_sample_count(target.get()));
+}
+
 class TruncatingAllocTest : public HeapStatsThreadLocalStoreTest {
 protected:
   TruncatingAllocTest() : test_alloc_(options_), long_name_(options_.maxNameLength() + 1, 'A') {}
@@ -795,6 +795,110 @@ TEST_F(TcpConnPoolImplTest, ConcurrentConnections) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+/**
+ * Test that warming up opens the warm connections of the cluster, which then serve requests
+ * without connecting.
+ */
+TEST_F(TcpConnPoolImplTest, WarmUp) {
+  cluster_->resetResourceManager(2, 1024, 1024, 1);
+  cluster_->warm_connections_ = 3;
+  InSequence s;
+
+  // The third warm connection is over the circuit breaker.
+  conn_pool_.expectConnCreate();
+  conn_pool_.expectConnCreate();
+  conn_pool_.warmUp();
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_preconnect_.value());
+  conn_pool_.test_conns_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  conn_pool_.test_conns_[1].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  // The most recently connected connection is used first.
+  ActiveTestConn c1(*this, 1, ActiveTestConn::Type::Immediate);
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  EXPECT_CALL(conn_pool_, onConnReleasedForTest());
+  c1.releaseConn();
+
+  EXPECT_CALL(conn_pool_, onConnDestroyedForTest()).Times(2);
+  conn_pool_.test_conns_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_conns_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_preconnect_.value());
+}
+
+/**
+ * Test that a draining pool is not warmed up.
+ */
+TEST_F(TcpConnPoolImplTest, NoWarmUpWhileDraining) {
+  cluster_->warm_connections_ = 1;
+  InSequence s;
+
+  ReadyWatcher drained;
+  EXPECT_CALL(drained, ready());
+  conn_pool_.addDrainedCallback([&]() -> void { drained.ready(); });
+
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _, _, _)).Times(0);
+  conn_pool_.warmUp();
+  EXPECT_EQ(0U, cluster_->stats_.upstream_cx_preconnect_.value());
+}
+
+/**
+ * Test that the preconnect ratio opens connections ahead of the requests, and replaces them when
+ * they close, but not after connect failures.
+ */
+TEST_F(TcpConnPoolImplTest, PreconnectRatio) {
+  cluster_->resetResourceManager(1024, 1024, 1024, 1);
+  cluster_->per_upstream_preconnect_ratio_ = 2;
+  InSequence s;
+
+  // The first request opens its connection, and a second one for the next request.
+  ConnPoolCallbacks callbacks1;
+  conn_pool_.expectConnCreate();
+  conn_pool_.expectConnCreate();
+  EXPECT_NE(nullptr, conn_pool_.newConnection(callbacks1));
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  EXPECT_CALL(callbacks1.pool_ready_, ready());
+  conn_pool_.test_conns_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  conn_pool_.test_conns_[1].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  // The second request does not wait for a connection, and 2 more are opened for the next ones.
+  ConnPoolCallbacks callbacks2;
+  EXPECT_CALL(callbacks2.pool_ready_, ready());
+  conn_pool_.expectConnCreate();
+  conn_pool_.expectConnCreate();
+  EXPECT_EQ(nullptr, conn_pool_.newConnection(callbacks2));
+  EXPECT_EQ(3U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  // A connect failure is not replaced.
+  EXPECT_CALL(conn_pool_, onConnDestroyedForTest());
+  conn_pool_.test_conns_[3].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(3U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  // An idle connection which closes is replaced, as well as the failed one.
+  conn_pool_.test_conns_[2].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  conn_pool_.expectConnCreate();
+  conn_pool_.expectConnCreate();
+  EXPECT_CALL(conn_pool_, onConnDestroyedForTest());
+  conn_pool_.test_conns_[2].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(5U, cluster_->stats_.upstream_cx_preconnect_.value());
+
+  EXPECT_CALL(conn_pool_, onConnReleasedForTest()).Times(2);
+  callbacks1.conn_data_.reset();
+  callbacks2.conn_data_.reset();
+
+  // Without requests in progress, nothing is opened ahead of demand.
+  EXPECT_CALL(conn_pool_, onConnDestroyedForTest()).Times(4);
+  conn_pool_.test_conns_[3].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_conns_[2].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_conns_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_conns_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(5U, cluster_->stats_.upstream_cx_preconnect_.value());
+}
+
 /**
  * Tests ConnectionState lifecycle with multiple concurrent connections.
  */
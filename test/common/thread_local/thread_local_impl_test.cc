@@ -145,5 +145,69 @@ TEST(ThreadLocalInstanceImplDispatcherTest, Dispatcher) {
   tls.shutdownThread();
 }
 
+class TestValueObject : public ThreadLocalObject {
+public:
+  TestValueObject(uint64_t value) : value_(value) {}
+
+  const uint64_t value_;
+};
+
+// Validate that a thread skips the updates of a slot superseded before it applied them.
+TEST(ThreadLocalInstanceImplCoalescingTest, CoalescedSet) {
+  InstanceImpl tls;
+  Stats::IsolatedStoreImpl store;
+
+  DangerousDeprecatedTestTime test_time;
+  Event::DispatcherImpl main_dispatcher(test_time.timeSystem());
+  Event::DispatcherImpl thread_dispatcher(test_time.timeSystem());
+
+  tls.registerThread(main_dispatcher, true);
+  tls.registerThread(thread_dispatcher, false);
+  tls.initializeStats(store);
+
+  SlotPtr slot = tls.allocateSlot();
+  // Values created on the thread, and values the thread read from the slot.
+  std::vector<uint64_t> created;
+  std::vector<uint64_t> read;
+  const auto set = [&slot, &created, &thread_dispatcher](uint64_t value) {
+    slot->set([value, &created,
+               &thread_dispatcher](Event::Dispatcher& dispatcher) -> ThreadLocalObjectSharedPtr {
+      if (&dispatcher == &thread_dispatcher) {
+        created.push_back(value);
+      }
+      return std::make_shared<TestValueObject>(value);
+    });
+  };
+
+  // The first value is applied by the thread as it has no data yet.
+  set(1);
+  // Only the last value set before a callback run on all threads is applied, as the callback reads
+  // it.
+  set(2);
+  set(3);
+  set(4);
+  slot->runOnAllThreads([&tls, &slot, &read, &thread_dispatcher]() {
+    if (&tls.dispatcher() == &thread_dispatcher) {
+      read.push_back(slot->getTyped<TestValueObject>().value_);
+    }
+  });
+  // The last value is applied.
+  set(5);
+  set(6);
+
+  Thread::ThreadPtr thread = Thread::threadFactoryForTest().createThread([&thread_dispatcher]() {
+    thread_dispatcher.run(Event::Dispatcher::RunType::NonBlock);
+  });
+  thread->join();
+
+  EXPECT_EQ(std::vector<uint64_t>({1, 4, 6}), created);
+  EXPECT_EQ(std::vector<uint64_t>({4}), read);
+  EXPECT_EQ(3, store.counter("thread_local.collapsed_updates").value());
+  EXPECT_EQ(6, slot->getTyped<TestValueObject>().value_);
+
+  tls.shutdownGlobalThreading();
+  tls.shutdownThread();
+}
+
 } // namespace ThreadLocal
 } // namespace Envoy
@@ -1307,6 +1307,67 @@ TEST_F(ClusterManagerImplTest, CloseTcpConnectionPoolsOnHealthFailure) {
   EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster1.get()));
 }
 
+// Test that the hosts which become healthy are warmed up, in the connection pools used so far.
+TEST_F(ClusterManagerImplTest, WarmUpHostsOnHealthChange) {
+  const std::string json =
+      fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("some_cluster")}));
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  cluster1->info_->name_ = "some_cluster";
+  cluster1->info_->warm_connections_ = 1;
+  // Deliver the health changes to the workers without merging them.
+  cluster1->info_->lb_config_.mutable_update_merge_window()->set_seconds(0);
+  HostSharedPtr host1 = makeTestHost(cluster1->info_, "tcp://127.0.0.1:80");
+  MockHostSet* host_set = cluster1->prioritySet().getMockHostSet(0);
+  host_set->hosts_ = {host1};
+  host_set->healthy_hosts_ = {host1};
+  ON_CALL(*cluster1, initializePhase()).WillByDefault(Return(Cluster::InitializePhase::Primary));
+
+  Http::ConnectionPool::MockInstance* cp1 = new Http::ConnectionPool::MockInstance();
+  Http::ConnectionPool::MockInstance* cp2 = new Http::ConnectionPool::MockInstance();
+  Tcp::ConnectionPool::MockInstance* tcp1 = new Tcp::ConnectionPool::MockInstance();
+  Tcp::ConnectionPool::MockInstance* tcp2 = new Tcp::ConnectionPool::MockInstance();
+
+  InSequence s;
+
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _, _)).WillOnce(Return(cluster1));
+  EXPECT_CALL(*cluster1, initialize(_))
+      .WillOnce(Invoke([cluster1](std::function<void()> initialize_callback) {
+        // Test inline init.
+        initialize_callback();
+      }));
+  create(parseBootstrapFromJson(json));
+
+  // The hosts present before the pools are used are not warmed up.
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp1));
+  cluster_manager_->httpConnPoolForCluster("some_cluster", ResourcePriority::Default,
+                                           Http::Protocol::Http11, nullptr);
+  EXPECT_CALL(factory_, allocateTcpConnPool_(_)).WillOnce(Return(tcp1));
+  cluster_manager_->tcpConnPoolForCluster("some_cluster", ResourcePriority::Default, nullptr,
+                                          nullptr);
+
+  // A host joining the cluster before its first health check is not warmed up.
+  HostSharedPtr host2 = makeTestHost(cluster1->info_, "tcp://127.0.0.1:81");
+  host2->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  host_set->hosts_ = {host1, host2};
+  host_set->runCallbacks({host2}, {});
+
+  // It is warmed up once it passes its health check, the health change carrying no host added.
+  EXPECT_CALL(factory_, allocateConnPool_(HostConstSharedPtr(host2))).WillOnce(Return(cp2));
+  EXPECT_CALL(*cp2, warmUp());
+  EXPECT_CALL(factory_, allocateTcpConnPool_(HostConstSharedPtr(host2))).WillOnce(Return(tcp2));
+  EXPECT_CALL(*tcp2, warmUp());
+  host2->healthFlagClear(Host::HealthFlag::FAILED_ACTIVE_HC);
+  host_set->healthy_hosts_ = {host1, host2};
+  host_set->runCallbacks({}, {});
+
+  // The hosts already healthy are not warmed up again.
+  EXPECT_CALL(*cp1, warmUp()).Times(0);
+  EXPECT_CALL(*tcp1, warmUp()).Times(0);
+  host_set->runCallbacks({}, {});
+
+  EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster1.get()));
+}
+
 // Test that we close all TCP connection pool connections when there is a host health failure, when
 // configured to do so.
 TEST_F(ClusterManagerImplTest, CloseTcpConnectionsOnHealthFailure) {
@@ -2649,6 +2710,32 @@ TEST_F(SockoptsTest, SockoptsClusterOverride) {
   expectSetsockopts(names_vals);
 }
 
+TEST_F(SockoptsTest, TcpFastOpenCluster) {
+  const std::string yaml = R"EOF(
+  static_resources:
+    clusters:
+    - name: SockoptsCluster
+      connect_timeout: 0.250s
+      lb_policy: ROUND_ROBIN
+      type: STATIC
+      hosts:
+      - socket_address:
+          address: "127.0.0.1"
+          port_value: 11001
+      upstream_connection_options:
+        tcp_fast_open: true
+  )EOF";
+  initialize(yaml);
+  // TCP Fast Open is left out on the platforms not defining TCP_FASTOPEN_CONNECT.
+  if (!ENVOY_SOCKET_TCP_FASTOPEN_CONNECT.has_value()) {
+    expectNoSocketOptions();
+    return;
+  }
+  std::vector<std::pair<Network::SocketOptionName, int>> names_vals{
+      {ENVOY_SOCKET_TCP_FASTOPEN_CONNECT, 1}};
+  expectSetsockopts(names_vals);
+}
+
 // Validate that when tcp keepalives are set in the Cluster, we see the socket
 // option propagated to setsockopt(). This is as close to an end-to-end test as we have for this
 // feature, due to the complexity of creating an integration test involving the network stack. We
@@ -71,6 +71,25 @@ TEST(EdfSchedulerTest, Expired) {
   EXPECT_EQ(nullptr, sched.pick());
 }
 
+// Validate that expired entries are counted until they are picked.
+TEST(EdfSchedulerTest, Size) {
+  EdfScheduler<uint32_t> sched;
+  EXPECT_EQ(0, sched.size());
+
+  auto second_entry = std::make_shared<uint32_t>(42);
+  {
+    auto first_entry = std::make_shared<uint32_t>(37);
+    sched.add(2, first_entry);
+    sched.add(1, second_entry);
+  }
+  EXPECT_EQ(2, sched.size());
+
+  auto p = sched.pick();
+  EXPECT_EQ(0, sched.size());
+  sched.add(1, p);
+  EXPECT_EQ(1, sched.size());
+}
+
 } // namespace
 } // namespace Upstream
 } // namespace Envoy
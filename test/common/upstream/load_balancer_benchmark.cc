@@ -1,14 +1,22 @@
 // Usage: bazel run //test/common/upstream:load_balancer_benchmark
 
+#include <array>
 #include <memory>
 
+#include "common/config/metadata.h"
+#include "common/config/well_known_names.h"
+#include "common/memory/stats.h"
 #include "common/runtime/runtime_impl.h"
+#include "common/upstream/load_balancer_impl.h"
 #include "common/upstream/maglev_lb.h"
 #include "common/upstream/ring_hash_lb.h"
+#include "common/upstream/subset_lb.h"
 #include "common/upstream/upstream_impl.h"
 
 #include "test/common/upstream/utility.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/simulated_time_system.h"
+#include "test/test_common/utility.h"
 
 #include "testing/base/public/benchmark.h"
 
@@ -40,17 +48,35 @@ public:
   std::shared_ptr<MockClusterInfo> info_{new NiceMock<MockClusterInfo>()};
 };
 
+class RoundRobinTester : public BaseTester {
+public:
+  RoundRobinTester(uint64_t num_hosts, uint32_t weighted_subset_percent, uint32_t weight)
+      : BaseTester(num_hosts, weighted_subset_percent, weight) {
+    round_robin_lb_ = std::make_unique<RoundRobinLoadBalancer>(
+        priority_set_, nullptr, stats_, runtime_, random_, common_config_, time_system_);
+  }
+
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_{ClusterInfoImpl::generateStats(stats_store_)};
+  NiceMock<Runtime::MockLoader> runtime_;
+  Runtime::RandomGeneratorImpl random_;
+  envoy::api::v2::Cluster::CommonLbConfig common_config_;
+  Event::SimulatedTimeSystem time_system_;
+  std::unique_ptr<RoundRobinLoadBalancer> round_robin_lb_;
+};
+
 class RingHashTester : public BaseTester {
 public:
   RingHashTester(uint64_t num_hosts, uint64_t min_ring_size) : BaseTester(num_hosts) {
     config_ = (envoy::api::v2::Cluster::RingHashLbConfig());
     config_.value().mutable_minimum_ring_size()->set_value(min_ring_size);
     ring_hash_lb_ = std::make_unique<RingHashLoadBalancer>(priority_set_, stats_, runtime_, random_,
-                                                           config_, common_config_);
+                                                           config_, common_config_, *api_);
   }
 
   Stats::IsolatedStoreImpl stats_store_;
   ClusterStats stats_{ClusterInfoImpl::generateStats(stats_store_)};
+  Api::ApiPtr api_{Api::createApiForTest(stats_store_)};
   NiceMock<Runtime::MockLoader> runtime_;
   Runtime::RandomGeneratorImpl random_;
   absl::optional<envoy::api::v2::Cluster::RingHashLbConfig> config_;
@@ -69,10 +95,16 @@ void BM_RingHashLoadBalancerBuildRing(benchmark::State& state) {
     const uint64_t num_hosts = state.range(0);
     const uint64_t min_ring_size = state.range(1);
     RingHashTester tester(num_hosts, min_ring_size);
+    const uint64_t memory_before = Memory::Stats::totalCurrentlyAllocated();
     state.ResumeTiming();
 
     // We are only interested in timing the initial ring build.
     tester.ring_hash_lb_->initialize();
+
+    // The memory of the ring, when built with tcmalloc.
+    state.PauseTiming();
+    state.counters["memory_bytes"] = Memory::Stats::totalCurrentlyAllocated() - memory_before;
+    state.ResumeTiming();
   }
 }
 BENCHMARK(BM_RingHashLoadBalancerBuildRing)
@@ -82,6 +114,8 @@ BENCHMARK(BM_RingHashLoadBalancerBuildRing)
     ->Args({100, 256000})
     ->Args({200, 256000})
     ->Args({500, 256000})
+    ->Args({1000, 1048576})
+    ->Args({5000, 1048576})
     ->Unit(benchmark::kMillisecond);
 
 void BM_MaglevLoadBalancerBuildTable(benchmark::State& state) {
@@ -100,6 +134,173 @@ BENCHMARK(BM_MaglevLoadBalancerBuildTable)
     ->Arg(500)
     ->Unit(benchmark::kMillisecond);
 
+// Host set updates of a cluster whose hosts fail and recover their health checks, one host at a
+// time. Only the healthy hosts change.
+void BM_RoundRobinLoadBalancerHealthChurn(benchmark::State& state) {
+  const uint64_t num_hosts = state.range(0);
+  RoundRobinTester tester(num_hosts, 50, 2);
+  HostSet& host_set = tester.priority_set_.getOrCreateHostSet(0);
+  const HostVectorConstSharedPtr hosts = std::make_shared<const HostVector>(host_set.hosts());
+  uint64_t unhealthy_host = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    HostVectorSharedPtr healthy_hosts = std::make_shared<HostVector>();
+    for (uint64_t i = 0; i < num_hosts; i++) {
+      if (i != unhealthy_host) {
+        healthy_hosts->push_back((*hosts)[i]);
+      }
+    }
+    unhealthy_host = (unhealthy_host + 1) % num_hosts;
+    state.ResumeTiming();
+
+    host_set.updateHosts(hosts, healthy_hosts, HostsPerLocalityImpl::empty(),
+                         HostsPerLocalityImpl::empty(), {}, {}, {}, absl::nullopt);
+  }
+}
+BENCHMARK(BM_RoundRobinLoadBalancerHealthChurn)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Host set updates of a cluster whose hosts are replaced one at a time, e.g. by EDS during a
+// rolling deployment.
+void BM_RoundRobinLoadBalancerMembershipChurn(benchmark::State& state) {
+  const uint64_t num_hosts = state.range(0);
+  RoundRobinTester tester(num_hosts, 50, 2);
+  HostSet& host_set = tester.priority_set_.getOrCreateHostSet(0);
+  HostVector current_hosts = host_set.hosts();
+  uint64_t replaced_host = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    const uint64_t index = replaced_host++ % num_hosts;
+    const HostVector hosts_removed = {current_hosts[index]};
+    current_hosts[index] = makeTestHost(
+        tester.info_, fmt::format("tcp://10.1.{}.{}:6379", index / 256, index % 256), 2);
+    const HostVector hosts_added = {current_hosts[index]};
+    HostVectorConstSharedPtr hosts = std::make_shared<const HostVector>(current_hosts);
+    state.ResumeTiming();
+
+    host_set.updateHosts(hosts, hosts, HostsPerLocalityImpl::empty(),
+                         HostsPerLocalityImpl::empty(), {}, hosts_added, hosts_removed,
+                         absl::nullopt);
+  }
+}
+BENCHMARK(BM_RoundRobinLoadBalancerMembershipChurn)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Subset load balancer of a cluster whose hosts carry 6 metadata keys, of 5 to 1000 values. The
+// subset selectors are the first num_selectors combinations of these keys.
+class SubsetTester {
+public:
+  SubsetTester(uint64_t num_hosts, uint64_t num_selectors) {
+    ASSERT(num_hosts < 65536);
+    ASSERT(num_selectors < (1 << Cardinalities.size()));
+    for (uint64_t i = 0; i < num_hosts; i++) {
+      hosts_.push_back(makeHost(i, fmt::format("tcp://10.0.{}.{}:6379", i / 256, i % 256)));
+    }
+    HostVectorConstSharedPtr hosts = std::make_shared<const HostVector>(hosts_);
+    priority_set_.getOrCreateHostSet(0).updateHosts(hosts, hosts, HostsPerLocalityImpl::empty(),
+                                                    HostsPerLocalityImpl::empty(), {}, hosts_, {},
+                                                    absl::nullopt);
+
+    envoy::api::v2::Cluster::LbSubsetConfig config;
+    config.set_fallback_policy(envoy::api::v2::Cluster::LbSubsetConfig::ANY_ENDPOINT);
+    for (uint32_t selector = 1; selector <= num_selectors; selector++) {
+      auto* keys = config.add_subset_selectors()->mutable_keys();
+      for (uint32_t key = 0; key < Cardinalities.size(); key++) {
+        if (selector & (1 << key)) {
+          *keys->Add() = fmt::format("key{}", key);
+        }
+      }
+    }
+    subset_info_ = std::make_unique<LoadBalancerSubsetInfoImpl>(config);
+  }
+
+  HostSharedPtr makeHost(uint64_t index, const std::string& url) {
+    envoy::api::v2::core::Metadata metadata;
+    for (uint32_t key = 0; key < Cardinalities.size(); key++) {
+      Config::Metadata::mutableMetadataValue(metadata, Config::MetadataFilters::get().ENVOY_LB,
+                                             fmt::format("key{}", key))
+          .set_string_value(fmt::format("value{}", index % Cardinalities[key]));
+    }
+    return makeTestHost(info_, url, metadata);
+  }
+
+  std::unique_ptr<SubsetLoadBalancer> createLoadBalancer() {
+    return std::make_unique<SubsetLoadBalancer>(
+        LoadBalancerType::RoundRobin, priority_set_, nullptr, stats_, runtime_, random_,
+        *subset_info_, absl::nullopt, absl::nullopt, common_config_, time_system_, *api_);
+  }
+
+  static constexpr std::array<uint64_t, 6> Cardinalities{{5, 10, 20, 50, 100, 1000}};
+
+  PrioritySetImpl priority_set_;
+  std::shared_ptr<MockClusterInfo> info_{new NiceMock<MockClusterInfo>()};
+  HostVector hosts_;
+  std::unique_ptr<LoadBalancerSubsetInfoImpl> subset_info_;
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_{ClusterInfoImpl::generateStats(stats_store_)};
+  Api::ApiPtr api_{Api::createApiForTest(stats_store_)};
+  NiceMock<Runtime::MockLoader> runtime_;
+  Runtime::RandomGeneratorImpl random_;
+  envoy::api::v2::Cluster::CommonLbConfig common_config_;
+  Event::SimulatedTimeSystem time_system_;
+};
+
+constexpr std::array<uint64_t, 6> SubsetTester::Cardinalities;
+
+void BM_SubsetLoadBalancerBuild(benchmark::State& state) {
+  SubsetTester tester(state.range(0), state.range(1));
+  for (auto _ : state) {
+    std::unique_ptr<SubsetLoadBalancer> lb = tester.createLoadBalancer();
+
+    // Do not time the destruction of the load balancer.
+    state.PauseTiming();
+    lb.reset();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_SubsetLoadBalancerBuild)
+    ->Args({1000, 8})
+    ->Args({20000, 8})
+    ->Args({20000, 32})
+    ->Args({20000, 63})
+    ->Unit(benchmark::kMillisecond);
+
+// Host set updates of a cluster with subsets whose hosts are replaced one at a time. The new host
+// has the metadata of the host it replaces, so that it enters one subset per selector.
+void BM_SubsetLoadBalancerMembershipChurn(benchmark::State& state) {
+  SubsetTester tester(state.range(0), state.range(1));
+  std::unique_ptr<SubsetLoadBalancer> lb = tester.createLoadBalancer();
+  HostSet& host_set = tester.priority_set_.getOrCreateHostSet(0);
+  HostVector& current_hosts = tester.hosts_;
+  uint64_t replaced_host = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    const uint64_t index = replaced_host++ % current_hosts.size();
+    const HostVector hosts_removed = {current_hosts[index]};
+    current_hosts[index] = tester.makeHost(
+        index, fmt::format("tcp://10.1.{}.{}:6379", index / 256, index % 256));
+    const HostVector hosts_added = {current_hosts[index]};
+    HostVectorConstSharedPtr hosts = std::make_shared<const HostVector>(current_hosts);
+    state.ResumeTiming();
+
+    host_set.updateHosts(hosts, hosts, HostsPerLocalityImpl::empty(),
+                         HostsPerLocalityImpl::empty(), {}, hosts_added, hosts_removed,
+                         absl::nullopt);
+  }
+}
+BENCHMARK(BM_SubsetLoadBalancerMembershipChurn)
+    ->Args({1000, 8})
+    ->Args({20000, 8})
+    ->Args({20000, 32})
+    ->Args({20000, 63})
+    ->Unit(benchmark::kMicrosecond);
+
 class TestLoadBalancerContext : public LoadBalancerContextBase {
 public:
   // Upstream::LoadBalancerContext
@@ -183,7 +384,7 @@ void BM_MaglevLoadBalancerChooseHost(benchmark::State& state) {
     // std::unordered_map. However, it should be roughly equivalent to the work done when
     // comparing different hashing algorithms.
     for (uint64_t i = 0; i < keys_to_simulate; i++) {
-      hit_counter[table.chooseHost(hashInt(i))->address()->asString()] += 1;
+      hit_counter[table.chooseHost(hashInt(i), 0)->address()->asString()] += 1;
     }
 
     // Do not time computation of mean, standard deviation, and relative standard deviation.
@@ -255,7 +456,7 @@ void BM_MaglevLoadBalancerHostLoss(benchmark::State& state) {
                       nullptr);
     std::vector<HostConstSharedPtr> hosts;
     for (uint64_t i = 0; i < keys_to_simulate; i++) {
-      hosts.push_back(table.chooseHost(hashInt(i)));
+      hosts.push_back(table.chooseHost(hashInt(i), 0));
     }
 
     BaseTester tester2(num_hosts - hosts_to_lose);
@@ -263,7 +464,7 @@ void BM_MaglevLoadBalancerHostLoss(benchmark::State& state) {
                        nullptr);
     std::vector<HostConstSharedPtr> hosts2;
     for (uint64_t i = 0; i < keys_to_simulate; i++) {
-      hosts2.push_back(table2.chooseHost(hashInt(i)));
+      hosts2.push_back(table2.chooseHost(hashInt(i), 0));
     }
 
     ASSERT(hosts.size() == hosts2.size());
@@ -299,7 +500,7 @@ void BM_MaglevLoadBalancerWeighted(benchmark::State& state) {
                       nullptr);
     std::vector<HostConstSharedPtr> hosts;
     for (uint64_t i = 0; i < keys_to_simulate; i++) {
-      hosts.push_back(table.chooseHost(hashInt(i)));
+      hosts.push_back(table.chooseHost(hashInt(i), 0));
     }
 
     BaseTester tester2(num_hosts, weighted_subset_percent, after_weight);
@@ -307,7 +508,7 @@ void BM_MaglevLoadBalancerWeighted(benchmark::State& state) {
                        nullptr);
     std::vector<HostConstSharedPtr> hosts2;
     for (uint64_t i = 0; i < keys_to_simulate; i++) {
-      hosts2.push_back(table2.chooseHost(hashInt(i)));
+      hosts2.push_back(table2.chooseHost(hashInt(i), 0));
     }
 
     ASSERT(hosts.size() == hosts2.size());
@@ -1,6 +1,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -11,6 +12,7 @@
 #include "test/common/upstream/utility.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/simulated_time_system.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -43,6 +45,7 @@ protected:
   std::shared_ptr<MockClusterInfo> info_{new NiceMock<MockClusterInfo>()};
   envoy::api::v2::Cluster::CommonLbConfig common_config_;
   envoy::api::v2::Cluster::LeastRequestLbConfig least_request_lb_config_;
+  Event::SimulatedTimeSystem time_system_;
 };
 
 class TestLb : public LoadBalancerBase {
@@ -301,6 +304,18 @@ TEST_P(LoadBalancerBaseTest, BoundaryConditions) {
   }
 }
 
+class EdfLoadBalancerBasePeer {
+public:
+  // Returns the size of the EDF queue of the hosts or healthy hosts of a priority.
+  static size_t queueSize(LoadBalancer& lb, uint32_t priority, bool healthy) {
+    EdfLoadBalancerBase& edf_lb = dynamic_cast<EdfLoadBalancerBase&>(lb);
+    const EdfLoadBalancerBase::HostsSource source(
+        priority, healthy ? EdfLoadBalancerBase::HostsSource::SourceType::HealthyHosts
+                          : EdfLoadBalancerBase::HostsSource::SourceType::AllHosts);
+    return edf_lb.scheduler_.at(source).edf_.size();
+  }
+};
+
 class RoundRobinLoadBalancerTest : public LoadBalancerTestBase {
 public:
   void init(bool need_local_cluster) {
@@ -309,7 +324,7 @@ public:
       local_host_set_ = reinterpret_cast<HostSetImpl*>(&local_priority_set_->getOrCreateHostSet(0));
     }
     lb_.reset(new RoundRobinLoadBalancer(priority_set_, local_priority_set_.get(), stats_, runtime_,
-                                         random_, common_config_));
+                                         random_, common_config_, time_system_));
   }
 
   std::shared_ptr<PrioritySetImpl> local_priority_set_;
@@ -442,6 +457,137 @@ TEST_P(RoundRobinLoadBalancerTest, Normal) {
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
 }
 
+// Returns how many times the host is chosen out of num_picks picks.
+uint32_t countPicks(LoadBalancer& lb, const HostConstSharedPtr& host, uint32_t num_picks) {
+  uint32_t picks = 0;
+  for (uint32_t i = 0; i < num_picks; ++i) {
+    if (lb.chooseHost(nullptr) == host) {
+      picks++;
+    }
+  }
+  return picks;
+}
+
+// Validate that a host added to the cluster ramps up over the slow start window, while the hosts
+// known at construction get their full weight at once.
+TEST_P(RoundRobinLoadBalancerTest, SlowStart) {
+  common_config_.mutable_slow_start_config()->mutable_slow_start_window()->set_seconds(10);
+  stats_.max_host_weight_.set(1);
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  init(false);
+  EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
+
+  HostSharedPtr new_host = makeTestHost(info_, "tcp://127.0.0.1:82");
+  hostSet().healthy_hosts_.push_back(new_host);
+  hostSet().hosts_.push_back(new_host);
+  hostSet().runCallbacks({new_host}, {});
+
+  // The new host starts at 10% of its weight, even though all the weights are 1.
+  std::unordered_map<HostConstSharedPtr, uint32_t> picks;
+  for (uint32_t i = 0; i < 20; ++i) {
+    picks[lb_->chooseHost(nullptr)]++;
+  }
+  EXPECT_EQ(1U, picks[new_host]);
+
+  // Once the window is over, the hosts are picked in turn again.
+  time_system_.sleep(std::chrono::seconds(10));
+  picks.clear();
+  for (uint32_t i = 0; i < 30; ++i) {
+    picks[lb_->chooseHost(nullptr)]++;
+  }
+  EXPECT_EQ(10U, picks[hostSet().healthy_hosts_[0]]);
+  EXPECT_EQ(10U, picks[hostSet().healthy_hosts_[1]]);
+  EXPECT_EQ(10U, picks[new_host]);
+}
+
+// Validate that the weight of a new host grows linearly over the slow start window. The weight is
+// only updated when the host is picked, so the picks are counted after a few rounds.
+TEST_P(RoundRobinLoadBalancerTest, SlowStartRamp) {
+  common_config_.mutable_slow_start_config()->mutable_slow_start_window()->set_seconds(10);
+  stats_.max_host_weight_.set(1);
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  init(false);
+
+  HostSharedPtr new_host = makeTestHost(info_, "tcp://127.0.0.1:82");
+  hostSet().healthy_hosts_.push_back(new_host);
+  hostSet().hosts_.push_back(new_host);
+  hostSet().runCallbacks({new_host}, {});
+
+  // Half way through the window, the new host has half of its weight: 0.5 / (1 + 1 + 0.5).
+  time_system_.sleep(std::chrono::milliseconds(5000));
+  countPicks(*lb_, new_host, 100);
+  EXPECT_NEAR(200, countPicks(*lb_, new_host, 1000), 2);
+
+  // At 75% of the window: 0.75 / (1 + 1 + 0.75).
+  time_system_.sleep(std::chrono::milliseconds(2500));
+  countPicks(*lb_, new_host, 100);
+  EXPECT_NEAR(300, countPicks(*lb_, new_host, 1100), 2);
+}
+
+// Validate that the aggression shapes the ramp as (elapsed / window) ^ (1 / aggression).
+TEST_P(RoundRobinLoadBalancerTest, SlowStartAggression) {
+  common_config_.mutable_slow_start_config()->mutable_slow_start_window()->set_seconds(10);
+  common_config_.mutable_slow_start_config()->mutable_aggression()->set_value(2.0);
+  stats_.max_host_weight_.set(1);
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  init(false);
+
+  HostSharedPtr new_host = makeTestHost(info_, "tcp://127.0.0.1:82");
+  hostSet().healthy_hosts_.push_back(new_host);
+  hostSet().hosts_.push_back(new_host);
+  hostSet().runCallbacks({new_host}, {});
+
+  // At 25% of the window, the weight is sqrt(0.25) = 0.5 rather than 0.25.
+  time_system_.sleep(std::chrono::milliseconds(2500));
+  countPicks(*lb_, new_host, 100);
+  EXPECT_NEAR(200, countPicks(*lb_, new_host, 1000), 2);
+
+  // At 64% of the window, the weight is sqrt(0.64) = 0.8: 0.8 / (1 + 1 + 0.8).
+  time_system_.sleep(std::chrono::milliseconds(3900));
+  countPicks(*lb_, new_host, 100);
+  EXPECT_NEAR(400, countPicks(*lb_, new_host, 1400), 2);
+}
+
+// Validate that a host which becomes healthy again starts over its slow start. The healthy hosts
+// are updated without the hosts added and removed, which goes through the comparison of the
+// memberships.
+TEST_P(RoundRobinLoadBalancerTest, SlowStartHealthyAgain) {
+  common_config_.mutable_slow_start_config()->mutable_slow_start_window()->set_seconds(10);
+  stats_.max_host_weight_.set(1);
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81"),
+                              makeTestHost(info_, "tcp://127.0.0.1:82")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  init(false);
+  HostSharedPtr flapping_host = hostSet().hosts_[0];
+
+  hostSet().healthy_hosts_ = {hostSet().hosts_[1], hostSet().hosts_[2]};
+  hostSet().runCallbacks({}, {});
+  EXPECT_EQ(0U, countPicks(*lb_, flapping_host, 10));
+
+  // Long after it became unhealthy, the host becomes healthy again and gets 10% of its weight.
+  time_system_.sleep(std::chrono::seconds(60));
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+  EXPECT_GE(1U, countPicks(*lb_, flapping_host, 20));
+
+  time_system_.sleep(std::chrono::milliseconds(5000));
+  countPicks(*lb_, flapping_host, 100);
+  EXPECT_NEAR(200, countPicks(*lb_, flapping_host, 1000), 2);
+
+  // Once the window is over, the hosts are picked in turn again.
+  time_system_.sleep(std::chrono::milliseconds(5000));
+  countPicks(*lb_, flapping_host, 100);
+  EXPECT_EQ(10U, countPicks(*lb_, flapping_host, 30));
+}
+
 // Validate that the RNG seed influences pick order.
 TEST_P(RoundRobinLoadBalancerTest, Seed) {
   hostSet().healthy_hosts_ = {
@@ -511,23 +657,25 @@ TEST_P(RoundRobinLoadBalancerTest, Weighted) {
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
-  // Add a host, it should participate in next round of scheduling.
+  // Add a host, it is scheduled from the current pick onwards while the other hosts keep their
+  // place in the schedule.
   hostSet().healthy_hosts_.push_back(makeTestHost(info_, "tcp://127.0.0.1:82", 3));
   hostSet().hosts_.push_back(hostSet().healthy_hosts_.back());
   hostSet().runCallbacks({hostSet().healthy_hosts_.back()}, {});
   EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
-  EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
-  EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
-  EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
-  // Remove last two hosts, add a new one with different weights.
+  EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().healthy_hosts_[2], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
+  // Remove last two hosts, add a new one with different weights. The removed hosts are still
+  // referenced by the test but they leave the schedule.
   HostVector removed_hosts = {hostSet().hosts_[1], hostSet().hosts_[2]};
   hostSet().healthy_hosts_.pop_back();
   hostSet().healthy_hosts_.pop_back();
@@ -538,8 +686,6 @@ TEST_P(RoundRobinLoadBalancerTest, Weighted) {
   hostSet().healthy_hosts_[0]->weight(1);
   hostSet().runCallbacks({hostSet().healthy_hosts_.back()}, removed_hosts);
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
-  EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
-  EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
@@ -547,6 +693,72 @@ TEST_P(RoundRobinLoadBalancerTest, Weighted) {
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_->chooseHost(nullptr));
   EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().healthy_hosts_[1], lb_->chooseHost(nullptr));
+}
+
+// Validate that a host whose health flips leaves and rejoins the schedule, while it is still in
+// the host set.
+TEST_P(RoundRobinLoadBalancerTest, WeightedHealthChange) {
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80", 1),
+                              makeTestHost(info_, "tcp://127.0.0.1:81", 2)};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  init(false);
+  EXPECT_EQ(hostSet().hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[1], lb_->chooseHost(nullptr));
+  // The health flip is not reported as a host added or removed.
+  hostSet().healthy_hosts_ = {hostSet().hosts_[0]};
+  hostSet().runCallbacks({}, {});
+  EXPECT_EQ(hostSet().hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[0], lb_->chooseHost(nullptr));
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+  EXPECT_EQ(hostSet().hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(hostSet().hosts_[1], lb_->chooseHost(nullptr));
+}
+
+// Validate that the EDF queues stay bounded when hosts churn and flap while all weights are 1, so
+// that the queues are never picked.
+TEST_P(RoundRobinLoadBalancerTest, UnweightedChurn) {
+  stats_.max_host_weight_.set(1);
+  for (uint32_t i = 0; i < 10; ++i) {
+    hostSet().hosts_.push_back(makeTestHost(info_, fmt::format("tcp://127.0.0.1:{}", 80 + i)));
+  }
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  init(false);
+  const uint32_t priority = hostSet().priority();
+
+  for (uint32_t i = 0; i < 1000; ++i) {
+    // A host fails its health checks and comes back.
+    hostSet().healthy_hosts_.erase(hostSet().healthy_hosts_.begin());
+    hostSet().runCallbacks({}, {});
+    hostSet().healthy_hosts_ = hostSet().hosts_;
+    hostSet().runCallbacks({}, {});
+
+    // A host is replaced.
+    HostSharedPtr removed = hostSet().hosts_.front();
+    HostSharedPtr added = makeTestHost(info_, fmt::format("tcp://127.0.0.1:{}", 1000 + i));
+    hostSet().hosts_.erase(hostSet().hosts_.begin());
+    hostSet().hosts_.push_back(added);
+    hostSet().healthy_hosts_ = hostSet().hosts_;
+    hostSet().runCallbacks({added}, {removed});
+
+    EXPECT_LE(EdfLoadBalancerBasePeer::queueSize(*lb_, priority, false), 20);
+    EXPECT_LE(EdfLoadBalancerBasePeer::queueSize(*lb_, priority, true), 20);
+  }
+
+  // The hosts are still all picked in turn.
+  std::set<HostConstSharedPtr> picked;
+  for (uint32_t i = 0; i < 10; ++i) {
+    picked.insert(lb_->chooseHost(nullptr));
+  }
+  EXPECT_EQ(10, picked.size());
 }
 
 // Validate that the RNG seed influences pick order when weighted RR.
@@ -968,8 +1180,9 @@ INSTANTIATE_TEST_CASE_P(PrimaryOrFailover, RoundRobinLoadBalancerTest,
 
 class LeastRequestLoadBalancerTest : public LoadBalancerTestBase {
 public:
-  LeastRequestLoadBalancer lb_{
-      priority_set_, nullptr, stats_, runtime_, random_, common_config_, least_request_lb_config_};
+  LeastRequestLoadBalancer lb_{priority_set_, nullptr,        stats_,
+                               runtime_,      random_,        common_config_,
+                               least_request_lb_config_,      time_system_};
 };
 
 TEST_P(LeastRequestLoadBalancerTest, NoHosts) { EXPECT_EQ(nullptr, lb_.chooseHost(nullptr)); }
@@ -1045,11 +1258,11 @@ TEST_P(LeastRequestLoadBalancerTest, PNC) {
   // Creating various load balancer objects with different choice configs.
   envoy::api::v2::Cluster::LeastRequestLbConfig lr_lb_config;
   lr_lb_config.mutable_choice_count()->set_value(2);
-  LeastRequestLoadBalancer lb_2{priority_set_, nullptr,        stats_,      runtime_,
-                                random_,       common_config_, lr_lb_config};
+  LeastRequestLoadBalancer lb_2{priority_set_, nullptr,        stats_,       runtime_,
+                                random_,       common_config_, lr_lb_config, time_system_};
   lr_lb_config.mutable_choice_count()->set_value(5);
-  LeastRequestLoadBalancer lb_5{priority_set_, nullptr,        stats_,      runtime_,
-                                random_,       common_config_, lr_lb_config};
+  LeastRequestLoadBalancer lb_5{priority_set_, nullptr,        stats_,       runtime_,
+                                random_,       common_config_, lr_lb_config, time_system_};
 
   // Verify correct number of choices.
 
@@ -1142,9 +1355,159 @@ TEST_P(LeastRequestLoadBalancerTest, WeightImbalanceCallbacks) {
   EXPECT_EQ(hostSet().healthy_hosts_[0], lb_.chooseHost(nullptr));
 }
 
+// Validate that a host added to the cluster ramps up over the slow start window, the EDF schedule
+// being used even though all the weights are 1.
+TEST_P(LeastRequestLoadBalancerTest, SlowStart) {
+  common_config_.mutable_slow_start_config()->mutable_slow_start_window()->set_seconds(10);
+  stats_.max_host_weight_.set(1);
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  LeastRequestLoadBalancer lb{priority_set_, nullptr, stats_,
+                              runtime_,      random_, common_config_,
+                              least_request_lb_config_, time_system_};
+
+  HostSharedPtr new_host = makeTestHost(info_, "tcp://127.0.0.1:82");
+  hostSet().healthy_hosts_.push_back(new_host);
+  hostSet().hosts_.push_back(new_host);
+  hostSet().runCallbacks({new_host}, {});
+  EXPECT_GE(1U, countPicks(lb, new_host, 20));
+
+  // Half way through the window: 0.5 / (1 + 1 + 0.5).
+  time_system_.sleep(std::chrono::milliseconds(5000));
+  countPicks(lb, new_host, 100);
+  EXPECT_NEAR(200, countPicks(lb, new_host, 1000), 2);
+}
+
 INSTANTIATE_TEST_CASE_P(PrimaryOrFailover, LeastRequestLoadBalancerTest,
                         ::testing::Values(true, false));
 
+class PeakEwmaLoadBalancerTest : public LoadBalancerTestBase {
+public:
+  // Makes the LB sample the hosts at the given indexes of the healthy hosts.
+  void expectSamples(uint64_t first, uint64_t second) {
+    EXPECT_CALL(random_, random())
+        .WillOnce(Return(0))
+        .WillOnce(Return(first))
+        .WillOnce(Return(second));
+  }
+
+  PeakEwmaLoadBalancer lb_{priority_set_, nullptr,        stats_,        runtime_,
+                           random_,       common_config_, absl::nullopt, time_system_};
+};
+
+TEST_P(PeakEwmaLoadBalancerTest, NoHosts) { EXPECT_EQ(nullptr, lb_.chooseHost(nullptr)); }
+
+TEST_P(PeakEwmaLoadBalancerTest, Normal) {
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({}, {}); // Trigger callbacks. The added/removed lists are not relevant.
+  const HostSharedPtr& host0 = hostSet().healthy_hosts_[0];
+  const HostSharedPtr& host1 = hostSet().healthy_hosts_[1];
+
+  // Hosts which have not responded yet get one request at a time.
+  expectSamples(0, 1);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+  host0->stats().rq_active_.set(1);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+
+  // The cost is the response time times the number of active requests plus one.
+  host0->stats().rq_active_.set(0);
+  lb_.onHostResponse(*host0, std::chrono::milliseconds(10), true);
+  lb_.onHostResponse(*host1, std::chrono::milliseconds(50), true);
+  expectSamples(0, 1);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+  host0->stats().rq_active_.set(5);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+
+  // A slow response is taken as is.
+  host0->stats().rq_active_.set(0);
+  lb_.onHostResponse(*host0, std::chrono::milliseconds(100), true);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+
+  // The response time of a host which does not respond decays, here to 100ms / e^2.
+  time_system_.sleep(std::chrono::seconds(20));
+  lb_.onHostResponse(*host1, std::chrono::milliseconds(50), true);
+  expectSamples(1, 0);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+}
+
+// The times of the requests which timed out or were reset raise the average, but do not lower it.
+TEST_P(PeakEwmaLoadBalancerTest, Failures) {
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({}, {}); // Trigger callbacks. The added/removed lists are not relevant.
+  const HostSharedPtr& host0 = hostSet().healthy_hosts_[0];
+  const HostSharedPtr& host1 = hostSet().healthy_hosts_[1];
+
+  // A host which times out before its first response is no longer probed.
+  expectSamples(0, 1);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+  lb_.onHostResponse(*host0, std::chrono::seconds(1), false);
+  lb_.onHostResponse(*host1, std::chrono::milliseconds(50), true);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+
+  // Its average decays while it does not respond, here to 1s / e^6, so that it is tried again.
+  time_system_.sleep(std::chrono::seconds(60));
+  lb_.onHostResponse(*host1, std::chrono::milliseconds(50), true);
+  expectSamples(0, 1);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+
+  // A new timeout makes it slow again at once.
+  lb_.onHostResponse(*host0, std::chrono::seconds(1), false);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+
+  // A request reset faster than the average does not lower it.
+  lb_.onHostResponse(*host0, std::chrono::milliseconds(1), false);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+
+  // A fast response does.
+  time_system_.sleep(std::chrono::seconds(60));
+  lb_.onHostResponse(*host0, std::chrono::milliseconds(1), true);
+  lb_.onHostResponse(*host1, std::chrono::milliseconds(50), true);
+  expectSamples(0, 1);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+}
+
+// The responses of hosts which are not in the host set are ignored.
+TEST_P(PeakEwmaLoadBalancerTest, RemovedHost) {
+  hostSet().healthy_hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                              makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({}, {}); // Trigger callbacks. The added/removed lists are not relevant.
+  const HostSharedPtr host0 = hostSet().healthy_hosts_[0];
+  const HostSharedPtr host1 = hostSet().healthy_hosts_[1];
+
+  expectSamples(0, 1);
+  EXPECT_EQ(host0, lb_.chooseHost(nullptr));
+  lb_.onHostResponse(*host0, std::chrono::milliseconds(10), true);
+  lb_.onHostResponse(*host1, std::chrono::milliseconds(50), true);
+
+  hostSet().healthy_hosts_ = {host1};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({}, {host0});
+  lb_.onHostResponse(*host0, std::chrono::milliseconds(1), true);
+
+  // Once added back, the host has not responded yet.
+  hostSet().healthy_hosts_ = {host0, host1};
+  hostSet().hosts_ = hostSet().healthy_hosts_;
+  hostSet().runCallbacks({host0}, {});
+  host0->stats().rq_active_.set(1);
+  expectSamples(0, 1);
+  EXPECT_EQ(host1, lb_.chooseHost(nullptr));
+}
+
+INSTANTIATE_TEST_CASE_P(PrimaryOrFailover, PeakEwmaLoadBalancerTest,
+                        ::testing::Values(true, false));
+
 class RandomLoadBalancerTest : public LoadBalancerTestBase {
 public:
   RandomLoadBalancer lb_{priority_set_, nullptr, stats_, runtime_, random_, common_config_};
@@ -11,6 +11,7 @@
 #include "test/common/upstream/utility.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/simulated_time_system.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -63,8 +64,9 @@ TEST(DISABLED_LeastRequestLoadBalancerWeightTest, Weight) {
   Runtime::RandomGeneratorImpl random;
   envoy::api::v2::Cluster::LeastRequestLbConfig least_request_lb_config;
   envoy::api::v2::Cluster::CommonLbConfig common_config;
-  LeastRequestLoadBalancer lb_{
-      priority_set, nullptr, stats, runtime, random, common_config, least_request_lb_config};
+  Event::SimulatedTimeSystem time_system;
+  LeastRequestLoadBalancer lb_{priority_set, nullptr, stats, runtime, random, common_config,
+                               least_request_lb_config, time_system};
 
   std::unordered_map<HostConstSharedPtr, uint64_t> host_hits;
   const uint64_t total_requests = 100;
@@ -227,5 +227,60 @@ TEST_F(MaglevLoadBalancerTest, LocalityWeightedGlobalPanic) {
   }
 }
 
+// With a hash balance factor, overloaded hosts are skipped for the next host of the table.
+TEST_F(MaglevLoadBalancerTest, HashBalanceFactor) {
+  host_set_.hosts_ = {
+      makeTestHost(info_, "tcp://127.0.0.1:90"), makeTestHost(info_, "tcp://127.0.0.1:91"),
+      makeTestHost(info_, "tcp://127.0.0.1:92"), makeTestHost(info_, "tcp://127.0.0.1:93"),
+      makeTestHost(info_, "tcp://127.0.0.1:94"), makeTestHost(info_, "tcp://127.0.0.1:95")};
+  host_set_.healthy_hosts_ = host_set_.hosts_;
+  host_set_.runCallbacks({}, {});
+  common_config_.mutable_consistent_hashing_lb_config()->mutable_hash_balance_factor()->set_value(
+      150);
+  init(7);
+
+  // The table is the one of the Basic test: {92, 94, 90, 91, 95, 90, 93}. The capacity of the
+  // hosts is 150% of (6 + 1) / 6 requests, i.e. 2 requests once rounded up.
+  host_set_.hosts_[2]->stats().rq_active_.set(4);
+  host_set_.hosts_[4]->stats().rq_active_.set(2);
+  stats_.upstream_rq_active_.set(6);
+  LoadBalancerPtr lb = lb_->factory()->create();
+  {
+    TestLoadBalancerContext context(0);
+    EXPECT_EQ(host_set_.hosts_[0], lb->chooseHost(&context));
+  }
+  EXPECT_EQ(2UL, stats_.lb_hash_host_overloaded_.value());
+  {
+    TestLoadBalancerContext context(3);
+    EXPECT_EQ(host_set_.hosts_[1], lb->chooseHost(&context));
+  }
+  EXPECT_EQ(2UL, stats_.lb_hash_host_overloaded_.value());
+}
+
+// A host met again on the table during the walk of a request is neither checked nor counted
+// again, and does not stop the walk before the hosts not checked yet.
+TEST_F(MaglevLoadBalancerTest, HashBalanceFactorRepeatedHost) {
+  host_set_.hosts_ = {
+      makeTestHost(info_, "tcp://127.0.0.1:90"), makeTestHost(info_, "tcp://127.0.0.1:91"),
+      makeTestHost(info_, "tcp://127.0.0.1:92"), makeTestHost(info_, "tcp://127.0.0.1:93"),
+      makeTestHost(info_, "tcp://127.0.0.1:94"), makeTestHost(info_, "tcp://127.0.0.1:95")};
+  host_set_.healthy_hosts_ = host_set_.hosts_;
+  host_set_.runCallbacks({}, {});
+  common_config_.mutable_consistent_hashing_lb_config()->mutable_hash_balance_factor()->set_value(
+      150);
+  init(7);
+
+  // The table is {92, 94, 90, 91, 95, 90, 93} and the capacity of the hosts is 2 requests. All the
+  // hosts but :93, the last of the table, are overloaded, and :90 is met twice.
+  for (uint32_t i : {0, 1, 2, 4, 5}) {
+    host_set_.hosts_[i]->stats().rq_active_.set(2);
+  }
+  stats_.upstream_rq_active_.set(6);
+  LoadBalancerPtr lb = lb_->factory()->create();
+  TestLoadBalancerContext context(0);
+  EXPECT_EQ(host_set_.hosts_[3], lb->chooseHost(&context));
+  EXPECT_EQ(5UL, stats_.lb_hash_host_overloaded_.value());
+}
+
 } // namespace Upstream
 } // namespace Envoy
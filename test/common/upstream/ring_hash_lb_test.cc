@@ -1,10 +1,13 @@
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/router/router.h"
 
+#include "common/common/hash.h"
 #include "common/network/utility.h"
 #include "common/upstream/ring_hash_lb.h"
 #include "common/upstream/upstream_impl.h"
@@ -12,6 +15,7 @@
 #include "test/common/upstream/utility.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -35,11 +39,13 @@ public:
 
 class RingHashLoadBalancerTest : public ::testing::TestWithParam<bool> {
 public:
-  RingHashLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {}
+  RingHashLoadBalancerTest()
+      : stats_(ClusterInfoImpl::generateStats(stats_store_)),
+        api_(Api::createApiForTest(stats_store_)) {}
 
   void init() {
     lb_ = std::make_unique<RingHashLoadBalancer>(priority_set_, stats_, runtime_, random_, config_,
-                                                 common_config_);
+                                                 common_config_, *api_);
     lb_->initialize();
   }
 
@@ -57,6 +63,7 @@ public:
   envoy::api::v2::Cluster::CommonLbConfig common_config_;
   NiceMock<Runtime::MockLoader> runtime_;
   NiceMock<Runtime::MockRandomGenerator> random_;
+  Api::ApiPtr api_;
   std::unique_ptr<RingHashLoadBalancer> lb_;
 };
 
@@ -276,5 +283,98 @@ TEST_P(RingHashLoadBalancerTest, UnevenHosts) {
   }
 }
 
+// With a hash balance factor, overloaded hosts are skipped for the next host on the ring.
+TEST_P(RingHashLoadBalancerTest, HashBalanceFactor) {
+  hostSet().hosts_ = {makeTestHost(info_, "tcp://127.0.0.1:80"),
+                      makeTestHost(info_, "tcp://127.0.0.1:81")};
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+
+  config_ = (envoy::api::v2::Cluster::RingHashLbConfig());
+  config_.value().mutable_minimum_ring_size()->set_value(3);
+  common_config_.mutable_consistent_hashing_lb_config()->mutable_hash_balance_factor()->set_value(
+      150);
+  init();
+
+  // hash ring:
+  // port | position
+  // ---------------------------
+  // :80  | 5454692015285649509
+  // :81  | 7859399908942313493
+  // :80  | 13838424394637650569
+  // :81  | 16064866803292627174
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  TestLoadBalancerContext context(0);
+
+  // The capacity of the hosts is 150% of (2 + 1) / 2 requests, i.e. 3 requests once rounded up.
+  hostSet().hosts_[0]->stats().rq_active_.set(2);
+  stats_.upstream_rq_active_.set(2);
+  EXPECT_EQ(hostSet().hosts_[0], lb->chooseHost(&context));
+  EXPECT_EQ(0UL, stats_.lb_hash_host_overloaded_.value());
+
+  hostSet().hosts_[0]->stats().rq_active_.set(3);
+  stats_.upstream_rq_active_.set(3);
+  EXPECT_EQ(hostSet().hosts_[1], lb->chooseHost(&context));
+  EXPECT_EQ(1UL, stats_.lb_hash_host_overloaded_.value());
+
+  // When all the hosts are overloaded, the host of the hash is chosen.
+  hostSet().hosts_[1]->stats().rq_active_.set(3);
+  EXPECT_EQ(hostSet().hosts_[0], lb->chooseHost(&context));
+  EXPECT_EQ(3UL, stats_.lb_hash_host_overloaded_.value());
+}
+
+// Large rings are sorted by several threads. The hosts must still be evenly spread on the ring.
+TEST_P(RingHashLoadBalancerTest, LargeRing) {
+  hostSet().hosts_ = {
+      makeTestHost(info_, "tcp://127.0.0.1:90"), makeTestHost(info_, "tcp://127.0.0.1:91"),
+      makeTestHost(info_, "tcp://127.0.0.1:92"), makeTestHost(info_, "tcp://127.0.0.1:93")};
+  hostSet().healthy_hosts_ = hostSet().hosts_;
+  hostSet().runCallbacks({}, {});
+
+  config_ = (envoy::api::v2::Cluster::RingHashLbConfig());
+  config_.value().mutable_minimum_ring_size()->set_value(1 << 19);
+  init();
+
+  LoadBalancerPtr lb = lb_->factory()->create();
+  std::unordered_map<HostConstSharedPtr, uint64_t> hits;
+  for (uint64_t i = 0; i < 10000; i++) {
+    TestLoadBalancerContext context(HashUtil::xxHash64(std::to_string(i)));
+    hits[lb->chooseHost(&context)]++;
+  }
+  EXPECT_EQ(4UL, hits.size());
+  for (const auto& host : hostSet().hosts_) {
+    EXPECT_NEAR(2500, hits[host], 250);
+  }
+}
+
+// Rings sorted in parallel chunks are the same as rings sorted on a single thread, whatever the
+// number of threads, including when it does not divide the ring evenly.
+TEST_P(RingHashFailoverTest, SortRingInParallel) {
+  typedef RingHashLoadBalancer::RingEntry RingEntry;
+  const auto compare = [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
+    return lhs.hash_ < rhs.hash_ || (lhs.hash_ == rhs.hash_ && lhs.host_index_ < rhs.host_index_);
+  };
+
+  // Few distinct hashes, so that many entries with the same hash are spread over the chunks.
+  std::vector<RingEntry> entries;
+  for (uint32_t i = 0; i < 9 * (1 << 16) + 7; i++) {
+    entries.push_back({HashUtil::xxHash64(std::to_string(i % 100000)) >> (i % 3), i % 13});
+  }
+  std::vector<RingEntry> expected = entries;
+  std::sort(expected.begin(), expected.end(), compare);
+
+  for (uint32_t max_threads : {1, 2, 3, 4, 8}) {
+    std::vector<RingEntry> ring = entries;
+    RingHashLoadBalancer::sortRing(*api_, ring, max_threads);
+    ASSERT_EQ(expected.size(), ring.size());
+    for (size_t i = 0; i < ring.size(); i++) {
+      ASSERT_EQ(expected[i].hash_, ring[i].hash_) << "max_threads=" << max_threads << " i=" << i;
+      ASSERT_EQ(expected[i].host_index_, ring[i].host_index_)
+          << "max_threads=" << max_threads << " i=" << i;
+    }
+  }
+}
+
 } // namespace Upstream
 } // namespace Envoy
@@ -2,6 +2,7 @@
 #include <initializer_list>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -17,6 +18,8 @@
 #include "test/mocks/filesystem/mocks.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/simulated_time_system.h"
+#include "test/test_common/utility.h"
 
 #include "absl/types/optional.h"
 #include "gmock/gmock.h"
@@ -46,6 +49,16 @@ private:
   std::shared_ptr<SubsetLoadBalancer> lb_;
 };
 
+class SubsetLoadBalancerSubsetTester {
+public:
+  // Returns the priority set of the subset matching the criteria of the context, or nullptr.
+  static PrioritySet* prioritySet(SubsetLoadBalancer& lb, LoadBalancerContext& context) {
+    const SubsetLoadBalancer::LbSubsetEntryPtr entry =
+        lb.findSubset(context.metadataMatchCriteria()->metadataMatchCriteria());
+    return entry != nullptr ? entry->priority_subset_.get() : nullptr;
+  }
+};
+
 namespace SubsetLoadBalancerTest {
 
 class TestMetadataMatchCriterion : public Router::MetadataMatchCriterion {
@@ -108,7 +121,9 @@ enum UpdateOrder { REMOVES_FIRST, SIMULTANEOUS };
 
 class SubsetLoadBalancerTest : public testing::TestWithParam<UpdateOrder> {
 public:
-  SubsetLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {
+  SubsetLoadBalancerTest()
+      : stats_(ClusterInfoImpl::generateStats(stats_store_)),
+        api_(Api::createApiForTest(stats_store_)) {
     stats_.max_host_weight_.set(1UL);
     least_request_lb_config_.mutable_choice_count()->set_value(2);
   }
@@ -176,7 +191,7 @@ public:
 
     lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, nullptr, stats_, runtime_, random_,
                                      subset_info_, ring_hash_lb_config_, least_request_lb_config_,
-                                     common_config_));
+                                     common_config_, time_system_, *api_));
   }
 
   void zoneAwareInit(const std::vector<HostURLMetadataMap>& host_metadata_per_locality,
@@ -220,7 +235,8 @@ public:
 
     lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, &local_priority_set_, stats_,
                                      runtime_, random_, subset_info_, ring_hash_lb_config_,
-                                     least_request_lb_config_, common_config_));
+                                     least_request_lb_config_, common_config_, time_system_,
+                                     *api_));
   }
 
   HostSharedPtr makeHost(const std::string& url, const HostMetadata& metadata) {
@@ -285,10 +301,10 @@ public:
 
     if (GetParam() == REMOVES_FIRST) {
       if (!add.empty()) {
-        host_set_.runCallbacks(add, {});
+        host_set.runCallbacks(add, {});
       }
     } else if (!add.empty() || !remove.empty()) {
-      host_set_.runCallbacks(add, remove);
+      host_set.runCallbacks(add, remove);
     }
   }
 
@@ -377,10 +393,12 @@ public:
   envoy::api::v2::Cluster::RingHashLbConfig ring_hash_lb_config_;
   envoy::api::v2::Cluster::LeastRequestLbConfig least_request_lb_config_;
   envoy::api::v2::Cluster::CommonLbConfig common_config_;
+  Event::SimulatedTimeSystem time_system_;
   NiceMock<Runtime::MockLoader> runtime_;
   NiceMock<Runtime::MockRandomGenerator> random_;
   Stats::IsolatedStoreImpl stats_store_;
   ClusterStats stats_;
+  Api::ApiPtr api_;
   PrioritySetImpl local_priority_set_;
   HostVectorSharedPtr local_hosts_;
   HostsPerLocalitySharedPtr local_hosts_per_locality_;
@@ -859,6 +877,92 @@ TEST_F(SubsetLoadBalancerTest, UpdateModifyingOnlyHostHealth) {
   EXPECT_EQ(host_set_.hosts_[3], lb_->chooseHost(&context_11));
 }
 
+// Validate that the subsets follow the hosts which left the priority or whose metadata changed, even
+// if the update does not report them.
+TEST_F(SubsetLoadBalancerTest, UpdateWithoutDeltas) {
+  EXPECT_CALL(subset_info_, fallbackPolicy())
+      .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK));
+
+  std::vector<std::set<std::string>> subset_keys = {{"version"}};
+  EXPECT_CALL(subset_info_, subsetKeys()).WillRepeatedly(ReturnRef(subset_keys));
+
+  init({
+      {"tcp://127.0.0.1:80", {{"version", "1.0"}}},
+      {"tcp://127.0.0.1:81", {{"version", "1.0"}}},
+      {"tcp://127.0.0.1:82", {{"version", "1.1"}}},
+  });
+  EXPECT_EQ(2U, stats_.lb_subsets_active_.value());
+
+  HostSharedPtr host_80 = host_set_.hosts_[0];
+  HostSharedPtr host_82 = host_set_.hosts_[2];
+  host_82->metadata(buildMetadata("1.0"));
+  host_set_.hosts_ = {host_80, host_82};
+  host_set_.healthy_hosts_ = host_set_.hosts_;
+  host_set_.runCallbacks({}, {});
+
+  EXPECT_EQ(1U, stats_.lb_subsets_active_.value());
+  EXPECT_EQ(2U, stats_.lb_subsets_created_.value());
+  EXPECT_EQ(1U, stats_.lb_subsets_removed_.value());
+
+  TestLoadBalancerContext context_10({{"version", "1.0"}});
+  TestLoadBalancerContext context_11({{"version", "1.1"}});
+  const std::set<HostConstSharedPtr> hosts_10{lb_->chooseHost(&context_10),
+                                              lb_->chooseHost(&context_10)};
+  EXPECT_EQ((std::set<HostConstSharedPtr>{host_80, host_82}), hosts_10);
+  EXPECT_EQ(nullptr, lb_->chooseHost(&context_11));
+}
+
+// Validate that adding or removing a host only updates the subsets of the host: the priority sets
+// of the other subsets do not run their member update callbacks.
+TEST_P(SubsetLoadBalancerTest, UpdateOnlyChangedSubsets) {
+  EXPECT_CALL(subset_info_, fallbackPolicy())
+      .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK));
+
+  std::vector<std::set<std::string>> subset_keys = {{"version"}, {"stage"}};
+  EXPECT_CALL(subset_info_, subsetKeys()).WillRepeatedly(ReturnRef(subset_keys));
+
+  init({
+      {"tcp://127.0.0.1:80", {{"version", "1.0"}, {"stage", "prod"}}},
+      {"tcp://127.0.0.1:81", {{"version", "1.1"}, {"stage", "prod"}}},
+      {"tcp://127.0.0.1:82", {{"version", "1.1"}, {"stage", "canary"}}},
+  });
+
+  TestLoadBalancerContext context_10({{"version", "1.0"}});
+  TestLoadBalancerContext context_11({{"version", "1.1"}});
+  TestLoadBalancerContext context_canary({{"stage", "canary"}});
+  PrioritySet* subset_10 = SubsetLoadBalancerSubsetTester::prioritySet(*lb_, context_10);
+  PrioritySet* subset_11 = SubsetLoadBalancerSubsetTester::prioritySet(*lb_, context_11);
+  PrioritySet* subset_canary = SubsetLoadBalancerSubsetTester::prioritySet(*lb_, context_canary);
+  ASSERT_NE(nullptr, subset_10);
+  ASSERT_NE(nullptr, subset_11);
+  ASSERT_NE(nullptr, subset_canary);
+
+  HostVector hosts_added_10;
+  HostVector hosts_removed_10;
+  subset_10->addMemberUpdateCb(
+      [&](uint32_t, const HostVector& hosts_added, const HostVector& hosts_removed) -> void {
+        hosts_added_10.insert(hosts_added_10.end(), hosts_added.begin(), hosts_added.end());
+        hosts_removed_10.insert(hosts_removed_10.end(), hosts_removed.begin(),
+                                hosts_removed.end());
+      });
+  uint32_t other_updates = 0;
+  for (PrioritySet* subset : {subset_11, subset_canary}) {
+    subset->addMemberUpdateCb(
+        [&](uint32_t, const HostVector&, const HostVector&) -> void { other_updates++; });
+  }
+
+  HostSharedPtr host = makeHost("tcp://127.0.0.1:83", {{"version", "1.0"}, {"stage", "prod"}});
+  modifyHosts({host}, {});
+  EXPECT_EQ(HostVector({host}), hosts_added_10);
+  EXPECT_TRUE(hosts_removed_10.empty());
+  EXPECT_EQ(0U, other_updates);
+
+  modifyHosts({}, {host});
+  EXPECT_EQ(HostVector({host}), hosts_added_10);
+  EXPECT_EQ(HostVector({host}), hosts_removed_10);
+  EXPECT_EQ(0U, other_updates);
+}
+
 TEST_F(SubsetLoadBalancerTest, BalancesDisjointSubsets) {
   EXPECT_CALL(subset_info_, fallbackPolicy())
       .WillRepeatedly(Return(envoy::api::v2::Cluster::LbSubsetConfig::NO_FALLBACK));
@@ -996,7 +1100,7 @@ TEST_F(SubsetLoadBalancerTest, IgnoresHostsWithoutMetadata) {
 
   lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, nullptr, stats_, runtime_, random_,
                                    subset_info_, ring_hash_lb_config_, least_request_lb_config_,
-                                   common_config_));
+                                   common_config_, time_system_, *api_));
 
   TestLoadBalancerContext context_version({{"version", "1.0"}});
 
@@ -1401,7 +1505,7 @@ TEST_F(SubsetLoadBalancerTest, DisabledLocalityWeightAwareness) {
 
   lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, nullptr, stats_, runtime_, random_,
                                    subset_info_, ring_hash_lb_config_, least_request_lb_config_,
-                                   common_config_));
+                                   common_config_, time_system_, *api_));
 
   TestLoadBalancerContext context({{"version", "1.1"}});
 
@@ -1430,7 +1534,7 @@ TEST_F(SubsetLoadBalancerTest, EnabledLocalityWeightAwareness) {
 
   lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, nullptr, stats_, runtime_, random_,
                                    subset_info_, ring_hash_lb_config_, least_request_lb_config_,
-                                   common_config_));
+                                   common_config_, time_system_, *api_));
 
   TestLoadBalancerContext context({{"version", "1.1"}});
 
@@ -1462,7 +1566,7 @@ TEST_F(SubsetLoadBalancerTest, EnabledScaleLocalityWeights) {
 
   lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, nullptr, stats_, runtime_, random_,
                                    subset_info_, ring_hash_lb_config_, least_request_lb_config_,
-                                   common_config_));
+                                   common_config_, time_system_, *api_));
   TestLoadBalancerContext context({{"version", "1.1"}});
 
   // Since we scale the locality weights by number of hosts removed, we expect to see the second
@@ -1504,7 +1608,7 @@ TEST_F(SubsetLoadBalancerTest, EnabledScaleLocalityWeightsRounding) {
 
   lb_.reset(new SubsetLoadBalancer(lb_type_, priority_set_, nullptr, stats_, runtime_, random_,
                                    subset_info_, ring_hash_lb_config_, least_request_lb_config_,
-                                   common_config_));
+                                   common_config_, time_system_, *api_));
   TestLoadBalancerContext context({{"version", "1.0"}});
 
   // We expect to see a 33/66 split because 2 * 1 / 2 = 1 and 2 * 3 / 4 = 1.5 -> 2
@@ -1633,6 +1633,41 @@ TEST_F(ClusterInfoImplTest, Metadata) {
   EXPECT_EQ(LoadBalancerType::Maglev, cluster->info()->lbType());
 }
 
+TEST_F(ClusterInfoImplTest, PeakEwma) {
+  const std::string yaml = R"EOF(
+    name: name
+    connect_timeout: 0.25s
+    type: STRICT_DNS
+    lb_policy: PEAK_EWMA
+    hosts: [{ socket_address: { address: foo.bar.com, port_value: 443 }}]
+    peak_ewma_lb_config:
+      choice_count: 3
+      decay_time: 5s
+  )EOF";
+
+  auto cluster = makeCluster(yaml);
+  EXPECT_EQ(LoadBalancerType::PeakEwma, cluster->info()->lbType());
+  EXPECT_EQ(3, cluster->info()->lbPeakEwmaConfig()->choice_count().value());
+  EXPECT_EQ(5, cluster->info()->lbPeakEwmaConfig()->decay_time().seconds());
+}
+
+// The peak EWMA load balancer does not support subsets.
+TEST_F(ClusterInfoImplTest, PeakEwmaWithSubsets) {
+  const std::string yaml = R"EOF(
+    name: name
+    connect_timeout: 0.25s
+    type: STRICT_DNS
+    lb_policy: PEAK_EWMA
+    hosts: [{ socket_address: { address: foo.bar.com, port_value: 443 }}]
+    lb_subset_config:
+      subset_selectors:
+        - keys: [ "version" ]
+  )EOF";
+
+  EXPECT_THROW_WITH_MESSAGE(makeCluster(yaml), EnvoyException,
+                            "cluster: LB type 'peak_ewma' may not be used with lb_subset_config");
+}
+
 // Typed metadata loading throws exception.
 TEST_F(ClusterInfoImplTest, BrokenTypedMetadata) {
   const std::string yaml = R"EOF(
@@ -6,6 +6,7 @@
 
 #include "common/buffer/buffer_impl.h"
 #include "common/event/dispatcher_impl.h"
+#include "common/network/connection_balancer_impl.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/network/listener_impl.h"
 #include "common/network/raw_buffer_socket.h"
@@ -42,6 +43,18 @@ namespace Extensions {
 namespace ListenerFilters {
 namespace ProxyProtocol {
 
+// Largest header read by the filter.
+constexpr size_t MaxHeaderLength = PROXY_PROTO_V2_HEADER_LEN + PROXY_PROTO_V2_ADDR_LEN_UNIX;
+
+// Number of bytes asked for by a read into the given slices.
+static size_t readLength(const struct iovec* iov, int iovcnt) {
+  size_t length = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    length += iov[i].iov_len;
+  }
+  return length;
+}
+
 // Build again on the basis of the connection_handler_test.cc
 
 class ProxyProtocolTest : public testing::TestWithParam<Network::Address::IpVersion>,
@@ -76,6 +89,7 @@ public:
   uint64_t listenerTag() const override { return 1; }
   const std::string& name() const override { return name_; }
   bool reverseWriteFilterOrder() const override { return true; }
+  Network::ConnectionBalancer& connectionBalancer() override { return connection_balancer_; }
 
   // Network::FilterChainManager
   const Network::FilterChain* findFilterChain(const Network::ConnectionSocket&) const override {
@@ -160,6 +174,7 @@ public:
   Network::MockConnectionCallbacks server_callbacks_;
   std::shared_ptr<Network::MockReadFilter> read_filter_;
   std::string name_;
+  Network::NopConnectionBalancerImpl connection_balancer_;
   const Network::FilterChainSharedPtr filter_chain_;
 };
 
@@ -257,60 +272,26 @@ TEST_P(ProxyProtocolTest, v2UnsupportedAF) {
 }
 
 TEST_P(ProxyProtocolTest, errorRecv_2) {
-  // A well formed v4/tcp message, no extensions, but introduce an error on recv (e.g. socket close)
-  constexpr uint8_t buffer[] = {0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49,
-                                0x54, 0x0a, 0x21, 0x11, 0x00, 0x0c, 0x01, 0x02, 0x03, 0x04,
-                                0x00, 0x01, 0x01, 0x02, 0x03, 0x05, 0x00, 0x02, 'm',  'o',
-                                'r',  'e',  ' ',  'd',  'a',  't',  'a'};
-  Api::MockOsSysCalls os_sys_calls;
-  TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls(&os_sys_calls);
-  EXPECT_CALL(os_sys_calls, recv(_, _, _, _))
-      .Times(AnyNumber())
-      .WillOnce(Return(Api::SysCallSizeResult{-1, 0}));
-  EXPECT_CALL(os_sys_calls, ioctl(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, unsigned long int request, void* argp) {
-        const int rc = ::ioctl(fd, request, argp);
-        return Api::SysCallIntResult{rc, errno};
-      }));
-  EXPECT_CALL(os_sys_calls, writev(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
-        const ssize_t rc = ::writev(fd, iov, iovcnt);
-        return Api::SysCallSizeResult{rc, errno};
-      }));
-  EXPECT_CALL(os_sys_calls, readv(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
-        const ssize_t rc = ::readv(fd, iov, iovcnt);
-        return Api::SysCallSizeResult{rc, errno};
-      }));
-
-  connect(false);
-  write(buffer, sizeof(buffer));
-
-  errno = 0;
-  expectProxyProtoError();
-}
-
-TEST_P(ProxyProtocolTest, errorFIONREAD_1) {
-  // A well formed v4/tcp message, no extensions, but introduce an error on ioctl(...FIONREAD...)
+  // A well formed v4/tcp message, no extensions, but introduce an error on read (e.g. socket close)
   constexpr uint8_t buffer[] = {0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49,
                                 0x54, 0x0a, 0x21, 0x11, 0x00, 0x0c, 0x01, 0x02, 0x03, 0x04,
                                 0x00, 0x01, 0x01, 0x02, 0x03, 0x05, 0x00, 0x02, 'm',  'o',
                                 'r',  'e',  ' ',  'd',  'a',  't',  'a'};
   Api::MockOsSysCalls os_sys_calls;
   TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls(&os_sys_calls);
-  EXPECT_CALL(os_sys_calls, ioctl(_, FIONREAD, _)).WillOnce(Return(Api::SysCallIntResult{-1, 0}));
   EXPECT_CALL(os_sys_calls, writev(_, _, _))
       .Times(AnyNumber())
       .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
         const ssize_t rc = ::writev(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
+  // The first read of the header fails.
   EXPECT_CALL(os_sys_calls, readv(_, _, _))
       .Times(AnyNumber())
       .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
+        if (readLength(iov, iovcnt) == MaxHeaderLength) {
+          return Api::SysCallSizeResult{-1, EIO};
+        }
         const ssize_t rc = ::readv(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
@@ -485,8 +466,8 @@ TEST_P(ProxyProtocolTest, v2ParseExtensions) {
   disconnect();
 }
 
-TEST_P(ProxyProtocolTest, v2ParseExtensionsIoctlError) {
-  // A well-formed ipv4/tcp with a TLV extension. An error is created in the ioctl(...FIONREAD...)
+TEST_P(ProxyProtocolTest, v2ParseExtensionsRecvError) {
+  // A well-formed ipv4/tcp with a TLV extension. An error is created in the read of the extension
   constexpr uint8_t buffer[] = {0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49,
                                 0x54, 0x0a, 0x21, 0x11, 0x00, 0x10, 0x01, 0x02, 0x03, 0x04,
                                 0x00, 0x01, 0x01, 0x02, 0x03, 0x05, 0x00, 0x02};
@@ -495,36 +476,22 @@ TEST_P(ProxyProtocolTest, v2ParseExtensionsIoctlError) {
   Api::MockOsSysCalls os_sys_calls;
   TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls(&os_sys_calls);
 
-  EXPECT_CALL(os_sys_calls, ioctl(_, FIONREAD, _))
+  // The extension is read once it is available.
+  EXPECT_CALL(os_sys_calls, readv(_, _, _))
       .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, unsigned long int request, void* argp) {
-        int x = ::ioctl(fd, request, argp);
-        if (x == 0 && *static_cast<int*>(argp) == sizeof(tlv)) {
-          return Api::SysCallIntResult{-1, errno};
-        } else {
-          return Api::SysCallIntResult{x, errno};
+      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
+        const ssize_t rc = ::readv(fd, iov, iovcnt);
+        if (rc > 0 && readLength(iov, iovcnt) == sizeof(tlv)) {
+          return Api::SysCallSizeResult{-1, EIO};
         }
-      }));
-
-  EXPECT_CALL(os_sys_calls, recv(_, _, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, void* buf, size_t len, int flags) {
-        const ssize_t rc = ::recv(fd, buf, len, flags);
         return Api::SysCallSizeResult{rc, errno};
       }));
-
   EXPECT_CALL(os_sys_calls, writev(_, _, _))
       .Times(AnyNumber())
       .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
         const ssize_t rc = ::writev(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
-  EXPECT_CALL(os_sys_calls, readv(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
-        const ssize_t rc = ::readv(fd, iov, iovcnt);
-        return Api::SysCallSizeResult{rc, errno};
-      }));
 
   connect(false);
   write(buffer, sizeof(buffer));
@@ -617,7 +584,7 @@ TEST_P(ProxyProtocolTest, v2Fragmented2) {
 
 TEST_P(ProxyProtocolTest, v2Fragmented3Error) {
   // A well-formed ipv4/tcp header, delivering all of the signature +1, w/ an error
-  // simulated in recv() on the +1
+  // simulated in the read of the +1
   constexpr uint8_t buffer[] = {0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49,
                                 0x54, 0x0a, 0x21, 0x11, 0x00, 0x0c, 0x01, 0x02, 0x03, 0x04,
                                 0x00, 0x01, 0x01, 0x02, 0x03, 0x05, 0x00, 0x02, 'm',  'o',
@@ -626,44 +593,34 @@ TEST_P(ProxyProtocolTest, v2Fragmented3Error) {
   Api::MockOsSysCalls os_sys_calls;
   TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls(&os_sys_calls);
 
-  EXPECT_CALL(os_sys_calls, recv(_, _, _, _))
+  // The read following the signature fails.
+  EXPECT_CALL(os_sys_calls, readv(_, _, _))
       .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, void* buf, size_t len, int flags) {
-        const ssize_t rc = ::recv(fd, buf, len, flags);
+      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
+        if (readLength(iov, iovcnt) == MaxHeaderLength - 16) {
+          return Api::SysCallSizeResult{-1, EIO};
+        }
+        const ssize_t rc = ::readv(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
-  EXPECT_CALL(os_sys_calls, recv(_, _, 1, _))
-      .Times(AnyNumber())
-      .WillOnce(Return(Api::SysCallSizeResult{-1, 0}));
-
-  EXPECT_CALL(os_sys_calls, ioctl(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, unsigned long int request, void* argp) {
-        const int rc = ::ioctl(fd, request, argp);
-        return Api::SysCallIntResult{rc, errno};
-      }));
   EXPECT_CALL(os_sys_calls, writev(_, _, _))
       .Times(AnyNumber())
       .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
         const ssize_t rc = ::writev(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
-  EXPECT_CALL(os_sys_calls, readv(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
-        const ssize_t rc = ::readv(fd, iov, iovcnt);
-        return Api::SysCallSizeResult{rc, errno};
-      }));
 
   connect(false);
-  write(buffer, 17);
+  write(buffer, 16);
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  write(buffer + 16, 1);
 
   expectProxyProtoError();
 }
 
 TEST_P(ProxyProtocolTest, v2Fragmented4Error) {
   // A well-formed ipv4/tcp header, part of the signature with an error introduced
-  // in recv() on the remainder
+  // in the read of the remainder
   constexpr uint8_t buffer[] = {0x0d, 0x0a, 0x0d, 0x0a, 0x00, 0x0d, 0x0a, 0x51, 0x55, 0x49,
                                 0x54, 0x0a, 0x21, 0x11, 0x00, 0x0c, 0x01, 0x02, 0x03, 0x04,
                                 0x00, 0x01, 0x01, 0x02, 0x03, 0x05, 0x00, 0x02, 'm',  'o',
@@ -672,34 +629,22 @@ TEST_P(ProxyProtocolTest, v2Fragmented4Error) {
   Api::MockOsSysCalls os_sys_calls;
   TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls(&os_sys_calls);
 
-  EXPECT_CALL(os_sys_calls, recv(_, _, _, _))
+  // The read of the remainder of the signature fails.
+  EXPECT_CALL(os_sys_calls, readv(_, _, _))
       .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, void* buf, size_t len, int flags) {
-        const ssize_t rc = ::recv(fd, buf, len, flags);
+      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
+        if (readLength(iov, iovcnt) == MaxHeaderLength - 10) {
+          return Api::SysCallSizeResult{-1, EIO};
+        }
+        const ssize_t rc = ::readv(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
-  EXPECT_CALL(os_sys_calls, recv(_, _, 4, _))
-      .Times(AnyNumber())
-      .WillOnce(Return(Api::SysCallSizeResult{-1, 0}));
-
-  EXPECT_CALL(os_sys_calls, ioctl(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, unsigned long int request, void* argp) {
-        const int rc = ::ioctl(fd, request, argp);
-        return Api::SysCallIntResult{rc, errno};
-      }));
   EXPECT_CALL(os_sys_calls, writev(_, _, _))
       .Times(AnyNumber())
       .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
         const ssize_t rc = ::writev(fd, iov, iovcnt);
         return Api::SysCallSizeResult{rc, errno};
       }));
-  EXPECT_CALL(os_sys_calls, readv(_, _, _))
-      .Times(AnyNumber())
-      .WillRepeatedly(Invoke([](int fd, const struct iovec* iov, int iovcnt) {
-        const ssize_t rc = ::readv(fd, iov, iovcnt);
-        return Api::SysCallSizeResult{rc, errno};
-      }));
 
   connect(false);
   write(buffer, 10);
@@ -904,6 +849,7 @@ public:
   uint64_t listenerTag() const override { return 1; }
   const std::string& name() const override { return name_; }
   bool reverseWriteFilterOrder() const override { return true; }
+  Network::ConnectionBalancer& connectionBalancer() override { return connection_balancer_; }
 
   // Network::FilterChainManager
   const Network::FilterChain* findFilterChain(const Network::ConnectionSocket&) const override {
@@ -966,6 +912,7 @@ public:
   Network::MockConnectionCallbacks server_callbacks_;
   std::shared_ptr<Network::MockReadFilter> read_filter_;
   std::string name_;
+  Network::NopConnectionBalancerImpl connection_balancer_;
   const Network::FilterChainSharedPtr filter_chain_;
 };
 
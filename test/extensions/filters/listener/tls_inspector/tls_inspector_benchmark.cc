@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <vector>
 
 #include "common/network/listen_socket_impl.h"
+#include "common/network/listener_filter_buffer_impl.h"
 
 #include "extensions/filters/listener/tls_inspector/tls_inspector.h"
 
@@ -34,10 +36,12 @@ public:
       : socket_(socket), dispatcher_(dispatcher) {}
   Network::ConnectionSocket& socket() override { return socket_; }
   Event::Dispatcher& dispatcher() override { return dispatcher_; }
+  Network::ListenerFilterBuffer& buffer() override { return *buffer_; }
   void continueFilterChain(bool success) override { RELEASE_ASSERT(success, ""); }
 
   Network::ConnectionSocket& socket_;
   Event::Dispatcher& dispatcher_;
+  std::unique_ptr<Network::ListenerFilterBuffer> buffer_;
 };
 
 // Don't inherit from the mock implementation at all, because this is instantiated
@@ -62,10 +66,15 @@ class FastMockOsSysCalls : public Api::MockOsSysCalls {
 public:
   FastMockOsSysCalls(const std::vector<uint8_t>& client_hello) : client_hello_(client_hello) {}
 
-  Api::SysCallSizeResult recv(int, void* buffer, size_t length, int) override {
-    RELEASE_ASSERT(length >= client_hello_.size(), "");
-    memcpy(buffer, client_hello_.data(), client_hello_.size());
-    return Api::SysCallSizeResult{ssize_t(client_hello_.size()), 0};
+  Api::SysCallSizeResult readv(int, const iovec* iov, int num_iov) override {
+    size_t copied = 0;
+    for (int i = 0; i < num_iov && copied < client_hello_.size(); i++) {
+      const size_t length = std::min(iov[i].iov_len, client_hello_.size() - copied);
+      memcpy(iov[i].iov_base, client_hello_.data() + copied, length);
+      copied += length;
+    }
+    RELEASE_ASSERT(copied == client_hello_.size(), "");
+    return Api::SysCallSizeResult{ssize_t(copied), 0};
   }
 
   const std::vector<uint8_t> client_hello_;
@@ -82,6 +91,8 @@ static void BM_TlsInspector(benchmark::State& state) {
   FastMockListenerFilterCallbacks cb(socket, dispatcher);
 
   for (auto _ : state) {
+    // Each accepted socket owns a buffer, like ConnectionHandlerImpl::ActiveSocket.
+    cb.buffer_ = std::make_unique<Network::ListenerFilterBufferImpl>(socket);
     Filter filter(cfg);
     filter.onAccept(cb);
     dispatcher.file_event_callback_(Event::FileReadyType::Read);
@@ -93,6 +104,7 @@ static void BM_TlsInspector(benchmark::State& state) {
     socket.setDetectedTransportProtocol("");
     socket.setRequestedServerName("");
     socket.setRequestedApplicationProtocols({});
+    socket.preReadData().drain(socket.preReadData().length());
   }
 }
 
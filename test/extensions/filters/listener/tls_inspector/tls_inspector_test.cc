@@ -10,6 +10,7 @@
 #include "openssl/ssl.h"
 
 using testing::_;
+using testing::AnyNumber;
 using testing::AtLeast;
 using testing::Eq;
 using testing::InSequence;
@@ -34,6 +35,7 @@ public:
     filter_ = std::make_unique<Filter>(cfg_);
     EXPECT_CALL(cb_, socket()).WillRepeatedly(ReturnRef(socket_));
     EXPECT_CALL(cb_, dispatcher()).WillRepeatedly(ReturnRef(dispatcher_));
+    EXPECT_CALL(cb_, buffer()).Times(AnyNumber());
     EXPECT_CALL(socket_, fd()).WillRepeatedly(Return(42));
 
     EXPECT_CALL(dispatcher_,
@@ -44,6 +46,19 @@ public:
     filter_->onAccept(cb_);
   }
 
+  // Copy length bytes of data, starting at offset, into the slices read from the socket.
+  static Api::SysCallSizeResult readData(const std::vector<uint8_t>& data, size_t offset,
+                                         size_t length, const iovec* iov, int num_iov) {
+    size_t copied = 0;
+    for (int i = 0; i < num_iov && copied < length; i++) {
+      const size_t slice_length = std::min(iov[i].iov_len, length - copied);
+      memcpy(iov[i].iov_base, data.data() + offset + copied, slice_length);
+      copied += slice_length;
+    }
+    ASSERT(copied == length);
+    return Api::SysCallSizeResult{ssize_t(length), 0};
+  }
+
   NiceMock<Api::MockOsSysCalls> os_sys_calls_;
   TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls_{&os_sys_calls_};
   Stats::IsolatedStoreImpl store_;
@@ -72,7 +87,7 @@ TEST_F(TlsInspectorTest, ConnectionClosed) {
 // Test that the filter detects detects read errors.
 TEST_F(TlsInspectorTest, ReadError) {
   init();
-  EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK)).WillOnce(InvokeWithoutArgs([]() {
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _)).WillOnce(InvokeWithoutArgs([]() {
     return Api::SysCallSizeResult{ssize_t(-1), ENOTSUP};
   }));
   EXPECT_CALL(cb_, continueFilterChain(false));
@@ -85,13 +100,10 @@ TEST_F(TlsInspectorTest, SniRegistered) {
   init();
   const std::string servername("example.com");
   std::vector<uint8_t> client_hello = Tls::Test::generateClientHello(servername, "");
-  EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
-      .WillOnce(
-          Invoke([&client_hello](int, void* buffer, size_t length, int) -> Api::SysCallSizeResult {
-            ASSERT(length >= client_hello.size());
-            memcpy(buffer, client_hello.data(), client_hello.size());
-            return Api::SysCallSizeResult{ssize_t(client_hello.size()), 0};
-          }));
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Invoke([&client_hello](int, const iovec* iov, int num_iov) {
+        return readData(client_hello, 0, client_hello.size(), iov, num_iov);
+      }));
   EXPECT_CALL(socket_, setRequestedServerName(Eq(servername)));
   EXPECT_CALL(socket_, setRequestedApplicationProtocols(_)).Times(0);
   EXPECT_CALL(socket_, setDetectedTransportProtocol(absl::string_view("tls")));
@@ -108,13 +120,10 @@ TEST_F(TlsInspectorTest, AlpnRegistered) {
   const std::vector<absl::string_view> alpn_protos = {absl::string_view("h2"),
                                                       absl::string_view("http/1.1")};
   std::vector<uint8_t> client_hello = Tls::Test::generateClientHello("", "\x02h2\x08http/1.1");
-  EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
-      .WillOnce(
-          Invoke([&client_hello](int, void* buffer, size_t length, int) -> Api::SysCallSizeResult {
-            ASSERT(length >= client_hello.size());
-            memcpy(buffer, client_hello.data(), client_hello.size());
-            return Api::SysCallSizeResult{ssize_t(client_hello.size()), 0};
-          }));
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Invoke([&client_hello](int, const iovec* iov, int num_iov) {
+        return readData(client_hello, 0, client_hello.size(), iov, num_iov);
+      }));
   EXPECT_CALL(socket_, setRequestedServerName(_)).Times(0);
   EXPECT_CALL(socket_, setRequestedApplicationProtocols(alpn_protos));
   EXPECT_CALL(socket_, setDetectedTransportProtocol(absl::string_view("tls")));
@@ -133,18 +142,16 @@ TEST_F(TlsInspectorTest, MultipleReads) {
   std::vector<uint8_t> client_hello = Tls::Test::generateClientHello(servername, "\x02h2");
   {
     InSequence s;
-    EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
+    EXPECT_CALL(os_sys_calls_, readv(42, _, _))
         .WillOnce(InvokeWithoutArgs([]() -> Api::SysCallSizeResult {
           return Api::SysCallSizeResult{ssize_t(-1), EAGAIN};
         }));
-    for (size_t i = 1; i <= client_hello.size(); i++) {
-      EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
-          .WillOnce(Invoke(
-              [&client_hello, i](int, void* buffer, size_t length, int) -> Api::SysCallSizeResult {
-                ASSERT(length >= client_hello.size());
-                memcpy(buffer, client_hello.data(), client_hello.size());
-                return Api::SysCallSizeResult{ssize_t(i), 0};
-              }));
+    // Each read returns the next byte only.
+    for (size_t i = 0; i < client_hello.size(); i++) {
+      EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+          .WillOnce(Invoke([&client_hello, i](int, const iovec* iov, int num_iov) {
+            return readData(client_hello, i, 1, iov, num_iov);
+          }));
     }
   }
 
@@ -167,13 +174,10 @@ TEST_F(TlsInspectorTest, MultipleReads) {
 TEST_F(TlsInspectorTest, NoExtensions) {
   init();
   std::vector<uint8_t> client_hello = Tls::Test::generateClientHello("", "");
-  EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
-      .WillOnce(
-          Invoke([&client_hello](int, void* buffer, size_t length, int) -> Api::SysCallSizeResult {
-            ASSERT(length >= client_hello.size());
-            memcpy(buffer, client_hello.data(), client_hello.size());
-            return Api::SysCallSizeResult{ssize_t(client_hello.size()), 0};
-          }));
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Invoke([&client_hello](int, const iovec* iov, int num_iov) {
+        return readData(client_hello, 0, client_hello.size(), iov, num_iov);
+      }));
   EXPECT_CALL(socket_, setRequestedServerName(_)).Times(0);
   EXPECT_CALL(socket_, setRequestedApplicationProtocols(_)).Times(0);
   EXPECT_CALL(socket_, setDetectedTransportProtocol(absl::string_view("tls")));
@@ -192,13 +196,15 @@ TEST_F(TlsInspectorTest, ClientHelloTooBig) {
   std::vector<uint8_t> client_hello = Tls::Test::generateClientHello("example.com", "");
   ASSERT(client_hello.size() > max_size);
   init();
-  EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
-      .WillOnce(
-          Invoke([&client_hello](int, void* buffer, size_t length, int) -> Api::SysCallSizeResult {
-            ASSERT(length == max_size);
-            memcpy(buffer, client_hello.data(), length);
-            return Api::SysCallSizeResult{ssize_t(length), 0};
-          }));
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Invoke([&client_hello, max_size](int, const iovec* iov, int num_iov) {
+        size_t length = 0;
+        for (int i = 0; i < num_iov; i++) {
+          length += iov[i].iov_len;
+        }
+        EXPECT_EQ(max_size, length);
+        return readData(client_hello, 0, length, iov, num_iov);
+      }));
   EXPECT_CALL(cb_, continueFilterChain(false));
   file_event_callback_(Event::FileReadyType::Read);
   EXPECT_EQ(1, cfg_->stats().client_hello_too_large_.value());
@@ -212,17 +218,55 @@ TEST_F(TlsInspectorTest, NotSsl) {
   // Use 100 bytes of zeroes. This is not valid as a ClientHello.
   data.resize(100);
 
-  EXPECT_CALL(os_sys_calls_, recv(42, _, _, MSG_PEEK))
-      .WillOnce(Invoke([&data](int, void* buffer, size_t length, int) -> Api::SysCallSizeResult {
-        ASSERT(length >= data.size());
-        memcpy(buffer, data.data(), data.size());
-        return Api::SysCallSizeResult{ssize_t(data.size()), 0};
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Invoke([&data](int, const iovec* iov, int num_iov) {
+        return readData(data, 0, data.size(), iov, num_iov);
       }));
   EXPECT_CALL(cb_, continueFilterChain(true));
   file_event_callback_(Event::FileReadyType::Read);
   EXPECT_EQ(1, cfg_->stats().tls_not_found_.value());
 }
 
+// Test that the ClientHello stays in the socket for the transport socket of the connection.
+TEST_F(TlsInspectorTest, ClientHelloKeptBySocket) {
+  init();
+  std::vector<uint8_t> client_hello = Tls::Test::generateClientHello("example.com", "");
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _))
+      .WillOnce(Invoke([&client_hello](int, const iovec* iov, int num_iov) {
+        return readData(client_hello, 0, client_hello.size(), iov, num_iov);
+      }));
+  EXPECT_CALL(cb_, continueFilterChain(true));
+  file_event_callback_(Event::FileReadyType::Read);
+  EXPECT_EQ(std::string(client_hello.begin(), client_hello.end()),
+            socket_.pre_read_data_.toString());
+}
+
+// Test that a ClientHello left in the buffer by the filters that came before is processed without
+// waiting for the socket.
+TEST_F(TlsInspectorTest, ClientHelloReadByPreviousFilter) {
+  std::vector<uint8_t> client_hello = Tls::Test::generateClientHello("example.com", "");
+  socket_.pre_read_data_.add(client_hello.data(), client_hello.size());
+  auto* file_event = new NiceMock<Event::MockFileEvent>();
+  EXPECT_CALL(*file_event, activate(Event::FileReadyType::Read));
+  EXPECT_CALL(dispatcher_, createFileEvent_(_, _, _, _))
+      .WillOnce(DoAll(SaveArg<1>(&file_event_callback_), Return(file_event)));
+  filter_ = std::make_unique<Filter>(cfg_);
+  EXPECT_CALL(cb_, socket()).WillRepeatedly(ReturnRef(socket_));
+  EXPECT_CALL(cb_, dispatcher()).WillRepeatedly(ReturnRef(dispatcher_));
+  EXPECT_CALL(cb_, buffer()).Times(AnyNumber());
+  EXPECT_CALL(socket_, fd()).WillRepeatedly(Return(42));
+  filter_->onAccept(cb_);
+
+  EXPECT_CALL(os_sys_calls_, readv(42, _, _)).WillOnce(InvokeWithoutArgs([]() {
+    return Api::SysCallSizeResult{ssize_t(-1), EAGAIN};
+  }));
+  EXPECT_CALL(socket_, setRequestedServerName(Eq("example.com")));
+  EXPECT_CALL(socket_, setDetectedTransportProtocol(absl::string_view("tls")));
+  EXPECT_CALL(cb_, continueFilterChain(true));
+  file_event_callback_(Event::FileReadyType::Read);
+  EXPECT_EQ(1, cfg_->stats().tls_found_.value());
+}
+
 } // namespace TlsInspector
 } // namespace ListenerFilters
 } // namespace Extensions
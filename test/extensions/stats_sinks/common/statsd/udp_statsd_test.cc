@@ -15,6 +15,8 @@
 #include "gtest/gtest.h"
 #include "spdlog/spdlog.h"
 
+using testing::_;
+using testing::ElementsAre;
 using testing::NiceMock;
 
 namespace Envoy {
@@ -26,6 +28,7 @@ namespace Statsd {
 class MockWriter : public Writer {
 public:
   MOCK_METHOD1(write, void(const std::string& message));
+  MOCK_METHOD1(writeBatch, void(const std::vector<absl::string_view>& datagrams));
 };
 
 class UdpStatsdSinkTest : public testing::TestWithParam<Network::Address::IpVersion> {};
@@ -134,7 +137,7 @@ TEST(UdpStatsdSinkTest, CheckActualStats) {
   source.counters_.push_back(counter);
 
   EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_counter:1|c"));
+              writeBatch(ElementsAre("envoy.test_counter:1|c")));
   sink.flush(source);
   counter->used_ = false;
 
@@ -145,7 +148,7 @@ TEST(UdpStatsdSinkTest, CheckActualStats) {
   source.gauges_.push_back(gauge);
 
   EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_gauge:1|g"));
+              writeBatch(ElementsAre("envoy.test_gauge:1|g")));
   sink.flush(source);
 
   NiceMock<Stats::MockHistogram> timer;
@@ -170,7 +173,7 @@ TEST(UdpStatsdSinkTest, CheckActualStatsWithCustomPrefix) {
   source.counters_.push_back(counter);
 
   EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("test_prefix.test_counter:1|c"));
+              writeBatch(ElementsAre("test_prefix.test_counter:1|c")));
   sink.flush(source);
   counter->used_ = false;
 
@@ -192,7 +195,7 @@ TEST(UdpStatsdSinkWithTagsTest, CheckActualStats) {
   source.counters_.push_back(counter);
 
   EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_counter:1|c|#key1:value1,key2:value2"));
+              writeBatch(ElementsAre("envoy.test_counter:1|c|#key1:value1,key2:value2")));
   sink.flush(source);
   counter->used_ = false;
 
@@ -204,7 +207,7 @@ TEST(UdpStatsdSinkWithTagsTest, CheckActualStats) {
   source.gauges_.push_back(gauge);
 
   EXPECT_CALL(*std::dynamic_pointer_cast<NiceMock<MockWriter>>(writer_ptr),
-              write("envoy.test_gauge:1|g|#key1:value1,key2:value2"));
+              writeBatch(ElementsAre("envoy.test_gauge:1|g|#key1:value1,key2:value2")));
   sink.flush(source);
 
   NiceMock<Stats::MockHistogram> timer;
@@ -217,6 +220,101 @@ TEST(UdpStatsdSinkWithTagsTest, CheckActualStats) {
   tls_.shutdownThread();
 }
 
+// Lines are packed into datagrams up to the configured size, separated by newlines.
+TEST(UdpStatsdSinkTest, BatchedDatagrams) {
+  NiceMock<Stats::MockSource> source;
+  auto writer_ptr = std::make_shared<NiceMock<MockWriter>>();
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  // Fits "envoy.counter_N:1|c" twice with a separator, but not three times.
+  UdpStatsdSink sink(tls_, writer_ptr, false, "", 50);
+
+  for (int i = 0; i < 3; ++i) {
+    auto counter = std::make_shared<NiceMock<Stats::MockCounter>>();
+    counter->name_ = fmt::format("counter_{}", i);
+    counter->used_ = true;
+    counter->latch_ = 1;
+    source.counters_.push_back(counter);
+  }
+  auto gauge = std::make_shared<NiceMock<Stats::MockGauge>>();
+  gauge->name_ = "gauge";
+  gauge->value_ = 2;
+  gauge->used_ = true;
+  source.gauges_.push_back(gauge);
+
+  EXPECT_CALL(*writer_ptr, writeBatch(ElementsAre("envoy.counter_0:1|c\nenvoy.counter_1:1|c",
+                                                  "envoy.counter_2:1|c\nenvoy.gauge:2|g")));
+  sink.flush(source);
+
+  // The buffer is reused by the next flush.
+  gauge->used_ = false;
+  EXPECT_CALL(*writer_ptr, writeBatch(ElementsAre("envoy.counter_0:1|c\nenvoy.counter_1:1|c",
+                                                  "envoy.counter_2:1|c")));
+  sink.flush(source);
+
+  tls_.shutdownThread();
+}
+
+// A line larger than the datagram size is sent alone.
+TEST(UdpStatsdSinkTest, OversizedLine) {
+  NiceMock<Stats::MockSource> source;
+  auto writer_ptr = std::make_shared<NiceMock<MockWriter>>();
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  UdpStatsdSink sink(tls_, writer_ptr, false, "", 20);
+
+  for (const std::string name : {"a", "long_counter_name", "b"}) {
+    auto counter = std::make_shared<NiceMock<Stats::MockCounter>>();
+    counter->name_ = name;
+    counter->used_ = true;
+    counter->latch_ = 1;
+    source.counters_.push_back(counter);
+  }
+
+  EXPECT_CALL(*writer_ptr, writeBatch(ElementsAre("envoy.a:1|c", "envoy.long_counter_name:1|c",
+                                                  "envoy.b:1|c")));
+  sink.flush(source);
+
+  tls_.shutdownThread();
+}
+
+TEST(UdpStatsdSinkTest, NothingToFlush) {
+  NiceMock<Stats::MockSource> source;
+  auto writer_ptr = std::make_shared<NiceMock<MockWriter>>();
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  UdpStatsdSink sink(tls_, writer_ptr, false);
+
+  auto counter = std::make_shared<NiceMock<Stats::MockCounter>>();
+  counter->name_ = "test_counter";
+  counter->used_ = false;
+  source.counters_.push_back(counter);
+
+  EXPECT_CALL(*writer_ptr, writeBatch(_)).Times(0);
+  sink.flush(source);
+
+  tls_.shutdownThread();
+}
+
+class UdpStatsdWriterTest : public testing::TestWithParam<Network::Address::IpVersion> {};
+INSTANTIATE_TEST_CASE_P(IpVersions, UdpStatsdWriterTest,
+                        testing::ValuesIn(TestEnvironment::getIpVersionsForTest()),
+                        TestUtility::ipTestParamsToString);
+
+// Each payload of a batch is received as a separate datagram.
+TEST_P(UdpStatsdWriterTest, WriteBatch) {
+  const auto server = Network::Test::bindFreeLoopbackPort(GetParam(),
+                                                          Network::Address::SocketType::Datagram);
+  {
+    Writer writer(server.first);
+    writer.writeBatch({"envoy.a:1|c\nenvoy.b:2|g", "envoy.c:3|c"});
+  }
+
+  char buffer[64];
+  ssize_t rc = ::recv(server.second, buffer, sizeof(buffer), 0);
+  EXPECT_EQ("envoy.a:1|c\nenvoy.b:2|g", std::string(buffer, rc));
+  rc = ::recv(server.second, buffer, sizeof(buffer), 0);
+  EXPECT_EQ("envoy.c:3|c", std::string(buffer, rc));
+  ::close(server.second);
+}
+
 } // namespace Statsd
 } // namespace Common
 } // namespace StatSinks
@@ -56,6 +56,8 @@ TEST_P(DogStatsdConfigLoopbackTest, ValidUdpIp) {
   EXPECT_NE(udp_sink, nullptr);
   EXPECT_EQ(udp_sink->getUseTagForTest(), true);
   EXPECT_EQ(udp_sink->getPrefix(), Common::Statsd::getDefaultPrefix());
+  EXPECT_EQ(udp_sink->getMaxBytesPerDatagramForTest(),
+            Common::Statsd::UdpStatsdSink::DEFAULT_MAX_BYTES_PER_DATAGRAM);
 }
 
 // Negative test for protoc-gen-validate constraints for dog_statsd.
@@ -79,6 +81,7 @@ TEST_P(DogStatsdConfigLoopbackTest, WithCustomPrefix) {
 
   const std::string customPrefix = "prefix.test";
   sink_config.set_prefix(customPrefix);
+  sink_config.mutable_max_bytes_per_datagram()->set_value(512);
 
   Server::Configuration::StatsSinkFactory* factory =
       Registry::FactoryRegistry<Server::Configuration::StatsSinkFactory>::getFactory(name);
@@ -93,6 +96,7 @@ TEST_P(DogStatsdConfigLoopbackTest, WithCustomPrefix) {
   auto udp_sink = dynamic_cast<Common::Statsd::UdpStatsdSink*>(sink.get());
   ASSERT_NE(udp_sink, nullptr);
   EXPECT_EQ(udp_sink->getPrefix(), customPrefix);
+  EXPECT_EQ(udp_sink->getMaxBytesPerDatagramForTest(), 512);
 }
 
 } // namespace DogStatsd
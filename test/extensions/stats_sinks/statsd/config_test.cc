@@ -81,6 +81,8 @@ TEST_P(StatsConfigParameterizedTest, UdpSinkDefaultPrefix) {
   auto udp_sink = dynamic_cast<Common::Statsd::UdpStatsdSink*>(sink.get());
   ASSERT_NE(udp_sink, nullptr);
   EXPECT_EQ(udp_sink->getPrefix(), defaultPrefix);
+  EXPECT_EQ(udp_sink->getMaxBytesPerDatagramForTest(),
+            Common::Statsd::UdpStatsdSink::DEFAULT_MAX_BYTES_PER_DATAGRAM);
 }
 
 TEST_P(StatsConfigParameterizedTest, UdpSinkCustomPrefix) {
@@ -99,6 +101,7 @@ TEST_P(StatsConfigParameterizedTest, UdpSinkCustomPrefix) {
   socket_address.set_port_value(8125);
   sink_config.set_prefix(customPrefix);
   EXPECT_NE(sink_config.prefix(), "");
+  sink_config.mutable_max_bytes_per_datagram()->set_value(512);
 
   Server::Configuration::StatsSinkFactory* factory =
       Registry::FactoryRegistry<Server::Configuration::StatsSinkFactory>::getFactory(name);
@@ -113,6 +116,7 @@ TEST_P(StatsConfigParameterizedTest, UdpSinkCustomPrefix) {
   auto udp_sink = dynamic_cast<Common::Statsd::UdpStatsdSink*>(sink.get());
   ASSERT_NE(udp_sink, nullptr);
   EXPECT_EQ(udp_sink->getPrefix(), customPrefix);
+  EXPECT_EQ(udp_sink->getMaxBytesPerDatagramForTest(), 512);
 }
 
 TEST(StatsConfigTest, TcpSinkDefaultPrefix) {
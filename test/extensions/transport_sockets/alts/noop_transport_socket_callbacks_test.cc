@@ -1,3 +1,5 @@
+#include "common/buffer/buffer_impl.h"
+
 #include "extensions/transport_sockets/alts/noop_transport_socket_callbacks.h"
 
 #include "test/mocks/network/mocks.h"
@@ -20,6 +22,7 @@ public:
   bool shouldDrainReadBuffer() override { return false; }
   void setReadBufferReady() override { set_read_buffer_ready_ = true; }
   void raiseEvent(Network::ConnectionEvent) override { event_raised_ = true; }
+  Buffer::Instance& preReadData() override { return pre_read_data_; }
 
   bool event_raised() const { return event_raised_; }
   bool set_read_buffer_ready() const { return set_read_buffer_ready_; }
@@ -28,6 +31,7 @@ private:
   bool event_raised_{false};
   bool set_read_buffer_ready_{false};
   Network::Connection& connection_;
+  Buffer::OwnedImpl pre_read_data_;
 };
 
 class NoOpTransportSocketCallbacksTest : public testing::Test {
@@ -44,6 +48,7 @@ TEST_F(NoOpTransportSocketCallbacksTest, TestAllCallbacks) {
   EXPECT_EQ(wrapper_callbacks_.fd(), wrapped_callbacks_.fd());
   EXPECT_EQ(&connection_, &wrapped_callbacks_.connection());
   EXPECT_FALSE(wrapped_callbacks_.shouldDrainReadBuffer());
+  EXPECT_EQ(&wrapper_callbacks_.preReadData(), &wrapped_callbacks_.preReadData());
 
   wrapped_callbacks_.setReadBufferReady();
   EXPECT_FALSE(wrapper_callbacks_.set_read_buffer_ready());
@@ -193,10 +193,10 @@ do
     --max-obj-name-len 1234 2>&1)
   check [ "${ADMIN_HOT_RESTART_VERSION}" != "${CLI_HOT_RESTART_VERSION}" ]
 
-  start_test Checking for hot-start-version mismatch when max-stats differs
+  start_test Checking for hot-start-version match when max-stats differs
   CLI_HOT_RESTART_VERSION=$("${ENVOY_BIN}" --hot-restart-version --base-id "${BASE_ID}" \
     --max-stats 12345 2>&1)
-  check [ "${ADMIN_HOT_RESTART_VERSION}" != "${CLI_HOT_RESTART_VERSION}" ]
+  check [ "${ADMIN_HOT_RESTART_VERSION}" = "${CLI_HOT_RESTART_VERSION}" ]
 
   enableHeapCheck
 
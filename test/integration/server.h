@@ -85,6 +85,16 @@ public:
     return wrapped_scope_->gauge(name);
   }
 
+  Counter& lazyCounter(const std::string& name) override {
+    Thread::LockGuard lock(lock_);
+    return wrapped_scope_->lazyCounter(name);
+  }
+
+  Gauge& lazyGauge(const std::string& name) override {
+    Thread::LockGuard lock(lock_);
+    return wrapped_scope_->lazyGauge(name);
+  }
+
   Histogram& histogram(const std::string& name) override {
     Thread::LockGuard lock(lock_);
     return wrapped_scope_->histogram(name);
@@ -119,6 +129,14 @@ public:
     Thread::LockGuard lock(lock_);
     return store_.gauge(name);
   }
+  Counter& lazyCounter(const std::string& name) override {
+    Thread::LockGuard lock(lock_);
+    return store_.lazyCounter(name);
+  }
+  Gauge& lazyGauge(const std::string& name) override {
+    Thread::LockGuard lock(lock_);
+    return store_.lazyGauge(name);
+  }
   Histogram& histogram(const std::string& name) override {
     Thread::LockGuard lock(lock_);
     return store_.histogram(name);
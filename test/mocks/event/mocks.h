@@ -69,6 +69,11 @@ public:
     return Event::TimerPtr{createTimer_(cb)};
   }
 
+  // Coarse timers are created as regular timers, so that tests need not tell them apart.
+  Event::TimerPtr createCoarseTimer(Event::TimerCb cb) override {
+    return Event::TimerPtr{createTimer_(cb)};
+  }
+
   void deferredDelete(DeferredDeletablePtr&& to_delete) override {
     deferredDelete_(to_delete.get());
     if (to_delete) {
@@ -104,6 +109,9 @@ public:
   MOCK_METHOD1(createTimer_, Timer*(Event::TimerCb cb));
   MOCK_METHOD1(deferredDelete_, void(DeferredDeletable* to_delete));
   MOCK_METHOD0(exit, void());
+  MOCK_METHOD3(initializeStats, void(Stats::Scope& scope, const std::string& prefix,
+                                     std::chrono::milliseconds slow_callback_threshold));
+  MOCK_CONST_METHOD0(recentSlowCallbacks, std::vector<SlowCallback>());
   MOCK_METHOD2(listenForSignal_, SignalEvent*(int signal_num, SignalCb cb));
   MOCK_METHOD1(post, void(std::function<void()> callback));
   MOCK_METHOD1(run, void(RunType type));
@@ -6,6 +6,7 @@
 #include "envoy/server/listener_manager.h"
 
 #include "common/network/address_impl.h"
+#include "common/network/listener_filter_buffer_impl.h"
 #include "common/network/utility.h"
 
 #include "test/test_common/printers.h"
@@ -29,6 +30,7 @@ MockListenerConfig::MockListenerConfig() {
   ON_CALL(*this, socket()).WillByDefault(ReturnRef(socket_));
   ON_CALL(*this, listenerScope()).WillByDefault(ReturnRef(scope_));
   ON_CALL(*this, name()).WillByDefault(ReturnRef(name_));
+  ON_CALL(*this, connectionBalancer()).WillByDefault(ReturnRef(connection_balancer_));
 }
 MockListenerConfig::~MockListenerConfig() {}
 
@@ -164,7 +166,15 @@ MockDrainDecision::~MockDrainDecision() {}
 MockListenerFilter::MockListenerFilter() {}
 MockListenerFilter::~MockListenerFilter() {}
 
-MockListenerFilterCallbacks::MockListenerFilterCallbacks() {}
+MockListenerFilterCallbacks::MockListenerFilterCallbacks() {
+  // The buffer reads from the socket returned by socket(), so it is created on first use.
+  ON_CALL(*this, buffer()).WillByDefault(Invoke([this]() -> ListenerFilterBuffer& {
+    if (buffer_ == nullptr) {
+      buffer_ = std::make_unique<ListenerFilterBufferImpl>(socket());
+    }
+    return *buffer_;
+  }));
+}
 MockListenerFilterCallbacks::~MockListenerFilterCallbacks() {}
 
 MockListenerFilterManager::MockListenerFilterManager() {}
@@ -200,6 +210,7 @@ MockConnectionSocket::MockConnectionSocket()
       remote_address_(new Address::Ipv4Instance(80)) {
   ON_CALL(*this, localAddress()).WillByDefault(ReturnRef(local_address_));
   ON_CALL(*this, remoteAddress()).WillByDefault(ReturnRef(remote_address_));
+  ON_CALL(*this, preReadData()).WillByDefault(ReturnRef(pre_read_data_));
 }
 
 MockConnectionSocket::~MockConnectionSocket() {}
@@ -226,6 +237,7 @@ MockTransportSocketFactory::~MockTransportSocketFactory() {}
 
 MockTransportSocketCallbacks::MockTransportSocketCallbacks() {
   ON_CALL(*this, connection()).WillByDefault(ReturnRef(connection_));
+  ON_CALL(*this, preReadData()).WillByDefault(ReturnRef(pre_read_data_));
 }
 MockTransportSocketCallbacks::~MockTransportSocketCallbacks() {}
 
@@ -13,6 +13,8 @@
 #include "envoy/network/transport_socket.h"
 #include "envoy/stats/scope.h"
 
+#include "common/buffer/buffer_impl.h"
+#include "common/network/connection_balancer_impl.h"
 #include "common/stats/isolated_store_impl.h"
 
 #include "test/mocks/event/mocks.h"
@@ -263,7 +265,10 @@ public:
 
   MOCK_METHOD0(socket, ConnectionSocket&());
   MOCK_METHOD0(dispatcher, Event::Dispatcher&());
+  MOCK_METHOD0(buffer, ListenerFilterBuffer&());
   MOCK_METHOD1(continueFilterChain, void(bool));
+
+  std::unique_ptr<ListenerFilterBuffer> buffer_;
 };
 
 class MockListenerFilterManager : public ListenerFilterManager {
@@ -359,9 +364,11 @@ public:
   MOCK_CONST_METHOD0(options, const Network::ConnectionSocket::OptionsSharedPtr&());
   MOCK_CONST_METHOD0(fd, int());
   MOCK_METHOD0(close, void());
+  MOCK_METHOD0(preReadData, Buffer::Instance&());
 
   Address::InstanceConstSharedPtr local_address_;
   Address::InstanceConstSharedPtr remote_address_;
+  Buffer::OwnedImpl pre_read_data_;
 };
 
 class MockListenerConfig : public ListenerConfig {
@@ -380,11 +387,13 @@ public:
   MOCK_CONST_METHOD0(listenerTag, uint64_t());
   MOCK_CONST_METHOD0(name, const std::string&());
   MOCK_CONST_METHOD0(reverseWriteFilterOrder, bool());
+  MOCK_METHOD0(connectionBalancer, ConnectionBalancer&());
 
   testing::NiceMock<MockFilterChainFactory> filter_chain_factory_;
   testing::NiceMock<MockListenSocket> socket_;
   Stats::IsolatedStoreImpl scope_;
   std::string name_;
+  NopConnectionBalancerImpl connection_balancer_;
 };
 
 class MockListener : public Listener {
@@ -486,8 +495,10 @@ public:
   MOCK_METHOD0(shouldDrainReadBuffer, bool());
   MOCK_METHOD0(setReadBufferReady, void());
   MOCK_METHOD1(raiseEvent, void(ConnectionEvent));
+  MOCK_METHOD0(preReadData, Buffer::Instance&());
 
   testing::NiceMock<MockConnection> connection_;
+  Buffer::OwnedImpl pre_read_data_;
 };
 
 } // namespace Network
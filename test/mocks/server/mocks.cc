@@ -83,10 +83,10 @@ MockOverloadManager::~MockOverloadManager() {}
 
 MockListenerComponentFactory::MockListenerComponentFactory()
     : socket_(std::make_shared<NiceMock<Network::MockListenSocket>>()) {
-  ON_CALL(*this, createListenSocket(_, _, _))
+  ON_CALL(*this, createListenSocket(_, _, _, _))
       .WillByDefault(Invoke([&](Network::Address::InstanceConstSharedPtr,
-                                const Network::Socket::OptionsSharedPtr& options,
-                                bool) -> Network::SocketSharedPtr {
+                                const Network::Socket::OptionsSharedPtr& options, bool,
+                                uint32_t) -> Network::SocketSharedPtr {
         if (!Network::Socket::applyOptions(options, *socket_,
                                            envoy::api::v2::core::SocketOption::STATE_PREBIND)) {
           throw EnvoyException("MockListenerComponentFactory: Setting socket options failed");
@@ -28,6 +28,9 @@ public:
                                       const std::vector<std::string>& server_names));
   MOCK_CONST_METHOD0(daysUntilFirstCertExpires, size_t());
   MOCK_METHOD1(iterateContexts, void(std::function<void(const Context&)> callback));
+  MOCK_METHOD0(sessionTicketKeys, std::vector<ServerContextConfig::SessionTicketKey>());
+  MOCK_METHOD1(setSessionTicketKeys,
+               void(const std::vector<ServerContextConfig::SessionTicketKey>& keys));
 };
 
 class MockConnection : public Connection {
@@ -70,6 +70,12 @@ MockSink::~MockSink() {}
 
 MockStore::MockStore() {
   ON_CALL(*this, counter(_)).WillByDefault(ReturnRef(counter_));
+  ON_CALL(*this, lazyCounter(_)).WillByDefault(Invoke([this](const std::string& name) -> Counter& {
+    return counter(name);
+  }));
+  ON_CALL(*this, lazyGauge(_)).WillByDefault(Invoke([this](const std::string& name) -> Gauge& {
+    return gauge(name);
+  }));
   ON_CALL(*this, histogram(_)).WillByDefault(Invoke([this](const std::string& name) -> Histogram& {
     auto* histogram = new NiceMock<MockHistogram>;
     histogram->name_ = name;
@@ -25,6 +25,7 @@ public:
   MOCK_METHOD0(shutdownGlobalThreading, void());
   MOCK_METHOD0(shutdownThread, void());
   MOCK_METHOD0(dispatcher, Event::Dispatcher&());
+  MOCK_METHOD1(initializeStats, void(Stats::Scope& scope));
 
   SlotPtr allocateSlot_() { return SlotPtr{new SlotImpl(*this, current_slot_++)}; }
   void runOnAllThreads_(Event::PostCb cb) { cb(); }
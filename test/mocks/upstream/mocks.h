@@ -176,6 +176,8 @@ public:
 
   // Upstream::LoadBalancer
   MOCK_METHOD1(chooseHost, HostConstSharedPtr(LoadBalancerContext* context));
+  MOCK_METHOD3(onHostResponse, void(const HostDescription& host,
+                                    std::chrono::microseconds response_time, bool complete));
 
   std::shared_ptr<MockHost> host_{new MockHost()};
 };
@@ -2,6 +2,7 @@
 
 #include "common/common/utility.h"
 #include "common/network/address_impl.h"
+#include "common/network/connection_balancer_impl.h"
 #include "common/network/raw_buffer_socket.h"
 #include "common/network/utility.h"
 
@@ -35,10 +36,13 @@ public:
   public:
     TestListener(ConnectionHandlerTest& parent, uint64_t tag, bool bind_to_port,
                  bool hand_off_restored_destination_connections, const std::string& name,
-                 std::chrono::milliseconds listener_filters_timeout)
+                 std::chrono::milliseconds listener_filters_timeout,
+                 Network::ConnectionBalancer* connection_balancer)
         : parent_(parent), tag_(tag), bind_to_port_(bind_to_port),
           hand_off_restored_destination_connections_(hand_off_restored_destination_connections),
-          name_(name), listener_filters_timeout_(listener_filters_timeout) {}
+          name_(name), listener_filters_timeout_(listener_filters_timeout),
+          connection_balancer_(connection_balancer != nullptr ? *connection_balancer
+                                                              : nop_connection_balancer_) {}
 
     // Network::ListenerConfig
     Network::FilterChainManager& filterChainManager() override { return parent_.manager_; }
@@ -56,6 +60,7 @@ public:
     uint64_t listenerTag() const override { return tag_; }
     const std::string& name() const override { return name_; }
     bool reverseWriteFilterOrder() const override { return true; }
+    Network::ConnectionBalancer& connectionBalancer() override { return connection_balancer_; }
 
     ConnectionHandlerTest& parent_;
     Network::MockListenSocket socket_;
@@ -64,6 +69,8 @@ public:
     const bool hand_off_restored_destination_connections_;
     const std::string name_;
     const std::chrono::milliseconds listener_filters_timeout_;
+    Network::NopConnectionBalancerImpl nop_connection_balancer_;
+    Network::ConnectionBalancer& connection_balancer_;
   };
 
   typedef std::unique_ptr<TestListener> TestListenerPtr;
@@ -71,20 +78,22 @@ public:
   TestListener* addListener(
       uint64_t tag, bool bind_to_port, bool hand_off_restored_destination_connections,
       const std::string& name,
-      std::chrono::milliseconds listener_filters_timeout = std::chrono::milliseconds(15000)) {
+      std::chrono::milliseconds listener_filters_timeout = std::chrono::milliseconds(15000),
+      Network::ConnectionBalancer* connection_balancer = nullptr) {
     TestListener* listener =
         new TestListener(*this, tag, bind_to_port, hand_off_restored_destination_connections, name,
-                         listener_filters_timeout);
+                         listener_filters_timeout, connection_balancer);
     listener->moveIntoListBack(TestListenerPtr{listener}, listeners_);
     return listener;
   }
 
   Stats::IsolatedStoreImpl stats_store_;
   NiceMock<Event::MockDispatcher> dispatcher_;
-  Network::ConnectionHandlerPtr handler_;
   NiceMock<Network::MockFilterChainManager> manager_;
   NiceMock<Network::MockFilterChainFactory> factory_;
   std::list<TestListenerPtr> listeners_;
+  // Destroyed before the listener configs, which the active listeners reference.
+  Network::ConnectionHandlerPtr handler_;
   const Network::FilterChainSharedPtr filter_chain_;
 };
 
@@ -247,6 +256,73 @@ TEST_F(ConnectionHandlerTest, CloseConnectionOnEmptyFilterChain) {
   EXPECT_CALL(*listener, onDestroy());
 }
 
+// With the exact balancer, a connection accepted by a worker owning more connections than another
+// worker is handed to that worker.
+TEST_F(ConnectionHandlerTest, ExactBalancerRebalance) {
+  Network::ExactConnectionBalancerImpl connection_balancer;
+  TestListener* test_listener = addListener(1, true, false, "test_listener",
+                                            std::chrono::milliseconds(15000), &connection_balancer);
+
+  Network::MockListener* listener = new NiceMock<Network::MockListener>();
+  Network::ListenerCallbacks* listener_callbacks;
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _))
+      .WillOnce(Invoke(
+          [&](Network::Socket&, Network::ListenerCallbacks& cb, bool, bool) -> Network::Listener* {
+            listener_callbacks = &cb;
+            return listener;
+          }));
+  EXPECT_CALL(test_listener->socket_, localAddress()).Times(2);
+  handler_->addListener(*test_listener);
+
+  NiceMock<Event::MockDispatcher> worker_dispatcher;
+  auto worker_handler =
+      std::make_unique<ConnectionHandlerImpl>(ENVOY_LOGGER(), worker_dispatcher, 1);
+  Network::MockListener* worker_listener = new NiceMock<Network::MockListener>();
+  EXPECT_CALL(worker_dispatcher, createListener_(_, _, _, _)).WillOnce(Return(worker_listener));
+  worker_handler->addListener(*test_listener);
+
+  EXPECT_CALL(manager_, findFilterChain(_)).WillRepeatedly(Return(filter_chain_.get()));
+  EXPECT_CALL(factory_, createNetworkFilterChain(_, _)).WillRepeatedly(Return(true));
+
+  // Both handlers own no connections, so the first connection stays with the accepting handler.
+  Network::MockConnection* connection = new NiceMock<Network::MockConnection>();
+  EXPECT_CALL(dispatcher_, createServerConnection_(_, _)).WillOnce(Return(connection));
+  listener_callbacks->onAccept(
+      Network::ConnectionSocketPtr{new NiceMock<Network::MockConnectionSocket>()}, true);
+  EXPECT_EQ(1UL, handler_->numConnections());
+  EXPECT_EQ(0UL, stats_store_.counter("downstream_cx_rebalanced").value());
+
+  // The second connection is posted to the worker owning fewer connections.
+  Network::MockConnection* worker_connection = new NiceMock<Network::MockConnection>();
+  EXPECT_CALL(worker_dispatcher, post(_));
+  EXPECT_CALL(worker_dispatcher, createServerConnection_(_, _))
+      .WillOnce(Return(worker_connection));
+  listener_callbacks->onAccept(
+      Network::ConnectionSocketPtr{new NiceMock<Network::MockConnectionSocket>()}, true);
+  EXPECT_EQ(1UL, handler_->numConnections());
+  EXPECT_EQ(1UL, worker_handler->numConnections());
+  EXPECT_EQ(1UL, stats_store_.counter("downstream_cx_rebalanced").value());
+  EXPECT_EQ(2UL, stats_store_.counter("downstream_cx_total").value());
+  EXPECT_EQ(1UL, stats_store_.counter("main_thread.downstream_cx_total").value());
+  EXPECT_EQ(1UL, stats_store_.gauge("main_thread.downstream_cx_active").value());
+  EXPECT_EQ(1UL, stats_store_.counter("worker_1.downstream_cx_total").value());
+  EXPECT_EQ(1UL, stats_store_.gauge("worker_1.downstream_cx_active").value());
+
+  // A stopped listener is no longer picked.
+  EXPECT_CALL(*worker_listener, onDestroy());
+  worker_handler->stopListeners(1);
+  EXPECT_CALL(dispatcher_, createServerConnection_(_, _))
+      .WillOnce(Return(new NiceMock<Network::MockConnection>()));
+  listener_callbacks->onAccept(
+      Network::ConnectionSocketPtr{new NiceMock<Network::MockConnectionSocket>()}, true);
+  EXPECT_EQ(2UL, handler_->numConnections());
+  EXPECT_EQ(1UL, stats_store_.counter("downstream_cx_rebalanced").value());
+
+  worker_handler.reset();
+  EXPECT_CALL(*listener, onDestroy());
+  handler_.reset();
+}
+
 TEST_F(ConnectionHandlerTest, FindListenerByAddress) {
   TestListener* test_listener1 = addListener(1, true, true, "test_listener1");
   Network::Address::InstanceConstSharedPtr alt_address(
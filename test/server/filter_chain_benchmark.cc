@@ -0,0 +1,118 @@
+// Usage: bazel run //test/server:filter_chain_benchmark
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/common/fmt.h"
+#include "common/network/listen_socket_impl.h"
+#include "common/network/utility.h"
+
+#include "server/filter_chain_index.h"
+
+#include "testing/base/public/benchmark.h"
+
+namespace Envoy {
+namespace Server {
+namespace {
+
+class TestFilterChain : public Network::FilterChain {
+public:
+  // Network::FilterChain
+  const Network::TransportSocketFactory& transportSocketFactory() const override {
+    return *transport_socket_factory_;
+  }
+  const std::vector<Network::FilterFactoryCb>& networkFilterFactories() const override {
+    return filters_factory_;
+  }
+
+private:
+  const Network::TransportSocketFactoryPtr transport_socket_factory_;
+  const std::vector<Network::FilterFactoryCb> filters_factory_;
+};
+
+// Rules of a listener terminating TLS for many server names: one filter chain per server name,
+// every tenth one being a wildcard domain, and a catch-all filter chain.
+std::vector<FilterChainMatchRules> serverNameRules(uint32_t num_server_names) {
+  std::vector<FilterChainMatchRules> rules;
+  for (uint32_t i = 0; i < num_server_names; i++) {
+    FilterChainMatchRules rule;
+    rule.server_names_.push_back(i % 10 == 0 ? fmt::format("*.tenant{}.example.com", i)
+                                             : fmt::format("www.tenant{}.example.com", i));
+    rule.transport_protocol_ = "tls";
+    rule.application_protocols_ = {"h2", "http/1.1"};
+    rule.filter_chain_ = std::make_shared<TestFilterChain>();
+    rules.push_back(std::move(rule));
+  }
+  FilterChainMatchRules catch_all;
+  catch_all.filter_chain_ = std::make_shared<TestFilterChain>();
+  rules.push_back(std::move(catch_all));
+  return rules;
+}
+
+std::unique_ptr<Network::ConnectionSocket> tlsSocket(const std::string& server_name) {
+  auto socket = std::make_unique<Network::ConnectionSocketImpl>(
+      -1, Network::Utility::parseInternetAddress("10.0.0.1", 443),
+      Network::Utility::parseInternetAddress("192.0.2.1", 34567));
+  socket->setDetectedTransportProtocol("tls");
+  socket->setRequestedServerName(server_name);
+  socket->setRequestedApplicationProtocols({"h2", "http/1.1"});
+  return std::move(socket);
+}
+
+void BM_FilterChainIndexBuild(benchmark::State& state) {
+  const std::vector<FilterChainMatchRules> rules = serverNameRules(state.range(0));
+  for (auto _ : state) {
+    FilterChainIndex index(rules);
+    benchmark::DoNotOptimize(index);
+  }
+}
+BENCHMARK(BM_FilterChainIndexBuild)->Arg(100)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+void lookup(benchmark::State& state, const std::vector<std::string>& server_names) {
+  const FilterChainIndex index(serverNameRules(state.range(0)));
+  std::vector<std::unique_ptr<Network::ConnectionSocket>> sockets;
+  for (const std::string& server_name : server_names) {
+    sockets.push_back(tlsSocket(server_name));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(index.findFilterChain(*sockets[i++ % sockets.size()]));
+  }
+}
+
+void BM_FilterChainIndexLookupExact(benchmark::State& state) {
+  std::vector<std::string> server_names;
+  for (uint32_t i = 1; i < 100; i += 3) {
+    server_names.push_back(fmt::format("www.tenant{}.example.com", i));
+  }
+  lookup(state, server_names);
+}
+BENCHMARK(BM_FilterChainIndexLookupExact)->Arg(100)->Arg(10000);
+
+void BM_FilterChainIndexLookupWildcard(benchmark::State& state) {
+  std::vector<std::string> server_names;
+  for (uint32_t i = 0; i < 100; i += 10) {
+    server_names.push_back(fmt::format("api.eu.tenant{}.example.com", i));
+  }
+  lookup(state, server_names);
+}
+BENCHMARK(BM_FilterChainIndexLookupWildcard)->Arg(100)->Arg(10000);
+
+void BM_FilterChainIndexLookupCatchAll(benchmark::State& state) {
+  lookup(state, {"www.example.org", "unknown.example.com", ""});
+}
+BENCHMARK(BM_FilterChainIndexLookupCatchAll)->Arg(100)->Arg(10000);
+
+} // namespace
+} // namespace Server
+} // namespace Envoy
+
+// Boilerplate main(), which discovers benchmarks in the same file and runs them.
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,231 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/network/address_impl.h"
+#include "common/network/listen_socket_impl.h"
+#include "common/network/utility.h"
+
+#include "server/filter_chain_index.h"
+
+#include "test/mocks/network/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Server {
+namespace {
+
+class FilterChainIndexTest : public testing::Test {
+public:
+  // Add a filter chain with the given rules, and return it.
+  const Network::FilterChain* addRule(FilterChainMatchRules rule) {
+    rule.filter_chain_ = std::make_shared<NiceMock<Network::MockFilterChain>>();
+    rules_.push_back(rule);
+    return rule.filter_chain_.get();
+  }
+
+  const Network::FilterChain* addServerNames(const std::vector<std::string>& server_names) {
+    FilterChainMatchRules rule;
+    rule.server_names_ = server_names;
+    return addRule(rule);
+  }
+
+  const Network::FilterChain* find(const std::string& server_name,
+                                   const std::string& local_address = "10.0.0.1",
+                                   uint32_t local_port = 443) {
+    socket_ = std::make_unique<Network::ConnectionSocketImpl>(
+        -1, Network::Utility::parseInternetAddress(local_address, local_port),
+        Network::Utility::parseInternetAddress("192.0.2.1", 34567));
+    socket_->setRequestedServerName(server_name);
+    return findSocket();
+  }
+
+  const Network::FilterChain* findSocket() {
+    if (index_ == nullptr) {
+      index_ = std::make_unique<FilterChainIndex>(rules_);
+    }
+    return index_->findFilterChain(*socket_);
+  }
+
+  std::vector<FilterChainMatchRules> rules_;
+  std::unique_ptr<FilterChainIndex> index_;
+  std::unique_ptr<Network::ConnectionSocketImpl> socket_;
+};
+
+TEST_F(FilterChainIndexTest, Empty) { EXPECT_EQ(nullptr, find("www.example.com")); }
+
+// The exact server name wins over the wildcard domains, and the longest wildcard domain wins over
+// the shorter ones.
+TEST_F(FilterChainIndexTest, ServerNames) {
+  const Network::FilterChain* exact = addServerNames({"www.example.com", "example.org"});
+  const Network::FilterChain* wildcard = addServerNames({"*.example.com"});
+  const Network::FilterChain* top_level_wildcard = addServerNames({"*.com"});
+
+  EXPECT_EQ(exact, find("www.example.com"));
+  EXPECT_EQ(exact, find("example.org"));
+  EXPECT_EQ(wildcard, find("api.example.com"));
+  EXPECT_EQ(wildcard, find("www.api.example.com"));
+  // Wildcard domains do not match the domain itself.
+  EXPECT_EQ(top_level_wildcard, find("example.com"));
+  EXPECT_EQ(top_level_wildcard, find("example-com.com"));
+  EXPECT_EQ(nullptr, find("www.example.org"));
+  EXPECT_EQ(nullptr, find("com"));
+  EXPECT_EQ(nullptr, find(""));
+}
+
+TEST_F(FilterChainIndexTest, ServerNamesCatchAll) {
+  const Network::FilterChain* exact = addServerNames({"www.example.com"});
+  const Network::FilterChain* catch_all = addRule(FilterChainMatchRules());
+
+  EXPECT_EQ(exact, find("www.example.com"));
+  EXPECT_EQ(catch_all, find("api.example.com"));
+  EXPECT_EQ(catch_all, find(""));
+}
+
+// Fully qualified server names, with a trailing dot, match as the names without it.
+TEST_F(FilterChainIndexTest, ServerNamesTrailingDot) {
+  const Network::FilterChain* exact = addServerNames({"www.example.com"});
+  const Network::FilterChain* wildcard = addServerNames({"*.com"});
+  const Network::FilterChain* qualified = addServerNames({"www.example.org."});
+  const Network::FilterChain* catch_all = addRule(FilterChainMatchRules());
+
+  EXPECT_EQ(exact, find("www.example.com."));
+  EXPECT_EQ(wildcard, find("example.com."));
+  EXPECT_EQ(qualified, find("www.example.org"));
+  EXPECT_EQ(qualified, find("www.example.org."));
+  EXPECT_EQ(catch_all, find("."));
+}
+
+// The destination port of the socket wins over port 0, which stands for any port.
+TEST_F(FilterChainIndexTest, DestinationPorts) {
+  FilterChainMatchRules rule;
+  rule.destination_port_ = 443;
+  const Network::FilterChain* https = addRule(rule);
+  rule.destination_port_ = 8443;
+  const Network::FilterChain* alternate = addRule(rule);
+
+  EXPECT_EQ(https, find("", "10.0.0.1", 443));
+  EXPECT_EQ(alternate, find("", "10.0.0.1", 8443));
+  EXPECT_EQ(nullptr, find("", "10.0.0.1", 80));
+
+  index_.reset();
+  const Network::FilterChain* any = addRule(FilterChainMatchRules());
+  EXPECT_EQ(https, find("", "10.0.0.1", 443));
+  EXPECT_EQ(any, find("", "10.0.0.1", 80));
+}
+
+// The most specific CIDR range of the destination IP wins.
+TEST_F(FilterChainIndexTest, DestinationIPs) {
+  FilterChainMatchRules rule;
+  rule.destination_ips_ = {"10.0.0.0/8"};
+  const Network::FilterChain* wide = addRule(rule);
+  rule.destination_ips_ = {"10.0.0.1/32", "10.0.0.2/32"};
+  const Network::FilterChain* narrow = addRule(rule);
+
+  EXPECT_EQ(narrow, find("", "10.0.0.1"));
+  EXPECT_EQ(narrow, find("", "10.0.0.2"));
+  EXPECT_EQ(wide, find("", "10.0.0.3"));
+  EXPECT_EQ(nullptr, find("", "192.168.0.1"));
+
+  index_.reset();
+  const Network::FilterChain* any = addRule(FilterChainMatchRules());
+  EXPECT_EQ(wide, find("", "10.0.0.3"));
+  EXPECT_EQ(any, find("", "192.168.0.1"));
+}
+
+// Sockets which are not bound to an IP address only match filter chains without IP requirements.
+TEST_F(FilterChainIndexTest, PipeAddress) {
+  FilterChainMatchRules rule;
+  rule.destination_ips_ = {"10.0.0.0/8"};
+  addRule(rule);
+  socket_ = std::make_unique<Network::ConnectionSocketImpl>(
+      -1, std::make_shared<Network::Address::PipeInstance>("/tmp/pipe"),
+      std::make_shared<Network::Address::PipeInstance>("/tmp/pipe"));
+  EXPECT_EQ(nullptr, findSocket());
+
+  index_.reset();
+  const Network::FilterChain* any = addRule(FilterChainMatchRules());
+  EXPECT_EQ(any, findSocket());
+}
+
+// Server names are matched before the transport and application protocols: the filter chains of
+// a less specific server name are not considered once a server name matched.
+TEST_F(FilterChainIndexTest, ServerNamesBeforeProtocols) {
+  FilterChainMatchRules rule;
+  rule.server_names_ = {"www.example.com"};
+  rule.transport_protocol_ = "tls";
+  addRule(rule);
+  addRule(FilterChainMatchRules());
+
+  EXPECT_EQ(nullptr, find("www.example.com"));
+}
+
+// The exact transport protocol wins over the filter chains without transport protocol.
+TEST_F(FilterChainIndexTest, TransportProtocols) {
+  FilterChainMatchRules rule;
+  rule.transport_protocol_ = "tls";
+  const Network::FilterChain* tls = addRule(rule);
+
+  find("");
+  socket_->setDetectedTransportProtocol("tls");
+  EXPECT_EQ(tls, findSocket());
+  socket_->setDetectedTransportProtocol("raw_buffer");
+  EXPECT_EQ(nullptr, findSocket());
+
+  index_.reset();
+  const Network::FilterChain* any = addRule(FilterChainMatchRules());
+  socket_->setDetectedTransportProtocol("tls");
+  EXPECT_EQ(tls, findSocket());
+  socket_->setDetectedTransportProtocol("raw_buffer");
+  EXPECT_EQ(any, findSocket());
+}
+
+// The first requested application protocol which a filter chain matches wins over the following
+// ones, and over the filter chains without application protocols.
+TEST_F(FilterChainIndexTest, ApplicationProtocols) {
+  FilterChainMatchRules rule;
+  rule.application_protocols_ = {"h2"};
+  const Network::FilterChain* h2 = addRule(rule);
+  rule.application_protocols_ = {"http/1.1", "http/1.0"};
+  const Network::FilterChain* http1 = addRule(rule);
+  const Network::FilterChain* any = addRule(FilterChainMatchRules());
+
+  find("");
+  socket_->setRequestedApplicationProtocols({"h2", "http/1.1"});
+  EXPECT_EQ(h2, findSocket());
+  socket_->setRequestedApplicationProtocols({"http/1.0", "h2"});
+  EXPECT_EQ(http1, findSocket());
+  socket_->setRequestedApplicationProtocols({"spdy/3"});
+  EXPECT_EQ(any, findSocket());
+  socket_->setRequestedApplicationProtocols({});
+  EXPECT_EQ(any, findSocket());
+}
+
+// Local and external source types win over any source type.
+TEST_F(FilterChainIndexTest, SourceTypes) {
+  FilterChainMatchRules rule;
+  rule.source_type_ = envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
+      FilterChainMatch_ConnectionSourceType_LOCAL;
+  const Network::FilterChain* local = addRule(rule);
+  const Network::FilterChain* any = addRule(FilterChainMatchRules());
+
+  socket_ = std::make_unique<Network::ConnectionSocketImpl>(
+      -1, Network::Utility::parseInternetAddress("127.0.0.1", 443),
+      Network::Utility::parseInternetAddress("127.0.0.1", 34567));
+  EXPECT_EQ(local, findSocket());
+  EXPECT_EQ(any, find("", "127.0.0.1"));
+
+  index_.reset();
+  rule.source_type_ = envoy::api::v2::listener::FilterChainMatch_ConnectionSourceType::
+      FilterChainMatch_ConnectionSourceType_EXTERNAL;
+  const Network::FilterChain* external = addRule(rule);
+  EXPECT_EQ(external, find("", "127.0.0.1"));
+}
+
+} // namespace
+} // namespace Server
+} // namespace Envoy
@@ -1,4 +1,7 @@
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "common/api/os_sys_calls_impl.h"
 #include "common/common/hex.h"
@@ -27,15 +30,30 @@ namespace Server {
 class HotRestartImplTest : public testing::Test {
 public:
   void setup() {
-    EXPECT_CALL(os_sys_calls_, shmUnlink(_));
-    EXPECT_CALL(os_sys_calls_, shmOpen(_, _, _));
-    EXPECT_CALL(os_sys_calls_, ftruncate(_, _)).WillOnce(WithArg<1>(Invoke([this](off_t size) {
-      buffer_.resize(size);
+    // Shared memory objects are emulated by name, so that the segments created by one
+    // HotRestartImpl are found by the next one.
+    EXPECT_CALL(os_sys_calls_, shmUnlink(_)).WillRepeatedly(Invoke([this](const char* name) {
+      return shm_objects_.erase(name) > 0 ? Api::SysCallIntResult{0, 0}
+                                          : Api::SysCallIntResult{-1, ENOENT};
+    }));
+    EXPECT_CALL(os_sys_calls_, shmOpen(_, _, _))
+        .WillRepeatedly(Invoke([this](const char* name, int oflag, mode_t) {
+          if (!(oflag & O_CREAT) && shm_objects_.count(name) == 0) {
+            return Api::SysCallIntResult{-1, ENOENT};
+          }
+          shm_objects_[name];
+          shm_fds_.push_back(name);
+          return Api::SysCallIntResult{static_cast<int>(shm_fds_.size() - 1), 0};
+        }));
+    EXPECT_CALL(os_sys_calls_, ftruncate(_, _)).WillRepeatedly(Invoke([this](int fd, off_t size) {
+      shm_objects_[shm_fds_[fd]].resize(size);
       return Api::SysCallIntResult{0, 0};
-    })));
-    EXPECT_CALL(os_sys_calls_, mmap(_, _, _, _, _, _)).WillOnce(InvokeWithoutArgs([this]() {
-      return Api::SysCallPtrResult{buffer_.data(), 0};
     }));
+    EXPECT_CALL(os_sys_calls_, mmap(_, _, _, _, _, _))
+        .WillRepeatedly(WithArg<4>(Invoke([this](int fd) {
+          return Api::SysCallPtrResult{shm_objects_[shm_fds_[fd]].data(), 0};
+        })));
+    EXPECT_CALL(os_sys_calls_, close(_)).WillRepeatedly(Return(Api::SysCallIntResult{0, 0}));
     EXPECT_CALL(os_sys_calls_, bind(_, _, _));
     EXPECT_CALL(options_, statsOptions()).WillRepeatedly(ReturnRef(stats_options_));
 
@@ -48,7 +66,8 @@ public:
   TestThreadsafeSingletonInjector<Api::OsSysCallsImpl> os_calls{&os_sys_calls_};
   NiceMock<MockOptions> options_;
   Stats::StatsOptionsImpl stats_options_;
-  std::vector<uint8_t> buffer_;
+  std::map<std::string, std::vector<uint8_t>> shm_objects_;
+  std::vector<std::string> shm_fds_;
   std::unique_ptr<HotRestartImpl> hot_restart_;
 };
 
@@ -78,7 +97,7 @@ TEST_F(HotRestartImplTest, versionString) {
   {
     ON_CALL(options_, maxStats()).WillByDefault(Return(2 * max_stats));
     setup();
-    EXPECT_NE(version, hot_restart_->version()) << "Version changes when max-stats change";
+    EXPECT_EQ(version, hot_restart_->version()) << "Version doesn't depend on max-stats";
     TearDown();
   }
 
@@ -126,9 +145,6 @@ TEST_F(HotRestartImplTest, crossAlloc) {
   stat4 = nullptr;
 
   EXPECT_CALL(options_, restartEpoch()).WillRepeatedly(Return(1));
-  EXPECT_CALL(os_sys_calls_, shmOpen(_, _, _));
-  EXPECT_CALL(os_sys_calls_, mmap(_, _, _, _, _, _))
-      .WillOnce(Return(Api::SysCallPtrResult{buffer_.data(), 0}));
   EXPECT_CALL(os_sys_calls_, bind(_, _, _));
   HotRestartImpl hot_restart2(options_);
   Stats::RawStatData* stat1_prime = hot_restart2.statsAllocator().alloc("stat1");
@@ -139,6 +155,48 @@ TEST_F(HotRestartImplTest, crossAlloc) {
   EXPECT_EQ(stat5, stat5_prime);
 }
 
+// Stats segments mapped by a process are found by the next one, and by the parent when mapped by
+// the child.
+TEST_F(HotRestartImplTest, crossAllocSegments) {
+  setup();
+
+  std::vector<Stats::RawStatData*> stats;
+  while (hot_restart_->statsAllocator().numSegments() < 2) {
+    stats.push_back(hot_restart_->statsAllocator().alloc(fmt::format("stat{}", stats.size())));
+  }
+  EXPECT_EQ(1, shm_objects_.count(SharedMemory::statsSegmentName(options_.baseId(), 1)));
+
+  EXPECT_CALL(options_, restartEpoch()).WillRepeatedly(Return(1));
+  EXPECT_CALL(os_sys_calls_, bind(_, _, _));
+  HotRestartImpl hot_restart2(options_);
+  for (uint64_t i = 0; i < stats.size(); ++i) {
+    EXPECT_EQ(stats[i], hot_restart2.statsAllocator().alloc(fmt::format("stat{}", i)));
+  }
+
+  std::vector<Stats::RawStatData*> child_stats;
+  while (hot_restart2.statsAllocator().numSegments() < 3) {
+    child_stats.push_back(
+        hot_restart2.statsAllocator().alloc(fmt::format("child{}", child_stats.size())));
+  }
+  for (uint64_t i = 0; i < child_stats.size(); ++i) {
+    EXPECT_EQ(child_stats[i], hot_restart_->statsAllocator().alloc(fmt::format("child{}", i)));
+  }
+}
+
+// A new first process removes the stats segments of the previous one.
+TEST_F(HotRestartImplTest, unlinkStaleSegments) {
+  setup();
+  while (hot_restart_->statsAllocator().numSegments() < 2) {
+    hot_restart_->statsAllocator().alloc(
+        fmt::format("stat{}", hot_restart_->statsAllocator().numStats()));
+  }
+  EXPECT_EQ(3, shm_objects_.size());
+
+  setup();
+  EXPECT_EQ(1, shm_objects_.size());
+  EXPECT_EQ(0, hot_restart_->statsAllocator().numSegments());
+}
+
 TEST_F(HotRestartImplTest, allocFail) {
   EXPECT_CALL(options_, maxStats()).WillRepeatedly(Return(2));
   setup();
@@ -845,6 +845,43 @@ TEST_P(AdminInstanceTest, Memory) {
                     Property(&envoy::admin::v2alpha::Memory::total_thread_cache, Ge(0))));
 }
 
+TEST_P(AdminInstanceTest, Dispatchers) {
+  Http::HeaderMapImpl header_map;
+  Buffer::OwnedImpl response;
+
+  Event::SlowCallback slow_callback{"timer", "Envoy::Foo::onTimeout()",
+                                    std::chrono::microseconds(75000),
+                                    SystemTime(std::chrono::seconds(1000))};
+  EXPECT_CALL(server_.dispatcher_, recentSlowCallbacks())
+      .WillOnce(Return(std::vector<Event::SlowCallback>{slow_callback}));
+  NiceMock<Event::MockDispatcher> worker_dispatcher;
+  EXPECT_CALL(server_.listener_manager_, workerDispatchers())
+      .WillOnce(Return(std::vector<std::reference_wrapper<Event::Dispatcher>>{worker_dispatcher}));
+
+  EXPECT_EQ(Http::Code::OK, getCallback("/dispatchers", header_map, response));
+  const std::string expected_json = R"EOF({
+ "dispatchers": [
+  {
+   "name": "main_thread",
+   "slow_callbacks": [
+    {
+     "kind": "timer",
+     "callback": "Envoy::Foo::onTimeout()",
+     "duration": "0.075s",
+     "time": "1970-01-01T00:16:40Z"
+    }
+   ]
+  },
+  {
+   "name": "worker_0",
+   "slow_callbacks": []
+  }
+ ]
+}
+)EOF";
+  EXPECT_EQ(expected_json, response.toString());
+}
+
 TEST_P(AdminInstanceTest, ContextThatReturnsNullCertDetails) {
   Http::HeaderMapImpl header_map;
   Buffer::OwnedImpl response;
@@ -44,7 +44,8 @@ public:
                      Event::DispatcherPtr{dispatcher_},
                      Network::ConnectionHandlerPtr{handler_},
                      overload_manager_,
-                     *api_};
+                     *api_,
+                     nullptr};
   Event::TimerPtr no_exit_timer_ = dispatcher_->createTimer([]() -> void {});
 };
 
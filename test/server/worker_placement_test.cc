@@ -0,0 +1,155 @@
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/fmt.h"
+#include "common/common/thread.h"
+#include "common/stats/isolated_store_impl.h"
+
+#include "server/worker_placement.h"
+
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Server {
+
+WorkerPlacement::Topology twoNodeTopology() {
+  WorkerPlacement::Topology topology;
+  for (uint32_t cpu = 0; cpu < 8; ++cpu) {
+    topology.allowed_cpus_.insert(cpu);
+    topology.cpu_nodes_[cpu] = cpu / 4;
+  }
+  return topology;
+}
+
+envoy::config::bootstrap::v2::WorkerPlacement placementConfig(const std::string& cpus) {
+  envoy::config::bootstrap::v2::WorkerPlacement config;
+  config.set_cpus(cpus);
+  return config;
+}
+
+TEST(WorkerPlacementTest, ParseCpuList) {
+  EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3, 8, 10, 11}),
+            WorkerPlacement::parseCpuList("0-3,8,10-11"));
+  // Lists read from sysfs end with a new line, and are not required to be sorted.
+  EXPECT_EQ(std::vector<uint32_t>({1, 2}), WorkerPlacement::parseCpuList("2,1,1-2\n"));
+  EXPECT_EQ(std::vector<uint32_t>({1023}), WorkerPlacement::parseCpuList("1023"));
+  EXPECT_TRUE(WorkerPlacement::parseCpuList("").empty());
+  EXPECT_TRUE(WorkerPlacement::parseCpuList("\n").empty());
+
+  for (const std::string& list : {"a", "1,b", "3-1", "1-", "-1", "1-2-3", "1024", "0-1024"}) {
+    EXPECT_THROW_WITH_MESSAGE(WorkerPlacement::parseCpuList(list), EnvoyException,
+                              fmt::format("invalid CPU list '{}'", list));
+  }
+}
+
+TEST(WorkerPlacementTest, InvalidConfig) {
+  EXPECT_THROW_WITH_MESSAGE(WorkerPlacement(placementConfig(" "), twoNodeTopology()),
+                            EnvoyException, "worker_placement: no CPU in ' '");
+  EXPECT_THROW_WITH_MESSAGE(WorkerPlacement(placementConfig("6-9"), twoNodeTopology()),
+                            EnvoyException,
+                            "worker_placement: CPU 8 is not one the process may run on");
+}
+
+// Workers are pinned to the CPUs of the list in turn.
+TEST(WorkerPlacementTest, WorkerCpus) {
+  envoy::config::bootstrap::v2::WorkerPlacement config = placementConfig("1,5-6");
+  WorkerPlacement placement(config, twoNodeTopology());
+  EXPECT_EQ(std::vector<uint32_t>({1}), placement.workerCpus(0));
+  EXPECT_EQ(std::vector<uint32_t>({5}), placement.workerCpus(1));
+  EXPECT_EQ(std::vector<uint32_t>({6}), placement.workerCpus(2));
+  EXPECT_EQ(std::vector<uint32_t>({1}), placement.workerCpus(3));
+  EXPECT_FALSE(placement.workerIncomingCpu(0).has_value());
+  EXPECT_EQ(0, placement.workerNumaNode(0));
+  EXPECT_EQ(1, placement.workerNumaNode(1));
+
+  config.set_incoming_cpu(true);
+  WorkerPlacement incoming_placement(config, twoNodeTopology());
+  EXPECT_EQ(1, incoming_placement.workerIncomingCpu(0).value());
+  EXPECT_EQ(6, incoming_placement.workerIncomingCpu(2).value());
+  EXPECT_EQ(1, incoming_placement.workerIncomingCpu(3).value());
+}
+
+// With NUMA node affinity, workers are pinned to the CPUs of the list on the node of their CPU.
+TEST(WorkerPlacementTest, NumaNodeAffinity) {
+  envoy::config::bootstrap::v2::WorkerPlacement config = placementConfig("1-2,5,8");
+  config.set_numa_node_affinity(true);
+  config.set_incoming_cpu(true);
+  WorkerPlacement::Topology topology = twoNodeTopology();
+  // CPUs of no known node are on node 0.
+  topology.allowed_cpus_.insert(8);
+  WorkerPlacement placement(config, topology);
+  EXPECT_EQ(std::vector<uint32_t>({1, 2, 8}), placement.workerCpus(0));
+  EXPECT_EQ(std::vector<uint32_t>({1, 2, 8}), placement.workerCpus(1));
+  EXPECT_EQ(std::vector<uint32_t>({5}), placement.workerCpus(2));
+  EXPECT_EQ(std::vector<uint32_t>({1, 2, 8}), placement.workerCpus(3));
+  // The incoming CPU of a worker is still its own CPU.
+  EXPECT_EQ(2, placement.workerIncomingCpu(1).value());
+  EXPECT_EQ(0, placement.workerNumaNode(3));
+  EXPECT_EQ(1, placement.workerNumaNode(2));
+}
+
+// A worker pinned to a CPU of the host runs there, which its stats report.
+TEST(WorkerPlacementTest, PinCurrentThread) {
+  const WorkerPlacement::Topology topology = WorkerPlacement::hostTopology();
+  ASSERT_FALSE(topology.allowed_cpus_.empty());
+  const uint32_t cpu = *topology.allowed_cpus_.rbegin();
+  WorkerPlacement placement(placementConfig(std::to_string(cpu)), topology);
+
+  Stats::IsolatedStoreImpl store;
+  WorkerAffinityPtr affinity = placement.createWorkerAffinity(1, store);
+  EXPECT_EQ(std::vector<uint32_t>({cpu}), affinity->cpus());
+  EXPECT_FALSE(affinity->incomingCpu().has_value());
+
+  Thread::ThreadFactoryImpl thread_factory;
+  Thread::ThreadPtr thread = thread_factory.createThread([&affinity]() {
+    affinity->pinCurrentThread();
+    affinity->recordPlacement();
+    affinity->recordPlacement();
+  });
+  thread->join();
+  EXPECT_EQ(cpu, store.gauge("worker_1.placement.cpu").value());
+  EXPECT_EQ(0, store.counter("worker_1.placement.numa_node_changes").value());
+}
+
+#ifdef __linux__
+int currentMemoryPolicy() {
+  int mode = -1;
+  std::array<unsigned long, ScopedNumaMemoryPolicy::MaxNumaNodes / 64> nodes{};
+  EXPECT_EQ(0, syscall(SYS_get_mempolicy, &mode, nodes.data(),
+                       ScopedNumaMemoryPolicy::MaxNumaNodes + 1, nullptr, 0));
+  return mode;
+}
+
+// The memory of the node is preferred within the scope, and the previous policy restored after it.
+// Hosts without NUMA support only check that the policy is left alone.
+TEST(WorkerPlacementTest, ScopedNumaMemoryPolicy) {
+  Thread::ThreadFactoryImpl thread_factory;
+  Thread::ThreadPtr thread = thread_factory.createThread([]() {
+    const int previous_mode = currentMemoryPolicy();
+    {
+      ScopedNumaMemoryPolicy memory_policy(absl::nullopt);
+      EXPECT_FALSE(memory_policy.active());
+    }
+    {
+      ScopedNumaMemoryPolicy memory_policy(0);
+      EXPECT_EQ(memory_policy.active() ? MPOL_PREFERRED : previous_mode, currentMemoryPolicy());
+    }
+    EXPECT_EQ(previous_mode, currentMemoryPolicy());
+  });
+  thread->join();
+}
+#endif
+
+} // namespace Server
+} // namespace Envoy